@@ -6,6 +6,12 @@ IMAGE_NAME="gopher64-tg5050-builder"
 GOPHER64_REPO_URL="https://github.com/gopher64/gopher64.git"
 FORCE_BUILD="${FORCE_BUILD:-0}"
 UPDATE_MIRROR="${UPDATE_MIRROR:-0}"
+# Profile-guided optimization: none | generate | use
+PGO_MODE="${PGO_MODE:-none}"
+# Process-wide allocator: system | mimalloc | jemalloc
+ALLOCATOR="${ALLOCATOR:-system}"
+# Keep frame pointers in Rust and C++ code (full stall watchdog stacks)
+FRAME_POINTERS="${FRAME_POINTERS:-0}"
 
 # Pinned gopher64 version — tested with our DRM display patches
 GOPHER64_COMMIT="efbeaeab888c25c752d1531149d20cdcbe50c7be"
@@ -18,6 +24,8 @@ CARGO_HOME_CACHE="$CACHE_ROOT/cargo/home"
 CARGO_TARGET_CACHE="$CACHE_ROOT/cargo/target"
 OUTPUT_DIR="$SCRIPT_DIR/bin/tg5050"
 OUTPUT_BIN="$OUTPUT_DIR/gopher64"
+PGO_PROFILE_DIR="$SCRIPT_DIR/pgo/profiles"
+PGO_CACHE_DIR="$CACHE_ROOT/pgo"
 
 GIT_MIRROR="$GIT_CACHE_DIR/gopher64.git"
 DOCKER_HASH_FILE="$STATE_DIR/docker-input.hash"
@@ -34,21 +42,67 @@ for arg in "$@"; do
 	--update-mirror)
 		UPDATE_MIRROR=1
 		;;
+	--pgo-generate)
+		PGO_MODE=generate
+		;;
+	--pgo-use)
+		PGO_MODE=use
+		;;
+	--allocator=*)
+		ALLOCATOR="${arg#--allocator=}"
+		;;
+	--frame-pointers)
+		FRAME_POINTERS=1
+		;;
 	--help|-h)
-		echo "Usage: ./build.sh [--force] [--update-mirror]"
+		echo "Usage: ./build.sh [--force] [--update-mirror] [--pgo-generate|--pgo-use] [--allocator=NAME] [--frame-pointers]"
 		echo "  --force    Ignore input-hash fast-path and run build pipeline."
 		echo "  --update-mirror  Refresh cached gopher64 git mirror from GitHub."
+		echo "  --pgo-generate   Build an instrumented binary for profile collection."
+		echo "                   Run it on device with the .g64-pgo-collect marker and copy"
+		echo "                   the resulting *.profraw files into pgo/profiles/."
+		echo "  --pgo-use        Merge pgo/profiles/* and build the optimized binary."
+		echo "  --allocator=NAME system (glibc, default), mimalloc or jemalloc. Replaces malloc"
+		echo "                   for the whole process; compare with tests/alloc_bench first."
+		echo "  --frame-pointers Keep frame pointers so .g64-stall-watchdog records whole stacks"
+		echo "                   (costs a register; measure before shipping such a build)."
 		exit 0
 		;;
 	*)
 		echo "Unknown argument: $arg" >&2
-		echo "Usage: ./build.sh [--force] [--update-mirror]" >&2
+		echo "Usage: ./build.sh [--force] [--update-mirror] [--pgo-generate|--pgo-use] [--allocator=NAME] [--frame-pointers]" >&2
 		exit 1
 		;;
 	esac
 done
 
 mkdir -p "$STATE_DIR" "$GIT_CACHE_DIR" "$SRC_CACHE_DIR" "$CARGO_HOME_CACHE" "$CARGO_TARGET_CACHE" "$OUTPUT_DIR"
+mkdir -p "$PGO_PROFILE_DIR" "$PGO_CACHE_DIR"
+
+case "$PGO_MODE" in
+none|generate)
+	;;
+use)
+	if ! find "$PGO_PROFILE_DIR" -maxdepth 1 -type f \( -name '*.profraw' -o -name '*.profdata' \) | grep -q .; then
+		echo "ERROR: --pgo-use needs *.profraw or *.profdata files in $PGO_PROFILE_DIR" >&2
+		echo "Collect them with a --pgo-generate build first." >&2
+		exit 1
+	fi
+	;;
+*)
+	echo "ERROR: unknown PGO_MODE '$PGO_MODE' (expected none, generate or use)" >&2
+	exit 1
+	;;
+esac
+
+case "$ALLOCATOR" in
+system|mimalloc|jemalloc)
+	;;
+*)
+	echo "ERROR: unknown allocator '$ALLOCATOR' (expected system, mimalloc or jemalloc)" >&2
+	exit 1
+	;;
+esac
 
 if command -v shasum >/dev/null 2>&1; then
 	HASH_CMD=(shasum -a 256)
@@ -84,6 +138,14 @@ compute_source_hash() {
 		while IFS= read -r file; do
 			echo "${file#$SCRIPT_DIR/} $(hash_file "$file")"
 		done < <(find "$SCRIPT_DIR/patches" -type f | sort)
+		echo "pgo_mode $PGO_MODE"
+		echo "allocator $ALLOCATOR"
+		echo "frame_pointers $FRAME_POINTERS"
+		if [ "$PGO_MODE" = "use" ]; then
+			while IFS= read -r file; do
+				echo "${file#$SCRIPT_DIR/} $(hash_file "$file")"
+			done < <(find "$PGO_PROFILE_DIR" -maxdepth 1 -type f | sort)
+		fi
 	} | hash_stdin
 }
 
@@ -126,8 +188,13 @@ docker run --rm -i \
 	-e GOPHER64_COMMIT="$GOPHER64_COMMIT" \
 	-e SOURCE_HASH="$SOURCE_HASH" \
 	-e UPDATE_MIRROR="$UPDATE_MIRROR" \
+	-e PGO_MODE="$PGO_MODE" \
+	-e ALLOCATOR="$ALLOCATOR" \
+	-e FRAME_POINTERS="$FRAME_POINTERS" \
 	-v "$OUTPUT_DIR:/output" \
 	-v "$SCRIPT_DIR/patches:/patches:ro" \
+	-v "$PGO_PROFILE_DIR:/pgo-profiles:ro" \
+	-v "$PGO_CACHE_DIR:/cache/pgo" \
 	-v "$GIT_MIRROR:/git-cache/gopher64.git:ro" \
 	-v "$SRC_CACHE_DIR:/cache/src" \
 	-v "$CARGO_HOME_CACHE:/cache/cargo-home" \
@@ -191,12 +258,67 @@ else
 	echo "--- Reusing cached patched source tree ---"
 fi
 
+# Profile-guided optimization. Rust always takes part; the clang-compiled
+# C++ (parallel-rdp + interface) only when clang and rustc share an LLVM
+# major version, because both write into the same profile and the indexed
+# profile format is version-specific.
+PGO_RUSTFLAGS=""
+if [ "${PGO_MODE}" != "none" ]; then
+	RUST_HOST="$(rustc -vV | sed -n 's/^host: //p')"
+	LLVM_PROFDATA="$(rustc --print sysroot)/lib/rustlib/${RUST_HOST}/bin/llvm-profdata"
+	RUSTC_LLVM_MAJOR="$(rustc -vV | sed -n 's/^LLVM version: \([0-9]*\).*/\1/p')"
+	CLANG_LLVM_MAJOR="$(clang --version | sed -n 's/.*clang version \([0-9]*\).*/\1/p' | head -n 1)"
+	PGO_CXX=0
+	if [ -n "$RUSTC_LLVM_MAJOR" ] && [ "$RUSTC_LLVM_MAJOR" = "$CLANG_LLVM_MAJOR" ]; then
+		PGO_CXX=1
+	else
+		echo "WARNING: rustc uses LLVM ${RUSTC_LLVM_MAJOR:-?} but clang is ${CLANG_LLVM_MAJOR:-?};" >&2
+		echo "WARNING: PGO covers Rust code only, C++ is built without profile feedback." >&2
+	fi
+
+	if [ "${PGO_MODE}" = "generate" ]; then
+		echo "--- PGO: building instrumented binary (C++ instrumented: ${PGO_CXX}) ---"
+		PGO_RUSTFLAGS='    "-C", "profile-generate=/tmp/gopher64-pgo",'
+		if [ "$PGO_CXX" = "1" ]; then
+			export CXXFLAGS_aarch64_unknown_linux_gnu="${CXXFLAGS_aarch64_unknown_linux_gnu} -fprofile-generate"
+		fi
+	else
+		echo "--- PGO: merging profiles ---"
+		if [ ! -x "$LLVM_PROFDATA" ]; then
+			echo "ERROR: llvm-profdata not found at $LLVM_PROFDATA (rustup component llvm-tools)" >&2
+			exit 1
+		fi
+		"$LLVM_PROFDATA" merge -o /cache/pgo/gopher64.profdata \
+			$(find /pgo-profiles -maxdepth 1 -type f \( -name '*.profraw' -o -name '*.profdata' \) | sort)
+		"$LLVM_PROFDATA" show /cache/pgo/gopher64.profdata | tail -n 4
+		echo "--- PGO: building optimized binary (C++ optimized: ${PGO_CXX}) ---"
+		PGO_RUSTFLAGS='    "-C", "profile-use=/cache/pgo/gopher64.profdata",'
+		if [ "$PGO_CXX" = "1" ]; then
+			export CXXFLAGS_aarch64_unknown_linux_gnu="${CXXFLAGS_aarch64_unknown_linux_gnu} -fprofile-use=/cache/pgo/gopher64.profdata -Wno-profile-instr-unprofiled -Wno-profile-instr-out-of-date"
+		fi
+	fi
+
+	# Separate target dirs keep the regular incremental cache intact.
+	export CARGO_TARGET_DIR="/cache/cargo-target/pgo-${PGO_MODE}"
+fi
+
+# The stall watchdog walks frame pointers; without them its stacks stop at
+# the first function that reused the register.
+FP_RUSTFLAGS=""
+if [ "${FRAME_POINTERS}" = "1" ]; then
+	echo "--- Keeping frame pointers ---"
+	FP_RUSTFLAGS='    "-C", "force-frame-pointers=yes",'
+	export CXXFLAGS_aarch64_unknown_linux_gnu="${CXXFLAGS_aarch64_unknown_linux_gnu} -fno-omit-frame-pointer"
+fi
+
 # Ensure cross-compilation config exists (cheap, deterministic).
 mkdir -p .cargo
 cat > .cargo/config.toml << CARGO_EOF
 [target.aarch64-unknown-linux-gnu]
 linker = "clang"
 rustflags = [
+${PGO_RUSTFLAGS}
+${FP_RUSTFLAGS}
     "-C", "target-cpu=cortex-a55",
     "-C", "link-arg=--target=aarch64-unknown-linux-gnu",
     "-C", "link-arg=--sysroot=/opt/aarch64-nextui-linux-gnu/aarch64-nextui-linux-gnu/libc",
@@ -218,5 +340,9 @@ CONTAINER_EOF
 
 printf '%s\n' "$BUILD_HASH" >"$BUILD_HASH_FILE"
 
+if [ "$PGO_MODE" = "generate" ]; then
+	echo "=== Instrumented binary: run games with the .g64-pgo-collect marker, then copy ==="
+	echo "=== \$USERDATA_PATH/<pak>/pgo/*.profraw into $PGO_PROFILE_DIR and run ./build.sh --pgo-use ==="
+fi
 echo "=== Binary available at $SCRIPT_DIR/bin/tg5050/gopher64 ==="
 echo "=== Deploy with: adb push $SCRIPT_DIR /mnt/SDCARD/Emus/tg5050/N64-gopher64.pak/ ==="
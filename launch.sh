@@ -35,12 +35,51 @@ get_cpu_mode() {
 	echo "$cpu_mode"
 }
 
+get_battery_saver() {
+	battery_saver="off"
+	if [ -f "$GAMESETTINGS_DIR/battery-saver" ]; then
+		battery_saver="$(cat "$GAMESETTINGS_DIR/battery-saver")"
+	fi
+	if [ -f "$GAMESETTINGS_DIR/battery-saver.tmp" ]; then
+		battery_saver="$(cat "$GAMESETTINGS_DIR/battery-saver.tmp")"
+	fi
+	echo "$battery_saver"
+}
+
+get_crt_effect() {
+	crt_effect="off"
+	if [ -f "$GAMESETTINGS_DIR/crt-effect" ]; then
+		crt_effect="$(cat "$GAMESETTINGS_DIR/crt-effect")"
+	fi
+	if [ -f "$GAMESETTINGS_DIR/crt-effect.tmp" ]; then
+		crt_effect="$(cat "$GAMESETTINGS_DIR/crt-effect.tmp")"
+	fi
+	echo "$crt_effect"
+}
+
+get_framebuffer_sync() {
+	framebuffer_sync="strict"
+	if [ -f "$GAMESETTINGS_DIR/framebuffer-sync" ]; then
+		framebuffer_sync="$(cat "$GAMESETTINGS_DIR/framebuffer-sync")"
+	fi
+	if [ -f "$GAMESETTINGS_DIR/framebuffer-sync.tmp" ]; then
+		framebuffer_sync="$(cat "$GAMESETTINGS_DIR/framebuffer-sync.tmp")"
+	fi
+	echo "$framebuffer_sync"
+}
+
 write_settings_json() {
 	cpu_mode="$(get_cpu_mode)"
+	battery_saver="$(get_battery_saver)"
+	crt_effect="$(get_crt_effect)"
+	framebuffer_sync="$(get_framebuffer_sync)"
 
 	jq -rM '{settings: .settings}' "$PAK_DIR/settings.json" >"$GAMESETTINGS_DIR/settings.json"
 
 	update_setting_key "$GAMESETTINGS_DIR/settings.json" "CPU Mode" "$cpu_mode"
+	update_setting_key "$GAMESETTINGS_DIR/settings.json" "Battery Saver" "$battery_saver"
+	update_setting_key "$GAMESETTINGS_DIR/settings.json" "CRT Effect" "$crt_effect"
+	update_setting_key "$GAMESETTINGS_DIR/settings.json" "Framebuffer Sync" "$framebuffer_sync"
 	sync
 }
 
@@ -58,7 +97,8 @@ update_setting_key() {
 settings_menu() {
 	mkdir -p "$GAMESETTINGS_DIR"
 
-	rm -f "$GAMESETTINGS_DIR/cpu-mode.tmp"
+	rm -f "$GAMESETTINGS_DIR/cpu-mode.tmp" "$GAMESETTINGS_DIR/battery-saver.tmp" "$GAMESETTINGS_DIR/crt-effect.tmp" \
+		"$GAMESETTINGS_DIR/framebuffer-sync.tmp"
 
 	write_settings_json
 
@@ -70,6 +110,12 @@ settings_menu() {
 				if [ "$exit_code" -eq 4 ]; then
 					# shellcheck disable=SC2016
 					echo "$minui_list_output" | jq -r --arg name "CPU Mode" '.settings[] | select(.name == $name) | .options[.selected]' >"$GAMESETTINGS_DIR/cpu-mode.tmp"
+					# shellcheck disable=SC2016
+					echo "$minui_list_output" | jq -r --arg name "Battery Saver" '.settings[] | select(.name == $name) | .options[.selected]' >"$GAMESETTINGS_DIR/battery-saver.tmp"
+					# shellcheck disable=SC2016
+					echo "$minui_list_output" | jq -r --arg name "CRT Effect" '.settings[] | select(.name == $name) | .options[.selected]' >"$GAMESETTINGS_DIR/crt-effect.tmp"
+					# shellcheck disable=SC2016
+					echo "$minui_list_output" | jq -r --arg name "Framebuffer Sync" '.settings[] | select(.name == $name) | .options[.selected]' >"$GAMESETTINGS_DIR/framebuffer-sync.tmp"
 					break
 				fi
 				if [ "$exit_code" -ne 0 ]; then
@@ -78,9 +124,15 @@ settings_menu() {
 			}
 
 			cpu_mode="$(echo "$minui_list_output" | jq -r --arg name "CPU Mode" '.settings[] | select(.name == $name) | .options[.selected]')"
+			battery_saver="$(echo "$minui_list_output" | jq -r --arg name "Battery Saver" '.settings[] | select(.name == $name) | .options[.selected]')"
+			crt_effect="$(echo "$minui_list_output" | jq -r --arg name "CRT Effect" '.settings[] | select(.name == $name) | .options[.selected]')"
+			framebuffer_sync="$(echo "$minui_list_output" | jq -r --arg name "Framebuffer Sync" '.settings[] | select(.name == $name) | .options[.selected]')"
 
 			echo "$minui_list_output" >"$GAMESETTINGS_DIR/settings.json"
 			echo "$cpu_mode" >"$GAMESETTINGS_DIR/cpu-mode"
+			echo "$battery_saver" >"$GAMESETTINGS_DIR/battery-saver"
+			echo "$crt_effect" >"$GAMESETTINGS_DIR/crt-effect"
+			echo "$framebuffer_sync" >"$GAMESETTINGS_DIR/framebuffer-sync"
 			sync
 		done
 	fi
@@ -114,6 +166,10 @@ get_rom_path() {
 
 configure_cpu() {
 	cpu_mode="$(get_cpu_mode)"
+	# Battery saver starts from ondemand; gopher64 then caps max clocks itself.
+	if [ "$(get_battery_saver)" = "on" ]; then
+		cpu_mode="ondemand"
+	fi
 
 	cat /sys/devices/system/cpu/cpu0/cpufreq/scaling_governor >"$HOME/cpu_governor.txt"
 	cat /sys/devices/system/cpu/cpu0/cpufreq/scaling_min_freq >"$HOME/cpu_min_freq.txt"
@@ -132,6 +188,9 @@ configure_cpu() {
 			cat "/sys/devices/system/cpu/cpu${cpu}/online" >"$HOME/cpu${cpu}_online.txt"
 		fi
 	done
+	if [ -f /sys/class/devfreq/1800000.gpu/max_freq ]; then
+		cat /sys/class/devfreq/1800000.gpu/max_freq >"$HOME/gpu_max_freq.txt"
+	fi
 
 	if [ "$cpu_mode" = "performance" ]; then
 		echo performance >/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor
@@ -278,6 +337,15 @@ cleanup() {
 			rm -f "$HOME/cpu${cpu}_online.txt"
 		fi
 	done
+	if [ -f "$HOME/gpu_max_freq.txt" ] && [ -f /sys/class/devfreq/1800000.gpu/max_freq ]; then
+		gpu_max_freq="$(cat "$HOME/gpu_max_freq.txt")"
+		echo "$gpu_max_freq" >/sys/class/devfreq/1800000.gpu/max_freq || true
+		rm -f "$HOME/gpu_max_freq.txt"
+	fi
+	if [ -f "$HOME/crtc_offload.txt" ]; then
+		G64_CRTC_RESTORE=1 gopher64 || true
+		rm -f "$HOME/crtc_offload.txt"
+	fi
 
 	if [ -f "$TEMP_ROM" ]; then
 		rm -f "$TEMP_ROM"
@@ -368,6 +436,41 @@ main() {
 	# touch .g64-disable-speed-limiter -> disable gopher64 VI speed limiter
 	# touch .g64-force-limit-freq1     -> keep limiter enabled but force limit_freq=1
 	# touch .g64-pin-big-core          -> pin threads to CPU4-CPU7 (performance cluster)
+	# touch .g64-control-socket       -> listen on /tmp/gopher64-control.sock for live knob changes:
+	#                                     set present gpu|cpu, set frameskip 0-4, set pacing vsync|novsync|drop-busy|cadence|vsync-locked|frameskip,
+	#                                     set limiter on|off, set pin big|all, set upscale 1|2|4|8,
+	#                                     set telemetry 0-2, set crt 0-3, get
+	# touch .g64-flight-recorder      -> keep the last 60s of frame timings in $LOGS_PATH/$PAK_NAME.flightrec
+	#                                     (survives crashes; previous session kept as .flightrec.prev)
+	# echo 50 > .g64-stall-watchdog   -> with .g64-flight-recorder, record the stack and stage of frames
+	#                                     taking over 50 ms (decode with tools/flightrec_dump); empty means 50;
+	#                                     whole stacks need a ./build.sh --frame-pointers binary
+	# touch .g64-pgo-collect          -> with a ./build.sh --pgo-generate binary, write profiles to
+	#                                     $USERDATA_PATH/$PAK_NAME/pgo (written on clean exit only)
+	# touch .g64-sdl-no-video         -> interface ignores the SDL window and loads libvulkan directly
+	#                                     (compare the "[interface] Startup ms:" log line with and without)
+	# echo 1800 > .g64-bench          -> benchmark run: limiter off, exit after 1800 presented frames
+	#                                     (after 60 warm-up frames) and write $LOGS_PATH/$PAK_NAME.bench.json;
+	#                                     an empty file means 1800
+	# echo 1 > .g64-bench-state       -> with .g64-bench, load save state slot 1 before measuring
+	# touch .g64-bench-null           -> with .g64-bench, scan out without presenting (no DRM)
+	# touch .g64-dl-cache             -> skip the draws of repeated display lists whose RDRAM inputs and
+	#                                     outputs are unchanged ("[dlcache]" summary line on exit)
+	# touch .g64-frame-checksum       -> write a checksum of every scanout to $LOGS_PATH/$PAK_NAME.checksums.txt
+	#                                     (compare two runs with tools/checksum_diff.sh)
+	# touch .g64-coherence-profile    -> log "[coherence]" framebuffer-check counters per perf window and
+	#                                     dump per-game totals to $LOGS_PATH/$PAK_NAME.coherence/<rom>.txt
+	# echo async > .g64-coherence     -> override the per-game Framebuffer Sync setting: strict, async (wait only
+	#                                     for the SyncFull covering the range) or relaxed (no CPU-side sync);
+	#                                     "[fb_sync]" logs syncs and stall time per perf window and on exit
+	# touch .g64-enqueue-per-command  -> hand RDP commands to parallel-rdp one call per command (A/B baseline)
+	# touch .g64-enqueue-stats        -> time command ingestion ("[enqueue] ... ns_per_cmd=" on exit, bench JSON)
+	# touch .g64-rdp-stats            -> log "[rdp_stats]" per-frame triangle/rect/load counts per perf window
+	# touch .g64-soft-rdp             -> render on the CPU (software RDP) even when Vulkan works
+	# touch .g64-vi-lite              -> CPU display fallback reads 16/32-bit frames straight from RDRAM
+	# touch .g64-crtc-offload         -> VI gamma via the CRTC gamma LUT, CPU-path borders from the CRTC background
+	# echo cadence > .g64-pacing      -> frame pacing policy: vsync (default), drop-busy, cadence (30 Hz),
+	#                                     vsync-locked or frameskip (compare offline with tools/pacing_sim)
 	DRM_TEST_PATTERN=0
 	DRM_FORCE_MSYNC=0
 	# Default to SetCrtc path on tg5050 because SetPlane path shows corruption.
@@ -377,6 +480,36 @@ main() {
 	G64_DISABLE_SPEED_LIMITER=0
 	G64_FORCE_LIMIT_FREQ1=0
 	G64_PIN_BIG_CORE=0
+	G64_CONTROL_SOCKET=0
+	G64_FLIGHT_RECORDER=0
+	G64_STALL_WATCHDOG=0
+	G64_SDL_NO_VIDEO=0
+	G64_BATTERY_SAVER=0
+	G64_BENCH_FRAMES=0
+	G64_BENCH_STATE=""
+	G64_BENCH_PRESENT=display
+	G64_DL_CACHE=0
+	G64_FRAME_CHECKSUM=0
+	G64_COHERENCE_PROFILE=0
+	G64_ENQUEUE_BATCH=1
+	G64_ENQUEUE_STATS=0
+	G64_RDP_STATS=0
+	G64_SOFT_RDP=0
+	G64_VI_LITE=0
+	G64_CRTC_OFFLOAD=0
+	G64_PACING=""
+	if [ "$(get_battery_saver)" = "on" ]; then
+		G64_BATTERY_SAVER=1
+	fi
+	# CRT effects are fused into the display scale pass (levels 0-3)
+	case "$(get_crt_effect)" in
+	scanlines) G64_CRT=1 ;;
+	mask) G64_CRT=2 ;;
+	bloom) G64_CRT=3 ;;
+	*) G64_CRT=0 ;;
+	esac
+	# Framebuffer coherence: strict, async or relaxed
+	G64_COHERENCE="$(get_framebuffer_sync)"
 	if [ -f "$PAK_DIR/.drm-test-pattern" ]; then
 		DRM_TEST_PATTERN=1
 	fi
@@ -404,6 +537,74 @@ main() {
 	if [ -f "$PAK_DIR/.g64-pin-big-core" ]; then
 		G64_PIN_BIG_CORE=1
 	fi
+	if [ -f "$PAK_DIR/.g64-control-socket" ]; then
+		G64_CONTROL_SOCKET=1
+	fi
+	if [ -f "$PAK_DIR/.g64-flight-recorder" ]; then
+		G64_FLIGHT_RECORDER="$LOGS_PATH/$PAK_NAME.flightrec"
+	fi
+	if [ -f "$PAK_DIR/.g64-stall-watchdog" ]; then
+		G64_STALL_WATCHDOG="$(tr -cd '0-9' <"$PAK_DIR/.g64-stall-watchdog")"
+		if [ -z "$G64_STALL_WATCHDOG" ]; then
+			G64_STALL_WATCHDOG=1
+		fi
+	fi
+	if [ -f "$PAK_DIR/.g64-sdl-no-video" ]; then
+		G64_SDL_NO_VIDEO=1
+	fi
+	if [ -f "$PAK_DIR/.g64-bench" ]; then
+		G64_BENCH_FRAMES="$(tr -cd '0-9' <"$PAK_DIR/.g64-bench")"
+		if [ -z "$G64_BENCH_FRAMES" ]; then
+			G64_BENCH_FRAMES=1800
+		fi
+		if [ -f "$PAK_DIR/.g64-bench-state" ]; then
+			G64_BENCH_STATE="$(tr -cd '0-9' <"$PAK_DIR/.g64-bench-state")"
+		fi
+		if [ -f "$PAK_DIR/.g64-bench-null" ]; then
+			G64_BENCH_PRESENT=null
+		fi
+	fi
+	if [ -f "$PAK_DIR/.g64-dl-cache" ]; then
+		G64_DL_CACHE=1
+	fi
+	if [ -f "$PAK_DIR/.g64-frame-checksum" ]; then
+		G64_FRAME_CHECKSUM="$LOGS_PATH/$PAK_NAME.checksums.txt"
+	fi
+	if [ -f "$PAK_DIR/.g64-coherence-profile" ]; then
+		mkdir -p "$LOGS_PATH/$PAK_NAME.coherence"
+		G64_COHERENCE_PROFILE="$LOGS_PATH/$PAK_NAME.coherence/$ROM_NAME.txt"
+	fi
+	if [ -f "$PAK_DIR/.g64-coherence" ]; then
+		G64_COHERENCE="$(tr -cd 'a-z' <"$PAK_DIR/.g64-coherence")"
+	fi
+	if [ -f "$PAK_DIR/.g64-enqueue-per-command" ]; then
+		G64_ENQUEUE_BATCH=0
+	fi
+	if [ -f "$PAK_DIR/.g64-enqueue-stats" ]; then
+		G64_ENQUEUE_STATS=1
+	fi
+	if [ -f "$PAK_DIR/.g64-rdp-stats" ]; then
+		G64_RDP_STATS=1
+	fi
+	if [ -f "$PAK_DIR/.g64-soft-rdp" ]; then
+		G64_SOFT_RDP=1
+	fi
+	if [ -f "$PAK_DIR/.g64-vi-lite" ]; then
+		G64_VI_LITE=1
+	fi
+	if [ -f "$PAK_DIR/.g64-crtc-offload" ]; then
+		G64_CRTC_OFFLOAD=1
+		# gopher64 sets the CRTC gamma LUT and background; cleanup resets them
+		# even if it crashes before restoring them itself.
+		touch "$HOME/crtc_offload.txt"
+	fi
+	if [ -f "$PAK_DIR/.g64-pacing" ]; then
+		G64_PACING="$(tr -cd 'a-z-' <"$PAK_DIR/.g64-pacing")"
+	fi
+	if [ -f "$PAK_DIR/.g64-pgo-collect" ]; then
+		mkdir -p "$USERDATA_PATH/$PAK_NAME/pgo"
+		export LLVM_PROFILE_FILE="$USERDATA_PATH/$PAK_NAME/pgo/gopher64-%p.profraw"
+	fi
 
 	# Use dummy video driver — our DRM display code handles scanout directly.
 	# SDL3's KMSDRM backend would fight us for the same DRM plane, causing corruption.
@@ -417,6 +618,27 @@ main() {
 	G64_DISABLE_SPEED_LIMITER="$G64_DISABLE_SPEED_LIMITER" \
 	G64_FORCE_LIMIT_FREQ1="$G64_FORCE_LIMIT_FREQ1" \
 	G64_PIN_BIG_CORE="$G64_PIN_BIG_CORE" \
+	G64_CONTROL_SOCKET="$G64_CONTROL_SOCKET" \
+	G64_FLIGHT_RECORDER="$G64_FLIGHT_RECORDER" \
+	G64_STALL_WATCHDOG="$G64_STALL_WATCHDOG" \
+	G64_SDL_NO_VIDEO="$G64_SDL_NO_VIDEO" \
+	G64_BATTERY_SAVER="$G64_BATTERY_SAVER" \
+	G64_CRT="$G64_CRT" \
+	G64_DL_CACHE="$G64_DL_CACHE" \
+	G64_FRAME_CHECKSUM="$G64_FRAME_CHECKSUM" \
+	G64_COHERENCE_PROFILE="$G64_COHERENCE_PROFILE" \
+	G64_COHERENCE="$G64_COHERENCE" \
+	G64_ENQUEUE_BATCH="$G64_ENQUEUE_BATCH" \
+	G64_ENQUEUE_STATS="$G64_ENQUEUE_STATS" \
+	G64_RDP_STATS="$G64_RDP_STATS" \
+	G64_SOFT_RDP="$G64_SOFT_RDP" \
+	G64_VI_LITE="$G64_VI_LITE" \
+	G64_CRTC_OFFLOAD="$G64_CRTC_OFFLOAD" \
+	G64_PACING="$G64_PACING" \
+	G64_BENCH_FRAMES="$G64_BENCH_FRAMES" \
+	G64_BENCH_STATE="$G64_BENCH_STATE" \
+	G64_BENCH_PRESENT="$G64_BENCH_PRESENT" \
+	G64_BENCH_JSON="$LOGS_PATH/$PAK_NAME.bench.json" \
 	gopher64 --fullscreen "$ROM_PATH" &
 	PROCESS_PID="$!"
 	echo "$PROCESS_PID" >"/tmp/gopher64.pid"
@@ -16,6 +16,40 @@ cp /patches/interface.cpp parallel-rdp/interface.cpp
 cp /patches/drm_display.hpp parallel-rdp/drm_display.hpp
 cp /patches/drm_display.cpp parallel-rdp/drm_display.cpp
 
+# Add runtime performance control socket
+cp /patches/perf_control.hpp parallel-rdp/perf_control.hpp
+cp /patches/perf_control.cpp parallel-rdp/perf_control.cpp
+
+# Add crash-safe perf flight recorder
+cp /patches/flight_recorder.hpp parallel-rdp/flight_recorder.hpp
+cp /patches/flight_recorder.cpp parallel-rdp/flight_recorder.cpp
+
+# Add battery power telemetry + battery saver clock caps
+cp /patches/power_monitor.hpp parallel-rdp/power_monitor.hpp
+cp /patches/power_monitor.cpp parallel-rdp/power_monitor.cpp
+
+# Add display-list memoization
+cp /patches/display_list_cache.hpp parallel-rdp/display_list_cache.hpp
+cp /patches/display_list_cache.cpp parallel-rdp/display_list_cache.cpp
+
+# Add framebuffer coherence profiler
+cp /patches/coherence_profile.hpp parallel-rdp/coherence_profile.hpp
+cp /patches/coherence_profile.cpp parallel-rdp/coherence_profile.cpp
+
+# Add software RDP fallback
+cp /patches/soft_rdp.hpp parallel-rdp/soft_rdp.hpp
+cp /patches/soft_rdp.cpp parallel-rdp/soft_rdp.cpp
+
+# Add VI-lite framebuffer geometry (header only)
+cp /patches/vi_lite.hpp parallel-rdp/vi_lite.hpp
+
+# Add frame pacing policies (header only, shared with tools/pacing_sim)
+cp /patches/frame_pacing.hpp parallel-rdp/frame_pacing.hpp
+
+# Add slow-frame stack capture
+cp /patches/stall_watchdog.hpp parallel-rdp/stall_watchdog.hpp
+cp /patches/stall_watchdog.cpp parallel-rdp/stall_watchdog.cpp
+
 # Ensure sdl-unix-console-build feature is enabled (idempotent)
 python3 << 'PYEOF'
 with open('Cargo.toml', 'r') as f:
@@ -32,7 +66,7 @@ with open('Cargo.toml', 'w') as f:
 print('Patched Cargo.toml: ensured sdl-unix-console-build feature')
 PYEOF
 
-# Patch build.rs: add drm_display.cpp, DRM include path, link libdrm (idempotent)
+# Patch build.rs: add drm_display.cpp + perf_control.cpp + flight_recorder.cpp + power_monitor.cpp + display_list_cache.cpp + coherence_profile.cpp + soft_rdp.cpp + stall_watchdog.cpp, DRM include path, link libdrm (idempotent)
 python3 << 'PYEOF'
 with open('build.rs', 'r') as f:
     content = f.read()
@@ -47,6 +81,41 @@ content = insert_after_once(
     '.file("parallel-rdp/wsi_platform.cpp")',
     '        .file("parallel-rdp/drm_display.cpp")'
 )
+content = insert_after_once(
+    content,
+    '.file("parallel-rdp/drm_display.cpp")',
+    '        .file("parallel-rdp/perf_control.cpp")'
+)
+content = insert_after_once(
+    content,
+    '.file("parallel-rdp/perf_control.cpp")',
+    '        .file("parallel-rdp/flight_recorder.cpp")'
+)
+content = insert_after_once(
+    content,
+    '.file("parallel-rdp/flight_recorder.cpp")',
+    '        .file("parallel-rdp/power_monitor.cpp")'
+)
+content = insert_after_once(
+    content,
+    '.file("parallel-rdp/power_monitor.cpp")',
+    '        .file("parallel-rdp/display_list_cache.cpp")'
+)
+content = insert_after_once(
+    content,
+    '.file("parallel-rdp/display_list_cache.cpp")',
+    '        .file("parallel-rdp/coherence_profile.cpp")'
+)
+content = insert_after_once(
+    content,
+    '.file("parallel-rdp/coherence_profile.cpp")',
+    '        .file("parallel-rdp/soft_rdp.cpp")'
+)
+content = insert_after_once(
+    content,
+    '.file("parallel-rdp/soft_rdp.cpp")',
+    '        .file("parallel-rdp/stall_watchdog.cpp")'
+)
 content = insert_after_once(
     content,
     '.include("parallel-rdp/parallel-rdp-standalone/util")',
@@ -60,7 +129,192 @@ content = insert_after_once(
 
 with open('build.rs', 'w') as f:
     f.write(content)
-print('Patched build.rs: added drm_display.cpp, DRM includes, libdrm link')
+print('Patched build.rs: added drm_display.cpp, perf_control.cpp, flight_recorder.cpp, power_monitor.cpp, display_list_cache.cpp, coherence_profile.cpp, soft_rdp.cpp, stall_watchdog.cpp, DRM includes, libdrm link')
+PYEOF
+
+# Add a batched command enqueue to parallel-rdp (idempotent). One ring lock
+# and one consumer wake-up per run of commands instead of per command.
+# Only applied when the ring code looks as expected; otherwise interface.cpp
+# falls back to per-command enqueue (RDP_HAS_ENQUEUE_COMMANDS stays unset).
+python3 << 'PYEOF'
+from pathlib import Path
+
+hpp = Path('parallel-rdp/parallel-rdp-standalone/parallel-rdp/rdp_device.hpp')
+cpp = Path('parallel-rdp/parallel-rdp-standalone/parallel-rdp/rdp_device.cpp')
+decl = 'void enqueue_command(unsigned num_words, const uint32_t *words);'
+batched_decl = 'void enqueue_commands(unsigned num_commands, const unsigned *word_counts, const uint32_t *words);'
+expected = [
+    'void CommandRing::enqueue_command(unsigned num_words, const uint32_t *words)',
+    'std::unique_lock<std::mutex> holder{lock};',
+    'read_count + ring.size()',
+    'ring[write_count++ & mask] = num_words;',
+    'single_threaded_processing',
+    'enqueue_command_direct(num_words, words)',
+]
+
+header = hpp.read_text()
+source = cpp.read_text()
+if 'enqueue_commands' in header:
+    print('Patched rdp_device: batched enqueue already present')
+elif header.count(decl) != 2 or not all(e in source for e in expected):
+    print('WARNING: rdp_device layout not recognized, batched enqueue not added')
+else:
+    lines = []
+    for line in header.split('\n'):
+        lines.append(line)
+        if line.strip() == decl:
+            lines.append(line[:len(line) - len(line.lstrip())] + batched_decl)
+    header = '\n'.join(lines)
+    header = header.replace('#pragma once\n', '#pragma once\n\n#define RDP_HAS_ENQUEUE_COMMANDS 1\n', 1)
+    source += """
+namespace RDP
+{
+void CommandRing::enqueue_commands(unsigned num_commands, const unsigned *word_counts, const uint32_t *words)
+{
+	std::unique_lock<std::mutex> holder{lock};
+	const size_t mask = ring.size() - 1;
+	for (unsigned c = 0; c < num_commands; c++)
+	{
+		const unsigned num_words = word_counts[c];
+		if (write_count + num_words + 1 > read_count + ring.size())
+		{
+			// Let the worker drain what this run has written so far.
+			cond.notify_all();
+			cond.wait(holder, [this, num_words]() {
+				return write_count + num_words + 1 <= read_count + ring.size();
+			});
+		}
+		ring[write_count++ & mask] = num_words;
+		for (unsigned i = 0; i < num_words; i++)
+			ring[write_count++ & mask] = words[i];
+		words += num_words;
+	}
+	cond.notify_all();
+}
+
+void CommandProcessor::enqueue_commands(unsigned num_commands, const unsigned *word_counts, const uint32_t *words)
+{
+	if (single_threaded_processing)
+	{
+		for (unsigned c = 0; c < num_commands; c++)
+		{
+			enqueue_command_direct(word_counts[c], words);
+			words += word_counts[c];
+		}
+	}
+	else
+		ring.enqueue_commands(num_commands, word_counts, words);
+}
+}
+"""
+    hpp.write_text(header)
+    cpp.write_text(source)
+    print('Patched rdp_device: added CommandProcessor::enqueue_commands')
+PYEOF
+
+# Add a non-blocking timeline query to parallel-rdp (idempotent), so the
+# async write-back mode can tell whether a SyncFull has retired without
+# waiting on the timeline worker's lock. Without it (RDP_HAS_TIMELINE_QUERY
+# unset) interface.cpp only learns about retired signals by waiting.
+python3 << 'PYEOF'
+from pathlib import Path
+
+hpp = Path('parallel-rdp/parallel-rdp-standalone/parallel-rdp/rdp_device.hpp')
+cpp = Path('parallel-rdp/parallel-rdp-standalone/parallel-rdp/rdp_device.cpp')
+decl = 'void wait_for_timeline(uint64_t index);'
+query_decl = 'bool timeline_reached(uint64_t index);'
+expected_header = ['thread_timeline_value', 'timeline_lock', decl]
+expected_source = ['void CommandProcessor::wait_for_timeline(uint64_t index)', 'thread_timeline_value >= index']
+
+header = hpp.read_text()
+source = cpp.read_text()
+# Earlier versions read thread_timeline_value without the lock.
+unlocked = '\treturn __atomic_load_n(&thread_timeline_value, __ATOMIC_ACQUIRE) >= index;\n'
+locked = '''\tstd::unique_lock<std::mutex> holder{timeline_lock, std::try_to_lock};
+\tif (!holder.owns_lock())
+\t\treturn false;
+\treturn thread_timeline_value >= index;
+'''
+if 'timeline_reached' in header and unlocked in source:
+    start = source.index('bool CommandProcessor::timeline_reached(uint64_t index)\n{\n')
+    end = source.index(unlocked, start) + len(unlocked)
+    source = source[:start] + 'bool CommandProcessor::timeline_reached(uint64_t index)\n{\n' + \
+        '\t// thread_timeline_value is only written under timeline_lock. A busy lock\n' + \
+        '\t// reads as "not yet"; callers poll again later.\n' + locked + source[end:]
+    cpp.write_text(source)
+    print('Patched rdp_device: timeline query now takes timeline_lock')
+elif 'timeline_reached' in header:
+    print('Patched rdp_device: timeline query already present')
+elif header.count(decl) != 1 or not all(e in header for e in expected_header) or \
+        not all(e in source for e in expected_source):
+    print('WARNING: rdp_device timeline not recognized, timeline query not added')
+else:
+    lines = []
+    for line in header.split('\n'):
+        lines.append(line)
+        if line.strip() == decl:
+            lines.append(line[:len(line) - len(line.lstrip())] + query_decl)
+    header = '\n'.join(lines)
+    header = header.replace('#pragma once\n', '#pragma once\n\n#define RDP_HAS_TIMELINE_QUERY 1\n', 1)
+    source += """
+namespace RDP
+{
+bool CommandProcessor::timeline_reached(uint64_t index)
+{
+	// thread_timeline_value is only written under timeline_lock. A busy lock
+	// reads as "not yet"; callers poll again later.
+""" + locked + """}
+}
+"""
+    hpp.write_text(header)
+    cpp.write_text(source)
+    print('Patched rdp_device: added CommandProcessor::timeline_reached')
+PYEOF
+
+# Report parallel-rdp's worker threads to interface.cpp as they start and
+# exit (idempotent), so the stall watchdog can capture their stacks too.
+# Each thread function is hooked only if found; a missing one just goes
+# unwatched.
+python3 << 'PYEOF'
+from pathlib import Path
+
+cpp = Path('parallel-rdp/parallel-rdp-standalone/parallel-rdp/rdp_device.cpp')
+hooks = [
+    ('void CommandRing::thread_loop(', 'rdp-ring'),
+    ('void CommandProcessor::thread_timeline(', 'rdp-timeline'),
+]
+scope = '''// Defined in interface.cpp (stall watchdog registration).
+void rdp_thread_started(const char *name);
+void rdp_thread_stopped();
+
+struct RdpThreadScope
+{
+	explicit RdpThreadScope(const char *name) { rdp_thread_started(name); }
+	~RdpThreadScope() { rdp_thread_stopped(); }
+};
+
+'''
+
+source = cpp.read_text()
+if 'RdpThreadScope' in source:
+    print('Patched rdp_device: thread hooks already present')
+elif 'namespace RDP\n{\n' not in source:
+    print('WARNING: rdp_device layout not recognized, thread hooks not added')
+else:
+    hooked = []
+    for signature, name in hooks:
+        start = source.find(signature)
+        body = source.find('\n{\n', start) if start >= 0 else -1
+        if body < 0:
+            print('WARNING: %s not found, %s thread not watched' % (signature.split(' ', 1)[1].rstrip('('), name))
+            continue
+        body += len('\n{\n')
+        source = source[:body] + '\tRdpThreadScope rdp_thread_scope("%s");\n' % name + source[body:]
+        hooked.append(name)
+    if hooked:
+        source = source.replace('namespace RDP\n{\n', scope + 'namespace RDP\n{\n', 1)
+        cpp.write_text(source)
+        print('Patched rdp_device: thread hooks for ' + ', '.join(hooked))
 PYEOF
 
 # Patch video.rs: remove SDL_WINDOW_VULKAN flag (idempotent)
@@ -124,4 +378,64 @@ path.write_text(content)
 print('Patched vi.rs: added G64_FORCE_LIMIT_FREQ1 runtime toggle')
 PYEOF
 
+# Give main.rs a G64_CRTC_RESTORE=1 mode that only resets the CRTC colour
+# properties (drm_display_restore_crtc) and exits, so launch.sh can clear a
+# gamma LUT or background left behind by a crashed session (idempotent).
+python3 << 'PYEOF'
+from pathlib import Path
+
+main = Path('src/main.rs')
+content = main.read_text()
+decl = 'unsafe extern "C" {\n    fn drm_display_restore_crtc() -> i32;\n}\n'
+hook = """    if std::env::var("G64_CRTC_RESTORE").map_or(false, |v| v == "1") {
+        std::process::exit(unsafe { drm_display_restore_crtc() });
+    }
+"""
+anchor = 'fn main() {\n'
+if hook in content:
+    print('main.rs: G64_CRTC_RESTORE already present')
+elif anchor not in content:
+    print('WARNING: fn main() not found in main.rs; G64_CRTC_RESTORE unavailable')
+else:
+    content = content.replace(anchor, decl + '\n' + anchor + hook, 1)
+    main.write_text(content)
+    print('Patched main.rs: G64_CRTC_RESTORE mode')
+PYEOF
+
+# Select the process-wide allocator (ALLOCATOR=system|mimalloc|jemalloc).
+# The Rust global allocator is swapped and, with the override features, the
+# malloc/free symbols of the executable as well, so parallel-rdp, SDL and the
+# Mali driver allocate from the same heap. Previous selections are removed
+# first so the cached tree can switch back and forth.
+python3 << 'PYEOF'
+import os
+import re
+from pathlib import Path
+
+allocator = os.environ.get('ALLOCATOR', 'system')
+crates = {
+    'mimalloc': ('mimalloc = { version = "0.1", default-features = false, features = ["override"] }',
+                 'static GLOBAL: mimalloc::MiMalloc = mimalloc::MiMalloc;'),
+    'jemalloc': ('tikv-jemallocator = { version = "0.6", features = ["unprefixed_malloc_on_supported_platforms"] }',
+                 'static GLOBAL: tikv_jemallocator::Jemalloc = tikv_jemallocator::Jemalloc;'),
+}
+if allocator != 'system' and allocator not in crates:
+    raise SystemExit(f'Unknown ALLOCATOR {allocator!r} (expected system, mimalloc or jemalloc)')
+
+marker = '# g64-allocator'
+cargo = Path('Cargo.toml')
+content = '\n'.join(l for l in cargo.read_text().split('\n') if not l.endswith(marker))
+if allocator != 'system':
+    content = content.replace('[dependencies]\n', '[dependencies]\n' + crates[allocator][0] + ' ' + marker + '\n', 1)
+cargo.write_text(content)
+
+main = Path('src/main.rs')
+content = re.sub(r'\n*// g64-allocator begin\n.*?// g64-allocator end\n', '', main.read_text(), flags=re.S)
+content = content.rstrip('\n') + '\n'
+if allocator != 'system':
+    content += '\n// g64-allocator begin\n#[global_allocator]\n' + crates[allocator][1] + '\n// g64-allocator end\n'
+main.write_text(content)
+print(f'Patched Cargo.toml/main.rs: allocator={allocator}')
+PYEOF
+
 echo "--- Patches applied ---"
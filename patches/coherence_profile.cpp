@@ -0,0 +1,126 @@
+/*
+ * Framebuffer coherence access-pattern profiler for tg5050
+ */
+
+#include "coherence_profile.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+
+static uint64_t now_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000ull + uint64_t(ts.tv_nsec) / 1000ull;
+}
+
+void coherence_profile_init(CoherenceProfile &p, const char *path)
+{
+	snprintf(p.path, sizeof(p.path), "%s", path ? path : COHERENCE_PROFILE_DEFAULT_PATH);
+	p.start_us = now_us();
+	p.enabled = true;
+	fprintf(stderr, "[coherence] Profiling framebuffer checks, dump to %s on exit\n", p.path);
+}
+
+static void accumulate(CoherenceCounters &total, const CoherenceCounters &w)
+{
+	total.checks += w.checks;
+	total.armed += w.armed;
+	total.check_bytes += w.check_bytes;
+	total.scanned_words += w.scanned_words;
+	total.hits += w.hits;
+	total.waits += w.waits;
+	total.wait_us += w.wait_us;
+	for (int k = 0; k < COHERENCE_MARK_KINDS; k++)
+	{
+		total.marks[k] += w.marks[k];
+		total.marks_already_dirty[k] += w.marks_already_dirty[k];
+		total.marked_bytes[k] += w.marked_bytes[k];
+	}
+	for (int i = 0; i < COHERENCE_PROFILE_LENGTH_BUCKETS; i++)
+		total.length_hist[i] += w.length_hist[i];
+}
+
+void coherence_profile_window(CoherenceProfile &p, double elapsed_s)
+{
+	if (!p.enabled)
+		return;
+
+	const CoherenceCounters &w = p.window;
+	const double s = elapsed_s > 0.0 ? elapsed_s : 1.0;
+	const uint64_t marks = w.marks[COHERENCE_MARK_COLOR] + w.marks[COHERENCE_MARK_DEPTH] +
+	                       w.marks[COHERENCE_MARK_TEXTURE];
+	fprintf(stderr, "[coherence] checks=%.0f/s armed=%.0f/s avg_len=%.0fB scanned=%.0f/s hits=%llu waits=%llu "
+	                "wait_ms=%.2f marks=%.0f/s (color=%llu depth=%llu texture=%llu) marked_kb=%.0f\n",
+	        double(w.checks) / s, double(w.armed) / s,
+	        w.armed ? double(w.check_bytes) / double(w.armed) : 0.0,
+	        double(w.scanned_words) / s,
+	        (unsigned long long)w.hits, (unsigned long long)w.waits, double(w.wait_us) / 1000.0,
+	        double(marks) / s,
+	        (unsigned long long)w.marks[COHERENCE_MARK_COLOR],
+	        (unsigned long long)w.marks[COHERENCE_MARK_DEPTH],
+	        (unsigned long long)w.marks[COHERENCE_MARK_TEXTURE],
+	        double(w.marked_bytes[COHERENCE_MARK_COLOR] + w.marked_bytes[COHERENCE_MARK_DEPTH] +
+	               w.marked_bytes[COHERENCE_MARK_TEXTURE]) / 1024.0);
+
+	accumulate(p.total, p.window);
+	p.window = CoherenceCounters();
+}
+
+void coherence_profile_dump(CoherenceProfile &p)
+{
+	if (!p.enabled)
+		return;
+	accumulate(p.total, p.window);
+	p.window = CoherenceCounters();
+
+	FILE *f = fopen(p.path, "w");
+	if (!f)
+	{
+		fprintf(stderr, "[coherence] Cannot write %s: %s\n", p.path, strerror(errno));
+		return;
+	}
+
+	const CoherenceCounters &t = p.total;
+	const double seconds = double(now_us() - p.start_us) / 1e6;
+	fprintf(f, "# gopher64 framebuffer coherence profile\n");
+	fprintf(f, "seconds %.1f\n", seconds);
+	fprintf(f, "checks %llu\narmed %llu\ncheck_bytes %llu\nscanned_words %llu\n",
+	        (unsigned long long)t.checks, (unsigned long long)t.armed,
+	        (unsigned long long)t.check_bytes, (unsigned long long)t.scanned_words);
+	fprintf(f, "hits %llu\nwaits %llu\nwait_ms %.2f\n",
+	        (unsigned long long)t.hits, (unsigned long long)t.waits, double(t.wait_us) / 1000.0);
+	for (int k = 0; k < COHERENCE_MARK_KINDS; k++)
+	{
+		fprintf(f, "marks_%s %llu already_dirty %llu bytes %llu\n", coherence_mark_names[k],
+		        (unsigned long long)t.marks[k], (unsigned long long)t.marks_already_dirty[k],
+		        (unsigned long long)t.marked_bytes[k]);
+	}
+
+	fprintf(f, "\n# armed check lengths (upper bound in bytes, count)\n");
+	for (int i = 0; i < COHERENCE_PROFILE_LENGTH_BUCKETS; i++)
+	{
+		if (!t.length_hist[i])
+			continue;
+		if (i + 1 < COHERENCE_PROFILE_LENGTH_BUCKETS)
+			fprintf(f, "len<=%u %llu\n", 8u << i, (unsigned long long)t.length_hist[i]);
+		else
+			fprintf(f, "len>%u %llu\n", 8u << (i - 1), (unsigned long long)t.length_hist[i]);
+	}
+
+	fprintf(f, "\n# 64 KiB regions: address checks(sampled) hits marks(sampled)\n");
+	for (int r = 0; r < COHERENCE_PROFILE_REGIONS; r++)
+	{
+		if (!p.check_regions[r] && !p.hit_regions[r] && !p.mark_regions[r])
+			continue;
+		fprintf(f, "0x%06x %u %u %u\n", unsigned(r) << COHERENCE_PROFILE_REGION_SHIFT,
+		        p.check_regions[r], p.hit_regions[r], p.mark_regions[r]);
+	}
+	fclose(f);
+
+	fprintf(stderr, "[coherence] session: checks=%llu armed=%llu hits=%llu waits=%llu wait_ms=%.1f -> %s\n",
+	        (unsigned long long)t.checks, (unsigned long long)t.armed, (unsigned long long)t.hits,
+	        (unsigned long long)t.waits, double(t.wait_us) / 1000.0, p.path);
+}
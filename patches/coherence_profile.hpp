@@ -0,0 +1,141 @@
+/*
+ * Framebuffer coherence access-pattern profiler for tg5050
+ *
+ * Counts how the CPU core calls rdp_check_framebuffers(): call rate,
+ * address and length distribution, how often a call overlaps a range the
+ * RDP may have written, and how often that forces a timeline wait. It
+ * also counts the ranges rdp_process_commands() marks dirty (color, depth
+ * and texture), including marks skipped because the range was already
+ * dirty.
+ *
+ * Addresses go into a histogram of 64 KiB RDRAM regions. Only one in
+ * eight checks and marks is sampled, so the hot path stays a few
+ * increments. A one-line summary is logged per perf window, and the
+ * session totals are written to a per-game text file on close.
+ *
+ * Usage: init(path) -> check()/hit()/mark() from the coherence path ->
+ *        window() once per perf window -> dump() on close
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define COHERENCE_PROFILE_DEFAULT_PATH "/tmp/gopher64-coherence.txt"
+// Length buckets are powers of two: [0] <= 8 bytes ... [15] >= 256 KiB
+#define COHERENCE_PROFILE_LENGTH_BUCKETS 16
+#define COHERENCE_PROFILE_REGION_SHIFT 16
+#define COHERENCE_PROFILE_REGIONS 128 // 8 MiB of RDRAM
+#define COHERENCE_PROFILE_SAMPLE_MASK 7
+
+enum CoherenceMarkKind
+{
+	COHERENCE_MARK_COLOR = 0,
+	COHERENCE_MARK_DEPTH = 1,
+	COHERENCE_MARK_TEXTURE = 2,
+	COHERENCE_MARK_KINDS
+};
+
+static const char *const coherence_mark_names[COHERENCE_MARK_KINDS] = {
+	"color",
+	"depth",
+	"texture",
+};
+
+struct CoherenceCounters
+{
+	uint64_t checks = 0;       // rdp_check_framebuffers() calls
+	uint64_t armed = 0;        // ... while RDP work was pending
+	uint64_t check_bytes = 0;  // requested lengths of armed calls
+	uint64_t scanned_words = 0; // dirty-map entries scanned
+	uint64_t hits = 0;         // overlaps with a dirty range
+	uint64_t waits = 0;        // hits that blocked on the timeline
+	uint64_t wait_us = 0;
+	uint64_t marks[COHERENCE_MARK_KINDS] = {};
+	uint64_t marks_already_dirty[COHERENCE_MARK_KINDS] = {};
+	uint64_t marked_bytes[COHERENCE_MARK_KINDS] = {};
+	uint64_t length_hist[COHERENCE_PROFILE_LENGTH_BUCKETS] = {};
+};
+
+struct CoherenceProfile
+{
+	bool enabled = false;
+	char path[256] = {};
+	uint64_t start_us = 0;
+	uint64_t sample = 0;
+
+	CoherenceCounters total;
+	CoherenceCounters window;
+
+	// Checks and marks are sampled (1 in COHERENCE_PROFILE_SAMPLE_MASK + 1),
+	// hits are rare enough to count them all.
+	uint32_t check_regions[COHERENCE_PROFILE_REGIONS] = {};
+	uint32_t hit_regions[COHERENCE_PROFILE_REGIONS] = {};
+	uint32_t mark_regions[COHERENCE_PROFILE_REGIONS] = {};
+};
+
+// path == nullptr uses COHERENCE_PROFILE_DEFAULT_PATH.
+void coherence_profile_init(CoherenceProfile &p, const char *path);
+
+inline uint32_t coherence_profile_region(uint32_t address)
+{
+	const uint32_t region = address >> COHERENCE_PROFILE_REGION_SHIFT;
+	return region < COHERENCE_PROFILE_REGIONS ? region : COHERENCE_PROFILE_REGIONS - 1;
+}
+
+// One rdp_check_framebuffers() call (byte address and length). armed is
+// false when no RDP work was pending and the call returned immediately.
+inline void coherence_profile_check(CoherenceProfile &p, uint32_t address, uint32_t length,
+                                    bool armed, uint32_t scanned_words)
+{
+	CoherenceCounters &w = p.window;
+	w.checks++;
+	if (!armed)
+		return;
+	w.armed++;
+	w.check_bytes += length;
+	w.scanned_words += scanned_words;
+
+	uint32_t bucket = 0;
+	while (bucket + 1 < COHERENCE_PROFILE_LENGTH_BUCKETS && (8u << bucket) < length)
+		bucket++;
+	w.length_hist[bucket]++;
+
+	if ((p.sample++ & COHERENCE_PROFILE_SAMPLE_MASK) == 0)
+		p.check_regions[coherence_profile_region(address)]++;
+}
+
+// The call overlapped a dirty range. waited: it blocked for wait_us.
+inline void coherence_profile_hit(CoherenceProfile &p, uint32_t address, bool waited, uint64_t wait_us)
+{
+	CoherenceCounters &w = p.window;
+	w.hits++;
+	if (waited)
+	{
+		w.waits++;
+		w.wait_us += wait_us;
+	}
+	p.hit_regions[coherence_profile_region(address)]++;
+}
+
+// A range marked by rdp_process_commands() (bytes, [begin, end)).
+inline void coherence_profile_mark(CoherenceProfile &p, CoherenceMarkKind kind, uint32_t begin, uint32_t end,
+                                   bool already_dirty)
+{
+	CoherenceCounters &w = p.window;
+	w.marks[kind]++;
+	if (already_dirty)
+		w.marks_already_dirty[kind]++;
+	else
+		w.marked_bytes[kind] += end - begin;
+	if ((p.sample++ & COHERENCE_PROFILE_SAMPLE_MASK) == 0)
+		p.mark_regions[coherence_profile_region(begin)]++;
+}
+
+// Log the window as one "[coherence]" line, fold it into the totals and
+// start a new window.
+void coherence_profile_window(CoherenceProfile &p, double elapsed_s);
+
+// Write session totals and the region histograms to p.path.
+void coherence_profile_dump(CoherenceProfile &p);
@@ -0,0 +1,213 @@
+/*
+ * Display-list memoization for tg5050
+ *
+ * Pure bookkeeping: hashing and the skip decision. Timeline queries and
+ * enqueueing commands stay in interface.cpp.
+ */
+
+#include "display_list_cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+
+static uint64_t now_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000ull + uint64_t(ts.tv_nsec) / 1000ull;
+}
+
+static inline uint64_t hash_mix(uint64_t h, uint64_t v)
+{
+	h ^= v * 0x9E3779B97F4A7C15ull;
+	h = (h << 27) | (h >> 37);
+	return h * 0xC2B2AE3D27D4EB4Full + 0x165667B19E3779F9ull;
+}
+
+static uint64_t hash_bytes(uint64_t h, const uint8_t *data, size_t size)
+{
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t v;
+		memcpy(&v, data + i, sizeof(v));
+		h = hash_mix(h, v);
+	}
+	uint64_t tail = 0;
+	memcpy(&tail, data + i, size - i);
+	return hash_mix(h, tail ^ (uint64_t(size) << 56));
+}
+
+int display_list_cache_match(DisplayListCache &c)
+{
+	c.lists++;
+
+	const uint64_t stream = hash_bytes(0, reinterpret_cast<const uint8_t *>(c.words.data()),
+	                                   c.words.size() * sizeof(uint32_t));
+	const uint64_t key = hash_mix(stream, c.last_stream);
+	c.last_stream = stream;
+	if (c.inherits_tmem)
+	{
+		c.inherited++;
+		return -1;
+	}
+
+	int oldest = 0;
+	for (int i = 0; i < DISPLAY_LIST_CACHE_ENTRIES; i++)
+	{
+		DisplayListCacheEntry &e = c.entries[i];
+		if (e.last_use && e.key == key)
+		{
+			e.last_use = c.lists;
+			if (c.lists < e.cooldown_until)
+				return -1;
+			c.candidates++;
+			return i;
+		}
+		if (e.last_use < c.entries[oldest].last_use)
+			oldest = i;
+	}
+
+	DisplayListCacheEntry &e = c.entries[oldest];
+	e = DisplayListCacheEntry();
+	e.key = key;
+	e.last_use = c.lists;
+	return -1;
+}
+
+static uint64_t hash_ranges(DisplayListCache &c, const std::vector<DisplayListRange> &ranges,
+                            const uint8_t *rdram, uint32_t rdram_size)
+{
+	const uint64_t start_us = now_us();
+	uint64_t h = 0;
+	for (const DisplayListRange &r : ranges)
+	{
+		if (r.begin >= rdram_size)
+			continue;
+		const uint32_t end = r.end < rdram_size ? r.end : rdram_size;
+		h = hash_mix(h, (uint64_t(r.begin) << 32) | end);
+		h = hash_bytes(h, rdram + r.begin, end - r.begin);
+		c.hashed_bytes += end - r.begin;
+	}
+	c.hash_us += now_us() - start_us;
+	return h;
+}
+
+uint64_t display_list_cache_state_hash(DisplayListCache &c, const uint8_t *rdram, uint32_t rdram_size)
+{
+	return hash_ranges(c, c.ranges, rdram, rdram_size);
+}
+
+bool display_list_cache_should_skip(DisplayListCache &c, int entry, uint64_t pre_hash)
+{
+	DisplayListCacheEntry &e = c.entries[entry];
+	if (e.has_state && e.pre_hash == pre_hash && e.post_hash == pre_hash)
+	{
+		e.misses = 0;
+		c.skipped++;
+		c.skipped_words += c.words.size();
+		return true;
+	}
+
+	// Streams that keep changing what they touch (animated textures,
+	// scrolling backgrounds) only cost two hashes; stop checking them for
+	// a while.
+	if (e.has_state && ++e.misses >= DISPLAY_LIST_CACHE_MAX_MISSES)
+	{
+		e.misses = 0;
+		e.cooldown_until = c.lists + DISPLAY_LIST_CACHE_COOLDOWN_LISTS;
+	}
+	return false;
+}
+
+void display_list_cache_record(DisplayListCache &c, int entry, uint64_t pre_hash, uint64_t post_hash)
+{
+	DisplayListCacheEntry &e = c.entries[entry];
+	e.pre_hash = pre_hash;
+	e.post_hash = post_hash;
+	e.has_state = true;
+}
+
+void display_list_cache_defer(DisplayListCache &c, int entry, uint64_t pre_hash)
+{
+	DisplayListCachePending &p = c.pending;
+	p.entry = entry;
+	p.key = c.entries[entry].key;
+	p.signal = 0;
+	p.pre_hash = pre_hash;
+	p.ranges.swap(c.ranges);
+}
+
+void display_list_cache_signaled(DisplayListCache &c, uint64_t signal)
+{
+	c.prior_signal = signal;
+	if (c.pending.entry >= 0 && !c.pending.signal)
+		c.pending.signal = signal;
+}
+
+void display_list_cache_complete(DisplayListCache &c, const uint8_t *rdram, uint32_t rdram_size)
+{
+	DisplayListCachePending &p = c.pending;
+	if (p.entry < 0)
+		return;
+	if (c.entries[p.entry].key == p.key)
+	{
+		const uint64_t post_hash = hash_ranges(c, p.ranges, rdram, rdram_size);
+		display_list_cache_record(c, p.entry, p.pre_hash, post_hash);
+		c.recorded++;
+	}
+	p.entry = -1;
+	p.signal = 0;
+	p.ranges.clear();
+}
+
+void display_list_cache_drop_pending(DisplayListCache &c)
+{
+	DisplayListCachePending &p = c.pending;
+	if (p.entry < 0)
+		return;
+	c.dropped++;
+	p.entry = -1;
+	p.signal = 0;
+	p.ranges.clear();
+}
+
+bool display_list_cache_pending_overlaps(const DisplayListCache &c, uint32_t begin, uint32_t end)
+{
+	for (const DisplayListRange &r : c.pending.ranges)
+		if (begin < r.end && r.begin < end)
+			return true;
+	return false;
+}
+
+void display_list_cache_forget_signals(DisplayListCache &c)
+{
+	display_list_cache_drop_pending(c);
+	c.prior_signal = 0;
+}
+
+void display_list_cache_clear(DisplayListCache &c)
+{
+	c.words.clear();
+	c.command_words.clear();
+	c.ranges.clear();
+	c.tmem_loaded = false;
+	c.tlut_loaded = false;
+	c.tlut_mode = true;
+	c.inherits_tmem = false;
+}
+
+void display_list_cache_report(const DisplayListCache &c, const char *when)
+{
+	if (!c.enabled)
+		return;
+	fprintf(stderr, "[dlcache] %s: lists=%llu candidates=%llu skipped=%llu (%.1f%%) skipped_words=%llu "
+	                "inherited=%llu busy=%llu recorded=%llu dropped=%llu hashed=%.1fMB hash_ms=%.1f\n",
+	        when, (unsigned long long)c.lists, (unsigned long long)c.candidates,
+	        (unsigned long long)c.skipped, c.lists ? 100.0 * double(c.skipped) / double(c.lists) : 0.0,
+	        (unsigned long long)c.skipped_words, (unsigned long long)c.inherited, (unsigned long long)c.busy,
+	        (unsigned long long)c.recorded, (unsigned long long)c.dropped,
+	        double(c.hashed_bytes) / (1024.0 * 1024.0),
+	        double(c.hash_us) / 1000.0);
+}
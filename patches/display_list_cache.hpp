@@ -0,0 +1,191 @@
+/*
+ * Display-list memoization for tg5050
+ *
+ * Buffers the RDP commands of one display list (everything up to and
+ * including SyncFull) together with the RDRAM ranges it touches: texture
+ * and TLUT loads, the color image and the depth image. When the same
+ * command stream comes back, the touched ranges are hashed. If the
+ * previous run of that stream started from this exact RDRAM state and
+ * left it unchanged, running it again cannot change anything, so its
+ * draw commands are dropped. The previous result is already in RDRAM;
+ * state and TMEM load commands are still sent so the RDP leaves the list
+ * in the same state.
+ *
+ * Invalidation is by content, not by write tracking. Any CPU write to a
+ * texture, framebuffer or depth range changes the hash, so that list
+ * renders again. That only holds for texels the list loads itself: a list
+ * that draws textured before loading TMEM (or the TLUT, with TLUT mode
+ * possibly on) uses whatever an earlier list left there, which no hash
+ * here covers, so it is never a candidate.
+ *
+ * Nothing here waits for the GPU. A candidate is only hashed when the
+ * list before it has already retired (prior_signal), and the hash after
+ * a rendered candidate is deferred until its own SyncFull has retired.
+ * The deferred hash is dropped if anything could write the ranges first.
+ *
+ * Usage: add()/add_range() per command -> match() at SyncFull ->
+ *        state_hash()/should_skip() for a match -> defer() after a
+ *        rendered candidate -> clear() -> signaled() with the SyncFull's
+ *        timeline value -> complete() once it has retired
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define DISPLAY_LIST_CACHE_ENTRIES 4
+// Consecutive state mismatches before a stream stops being hashed for a while
+#define DISPLAY_LIST_CACHE_MAX_MISSES 4
+#define DISPLAY_LIST_CACHE_COOLDOWN_LISTS 120
+// Lists longer than this are passed through unbuffered
+#define DISPLAY_LIST_CACHE_MAX_WORDS (256 * 1024)
+
+struct DisplayListCacheEntry
+{
+	uint64_t key = 0;       // stream hash combined with the preceding stream
+	uint64_t pre_hash = 0;  // touched ranges before the last rendered run
+	uint64_t post_hash = 0; // ... and after it
+	bool has_state = false;
+	uint32_t misses = 0;
+	uint64_t cooldown_until = 0; // list count
+	uint64_t last_use = 0;
+};
+
+struct DisplayListRange
+{
+	uint32_t begin = 0; // bytes
+	uint32_t end = 0;
+};
+
+// A rendered candidate waiting for its list to retire before the hash of
+// its result can be taken.
+struct DisplayListCachePending
+{
+	int entry = -1;
+	uint64_t key = 0;    // entry key when deferred; the slot may be reused
+	uint64_t signal = 0; // the list's SyncFull, 0 until signaled()
+	uint64_t pre_hash = 0;
+	std::vector<DisplayListRange> ranges;
+};
+
+struct DisplayListCache
+{
+	bool enabled = false;
+
+	// Current list
+	std::vector<uint32_t> words;
+	std::vector<uint32_t> command_words; // words per buffered command
+	std::vector<DisplayListRange> ranges;
+	uint64_t last_stream = 0;
+	// TMEM provenance of the current list
+	bool tmem_loaded = false;
+	bool tlut_loaded = false;
+	bool tlut_mode = true; // until the list sets other modes, assume on
+	bool inherits_tmem = false;
+
+	DisplayListCacheEntry entries[DISPLAY_LIST_CACHE_ENTRIES] = {};
+
+	// Timeline value covering everything enqueued before the current list,
+	// 0 while unknown (unsignaled work was enqueued, or a new processor).
+	uint64_t prior_signal = 0;
+	DisplayListCachePending pending;
+
+	// Totals
+	uint64_t lists = 0;
+	uint64_t candidates = 0;
+	uint64_t skipped = 0;
+	uint64_t skipped_words = 0;
+	uint64_t inherited = 0; // lists drawing with TMEM loaded by an earlier list
+	uint64_t busy = 0;     // candidates passed through, earlier lists still running
+	uint64_t recorded = 0; // deferred hashes taken
+	uint64_t dropped = 0;  // deferred hashes given up
+	uint64_t hashed_bytes = 0;
+	uint64_t hash_us = 0;
+};
+
+inline void display_list_cache_add(DisplayListCache &c, const uint32_t *words, uint32_t count)
+{
+	c.words.insert(c.words.end(), words, words + count);
+	c.command_words.push_back(count);
+
+	switch ((words[0] >> 24) & 63)
+	{
+	case 0x0a: // TextureTriangle
+	case 0x0b: // TextureZBufferTriangle
+	case 0x0e: // ShadeTextureTriangle
+	case 0x0f: // ShadeTextureZBufferTriangle
+	case 0x24: // TextureRectangle
+	case 0x25: // TextureRectangleFlip
+		if (!c.tmem_loaded || (c.tlut_mode && !c.tlut_loaded))
+			c.inherits_tmem = true;
+		break;
+	case 0x2f: // SetOtherModes
+		c.tlut_mode = (words[0] >> 15) & 1;
+		break;
+	case 0x30: // LoadTLut
+		c.tlut_loaded = true;
+		break;
+	case 0x33: // LoadBlock
+	case 0x34: // LoadTile
+		c.tmem_loaded = true;
+		break;
+	default:
+		break;
+	}
+}
+
+// Byte range [begin, end) of RDRAM read or written by the current list.
+inline void display_list_cache_add_range(DisplayListCache &c, uint32_t begin, uint32_t end)
+{
+	if (end <= begin)
+		return;
+	// Triangles re-report the same color/depth range; skip the common repeats.
+	const size_t n = c.ranges.size();
+	for (size_t i = n > 2 ? n - 2 : 0; i < n; i++)
+		if (c.ranges[i].begin == begin && c.ranges[i].end == end)
+			return;
+	c.ranges.push_back({ begin, end });
+}
+
+// Hash the buffered command stream. Returns the entry index when this
+// stream (following the same preceding stream, as a stand-in for the RDP
+// state it inherits) has been seen before and is worth checking, else -1.
+int display_list_cache_match(DisplayListCache &c);
+
+// Hash the contents of every touched range. All earlier lists must have
+// retired so rdram holds their results.
+uint64_t display_list_cache_state_hash(DisplayListCache &c, const uint8_t *rdram, uint32_t rdram_size);
+
+// True if the last rendered run of this entry started from pre_hash and
+// left it unchanged, i.e. rendering it again is a no-op.
+bool display_list_cache_should_skip(DisplayListCache &c, int entry, uint64_t pre_hash);
+
+// Store the state before and after a rendered candidate list.
+void display_list_cache_record(DisplayListCache &c, int entry, uint64_t pre_hash, uint64_t post_hash);
+
+// The current list was enqueued as a candidate: keep its ranges to hash
+// its result once it has retired. Call before clear().
+void display_list_cache_defer(DisplayListCache &c, int entry, uint64_t pre_hash);
+
+// The list just flushed was signaled on the timeline with signal.
+void display_list_cache_signaled(DisplayListCache &c, uint64_t signal);
+
+// The deferred list has retired: hash its ranges and record the entry.
+void display_list_cache_complete(DisplayListCache &c, const uint8_t *rdram, uint32_t rdram_size);
+
+// Give up on the deferred hash, e.g. before work that may write its ranges.
+void display_list_cache_drop_pending(DisplayListCache &c);
+
+// True if [begin, end) overlaps a range of the deferred list.
+bool display_list_cache_pending_overlaps(const DisplayListCache &c, uint32_t begin, uint32_t end);
+
+// The timeline values no longer apply (the processor was replaced).
+void display_list_cache_forget_signals(DisplayListCache &c);
+
+// Drop the buffered list (after it was enqueued or skipped).
+void display_list_cache_clear(DisplayListCache &c);
+
+// One-line summary for the log.
+void display_list_cache_report(const DisplayListCache &c, const char *when);
@@ -16,9 +16,12 @@
 #include <cstring>
 #include <cerrno>
 #include <cstdlib>
+#include <cmath>
+#include <strings.h>
 #include <vector>
 #include <fcntl.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 
@@ -173,6 +176,55 @@ static uint32_t find_plane_by_type(int fd, uint32_t crtc_id, uint64_t plane_type
 	return result;
 }
 
+// Record the CRTC properties the colour and border offloads use. The
+// background property has no settled name across drivers.
+static void probe_crtc_properties(DrmDisplay &d)
+{
+	drmModeObjectProperties *props = drmModeObjectGetProperties(d.fd, d.crtc_id, DRM_MODE_OBJECT_CRTC);
+	if (!props)
+	{
+		fprintf(stderr, "[drm_display] CRTC properties unavailable: %s\n", strerror(errno));
+		return;
+	}
+
+	for (uint32_t i = 0; i < props->count_props; i++)
+	{
+		drmModePropertyRes *prop = drmModeGetProperty(d.fd, props->props[i]);
+		if (!prop)
+			continue;
+		if (strcmp(prop->name, "GAMMA_LUT") == 0)
+			d.gamma_lut_prop = prop->prop_id;
+		else if (strcmp(prop->name, "GAMMA_LUT_SIZE") == 0)
+			d.gamma_lut_size = uint32_t(props->prop_values[i]);
+		else if (strcmp(prop->name, "CTM") == 0)
+			d.ctm_prop = prop->prop_id;
+		else if (strcasecmp(prop->name, "BACKGROUND_COLOR") == 0 || strcasecmp(prop->name, "bg_color") == 0)
+			d.background_prop = prop->prop_id;
+		drmModeFreeProperty(prop);
+	}
+	drmModeFreeObjectProperties(props);
+
+	if (d.gamma_lut_prop && d.gamma_lut_size < 2)
+		d.gamma_lut_prop = 0;
+	fprintf(stderr, "[drm_display] CRTC properties: GAMMA_LUT=%s(size=%u) CTM=%s background=%s\n",
+	        d.gamma_lut_prop ? "yes" : "no", d.gamma_lut_size,
+	        d.ctm_prop ? "yes" : "no", d.background_prop ? "yes" : "no");
+}
+
+// Put GAMMA_LUT and the background back to the driver defaults (no LUT,
+// transparent black). A crashed or killed session never reaches cleanup,
+// so init clears whatever it left behind before using either property.
+static void reset_crtc_properties(DrmDisplay &d)
+{
+	if (d.gamma_lut_prop &&
+	    drmModeObjectSetProperty(d.fd, d.crtc_id, DRM_MODE_OBJECT_CRTC, d.gamma_lut_prop, 0) < 0)
+		fprintf(stderr, "[drm_display] reset GAMMA_LUT: %s\n", strerror(errno));
+	if (d.background_prop &&
+	    drmModeObjectSetProperty(d.fd, d.crtc_id, DRM_MODE_OBJECT_CRTC, d.background_prop, 0) < 0)
+		fprintf(stderr, "[drm_display] reset CRTC background: %s\n", strerror(errno));
+	d.gamma_enabled = false;
+}
+
 static void init_debug_flags(DrmDisplay &d)
 {
 	if (d.debug_flags_initialized)
@@ -204,6 +256,9 @@ static void wait_vblank(DrmDisplay &d)
 	if (d.debug_no_vblank_sync)
 		return;
 
+	struct timespec t0 = {}, t1 = {};
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
 	drmVBlank vbl = {};
 	vbl.request.type = DRM_VBLANK_RELATIVE;
 	vbl.request.sequence = 1;
@@ -212,6 +267,78 @@ static void wait_vblank(DrmDisplay &d)
 		fprintf(stderr, "[drm_display] drmWaitVBlank failed: %s\n", strerror(errno));
 		d.vblank_error_logged = true;
 	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	int64_t waited_ns = int64_t(t1.tv_sec - t0.tv_sec) * 1000000000ll + (t1.tv_nsec - t0.tv_nsec);
+	if (waited_ns > 0)
+		d.vblank_wait_us += uint64_t(waited_ns) / 1000;
+}
+
+// Current vblank sequence number (a relative wait of zero returns at once).
+static bool vblank_sequence(DrmDisplay &d, uint32_t &sequence)
+{
+	drmVBlank vbl = {};
+	vbl.request.type = DRM_VBLANK_RELATIVE;
+	vbl.request.sequence = 0;
+	if (drmWaitVBlank(d.fd, &vbl) < 0)
+		return false;
+	sequence = vbl.reply.sequence;
+	return true;
+}
+
+// Cadence pacing: hold the flip until enough vblanks have passed since the
+// previous flip latched.
+static void pacing_wait(DrmDisplay &d)
+{
+	if (d.pacing.policy != FRAME_PACING_CADENCE || !d.flip_latch_valid)
+		return;
+	uint32_t sequence = 0;
+	if (!vblank_sequence(d, sequence))
+		return;
+	const int32_t since_latch = int32_t(sequence - d.flip_latch_sequence);
+	for (uint32_t n = frame_pacing_flip_waits(d.pacing, since_latch); n; n--)
+		wait_vblank(d);
+}
+
+// A flip was just queued: it latches on the next vblank.
+static void note_flip_queued(DrmDisplay &d)
+{
+	if (d.pacing.policy != FRAME_PACING_CADENCE)
+		return;
+	uint32_t sequence = 0;
+	d.flip_latch_valid = vblank_sequence(d, sequence);
+	d.flip_latch_sequence = sequence + 1;
+}
+
+// PageFlip under the pacing policy. Returns false when the frame was
+// dropped (drop-busy) or the flip failed; what prefixes the error message.
+static bool queue_page_flip(DrmDisplay &d, uint32_t fb_id, const char *what)
+{
+	pacing_wait(d);
+	int err = drmModePageFlip(d.fd, d.crtc_id, fb_id, 0, nullptr);
+	if (err < 0 && errno == EBUSY)
+	{
+		d.flip_busy_count++;
+		if (frame_pacing_on_busy(d.pacing) == FRAME_PACING_DROP)
+		{
+			d.pacing_drops++;
+			return false;
+		}
+		// Previous flip not yet completed — wait for vblank and retry.
+		wait_vblank(d);
+		err = drmModePageFlip(d.fd, d.crtc_id, fb_id, 0, nullptr);
+	}
+	if (err < 0)
+	{
+		if (!d.setcrtc_error_logged)
+		{
+			fprintf(stderr, "[drm_display] %spageFlip: %s\n", what, strerror(errno));
+			d.setcrtc_error_logged = true;
+		}
+		return false;
+	}
+	note_flip_queued(d);
+	return true;
 }
 
 bool drm_display_init(DrmDisplay &d)
@@ -225,8 +352,17 @@ bool drm_display_init(DrmDisplay &d)
 		return false;
 	}
 
-	// Need master for modesetting
-	drmSetMaster(d.fd);
+	// Need master for modesetting. Failure usually means another client
+	// (e.g. an SDL KMSDRM video driver) still holds it.
+	if (drmSetMaster(d.fd) == 0)
+	{
+		d.is_master = true;
+		fprintf(stderr, "[drm_display] Acquired DRM master\n");
+	}
+	else
+	{
+		fprintf(stderr, "[drm_display] drmSetMaster failed: %s (another DRM master active?)\n", strerror(errno));
+	}
 
 	// Enable universal planes
 	drmSetClientCap(d.fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1);
@@ -346,6 +482,9 @@ found_crtc:
 		// Not fatal - we'll use drmModeSetCrtc instead of SetPlane
 	}
 
+	probe_crtc_properties(d);
+	reset_crtc_properties(d);
+
 	// Set the CRTC mode with a proper display-sized buffer.
 	// This ensures the display pipeline is fully initialized.
 	if (!create_dumb_buffer(d.fd, d.mode_buf, d.display_width, d.display_height))
@@ -489,45 +628,188 @@ static void neon_row_rgba_to_xrgb_4x(const uint8_t *src, uint8_t *dst, uint32_t
 
 #endif // __aarch64__
 
-// Scalar row conversion — format convert + optional nearest-neighbor horizontal scale.
+// Scalar row conversion — format convert + nearest-neighbor horizontal scale
+// through the plan's column map (source byte offset per destination pixel).
 static void scalar_row_rgba_to_xrgb(const uint8_t *src, uint8_t *dst,
-                                     uint32_t src_width, uint32_t dst_width)
+                                     const uint32_t *col_map, uint32_t dst_width)
 {
 	uint32_t *out = reinterpret_cast<uint32_t *>(dst);
 	for (uint32_t x = 0; x < dst_width; x++)
 	{
-		uint32_t src_x = (x * src_width) / dst_width;
-		if (src_x >= src_width) src_x = src_width - 1;
-		const uint8_t *p = src + src_x * 4;
+		const uint8_t *p = src + col_map[x];
 		out[x] = (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | uint32_t(p[2]);
 	}
 }
 
+// ---------------------------------------------------------------------------
+// RDRAM row conversion for the VI-lite present. RDRAM is kept as host-order
+// 32-bit words: a 32-bit pixel is one word (R in the top byte), and the two
+// 16-bit pixels of a word are swapped in memory.
 // ---------------------------------------------------------------------------
 
-bool drm_display_present(DrmDisplay &d, const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t stride)
+static inline uint32_t rgba5551_to_xrgb(uint32_t v)
 {
-	init_debug_flags(d);
+	const uint32_t r = (v >> 11) & 0x1f, g = (v >> 6) & 0x1f, b = (v >> 1) & 0x1f;
+	return (((r << 3) | (r >> 2)) << 16) | (((g << 3) | (g >> 2)) << 8) | ((b << 3) | (b >> 2));
+}
 
-	const uint32_t min_stride = width * 4;
-	if (stride < min_stride)
+// Convert pixel_count pixels of the RDRAM row at byte address row into XRGB.
+// row must be aligned to the pixel size.
+static void rdram_row_to_xrgb(const uint8_t *rdram, uint32_t row, uint32_t pixel_bytes,
+                              uint32_t *dst, uint32_t pixel_count)
+{
+	uint32_t x = 0;
+	if (pixel_bytes == 4)
 	{
-		fprintf(stderr, "[drm_display] Invalid source stride: stride=%u width=%u (need >= %u)\n",
-		        stride, width, min_stride);
-		return false;
+		const uint32_t *src = reinterpret_cast<const uint32_t *>(rdram + row);
+#ifdef __aarch64__
+		const uint32_t neon_end = pixel_count & ~3u;
+		for (; x < neon_end; x += 4)
+			vst1q_u32(dst + x, vshrq_n_u32(vld1q_u32(src + x), 8));
+#endif
+		for (; x < pixel_count; x++)
+			dst[x] = src[x] >> 8;
+		return;
 	}
 
-	// Always allocate at display resolution.  The Allwinner DE3.3 hw scaler
-	// corrupts non-uniform patterns, so we CPU-upscale and PageFlip at 1:1.
-	const uint32_t alloc_width = d.display_width;
-	const uint32_t alloc_height = d.display_height;
+#ifdef __aarch64__
+	// Word-aligned rows: eight pixels (four words) per iteration.
+	if ((row & 3) == 0)
+	{
+		const uint16_t *src = reinterpret_cast<const uint16_t *>(rdram + row);
+		const uint32_t neon_end = pixel_count & ~7u;
+		for (; x < neon_end; x += 8)
+		{
+			const uint16x8_t px = vrev32q_u16(vld1q_u16(src + x));
+			const uint8x8_t r5 = vmovn_u16(vshrq_n_u16(px, 11));
+			const uint8x8_t g5 = vand_u8(vmovn_u16(vshrq_n_u16(px, 6)), vdup_n_u8(0x1f));
+			const uint8x8_t b5 = vand_u8(vmovn_u16(vshrq_n_u16(px, 1)), vdup_n_u8(0x1f));
+			uint8x8x4_t out;
+			out.val[0] = vorr_u8(vshl_n_u8(b5, 3), vshr_n_u8(b5, 2));
+			out.val[1] = vorr_u8(vshl_n_u8(g5, 3), vshr_n_u8(g5, 2));
+			out.val[2] = vorr_u8(vshl_n_u8(r5, 3), vshr_n_u8(r5, 2));
+			out.val[3] = vdup_n_u8(0);
+			vst4_u8(reinterpret_cast<uint8_t *>(dst + x), out);
+		}
+	}
+#endif
+	for (; x < pixel_count; x++)
+		dst[x] = rgba5551_to_xrgb(*reinterpret_cast<const uint16_t *>(rdram + ((row + x * 2) ^ 2)));
+}
 
-	if (!d.buffers_ready || d.src_width != width || d.src_height != height)
+// Horizontal expand of an XRGB row by the plan's kernel.
+static void xrgb_row_expand(const uint32_t *src, uint32_t *dst, const DrmDisplay::BlitPlan &plan)
+{
+	uint32_t x = 0;
+	if (plan.kernel == DRM_BLIT_2X)
 	{
-		// Clean up old buffers
-		for (int i = 0; i < 2; i++)
-			destroy_dumb_buffer(d.fd, d.buffers[i]);
+#ifdef __aarch64__
+		const uint32_t neon_end = plan.src_width & ~3u;
+		for (; x < neon_end; x += 4)
+		{
+			const uint32x4_t px = vld1q_u32(src + x);
+			const uint32x4x2_t dup = vzipq_u32(px, px);
+			vst1q_u32(dst + x * 2, dup.val[0]);
+			vst1q_u32(dst + x * 2 + 4, dup.val[1]);
+		}
+#endif
+		for (; x < plan.src_width; x++)
+			dst[x * 2] = dst[x * 2 + 1] = src[x];
+	}
+	else if (plan.kernel == DRM_BLIT_4X)
+	{
+		for (; x < plan.src_width; x++)
+		{
+#ifdef __aarch64__
+			vst1q_u32(dst + x * 4, vdupq_n_u32(src[x]));
+#else
+			dst[x * 4] = dst[x * 4 + 1] = dst[x * 4 + 2] = dst[x * 4 + 3] = src[x];
+#endif
+		}
+	}
+	else
+	{
+		// Column map offsets are in 4-byte source pixels, as for RGBA.
+		const uint32_t *col_map = plan.col_map.data();
+		for (; x < plan.dst_width; x++)
+			dst[x] = src[col_map[x] >> 2];
+	}
+}
+
+static const char *const blit_kernel_names[] = { "1:1", "2x", "4x", "generic" };
+
+// Find or build the blit plan for a source geometry. The least recently
+// used plan is rebuilt when all slots are taken.
+static DrmDisplay::BlitPlan &get_blit_plan(DrmDisplay &d, uint32_t width, uint32_t height,
+                                           uint32_t dst_width, uint32_t dst_height)
+{
+	const uint64_t use = uint64_t(d.frame_count) + 1;
+	int slot = 0;
+	for (int i = 0; i < DRM_DISPLAY_BLIT_PLANS; i++)
+	{
+		DrmDisplay::BlitPlan &plan = d.blit_plans[i];
+		if (plan.last_use && plan.src_width == width && plan.src_height == height &&
+		    plan.dst_width == dst_width && plan.dst_height == dst_height)
+		{
+			plan.last_use = use;
+			d.active_plan = i;
+			return plan;
+		}
+		if (plan.last_use < d.blit_plans[slot].last_use)
+			slot = i;
+	}
+
+	DrmDisplay::BlitPlan &plan = d.blit_plans[slot];
+	plan.src_width = width;
+	plan.src_height = height;
+	plan.dst_width = dst_width;
+	plan.dst_height = dst_height;
+	plan.last_use = use;
+
+	if (width == dst_width)
+		plan.kernel = DRM_BLIT_1TO1;
+	else if (dst_width == width * 2)
+		plan.kernel = DRM_BLIT_2X;
+	else if (dst_width == width * 4)
+		plan.kernel = DRM_BLIT_4X;
+	else
+		plan.kernel = DRM_BLIT_GENERIC;
+
+	// Fixed-point nearest-neighbor selection, as the per-pixel path did.
+	plan.row_map.resize(dst_height);
+	for (uint32_t dst_y = 0; dst_y < dst_height; dst_y++)
+	{
+		uint32_t src_y = (dst_y * height) / dst_height;
+		plan.row_map[dst_y] = src_y < height ? src_y : height - 1;
+	}
+	plan.col_map.resize(dst_width);
+	for (uint32_t dst_x = 0; dst_x < dst_width; dst_x++)
+	{
+		uint32_t src_x = (dst_x * width) / dst_width;
+		plan.col_map[dst_x] = (src_x < width ? src_x : width - 1) * 4;
+	}
+
+	d.active_plan = slot;
+	const char *v_tag = (height == dst_height) ? "1:1" : (height > dst_height) ? "down" : "up";
+	fprintf(stderr, "[drm_display] Blit plan %d: %ux%u -> %ux%u  H=%s V=%s\n",
+	        slot, width, height, dst_width, dst_height, blit_kernel_names[plan.kernel], v_tag);
+	return plan;
+}
+
+// ---------------------------------------------------------------------------
 
+// Allocate the display-sized buffers on first use and track the source
+// geometry. Returns false if allocation fails.
+static bool prepare_buffers(DrmDisplay &d, uint32_t width, uint32_t height)
+{
+	// Always allocate at display resolution (or the active area).  The
+	// Allwinner DE3.3 hw scaler corrupts non-uniform patterns, so we
+	// CPU-upscale and PageFlip/SetPlane at 1:1.
+	const uint32_t alloc_width = d.active_area ? d.area_width : d.display_width;
+	const uint32_t alloc_height = d.active_area ? d.area_height : d.display_height;
+
+	if (!d.buffers_ready)
+	{
 		d.src_width = width;
 		d.src_height = height;
 
@@ -549,81 +831,49 @@ bool drm_display_present(DrmDisplay &d, const uint8_t *rgba, uint32_t width, uin
 		        width, height,
 		        d.display_width, d.display_height);
 	}
-
-	DrmDisplay::DumbBuffer &buf = d.buffers[d.current_buffer];
-
-	if (d.debug_test_pattern)
+	else if (d.src_width != width || d.src_height != height)
 	{
-		// Deterministic pattern to isolate DRM path from Vulkan readback path.
-		uint8_t phase = uint8_t((d.frame_count * 3) & 0xFF);
-		for (uint32_t y = 0; y < buf.height; y++)
-		{
-			uint32_t *dst_row = (uint32_t *)(buf.map + y * buf.stride);
-			for (uint32_t x = 0; x < buf.width; x++)
-			{
-				uint8_t r = uint8_t((x + phase) & 0xFF);
-				uint8_t g = uint8_t((y * 2 + phase) & 0xFF);
-				uint8_t b = uint8_t(((x ^ y) + phase) & 0xFF);
-
-				if ((x % 64) == 0 || (y % 32) == 0)
-				{
-					r = g = b = 255;
-				}
-				if (x < 3 || y < 3 || x >= buf.width - 3 || y >= buf.height - 3)
-				{
-					r = 255; g = 0; b = 0;
-				}
-				dst_row[x] = (r << 16) | (g << 8) | b;
-			}
-		}
+		// The buffers are display-sized whatever the source is; only the
+		// blit plan changes.
+		fprintf(stderr, "[drm_display] Source geometry %ux%u -> %ux%u (buffers kept)\n",
+		        d.src_width, d.src_height, width, height);
+		d.src_width = width;
+		d.src_height = height;
+		d.geometry_changes++;
 	}
-	else
-	{
-		// Copy scanout pixels into dumb buffer.
-		// Input is RGBA8888.  FB is XRGB8888.
-		//
-		// Unified per-axis blit: fixed-point vertical row selection handles
-		// upscale, downscale, or 1:1.  Horizontal dispatch picks the best
-		// NEON (or scalar) path for the detected ratio.
-
-		const bool h_exact   = (width == buf.width);
-		const bool h_up_2x   = (!h_exact && width > 0 && buf.width == width * 2);
-		const bool h_up_4x   = (!h_exact && width > 0 && buf.width == width * 4);
 
-		if (!d.blit_path_logged)
-		{
-			const char *h_tag = h_exact ? "1:1" : h_up_2x ? "2x" : h_up_4x ? "4x" : "generic";
-			const char *v_tag = (height == buf.height)  ? "1:1"
-			                  : (height > buf.height)    ? "down"
-			                                             : "up";
-			fprintf(stderr,
-			        "[drm_display] Blit path: %ux%u -> %ux%u  H=%s V=%s\n",
-			        width, height, buf.width, buf.height, h_tag, v_tag);
-			d.blit_path_logged = true;
-		}
+	return true;
+}
 
-		for (uint32_t dst_y = 0; dst_y < buf.height; dst_y++)
+// Deterministic pattern to isolate the DRM path from the pixel source.
+static void fill_test_pattern(DrmDisplay &d, DrmDisplay::DumbBuffer &buf)
+{
+	uint8_t phase = uint8_t((d.frame_count * 3) & 0xFF);
+	for (uint32_t y = 0; y < buf.height; y++)
+	{
+		uint32_t *dst_row = (uint32_t *)(buf.map + y * buf.stride);
+		for (uint32_t x = 0; x < buf.width; x++)
 		{
-			// Fixed-point nearest-neighbor vertical row selection.
-			uint32_t src_y = (dst_y * height) / buf.height;
-			if (src_y >= height) src_y = height - 1;
-
-			const uint8_t *src_row = rgba + src_y * stride;
-			uint8_t *dst_row = buf.map + dst_y * buf.stride;
+			uint8_t r = uint8_t((x + phase) & 0xFF);
+			uint8_t g = uint8_t((y * 2 + phase) & 0xFF);
+			uint8_t b = uint8_t(((x ^ y) + phase) & 0xFF);
 
-#ifdef __aarch64__
-			if (h_exact)
-				neon_row_rgba_to_xrgb_1to1(src_row, dst_row, buf.width);
-			else if (h_up_2x)
-				neon_row_rgba_to_xrgb_2x(src_row, dst_row, width);
-			else if (h_up_4x)
-				neon_row_rgba_to_xrgb_4x(src_row, dst_row, width);
-			else
-#endif
-				scalar_row_rgba_to_xrgb(src_row, dst_row, width, buf.width);
+			if ((x % 64) == 0 || (y % 32) == 0)
+			{
+				r = g = b = 255;
+			}
+			if (x < 3 || y < 3 || x >= buf.width - 3 || y >= buf.height - 3)
+			{
+				r = 255; g = 0; b = 0;
+			}
+			dst_row[x] = (r << 16) | (g << 8) | b;
 		}
 	}
+}
 
+// Make the CPU writes to buf visible and flip to it.
+static bool submit_buffer(DrmDisplay &d, DrmDisplay::DumbBuffer &buf)
+{
 	if (d.debug_force_msync)
 	{
 		long page_size = sysconf(_SC_PAGESIZE);
@@ -660,6 +910,32 @@ bool drm_display_present(DrmDisplay &d, const uint8_t *rgba, uint32_t width, uin
 		drmModeDirtyFB(d.fd, buf.fb_id, nullptr, 0);
 	}
 
+	// Active area: the buffer is smaller than the mode, so it is placed
+	// with a 1:1 SetPlane (paced to vblank by the driver) and the CRTC
+	// background shows around it.
+	if (d.active_area)
+	{
+		pacing_wait(d);
+		int err = drmModeSetPlane(d.fd, d.plane_id, d.crtc_id, buf.fb_id, 0,
+		                          int32_t(d.area_x), int32_t(d.area_y), buf.width, buf.height,
+		                          0, 0, buf.width << 16, buf.height << 16);
+		if (err < 0)
+		{
+			if (!d.setcrtc_error_logged)
+			{
+				fprintf(stderr, "[drm_display] active-area setPlane: %s\n", strerror(errno));
+				d.setcrtc_error_logged = true;
+			}
+			return false;
+		}
+		d.mode_set = true;
+		d.plane_shrunk = true;
+		note_flip_queued(d);
+		d.current_buffer ^= 1;
+		d.frame_count++;
+		return true;
+	}
+
 	// The initial SetCrtc in drm_display_init() established the mode.
 	// For frame updates we use PageFlip: it queues a buffer swap at the
 	// next vblank without blocking, unlike SetCrtc which does a full modeset.
@@ -677,33 +953,207 @@ bool drm_display_present(DrmDisplay &d, const uint8_t *rgba, uint32_t width, uin
 		}
 		d.mode_set = true;
 	}
-	else
+	else if (!queue_page_flip(d, buf.fb_id, ""))
+	{
+		return false;
+	}
+
+	d.current_buffer ^= 1;
+	d.frame_count++;
+	return true;
+}
+
+bool drm_display_present(DrmDisplay &d, const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t stride)
+{
+	init_debug_flags(d);
+
+	const uint32_t min_stride = width * 4;
+	if (stride < min_stride)
+	{
+		fprintf(stderr, "[drm_display] Invalid source stride: stride=%u width=%u (need >= %u)\n",
+		        stride, width, min_stride);
+		return false;
+	}
+
+	if (!prepare_buffers(d, width, height))
+		return false;
+
+	DrmDisplay::DumbBuffer &buf = d.buffers[d.current_buffer];
+	if (d.debug_test_pattern)
+	{
+		fill_test_pattern(d, buf);
+		return submit_buffer(d, buf);
+	}
+
+	// Copy scanout pixels into dumb buffer.
+	// Input is RGBA8888.  FB is XRGB8888.
+	//
+	// The cached plan holds the vertical row map and the horizontal
+	// kernel (NEON for exact 1:1/2x/4x ratios, column map otherwise).
+	const DrmDisplay::BlitPlan &plan = get_blit_plan(d, width, height, buf.width, buf.height);
+	const uint32_t *row_map = plan.row_map.data();
+	const uint32_t *col_map = plan.col_map.data();
+
+	for (uint32_t dst_y = 0; dst_y < buf.height; dst_y++)
 	{
-		int err = drmModePageFlip(d.fd, d.crtc_id, buf.fb_id, 0, nullptr);
-		if (err < 0 && errno == EBUSY)
+		const uint8_t *src_row = rgba + row_map[dst_y] * stride;
+		uint8_t *dst_row = buf.map + dst_y * buf.stride;
+
+#ifdef __aarch64__
+		if (plan.kernel == DRM_BLIT_1TO1)
+			neon_row_rgba_to_xrgb_1to1(src_row, dst_row, buf.width);
+		else if (plan.kernel == DRM_BLIT_2X)
+			neon_row_rgba_to_xrgb_2x(src_row, dst_row, width);
+		else if (plan.kernel == DRM_BLIT_4X)
+			neon_row_rgba_to_xrgb_4x(src_row, dst_row, width);
+		else
+#endif
+			scalar_row_rgba_to_xrgb(src_row, dst_row, col_map, buf.width);
+	}
+
+	return submit_buffer(d, buf);
+}
+
+bool drm_display_present_rdram(DrmDisplay &d, const uint8_t *rdram, uint32_t rdram_size, const ViLiteFrame &f)
+{
+	init_debug_flags(d);
+
+	if (f.pixel_bytes != 2 && f.pixel_bytes != 4)
+		return false;
+	if ((f.origin & (f.pixel_bytes - 1)) || f.origin >= rdram_size || f.bytes() > rdram_size - f.origin)
+		return false;
+
+	if (!prepare_buffers(d, f.width, f.height))
+		return false;
+
+	DrmDisplay::DumbBuffer &buf = d.buffers[d.current_buffer];
+	if (d.debug_test_pattern)
+	{
+		fill_test_pattern(d, buf);
+		return submit_buffer(d, buf);
+	}
+
+	// RGBA5551/8888 in RDRAM -> XRGB8888. 1:1 rows are converted straight
+	// into the buffer; scaled rows go through one converted source row,
+	// which vertical duplicates reuse rather than reading the (uncached)
+	// buffer back.
+	const DrmDisplay::BlitPlan &plan = get_blit_plan(d, f.width, f.height, buf.width, buf.height);
+	const uint32_t row_bytes = f.line * f.pixel_bytes;
+	if (d.rdram_row.size() < f.width)
+		d.rdram_row.resize(f.width);
+	uint32_t converted_row = UINT32_MAX;
+
+	for (uint32_t dst_y = 0; dst_y < buf.height; dst_y++)
+	{
+		const uint32_t src_y = plan.row_map[dst_y];
+		const uint32_t src_row = f.origin + src_y * row_bytes;
+		uint32_t *dst_row = reinterpret_cast<uint32_t *>(buf.map + dst_y * buf.stride);
+
+		if (plan.kernel == DRM_BLIT_1TO1)
 		{
-			// Previous flip not yet completed — wait for vblank and retry.
-			wait_vblank(d);
-			err = drmModePageFlip(d.fd, d.crtc_id, buf.fb_id, 0, nullptr);
+			rdram_row_to_xrgb(rdram, src_row, f.pixel_bytes, dst_row, buf.width);
+			continue;
 		}
-		if (err < 0)
+		if (src_y != converted_row)
 		{
-			if (!d.setcrtc_error_logged)
-			{
-				fprintf(stderr, "[drm_display] pageFlip: %s\n", strerror(errno));
-				d.setcrtc_error_logged = true;
-			}
+			rdram_row_to_xrgb(rdram, src_row, f.pixel_bytes, d.rdram_row.data(), f.width);
+			converted_row = src_y;
+		}
+		xrgb_row_expand(d.rdram_row.data(), dst_row, plan);
+	}
+
+	return submit_buffer(d, buf);
+}
+
+bool drm_display_set_gamma(DrmDisplay &d, bool enable)
+{
+	if (!d.gamma_lut_prop)
+		return false;
+	if (enable == d.gamma_enabled)
+		return true;
+
+	if (enable && !d.gamma_blob_id)
+	{
+		// VI gamma is a square root curve over the full range.
+		std::vector<drm_color_lut> lut(d.gamma_lut_size);
+		for (uint32_t i = 0; i < d.gamma_lut_size; i++)
+		{
+			const double x = double(i) / double(d.gamma_lut_size - 1);
+			const uint16_t v = uint16_t(sqrt(x) * 65535.0 + 0.5);
+			lut[i].red = lut[i].green = lut[i].blue = v;
+			lut[i].reserved = 0;
+		}
+		if (drmModeCreatePropertyBlob(d.fd, lut.data(), lut.size() * sizeof(drm_color_lut), &d.gamma_blob_id) < 0)
+		{
+			fprintf(stderr, "[drm_display] gamma LUT blob: %s\n", strerror(errno));
+			d.gamma_lut_prop = 0;
 			return false;
 		}
 	}
 
-	d.current_buffer ^= 1;
-	d.frame_count++;
+	if (drmModeObjectSetProperty(d.fd, d.crtc_id, DRM_MODE_OBJECT_CRTC, d.gamma_lut_prop,
+	                             enable ? d.gamma_blob_id : 0) < 0)
+	{
+		fprintf(stderr, "[drm_display] set GAMMA_LUT: %s\n", strerror(errno));
+		d.gamma_lut_prop = 0;
+		return false;
+	}
+	d.gamma_enabled = enable;
+	fprintf(stderr, "[drm_display] CRTC gamma %s\n", enable ? "on" : "off");
+	return true;
+}
+
+bool drm_display_enable_active_area(DrmDisplay &d)
+{
+	if (d.buffers_ready || !d.plane_id || !d.background_prop)
+		return false;
+
+	// Opaque black; the background is 16 bits per channel, alpha on top.
+	if (drmModeObjectSetProperty(d.fd, d.crtc_id, DRM_MODE_OBJECT_CRTC, d.background_prop,
+	                             0xffff000000000000ull) < 0)
+	{
+		fprintf(stderr, "[drm_display] set CRTC background: %s\n", strerror(errno));
+		return false;
+	}
+
+	// 4:3 image, as tall as the display allows.
+	d.area_height = d.display_height;
+	d.area_width = (d.display_height * 4 / 3) & ~1u;
+	if (d.area_width > d.display_width)
+	{
+		d.area_width = d.display_width;
+		d.area_height = (d.display_width * 3 / 4) & ~1u;
+	}
+	d.area_x = (d.display_width - d.area_width) / 2;
+	d.area_y = (d.display_height - d.area_height) / 2;
+
+	// Primary planes may be required to cover the whole CRTC; try the
+	// placement with the (black) mode-set buffer first.
+	if (d.mode_buf.fb_id &&
+	    drmModeSetPlane(d.fd, d.plane_id, d.crtc_id, d.mode_buf.fb_id, 0,
+	                    int32_t(d.area_x), int32_t(d.area_y), d.area_width, d.area_height,
+	                    0, 0, d.area_width << 16, d.area_height << 16) < 0)
+	{
+		fprintf(stderr, "[drm_display] Active area rejected by the plane: %s\n", strerror(errno));
+		drmModeSetCrtc(d.fd, d.crtc_id, d.mode_buf.fb_id, 0, 0, &d.connector_id, 1, &d.mode_info);
+		return false;
+	}
+	d.active_area = true;
+	d.plane_shrunk = true;
+	fprintf(stderr, "[drm_display] Active area %ux%u at %u,%u, borders from the CRTC background\n",
+	        d.area_width, d.area_height, d.area_x, d.area_y);
 	return true;
 }
 
 bool drm_display_flip(DrmDisplay &d, uint32_t fb_id)
 {
+	// A display-sized buffer after active-area frames: SetCrtc resets the
+	// plane to the full mode, PageFlip would keep the small rectangle.
+	if (d.plane_shrunk)
+	{
+		d.mode_set = false;
+		d.plane_shrunk = false;
+	}
 	if (!d.mode_set)
 	{
 		int err = drmModeSetCrtc(d.fd, d.crtc_id, fb_id, 0, 0,
@@ -715,41 +1165,95 @@ bool drm_display_flip(DrmDisplay &d, uint32_t fb_id)
 		}
 		d.mode_set = true;
 	}
-	else
+	else if (!queue_page_flip(d, fb_id, "flip: "))
 	{
-		int err = drmModePageFlip(d.fd, d.crtc_id, fb_id, 0, nullptr);
-		if (err < 0 && errno == EBUSY)
-		{
-			wait_vblank(d);
-			err = drmModePageFlip(d.fd, d.crtc_id, fb_id, 0, nullptr);
-		}
-		if (err < 0)
-		{
-			if (!d.setcrtc_error_logged)
-			{
-				fprintf(stderr, "[drm_display] flip: pageFlip: %s\n", strerror(errno));
-				d.setcrtc_error_logged = true;
-			}
-			return false;
-		}
+		return false;
 	}
 	d.frame_count++;
 	return true;
 }
 
+uint64_t drm_display_dumb_bytes(const DrmDisplay &d)
+{
+	uint64_t total = 0;
+	for (int i = 0; i < 2; i++)
+		if (d.buffers[i].handle)
+			total += d.buffers[i].size;
+	if (d.mode_buf.handle)
+		total += d.mode_buf.size;
+	return total;
+}
+
 void drm_display_cleanup(DrmDisplay &d)
 {
+	if (d.fd >= 0 && d.crtc_id)
+		reset_crtc_properties(d);
+	if (d.gamma_blob_id)
+	{
+		drmModeDestroyPropertyBlob(d.fd, d.gamma_blob_id);
+		d.gamma_blob_id = 0;
+	}
+
 	for (int i = 0; i < 2; i++)
 		destroy_dumb_buffer(d.fd, d.buffers[i]);
 	destroy_dumb_buffer(d.fd, d.mode_buf);
 
 	if (d.fd >= 0)
 	{
-		drmDropMaster(d.fd);
+		if (d.is_master)
+		{
+			if (drmDropMaster(d.fd) == 0)
+				fprintf(stderr, "[drm_display] Dropped DRM master\n");
+			else
+				fprintf(stderr, "[drm_display] drmDropMaster failed: %s\n", strerror(errno));
+			d.is_master = false;
+		}
 		close(d.fd);
 		d.fd = -1;
 	}
 
 	d.buffers_ready = false;
 	d.mode_set = false;
+	d.active_area = false;
+	d.plane_shrunk = false;
+	for (int i = 0; i < DRM_DISPLAY_BLIT_PLANS; i++)
+		d.blit_plans[i] = DrmDisplay::BlitPlan();
+	d.active_plan = -1;
+}
+
+extern "C" int drm_display_restore_crtc(void)
+{
+	DrmDisplay d;
+	d.fd = open("/dev/dri/card0", O_RDWR | O_CLOEXEC);
+	if (d.fd < 0)
+	{
+		fprintf(stderr, "[drm_display] Cannot open /dev/dri/card0: %s\n", strerror(errno));
+		return 1;
+	}
+	if (drmSetMaster(d.fd) != 0)
+		fprintf(stderr, "[drm_display] drmSetMaster failed: %s (another DRM master active?)\n", strerror(errno));
+
+	drmModeRes *res = drmModeGetResources(d.fd);
+	if (!res)
+	{
+		fprintf(stderr, "[drm_display] getResources: %s\n", strerror(errno));
+		close(d.fd);
+		return 1;
+	}
+	for (int i = 0; i < res->count_crtcs; i++)
+	{
+		d.crtc_id = res->crtcs[i];
+		d.gamma_lut_prop = 0;
+		d.gamma_lut_size = 0;
+		d.ctm_prop = 0;
+		d.background_prop = 0;
+		probe_crtc_properties(d);
+		reset_crtc_properties(d);
+	}
+	drmModeFreeResources(res);
+
+	drmDropMaster(d.fd);
+	close(d.fd);
+	d.fd = -1;
+	return 0;
 }
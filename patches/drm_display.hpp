@@ -4,17 +4,33 @@
  * Manages DRM/KMS modesetting and dumb buffer scanout with hardware
  * plane scaling. Used to bypass the broken VK_KHR_display on Mali-G57.
  *
- * Usage: init() -> present(pixels, w, h) in a loop -> cleanup()
+ * Usage: init() -> present(pixels, w, h) or present_rdram(rdram, frame)
+ *        in a loop -> cleanup()
  */
 
 #pragma once
 
 #include <cstdint>
+#include <vector>
 #include <xf86drmMode.h>
 
+#include "frame_pacing.hpp"
+#include "vi_lite.hpp"
+
+#define DRM_DISPLAY_BLIT_PLANS 4
+
+enum DrmBlitKernel : uint8_t
+{
+	DRM_BLIT_1TO1 = 0,
+	DRM_BLIT_2X = 1,
+	DRM_BLIT_4X = 2,
+	DRM_BLIT_GENERIC = 3,
+};
+
 struct DrmDisplay
 {
 	int fd = -1;
+	bool is_master = false;
 	uint32_t connector_id = 0;
 	uint32_t crtc_id = 0;
 	uint32_t plane_id = 0;
@@ -26,7 +42,7 @@ struct DrmDisplay
 	// Saved mode for deferred mode setting
 	drmModeModeInfo mode_info = {};
 
-	// Double-buffered dumb buffers (allocated at source resolution)
+	// Double-buffered dumb buffers (allocated once, at display resolution)
 	struct DumbBuffer
 	{
 		uint32_t handle = 0;
@@ -44,7 +60,29 @@ struct DrmDisplay
 	int current_buffer = 0;
 	int frame_count = 0;
 
-	// Source resolution (set on first present)
+	// How one source geometry maps onto the display buffer. Built on first
+	// use and cached, so switching between geometries costs nothing after
+	// the first frame of each.
+	struct BlitPlan
+	{
+		uint32_t src_width = 0;
+		uint32_t src_height = 0;
+		uint32_t dst_width = 0;
+		uint32_t dst_height = 0;
+		DrmBlitKernel kernel = DRM_BLIT_GENERIC;
+		std::vector<uint32_t> row_map; // dst row -> src row
+		std::vector<uint32_t> col_map; // dst column -> src byte offset (generic kernel)
+		uint64_t last_use = 0;
+	};
+
+	BlitPlan blit_plans[DRM_DISPLAY_BLIT_PLANS] = {};
+	int active_plan = -1;
+	uint32_t geometry_changes = 0;
+
+	// One converted source row for the scaled RDRAM present
+	std::vector<uint32_t> rdram_row;
+
+	// Source resolution of the last presented frame
 	uint32_t src_width = 0;
 	uint32_t src_height = 0;
 	bool buffers_ready = false;
@@ -61,21 +99,72 @@ struct DrmDisplay
 	bool plane_is_overlay = false;
 	bool vblank_error_logged = false;
 	bool fast_upscale_logged = false;
-	bool blit_path_logged = false;
+
+	// CRTC colour/background properties (0 when the driver lacks them)
+	uint32_t gamma_lut_prop = 0;
+	uint32_t gamma_lut_size = 0;
+	uint32_t ctm_prop = 0;
+	uint32_t background_prop = 0;
+	uint32_t gamma_blob_id = 0;
+	bool gamma_enabled = false;
+
+	// Active-area mode: the CPU-path buffers cover only the aspect-fit image
+	// rectangle, placed with a 1:1 SetPlane; the CRTC background fills the
+	// borders.
+	bool active_area = false;
+	bool plane_shrunk = false; // the plane currently shows an active-area buffer
+	uint32_t area_x = 0;
+	uint32_t area_y = 0;
+	uint32_t area_width = 0;
+	uint32_t area_height = 0;
+
+	// Flip pacing (see frame_pacing.hpp); set by the caller
+	FramePacingConfig pacing;
+	uint32_t flip_latch_sequence = 0; // vblank the last queued flip latches on
+	bool flip_latch_valid = false;
+
+	// Running totals for telemetry (never reset by the display code)
+	uint32_t flip_busy_count = 0;   // PageFlip calls that returned EBUSY
+	uint64_t vblank_wait_us = 0;    // time spent in drmWaitVBlank
+	uint32_t pacing_drops = 0;      // frames dropped by the drop-busy policy
 };
 
 // Initialize DRM: open device, find connector/CRTC/plane, set mode.
 // Returns true on success.
 bool drm_display_init(DrmDisplay &d);
 
-// Present a frame. Copies RGBA8888 pixels into a dumb buffer and
-// issues a plane flip with hardware scaling to display resolution.
-// First call allocates buffers sized to (width x height).
+// Present a frame. Scales RGBA8888 pixels into a display-sized dumb buffer
+// and flips it. The first call allocates the buffers; later source size
+// changes only select another blit plan.
 bool drm_display_present(DrmDisplay &d, const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t stride);
 
+// Present the VI framebuffer f straight from RDRAM (host-order 32-bit
+// words): RGBA5551 or RGBA8888 is converted into the dumb buffer with no
+// intermediate frame. Returns false without flipping when f lies outside
+// RDRAM or is not aligned to its pixel size.
+bool drm_display_present_rdram(DrmDisplay &d, const uint8_t *rdram, uint32_t rdram_size, const ViLiteFrame &f);
+
+// Apply (or remove) the VI gamma curve through the CRTC GAMMA_LUT. Cheap
+// when the state does not change. Returns false when the CRTC has no
+// GAMMA_LUT or the update failed; the image is then left uncorrected.
+bool drm_display_set_gamma(DrmDisplay &d, bool enable);
+
+// Switch the CPU present paths to active-area buffers with a black CRTC
+// background for the borders. Needs a plane and the background property;
+// must be called before the first present. Returns false if unsupported.
+bool drm_display_enable_active_area(DrmDisplay &d);
+
 // Flip an externally-managed framebuffer (e.g. Vulkan DMA-buf).
 // Handles initial SetCrtc vs subsequent PageFlip automatically.
 bool drm_display_flip(DrmDisplay &d, uint32_t fb_id);
 
+// Total bytes currently held in dumb buffers owned by this display.
+uint64_t drm_display_dumb_bytes(const DrmDisplay &d);
+
 // Tear down: release buffers, restore CRTC, close fd.
 void drm_display_cleanup(DrmDisplay &d);
+
+// Reset GAMMA_LUT and the background of every CRTC to the driver defaults
+// from a fresh DRM client. Run by launch.sh (G64_CRTC_RESTORE=1) after the
+// emulator exits, however it exited. Returns 0 on success.
+extern "C" int drm_display_restore_crtc(void);
@@ -0,0 +1,348 @@
+/*
+ * Crash-safe performance flight recorder for tg5050
+ *
+ * Records are claimed with an atomic fetch-add on header->write_index and
+ * published by storing seq last, so the signal handler can append its own
+ * record even if it interrupts a writer. Everything reachable from the
+ * handler is async-signal-safe: atomics, plain stores, msync(), sigaction()
+ * and raise().
+ */
+
+#include "flight_recorder.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+static const int fatal_signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT, SIGTERM };
+#define FATAL_SIGNAL_COUNT (sizeof(fatal_signals) / sizeof(fatal_signals[0]))
+
+static FlightRecorder *active_recorder;
+static struct sigaction previous_actions[FATAL_SIGNAL_COUNT];
+
+static uint64_t clock_us(clockid_t id)
+{
+	struct timespec ts = {};
+	clock_gettime(id, &ts);
+	return uint64_t(ts.tv_sec) * 1000000ull + uint64_t(ts.tv_nsec) / 1000ull;
+}
+
+static uint32_t clamp_u32(uint64_t v)
+{
+	return v > 0xffffffffull ? 0xffffffffu : uint32_t(v);
+}
+
+static FlightRecord *claim_record(FlightRecorder &r, uint32_t frame, uint16_t type, uint64_t &seq)
+{
+	seq = __atomic_add_fetch(&r.header->write_index, 1, __ATOMIC_RELAXED);
+	FlightRecord *rec = &r.records[(seq - 1) % r.header->capacity];
+	__atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+	rec->time_us = clock_us(CLOCK_MONOTONIC);
+	rec->frame = frame;
+	rec->type = type;
+	rec->path = 0;
+	memset(rec->text, 0, sizeof(rec->text));
+	return rec;
+}
+
+static void publish_record(FlightRecord *rec, uint64_t seq)
+{
+	__atomic_store_n(&rec->seq, seq, __ATOMIC_RELEASE);
+}
+
+static int fatal_signal_index(int signo)
+{
+	for (size_t i = 0; i < FATAL_SIGNAL_COUNT; i++)
+		if (fatal_signals[i] == signo)
+			return int(i);
+	return -1;
+}
+
+static void fatal_signal_handler(int signo, siginfo_t *info, void *ucontext)
+{
+	int saved_errno = errno;
+	FlightRecorder *r = active_recorder;
+	if (r && r->header)
+	{
+		uint64_t seq;
+		FlightRecord *rec = claim_record(*r, 0, FLIGHT_RECORD_SIGNAL, seq);
+		rec->signal.signo = signo;
+		rec->signal.code = info ? info->si_code : 0;
+		rec->signal.addr = info ? uint64_t(reinterpret_cast<uintptr_t>(info->si_addr)) : 0;
+		publish_record(rec, seq);
+
+		r->header->last_signal = signo;
+		r->header->signal_time_us = rec->time_us;
+		__atomic_store_n(&r->header->state, uint32_t(FLIGHT_RECORDER_SIGNALED), __ATOMIC_RELEASE);
+		msync(r->header, r->map_size, MS_SYNC);
+	}
+
+	// Hand the signal back to whoever owned it before us (Rust's stack
+	// guard handler, SDL's quit handler, or the default action).
+	int idx = fatal_signal_index(signo);
+	if (idx >= 0)
+	{
+		const struct sigaction &prev = previous_actions[idx];
+		sigaction(signo, &prev, nullptr);
+		if ((prev.sa_flags & SA_SIGINFO) && prev.sa_sigaction)
+		{
+			prev.sa_sigaction(signo, info, ucontext);
+			errno = saved_errno;
+			return;
+		}
+		if (!(prev.sa_flags & SA_SIGINFO) && prev.sa_handler != SIG_DFL && prev.sa_handler != SIG_IGN)
+		{
+			prev.sa_handler(signo);
+			errno = saved_errno;
+			return;
+		}
+	}
+
+	// Synchronous faults re-trigger with the default action when the
+	// faulting instruction restarts; asynchronous ones must be re-raised.
+	if (signo == SIGABRT || signo == SIGTERM)
+		raise(signo);
+	errno = saved_errno;
+}
+
+static void install_signal_handlers(FlightRecorder &r)
+{
+	// A stack overflow SIGSEGV needs an alternate stack to run the handler.
+	// Keep one the runtime may already have installed for this thread.
+	stack_t current = {};
+	if (sigaltstack(nullptr, &current) == 0 && (current.ss_flags & SS_DISABLE))
+	{
+		const size_t alt_size = 64 * 1024;
+		r.alt_stack = malloc(alt_size);
+		if (r.alt_stack)
+		{
+			stack_t ss = {};
+			ss.ss_sp = r.alt_stack;
+			ss.ss_size = alt_size;
+			if (sigaltstack(&ss, nullptr) < 0)
+			{
+				free(r.alt_stack);
+				r.alt_stack = nullptr;
+			}
+		}
+	}
+
+	struct sigaction sa = {};
+	sa.sa_sigaction = fatal_signal_handler;
+	sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+	sigemptyset(&sa.sa_mask);
+	for (size_t i = 0; i < FATAL_SIGNAL_COUNT; i++)
+		sigaction(fatal_signals[i], &sa, &previous_actions[i]);
+}
+
+static void restore_signal_handlers(FlightRecorder &r)
+{
+	for (size_t i = 0; i < FATAL_SIGNAL_COUNT; i++)
+	{
+		struct sigaction current = {};
+		sigaction(fatal_signals[i], nullptr, &current);
+		// Only restore handlers that are still ours.
+		if ((current.sa_flags & SA_SIGINFO) && current.sa_sigaction == fatal_signal_handler)
+			sigaction(fatal_signals[i], &previous_actions[i], nullptr);
+	}
+
+	if (r.alt_stack)
+	{
+		stack_t ss = {};
+		ss.ss_flags = SS_DISABLE;
+		sigaltstack(&ss, nullptr);
+		free(r.alt_stack);
+		r.alt_stack = nullptr;
+	}
+}
+
+bool flight_recorder_init(FlightRecorder &r, const char *path, uint32_t seconds)
+{
+	if (!path || !path[0])
+		path = FLIGHT_RECORDER_DEFAULT_PATH;
+	if (seconds == 0)
+		seconds = FLIGHT_RECORDER_DEFAULT_SECONDS;
+	snprintf(r.path, sizeof(r.path), "%s", path);
+
+	// Keep the previous session's ring: that is the one that crashed.
+	char prev_path[sizeof(r.path) + 8];
+	snprintf(prev_path, sizeof(prev_path), "%s.prev", r.path);
+	rename(r.path, prev_path);
+
+	const uint32_t capacity = seconds * FLIGHT_RECORDER_RECORDS_PER_SECOND;
+	r.map_size = sizeof(FlightRecorderHeader) + size_t(capacity) * sizeof(FlightRecord);
+
+	r.fd = open(r.path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (r.fd < 0)
+	{
+		fprintf(stderr, "[flight_recorder] open %s: %s\n", r.path, strerror(errno));
+		return false;
+	}
+	if (ftruncate(r.fd, off_t(r.map_size)) < 0)
+	{
+		fprintf(stderr, "[flight_recorder] ftruncate %s: %s\n", r.path, strerror(errno));
+		close(r.fd);
+		r.fd = -1;
+		return false;
+	}
+
+	void *map = mmap(nullptr, r.map_size, PROT_READ | PROT_WRITE, MAP_SHARED, r.fd, 0);
+	if (map == MAP_FAILED)
+	{
+		fprintf(stderr, "[flight_recorder] mmap %s: %s\n", r.path, strerror(errno));
+		close(r.fd);
+		r.fd = -1;
+		return false;
+	}
+
+	r.header = static_cast<FlightRecorderHeader *>(map);
+	r.records = reinterpret_cast<FlightRecord *>(static_cast<uint8_t *>(map) + sizeof(FlightRecorderHeader));
+
+	memset(r.header, 0, sizeof(*r.header));
+	memcpy(r.header->magic, FLIGHT_RECORDER_MAGIC, sizeof(r.header->magic));
+	r.header->version = FLIGHT_RECORDER_VERSION;
+	r.header->record_size = sizeof(FlightRecord);
+	r.header->capacity = capacity;
+	r.header->pid = int32_t(getpid());
+	r.header->start_realtime_us = clock_us(CLOCK_REALTIME);
+	r.header->start_monotonic_us = clock_us(CLOCK_MONOTONIC);
+	r.header->state = FLIGHT_RECORDER_RUNNING;
+
+	active_recorder = &r;
+	install_signal_handlers(r);
+
+	fprintf(stderr, "[flight_recorder] Recording last %us (%u records, %zu KiB) to %s\n",
+	        seconds, capacity, r.map_size / 1024, r.path);
+	return true;
+}
+
+bool flight_recorder_active(const FlightRecorder &r)
+{
+	return r.header != nullptr;
+}
+
+uint16_t flight_recorder_path_id(const char *path_tag)
+{
+	const size_t count = sizeof(flight_recorder_path_names) / sizeof(flight_recorder_path_names[0]);
+	for (size_t i = 1; i < count; i++)
+		if (strcmp(path_tag, flight_recorder_path_names[i]) == 0)
+			return uint16_t(i);
+	return 0;
+}
+
+void flight_recorder_frame(FlightRecorder &r, uint32_t frame, const char *path_tag,
+                           uint64_t gap_us, uint64_t scanout_us, uint64_t render_us,
+                           uint64_t flip_us, uint64_t total_us,
+                           uint64_t vblank_wait_us, uint32_t flip_busy)
+{
+	if (!r.header)
+		return;
+
+	uint64_t seq;
+	FlightRecord *rec = claim_record(r, frame, FLIGHT_RECORD_FRAME, seq);
+	rec->path = flight_recorder_path_id(path_tag);
+	rec->timing.gap_us = clamp_u32(gap_us);
+	rec->timing.scanout_us = clamp_u32(scanout_us);
+	rec->timing.render_us = clamp_u32(render_us);
+	rec->timing.flip_us = clamp_u32(flip_us);
+	rec->timing.total_us = clamp_u32(total_us);
+	rec->timing.vblank_wait_us = clamp_u32(vblank_wait_us);
+	rec->timing.flip_busy = flip_busy;
+	publish_record(rec, seq);
+}
+
+void flight_recorder_clocks(FlightRecorder &r, uint32_t frame,
+                            int cpu_mhz, int gpu_mhz, int gpu_util, double fps)
+{
+	if (!r.header)
+		return;
+
+	uint64_t seq;
+	FlightRecord *rec = claim_record(r, frame, FLIGHT_RECORD_CLOCKS, seq);
+	rec->clocks.cpu_mhz = cpu_mhz;
+	rec->clocks.gpu_mhz = gpu_mhz;
+	rec->clocks.gpu_util = gpu_util;
+	rec->clocks.fps_x100 = fps > 0.0 ? uint32_t(fps * 100.0 + 0.5) : 0;
+	publish_record(rec, seq);
+}
+
+void flight_recorder_event(FlightRecorder &r, uint32_t frame, const char *fmt, ...)
+{
+	if (!r.header)
+		return;
+
+	uint64_t seq;
+	FlightRecord *rec = claim_record(r, frame, FLIGHT_RECORD_EVENT, seq);
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(rec->text, sizeof(rec->text), fmt, ap);
+	va_end(ap);
+	publish_record(rec, seq);
+}
+
+void flight_recorder_stall(FlightRecorder &r, uint32_t frame, FlightStage stage,
+                           uint64_t elapsed_us, uint64_t threshold_us, uint64_t stage_us, uint32_t threads)
+{
+	if (!r.header)
+		return;
+
+	uint64_t seq;
+	FlightRecord *rec = claim_record(r, frame, FLIGHT_RECORD_STALL, seq);
+	rec->path = stage;
+	rec->stall.elapsed_us = clamp_u32(elapsed_us);
+	rec->stall.threshold_us = clamp_u32(threshold_us);
+	rec->stall.stage_us = clamp_u32(stage_us);
+	rec->stall.threads = threads;
+	publish_record(rec, seq);
+}
+
+void flight_recorder_stack(FlightRecorder &r, uint32_t frame, int32_t tid, uint8_t thread,
+                           uint8_t depth, uint8_t frames, bool symbol, uint64_t offset, const char *where)
+{
+	if (!r.header)
+		return;
+
+	uint64_t seq;
+	FlightRecord *rec = claim_record(r, frame, FLIGHT_RECORD_STACK, seq);
+	rec->stack.tid = tid;
+	rec->stack.thread = thread;
+	rec->stack.depth = depth;
+	rec->stack.frames = frames;
+	rec->stack.symbol = symbol ? 1 : 0;
+	rec->stack.offset = offset;
+	if (where)
+		strncpy(rec->stack.where, where, sizeof(rec->stack.where) - 1);
+	publish_record(rec, seq);
+}
+
+void flight_recorder_flush(FlightRecorder &r)
+{
+	if (r.fd < 0)
+		return;
+	sync_file_range(r.fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+}
+
+void flight_recorder_cleanup(FlightRecorder &r)
+{
+	if (!r.header)
+		return;
+
+	restore_signal_handlers(r);
+	active_recorder = nullptr;
+
+	r.header->state = FLIGHT_RECORDER_CLEAN_EXIT;
+	msync(r.header, r.map_size, MS_SYNC);
+	munmap(r.header, r.map_size);
+	r.header = nullptr;
+	r.records = nullptr;
+
+	close(r.fd);
+	r.fd = -1;
+}
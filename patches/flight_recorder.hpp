@@ -0,0 +1,190 @@
+/*
+ * Crash-safe performance flight recorder for tg5050
+ *
+ * Per-frame stage timings, vblank waits, flip retries, clock samples,
+ * events and slow-frame stacks (stall_watchdog.hpp) are written into a ring that lives in a MAP_SHARED file mapping.
+ * The page cache owns the data, so the last records survive a segfault
+ * inside libmali, an abort, or a SIGKILL of a hung process. Fatal signals
+ * additionally stamp the header, msync() the ring and then chain to the
+ * previous handler.
+ *
+ * The layout is fixed-size and POD so tools/flightrec_dump can decode it
+ * on the host.
+ *
+ * Usage: init(path) -> frame()/clocks()/event() while running -> cleanup()
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define FLIGHT_RECORDER_MAGIC "G64FREC1"
+#define FLIGHT_RECORDER_VERSION 1
+#define FLIGHT_RECORDER_DEFAULT_PATH "/tmp/gopher64-flightrec.bin"
+#define FLIGHT_RECORDER_DEFAULT_SECONDS 60
+// Ring slots per recorded second: one frame record per vblank plus headroom
+// for clock samples and events.
+#define FLIGHT_RECORDER_RECORDS_PER_SECOND 128
+
+enum FlightRecordType : uint16_t
+{
+	FLIGHT_RECORD_FRAME = 1,
+	FLIGHT_RECORD_CLOCKS = 2,
+	FLIGHT_RECORD_EVENT = 3,
+	FLIGHT_RECORD_SIGNAL = 4,
+	FLIGHT_RECORD_STALL = 5, // a frame ran past the watchdog threshold
+	FLIGHT_RECORD_STACK = 6, // one stack frame of a thread captured at a stall
+};
+
+enum FlightRecorderState : uint32_t
+{
+	FLIGHT_RECORDER_RUNNING = 0,
+	FLIGHT_RECORDER_CLEAN_EXIT = 1,
+	FLIGHT_RECORDER_SIGNALED = 2,
+};
+
+struct FlightRecord
+{
+	uint64_t seq;     // 1-based write index, 0 while the slot is being written
+	uint64_t time_us; // CLOCK_MONOTONIC
+	uint32_t frame;   // VI frame counter
+	uint16_t type;    // FlightRecordType
+	uint16_t path;    // FLIGHT_RECORD_FRAME: index into flight_recorder_path_names
+	                  // FLIGHT_RECORD_STALL: index into flight_recorder_stage_names
+	union
+	{
+		struct
+		{
+			uint32_t gap_us;
+			uint32_t scanout_us;
+			uint32_t render_us;
+			uint32_t flip_us;
+			uint32_t total_us;
+			uint32_t vblank_wait_us;
+			uint32_t flip_busy;
+		} timing;
+		struct
+		{
+			int32_t cpu_mhz;
+			int32_t gpu_mhz;
+			int32_t gpu_util;
+			uint32_t fps_x100;
+		} clocks;
+		struct
+		{
+			int32_t signo;
+			int32_t code;
+			uint64_t addr;
+		} signal;
+		struct
+		{
+			uint32_t elapsed_us;  // frame time when the stacks were taken
+			uint32_t threshold_us;
+			uint32_t stage_us;    // time spent in the current stage so far
+			uint32_t threads;     // threads that delivered a stack
+		} stall;
+		struct
+		{
+			int32_t tid;
+			uint8_t thread; // watchdog thread slot
+			uint8_t depth;  // 0 = innermost
+			uint8_t frames; // stack depth captured
+			uint8_t symbol; // 1: offset is from `where` as a symbol, 0: from the module base
+			uint64_t offset;
+			char where[24]; // symbol or module basename, truncated
+		} stack;
+		char text[40];
+	};
+};
+
+static_assert(sizeof(FlightRecord) == 64, "FlightRecord layout changed");
+
+struct FlightRecorderHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t capacity;
+	int32_t pid;
+	uint64_t start_realtime_us;
+	uint64_t start_monotonic_us;
+	uint64_t write_index; // records written so far
+	uint32_t state;       // FlightRecorderState
+	int32_t last_signal;
+	uint64_t signal_time_us;
+	uint8_t reserved[64];
+};
+
+static_assert(sizeof(FlightRecorderHeader) == 128, "FlightRecorderHeader layout changed");
+
+// Frame path tags as passed to perf_monitor_frame(). Index 0 is "unknown".
+static const char *const flight_recorder_path_names[] = {
+	"unknown",
+	"gpu-dmabuf",
+	"cpu-fallback",
+	"null",
+	"soft",
+	"soft-null",
+	"vi-lite",
+};
+
+// Frame loop stages as tracked by the stall watchdog.
+enum FlightStage : uint16_t
+{
+	FLIGHT_STAGE_EMULATION = 0,
+	FLIGHT_STAGE_RENDER = 1,
+	FLIGHT_STAGE_PRESENT = 2,
+	FLIGHT_STAGES
+};
+
+static const char *const flight_recorder_stage_names[FLIGHT_STAGES] = {
+	"emulation",
+	"render",
+	"present",
+};
+
+struct FlightRecorder
+{
+	int fd = -1;
+	FlightRecorderHeader *header = nullptr;
+	FlightRecord *records = nullptr;
+	size_t map_size = 0;
+	char path[256] = {};
+	void *alt_stack = nullptr;
+};
+
+// Create (or truncate) the ring file and install the fatal signal handlers.
+// An existing file is kept as "<path>.prev". path == nullptr uses
+// FLIGHT_RECORDER_DEFAULT_PATH. Returns true on success.
+bool flight_recorder_init(FlightRecorder &r, const char *path, uint32_t seconds);
+
+bool flight_recorder_active(const FlightRecorder &r);
+
+// Map a perf path tag to its flight_recorder_path_names index.
+uint16_t flight_recorder_path_id(const char *path_tag);
+
+void flight_recorder_frame(FlightRecorder &r, uint32_t frame, const char *path_tag,
+                           uint64_t gap_us, uint64_t scanout_us, uint64_t render_us,
+                           uint64_t flip_us, uint64_t total_us,
+                           uint64_t vblank_wait_us, uint32_t flip_busy);
+
+void flight_recorder_clocks(FlightRecorder &r, uint32_t frame,
+                            int cpu_mhz, int gpu_mhz, int gpu_util, double fps);
+
+void flight_recorder_event(FlightRecorder &r, uint32_t frame, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+void flight_recorder_stall(FlightRecorder &r, uint32_t frame, FlightStage stage,
+                           uint64_t elapsed_us, uint64_t threshold_us, uint64_t stage_us, uint32_t threads);
+
+// One frame of a captured stack; where is copied and truncated.
+void flight_recorder_stack(FlightRecorder &r, uint32_t frame, int32_t tid, uint8_t thread,
+                           uint8_t depth, uint8_t frames, bool symbol, uint64_t offset, const char *where);
+
+// Start write-back of dirty ring pages without waiting, so a full system
+// hang still leaves recent records on storage. Call about once per second.
+void flight_recorder_flush(FlightRecorder &r);
+
+// Mark a clean exit, restore the previous signal handlers and unmap.
+void flight_recorder_cleanup(FlightRecorder &r);
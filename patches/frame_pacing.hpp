@@ -0,0 +1,112 @@
+/*
+ * Frame pacing policies for tg5050
+ *
+ * The decisions the display path makes about when a frame is rendered and
+ * when it is flipped, as pure functions. The runtime calls them from
+ * rdp_render_frame() and the DRM flip path; tools/pacing_sim replays
+ * recorded frame timings through the same functions, so a policy behaves
+ * the same in the simulation as on the device.
+ *
+ * Policies:
+ *   vsync         core speed limiter, a frame that finds the previous flip
+ *                 still pending waits for the vblank (today's default)
+ *   drop-busy     core speed limiter, such a frame is dropped instead; the
+ *                 already queued, older frame is shown (not mailbox: KMS
+ *                 cannot replace a queued flip with a newer one)
+ *   cadence       core speed limiter, one VI frame in `cadence` is
+ *                 rendered and flips are held to one per `cadence` vblanks
+ *                 (2: an even 30 Hz on a 60 Hz panel)
+ *   vsync-locked  no core limiter: waiting for flips paces the emulation
+ *   frameskip     core speed limiter, only every (skip + 1)th VI frame is
+ *                 rendered, flips as vsync
+ *
+ * Usage: frame_pacing_parse() -> frame_pacing_render() per VI frame ->
+ *        frame_pacing_flip_waits() / frame_pacing_on_busy() per flip
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+enum FramePacingPolicy : uint8_t
+{
+	FRAME_PACING_VSYNC = 0,
+	FRAME_PACING_DROP_BUSY = 1,
+	FRAME_PACING_CADENCE = 2,
+	FRAME_PACING_VSYNC_LOCKED = 3,
+	FRAME_PACING_FRAMESKIP = 4,
+	FRAME_PACING_POLICIES
+};
+
+static const char *const frame_pacing_names[FRAME_PACING_POLICIES] = {
+	"vsync",
+	"drop-busy",
+	"cadence",
+	"vsync-locked",
+	"frameskip",
+};
+
+enum FramePacingBusy : uint8_t
+{
+	FRAME_PACING_WAIT = 0, // wait for the vblank, then queue the flip
+	FRAME_PACING_DROP = 1, // do not show this frame
+};
+
+struct FramePacingConfig
+{
+	FramePacingPolicy policy = FRAME_PACING_VSYNC;
+	uint32_t cadence = 2; // vblanks per flip for FRAME_PACING_CADENCE
+	uint32_t skip = 1;    // skipped VI frames per rendered one for FRAME_PACING_FRAMESKIP
+};
+
+// Policy by name. Returns false and leaves policy unchanged if unknown.
+inline bool frame_pacing_parse(const char *name, FramePacingPolicy &policy)
+{
+	for (int i = 0; i < FRAME_PACING_POLICIES; i++)
+	{
+		if (strcmp(name, frame_pacing_names[i]) == 0)
+		{
+			policy = FramePacingPolicy(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Whether the core's own speed limiter paces emulation.
+inline bool frame_pacing_core_limiter(const FramePacingConfig &c)
+{
+	return c.policy != FRAME_PACING_VSYNC_LOCKED;
+}
+
+// Whether VI frame `frame` is rendered. frame_skip is the runtime knob
+// (battery saver, control channel); the frameskip policy raises it.
+inline bool frame_pacing_render(const FramePacingConfig &c, uint32_t frame, uint32_t frame_skip)
+{
+	if (c.policy == FRAME_PACING_FRAMESKIP && frame_skip < c.skip)
+		frame_skip = c.skip;
+	// Only frames the cadence can show are rendered; the flip waits keep
+	// them evenly spaced.
+	if (c.policy == FRAME_PACING_CADENCE && c.cadence > 1 && frame_skip < c.cadence - 1)
+		frame_skip = c.cadence - 1;
+	return frame_skip == 0 || (frame % (frame_skip + 1)) == 0;
+}
+
+// Vblanks to wait before queueing a flip. vblanks_since_latch is the
+// current vblank sequence minus the one the previous flip latched (or will
+// latch) on; negative while that flip is still pending. A flip queued now
+// latches on the next vblank.
+inline uint32_t frame_pacing_flip_waits(const FramePacingConfig &c, int32_t vblanks_since_latch)
+{
+	if (c.policy != FRAME_PACING_CADENCE || c.cadence < 2)
+		return 0;
+	const int32_t waits = int32_t(c.cadence) - 1 - vblanks_since_latch;
+	return waits > 0 ? uint32_t(waits) : 0;
+}
+
+// What to do with a frame whose flip finds the previous one still pending.
+inline FramePacingBusy frame_pacing_on_busy(const FramePacingConfig &c)
+{
+	return c.policy == FRAME_PACING_DROP_BUSY ? FRAME_PACING_DROP : FRAME_PACING_WAIT;
+}
@@ -8,6 +8,56 @@
  *    presents via DRM dumb buffers with hardware plane scaling.
  * 3. rdp_update_screen() uses device->next_frame_context() instead of WSI frame management.
  * 4. DRM display is initialized in rdp_init() and cleaned up in rdp_close().
+ * 5. Optional runtime control socket (G64_CONTROL_SOCKET) changes perf knobs
+ *    at frame boundaries without a relaunch.
+ * 6. Optional flight recorder (G64_FLIGHT_RECORDER) keeps per-frame timings
+ *    in a crash-safe mmap'd ring.
+ * 7. Memory telemetry ([mem] lines): process RSS/PSS, Vulkan heaps, DRM dumb
+ *    buffers and the large interface-owned allocations, with high-water marks.
+ * 8. Optional SDL-video-free startup (G64_SDL_NO_VIDEO): the SDL window is
+ *    ignored and Granite loads libvulkan itself; startup phases are timed.
+ * 9. Battery power telemetry (watts, mJ per presented frame) and an optional
+ *    battery saver (G64_BATTERY_SAVER): 30 FPS presentation cap, lowest
+ *    sustaining CPU/GPU clocks, optional VI filter passes skipped.
+ * 10. Optional fixed-length benchmark run (G64_BENCH_FRAMES): limiter off,
+ *    real or null presentation, JSON summary written on exit.
+ * 11. Optional CRT effects (G64_CRT): scanlines, aperture mask and beam bloom
+ *    computed inside the compute pass that scales into the display image.
+ * 12. Optional display-list memoization (G64_DL_CACHE): repeated lists whose
+ *    inputs and outputs are unchanged in RDRAM skip their draw commands.
+ * 13. Optional per-frame output checksums (G64_FRAME_CHECKSUM) of the VI
+ *    scanout, so two runs of the same replay can be diffed frame by frame.
+ * 14. Optional coherence profiler (G64_COHERENCE_PROFILE): counters and
+ *    address histograms for rdp_check_framebuffers() and the dirty marks.
+ * 15. VI register writes only update a shadow; changed registers are latched
+ *    into the processor once per rendered frame, right before scanout.
+ * 16. RDP commands are handed to the processor in runs (one enqueue call per
+ *    run) when the patched parallel-rdp provides enqueue_commands().
+ * 17. Optional RDP command statistics (G64_RDP_STATS): per-frame counts of
+ *    triangles, rectangles, loads, framebuffer switches and command bytes.
+ * 18. Software RDP fallback: when Vulkan cannot be brought up (or with
+ *    G64_SOFT_RDP=1) commands go to a banded multithreaded CPU rasterizer
+ *    and frames are scanned out of RDRAM into the DRM dumb buffers.
+ * 19. Optional VI-lite present for the CPU display fallback (G64_VI_LITE):
+ *    plain 16/32-bit frames are converted from RDRAM straight into the dumb
+ *    buffer, waiting on the GPU only when pending RDP work may write the
+ *    frame's range, instead of a VI pass and scanout_sync() readback.
+ * 20. Optional CRTC offload (G64_CRTC_OFFLOAD): VI gamma through the CRTC
+ *    GAMMA_LUT instead of the VI pass, and CPU-path buffers covering only
+ *    the 4:3 image with the CRTC background as the borders. Both are reset
+ *    at DRM init, and by launch.sh (G64_CRTC_RESTORE) after any exit.
+ * 21. Frame pacing policy (G64_PACING, frame_pacing.hpp): vsync, drop-busy,
+ *    cadence, vsync-locked or frameskip. The same decision functions drive
+ *    tools/pacing_sim.
+ * 22. Optional slow-frame watchdog (G64_STALL_WATCHDOG, stall_watchdog.hpp):
+ *    frames over the threshold get the stacks of the emulation thread and
+ *    the RDP worker threads and the current stage written to the flight
+ *    recorder.
+ * 23. Optional async framebuffer write-back (G64_COHERENCE=async): dirty
+ *    ranges are tracked per SyncFull, retired with a non-blocking timeline
+ *    query, and a CPU access only waits for the SyncFull that covers it.
+ * 24. Framebuffer coherence mode per game (G64_COHERENCE): strict, async or
+ *    relaxed (no CPU-side sync), with "[fb_sync]" syncs and stall time.
  */
 
 #include "wsi_platform.hpp"
@@ -15,6 +65,13 @@
 #include "rdp_device.hpp"
 #include "interface.hpp"
 #include "drm_display.hpp"
+#include "perf_control.hpp"
+#include "flight_recorder.hpp"
+#include "power_monitor.hpp"
+#include "display_list_cache.hpp"
+#include "coherence_profile.hpp"
+#include "soft_rdp.hpp"
+#include "stall_watchdog.hpp"
 #include <SDL3/SDL_vulkan.h>
 #include <SDL3_ttf/SDL_ttf.h>
 #include <cstring>
@@ -27,9 +84,17 @@
 #include <errno.h>
 #include <sched.h>
 #include <strings.h>
+#include <dirent.h>
+#include <sys/resource.h>
 
 using namespace Vulkan;
 
+// Provided by the LLVM profile runtime in ./build.sh --pgo-generate builds.
+extern "C" int __llvm_profile_write_file(void) __attribute__((weak));
+// Provided when ./build.sh --allocator=mimalloc|jemalloc replaced malloc.
+extern "C" int mi_version(void) __attribute__((weak));
+extern "C" int mallctl(const char *name, void *oldp, size_t *oldlenp, void *newp, size_t newlen) __attribute__((weak));
+
 #define DP_STATUS_XBUS_DMA 0x01
 #define DP_STATUS_FREEZE 0x02
 #define DP_STATUS_FLUSH 0x04
@@ -123,7 +188,8 @@ static_assert(sizeof(RDP::RGBA) == 4, "RDP::RGBA must be 4 bytes");
 
 struct PerfMonitor
 {
-	bool enabled = true;
+	// 0 = silent, 1 = one [perf] line per window, 2 = also per-frame stages
+	int log_level = 1;
 	uint64_t window_start_ms = 0;
 	uint32_t frames_in_window = 0;
 	uint64_t sum_frame_gap_us = 0;
@@ -140,10 +206,131 @@ struct PerfMonitor
 	char sunxi_gpu_info_path[256] = {};
 	char cur_freq_path[256] = {};
 	char cpu_freq_path[256] = {};
+	char last_line[384] = {};
+	// Previous drm_display totals, for per-frame deltas
+	uint64_t last_vblank_wait_us = 0;
+	uint32_t last_flip_busy_count = 0;
+	// PerfWindowUser bits: who needs the window statistics right now
+	uint32_t window_users = 0;
+};
+
+// Besides the "[perf]" log, the window statistics feed other consumers. Each
+// one sets its bit while it needs them; with none set, perf_monitor_frame()
+// skips the per-frame accounting.
+enum PerfWindowUser : uint32_t
+{
+	PERF_WINDOW_LOG = 1u << 0,             // log_level > 0
+	PERF_WINDOW_BASELINE = 1u << 1,        // a control client waits for a baseline
+	PERF_WINDOW_FLIGHT_RECORDER = 1u << 2, // once-per-window clock sample
+	PERF_WINDOW_BATTERY_SAVER = 1u << 3,   // clock caps follow the window load
+	PERF_WINDOW_BENCH = 1u << 4,           // bench run between warm-up and end
+	PERF_WINDOW_COHERENCE = 1u << 5,       // "[coherence]" line per window
+	PERF_WINDOW_RDP_STATS = 1u << 6,       // "[rdp_stats]" line per window
+	PERF_WINDOW_FB_SYNC = 1u << 7,         // "[fb_sync]" line per window (async, relaxed)
 };
 
 static PerfMonitor perf_monitor;
 
+static void perf_monitor_window_user(uint32_t user, bool active)
+{
+	if (active)
+		perf_monitor.window_users |= user;
+	else
+		perf_monitor.window_users &= ~user;
+}
+
+// Knobs that can change at runtime through the control socket.
+// Applied only at the frame boundary in rdp_render_frame().
+struct RuntimeTuning
+{
+	bool control_enabled = false;
+	bool force_cpu_present = false;
+	bool pin_big_cores = false;
+	uint32_t frame_skip = 0;
+	uint32_t frame_counter = 0;
+};
+
+static RuntimeTuning runtime_tuning;
+static PerfControl perf_control;
+static FlightRecorder flight_recorder;
+static PowerMonitor power_monitor;
+static BatterySaver battery_saver;
+static CoherenceProfile coherence_profile;
+static SoftRdp soft_rdp;
+static StallWatchdog stall_watchdog;
+static bool stall_watchdog_emu_registered; // the thread calling rdp_render_frame()
+
+// VI registers only matter at scanout, but the core writes them as they
+// change, often several times per frame. Writes land in this shadow and the
+// registers that changed are pushed to the processor once per rendered
+// frame, so the VI pass always sees one consistent snapshot.
+struct ViShadow
+{
+	uint32_t regs[VI_REGS_COUNT] = {};    // last value written by the core
+	uint32_t latched[VI_REGS_COUNT] = {}; // values the processor holds
+	uint32_t dirty = 0;                   // bit per register written since the last latch
+	uint32_t changed = 0;                 // registers that differed at the last latch
+	bool push_all = true;                 // new processor: replay every register
+	uint64_t writes = 0;
+	uint64_t pushes = 0;
+};
+
+static ViShadow vi_shadow;
+
+// Display-engine work taken off the per-pixel paths (G64_CRTC_OFFLOAD).
+// While gamma is offloaded the processor sees VI_STATUS without the gamma
+// enable bit and the CRTC LUT follows the bit instead.
+#define VI_STATUS_GAMMA_ENABLE 0x8
+
+struct CrtcOffload
+{
+	bool enabled = false;
+	bool gamma = false;
+	bool active_area = false;
+};
+
+static CrtcOffload crtc_offload;
+
+// Push the registers that changed since the last latch. Call before scanout.
+static void vi_shadow_latch()
+{
+	uint32_t changed = 0;
+	for (uint32_t reg = 0; reg < VI_REGS_COUNT; reg++)
+	{
+		const bool dirty = (vi_shadow.dirty >> reg) & 1;
+		if (!vi_shadow.push_all && (!dirty || vi_shadow.regs[reg] == vi_shadow.latched[reg]))
+			continue;
+		if (vi_shadow.regs[reg] != vi_shadow.latched[reg])
+			changed |= 1u << reg;
+		if (processor)
+		{
+			uint32_t value = vi_shadow.regs[reg];
+			if (reg == VI_STATUS_REG && crtc_offload.gamma)
+				value &= ~uint32_t(VI_STATUS_GAMMA_ENABLE);
+			processor->set_vi_register(RDP::VIRegister(reg), value);
+		}
+		vi_shadow.latched[reg] = vi_shadow.regs[reg];
+		vi_shadow.pushes++;
+	}
+	vi_shadow.changed = changed;
+	vi_shadow.dirty = 0;
+	vi_shadow.push_all = false;
+}
+
+// The latched registers the VI-lite scanouts read.
+static ViLiteRegs vi_shadow_lite_regs()
+{
+	ViLiteRegs vi;
+	vi.status = vi_shadow.latched[VI_STATUS_REG];
+	vi.origin = vi_shadow.latched[VI_ORIGIN_REG];
+	vi.width = vi_shadow.latched[VI_WIDTH_REG];
+	vi.h_start = vi_shadow.latched[VI_H_START_REG];
+	vi.v_start = vi_shadow.latched[VI_V_START_REG];
+	vi.x_scale = vi_shadow.latched[VI_X_SCALE_REG];
+	vi.y_scale = vi_shadow.latched[VI_Y_SCALE_REG];
+	return vi;
+}
+
 static uint64_t monotonic_ms()
 {
 	struct timespec ts = {};
@@ -158,6 +345,34 @@ static uint64_t monotonic_us()
 	return uint64_t(ts.tv_sec) * 1000000ull + uint64_t(ts.tv_nsec) / 1000ull;
 }
 
+// Milliseconds since the process was started (exec), or -1 if unknown.
+// Used to attribute startup time spent in the core before rdp_init().
+static double process_age_ms()
+{
+	FILE *f = fopen("/proc/self/stat", "r");
+	if (!f)
+		return -1.0;
+	char buf[1024];
+	size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+	fclose(f);
+	buf[len] = '\0';
+
+	// Field 22 (starttime, clock ticks since boot); skip past "(comm)" first.
+	char *p = strrchr(buf, ')');
+	if (!p)
+		return -1.0;
+	unsigned long long start_ticks = 0;
+	for (int field = 2; p && field < 22; field++)
+		p = strchr(p + 1, ' ');
+	if (!p || sscanf(p + 1, "%llu", &start_ticks) != 1)
+		return -1.0;
+
+	struct timespec ts = {};
+	clock_gettime(CLOCK_BOOTTIME, &ts);
+	double now_ms = double(ts.tv_sec) * 1000.0 + double(ts.tv_nsec) / 1e6;
+	return now_ms - double(start_ticks) * 1000.0 / double(sysconf(_SC_CLK_TCK));
+}
+
 static bool env_enabled(const char *name)
 {
 	const char *v = getenv(name);
@@ -169,12 +384,91 @@ static bool env_enabled(const char *name)
 	       strcasecmp(v, "on") == 0;
 }
 
-static void maybe_pin_to_big_cores()
+// For settings that are off, on at a default path, or on at a given path:
+// an enabled value ("1", "true", ...) sets path to nullptr (the module's
+// default), anything starting with '/' is the path. False when off.
+static bool env_path_or_default(const char *name, const char **path)
 {
-	if (!env_enabled("G64_PIN_BIG_CORE"))
+	const char *v = getenv(name);
+	*path = nullptr;
+	if (v && v[0] == '/')
+	{
+		*path = v;
+		return true;
+	}
+	return env_enabled(name);
+}
+
+// CPU display fallback without the VI pass: frames the VI shows as plain
+// RGBA5551/8888 are read from RDRAM directly. Anything else (blank VI,
+// letterbox crop, frame checksums, odd alignment) still goes through
+// scanout_sync().
+struct ViLitePresent
+{
+	bool enabled = false;
+	uint64_t frames = 0;
+	uint64_t waits = 0;     // frames that overlapped pending RDP writes
+	uint64_t wait_us = 0;
+	uint64_t fallbacks = 0; // frames handed to scanout_sync()
+};
+
+static ViLitePresent vi_lite_present;
+
+static void init_vi_lite_present()
+{
+	vi_lite_present.enabled = env_enabled("G64_VI_LITE");
+	if (vi_lite_present.enabled)
+		fprintf(stderr, "[vi_lite] CPU fallback presents 16/32-bit frames straight from RDRAM\n");
+}
+
+// G64_PACING picks the render/flip policy (frame_pacing.hpp). Unset keeps
+// vsync, the previous behaviour. Call after the speed limiter default.
+static void init_frame_pacing()
+{
+	drm_display.pacing = FramePacingConfig();
+	const char *name = getenv("G64_PACING");
+	if (!name || !name[0])
+		return;
+	if (!frame_pacing_parse(name, drm_display.pacing.policy))
+	{
+		fprintf(stderr, "[interface] Unknown G64_PACING=%s, using vsync\n", name);
+		return;
+	}
+	if (!frame_pacing_core_limiter(drm_display.pacing))
+		callback.enable_speedlimiter = false;
+	fprintf(stderr, "[interface] Pacing: %s (limiter %s)\n", name, callback.enable_speedlimiter ? "on" : "off");
+	flight_recorder_event(flight_recorder, 0, "pacing %s", name);
+}
+
+// After drm_display_init(), before the first present.
+static void init_crtc_offload()
+{
+	crtc_offload.enabled = env_enabled("G64_CRTC_OFFLOAD");
+	if (!crtc_offload.enabled)
 		return;
+	crtc_offload.gamma = drm_display.gamma_lut_prop != 0;
+	crtc_offload.active_area = drm_display_enable_active_area(drm_display);
+	fprintf(stderr, "[crtc] offload: gamma=%s active_area=%s\n",
+	        crtc_offload.gamma ? "lut" : "vi", crtc_offload.active_area ? "on" : "off");
+}
 
-	cpu_set_t set;
+// Once per frame, after vi_shadow_latch(): point the CRTC LUT at the VI
+// gamma state. If the LUT stops working gamma goes back to the VI pass.
+static void crtc_offload_frame()
+{
+	if (!crtc_offload.gamma)
+		return;
+	const bool vi_gamma = (vi_shadow.latched[VI_STATUS_REG] & VI_STATUS_GAMMA_ENABLE) != 0;
+	if (!drm_display_set_gamma(drm_display, vi_gamma))
+	{
+		fprintf(stderr, "[crtc] gamma LUT failed, VI pass applies gamma again\n");
+		crtc_offload.gamma = false;
+		vi_shadow.push_all = true;
+	}
+}
+
+static void build_big_core_set(cpu_set_t &set)
+{
 	CPU_ZERO(&set);
 	int cpu_count = 0;
 
@@ -190,10 +484,17 @@ static void maybe_pin_to_big_cores()
 	}
 
 	if (cpu_count == 0)
-	{
 		CPU_SET(4, &set);
-		cpu_count = 1;
-	}
+}
+
+static void maybe_pin_to_big_cores()
+{
+	if (!env_enabled("G64_PIN_BIG_CORE"))
+		return;
+
+	cpu_set_t set;
+	build_big_core_set(set);
+	runtime_tuning.pin_big_cores = true;
 
 	if (sched_setaffinity(0, sizeof(set), &set) == 0)
 	{
@@ -205,6 +506,72 @@ static void maybe_pin_to_big_cores()
 	}
 }
 
+// Report which malloc the binary was linked with, so perf logs from
+// different --allocator builds can be told apart.
+static void log_allocator()
+{
+	char name[32] = "glibc";
+	if (mi_version)
+	{
+		int v = mi_version();
+		snprintf(name, sizeof(name), "mimalloc %d.%d.%d", v / 100, (v / 10) % 10, v % 10);
+	}
+	else if (mallctl)
+	{
+		const char *version = nullptr;
+		size_t len = sizeof(version);
+		if (mallctl("version", &version, &len, nullptr, 0) == 0 && version)
+			snprintf(name, sizeof(name), "jemalloc %.*s", 16, version);
+		else
+			snprintf(name, sizeof(name), "jemalloc");
+	}
+
+	fprintf(stderr, "[interface] Allocator: %s\n", name);
+	flight_recorder_event(flight_recorder, 0, "allocator %s", name);
+}
+
+// Must run before the processor is created: it overrides the upscale factor.
+static void init_power()
+{
+	power_monitor_init(power_monitor);
+	if (!env_enabled("G64_BATTERY_SAVER"))
+		return;
+
+	// Present every other VI frame (30 FPS NTSC / 25 FPS PAL) through the
+	// existing frame-skip knob, render at native resolution, and let the
+	// clock caps follow whatever that leaves for the CPU and GPU. The VI
+	// post passes (render_frame()) and the CRT effects (init_crt()) stay off.
+	battery_saver.enabled = true;
+	runtime_tuning.frame_skip = 1;
+	gfx_info.upscale = 1;
+	battery_saver_init(battery_saver);
+	perf_monitor_window_user(PERF_WINDOW_BATTERY_SAVER, true);
+
+	fprintf(stderr, "[interface] Battery saver: 30 FPS cap, upscale 1x, VI filters and CRT effects off\n");
+	flight_recorder_event(flight_recorder, 0, "battery saver on");
+}
+
+// sched_setaffinity(0) only covers the calling thread (and threads it spawns
+// later). At runtime every existing thread has to be moved explicitly.
+static int set_affinity_all_threads(const cpu_set_t &set)
+{
+	DIR *dir = opendir("/proc/self/task");
+	if (!dir)
+		return -1;
+
+	int count = 0;
+	while (struct dirent *ent = readdir(dir))
+	{
+		if (ent->d_name[0] < '0' || ent->d_name[0] > '9')
+			continue;
+		pid_t tid = static_cast<pid_t>(strtol(ent->d_name, nullptr, 10));
+		if (sched_setaffinity(tid, sizeof(set), &set) == 0)
+			count++;
+	}
+	closedir(dir);
+	return count;
+}
+
 static bool read_text_file(const char *path, char *out, size_t out_size)
 {
 	if (!out || out_size == 0)
@@ -269,10 +636,11 @@ static bool read_int_file(const char *path, int &value_out)
 static void init_perf_monitor()
 {
 	const char *env = getenv("G64_PERF_LOG");
-	if (env && env[0] == '0')
-		perf_monitor.enabled = false;
+	if (env && env[0] >= '0' && env[0] <= '2')
+		perf_monitor.log_level = env[0] - '0';
+	perf_monitor_window_user(PERF_WINDOW_LOG, perf_monitor.log_level > 0);
 
-	if (!perf_monitor.enabled || perf_monitor.paths_initialized)
+	if (perf_monitor.paths_initialized)
 		return;
 
 	const char *sunxi_candidates[] = {
@@ -325,6 +693,30 @@ static void init_perf_monitor()
 	perf_monitor.paths_initialized = true;
 }
 
+static void perf_monitor_reset_window(uint64_t now_ms)
+{
+	perf_monitor.window_start_ms = now_ms;
+	perf_monitor.frames_in_window = 0;
+	perf_monitor.sum_frame_gap_us = 0;
+	perf_monitor.sum_scanout_us = 0;
+	perf_monitor.sum_render_us = 0;
+	perf_monitor.sum_flip_us = 0;
+	perf_monitor.sum_total_us = 0;
+	perf_monitor.max_frame_gap_us = 0;
+	perf_monitor.max_scanout_us = 0;
+	perf_monitor.max_render_us = 0;
+	perf_monitor.max_flip_us = 0;
+	perf_monitor.max_total_us = 0;
+}
+
+static void memory_telemetry_report(const char *when);
+static void bench_frame(const char *path_tag, uint64_t frame_gap_us, uint64_t scanout_us,
+                        uint64_t render_us, uint64_t flip_us, uint64_t total_us);
+static void bench_window(int cpu_mhz, int gpu_mhz, int gpu_util, const PowerSample &ps);
+static void rdp_stats_window();
+static void fb_sync_window(double elapsed_s);
+static void async_writeback_reset();
+
 static void perf_monitor_frame(const char *path_tag,
                                uint64_t frame_gap_us,
                                uint64_t scanout_us,
@@ -332,12 +724,28 @@ static void perf_monitor_frame(const char *path_tag,
                                uint64_t flip_us,
                                uint64_t total_us)
 {
-	if (!perf_monitor.enabled)
-		return;
-
 	if (!perf_monitor.paths_initialized)
 		init_perf_monitor();
 
+	const uint64_t vblank_wait_us = drm_display.vblank_wait_us - perf_monitor.last_vblank_wait_us;
+	const uint32_t flip_busy = drm_display.flip_busy_count - perf_monitor.last_flip_busy_count;
+	perf_monitor.last_vblank_wait_us = drm_display.vblank_wait_us;
+	perf_monitor.last_flip_busy_count = drm_display.flip_busy_count;
+	flight_recorder_frame(flight_recorder, runtime_tuning.frame_counter, path_tag,
+	                      frame_gap_us, scanout_us, render_us, flip_us, total_us,
+	                      vblank_wait_us, flip_busy);
+	bench_frame(path_tag, frame_gap_us, scanout_us, render_us, flip_us, total_us);
+
+	if (!perf_monitor.window_users)
+		return;
+
+	if (perf_monitor.log_level >= 2)
+	{
+		fprintf(stderr, "[perf] frame path=%s gap=%.2f scanout=%.2f render=%.2f flip=%.2f total=%.2f\n",
+		        path_tag, frame_gap_us / 1000.0, scanout_us / 1000.0, render_us / 1000.0,
+		        flip_us / 1000.0, total_us / 1000.0);
+	}
+
 	uint64_t now_ms = monotonic_ms();
 	if (perf_monitor.window_start_ms == 0)
 		perf_monitor.window_start_ms = now_ms;
@@ -398,59 +806,307 @@ static void perf_monitor_frame(const char *path_tag,
 	const double max_gap_ms = double(perf_monitor.max_frame_gap_us) / 1000.0;
 	const double max_total_ms = double(perf_monitor.max_total_us) / 1000.0;
 
+	char power[48] = {};
+	const PowerSample ps = power_monitor_sample(power_monitor, double(elapsed_ms) / 1000.0,
+	                                            perf_monitor.frames_in_window);
+	if (ps.valid && ps.charging)
+		snprintf(power, sizeof(power), " power=charging");
+	else if (ps.valid)
+		snprintf(power, sizeof(power), " power=%.2fW mj_frame=%.1f", ps.watts, ps.mj_per_frame);
+
+	char clocks[64] = {};
 	if (gpu_util >= 0 && gpu_mhz >= 0 && cpu_mhz >= 0)
+		snprintf(clocks, sizeof(clocks), " cpu=%dMHz gpu=%d%%@%dMHz", cpu_mhz, gpu_util, gpu_mhz);
+	else if (gpu_mhz >= 0 && cpu_mhz >= 0)
+		snprintf(clocks, sizeof(clocks), " cpu=%dMHz gpu_freq=%dMHz", cpu_mhz, gpu_mhz);
+	else if (cpu_mhz >= 0)
+		snprintf(clocks, sizeof(clocks), " cpu=%dMHz", cpu_mhz);
+
+	snprintf(perf_monitor.last_line, sizeof(perf_monitor.last_line),
+	         "path=%s fps=%.1f%s%s "
+	         "stage_ms(avg gap=%.2f scanout=%.2f render=%.2f flip=%.2f total=%.2f "
+	         "max_gap=%.2f max_total=%.2f)",
+	         path_tag, fps, clocks, power,
+	         avg_gap_ms, avg_scanout_ms, avg_render_ms, avg_flip_ms, avg_total_ms,
+	         max_gap_ms, max_total_ms);
+
+	if (perf_monitor.log_level > 0)
 	{
-		fprintf(stderr,
-		        "[perf] path=%s fps=%.1f cpu=%dMHz gpu=%d%%@%dMHz "
-		        "stage_ms(avg gap=%.2f scanout=%.2f render=%.2f flip=%.2f total=%.2f "
-		        "max_gap=%.2f max_total=%.2f)\n",
-		        path_tag, fps, cpu_mhz, gpu_util, gpu_mhz,
-		        avg_gap_ms, avg_scanout_ms, avg_render_ms, avg_flip_ms, avg_total_ms,
-		        max_gap_ms, max_total_ms);
+		fprintf(stderr, "[perf] %s\n", perf_monitor.last_line);
+		memory_telemetry_report("window");
 	}
-	else if (gpu_mhz >= 0 && cpu_mhz >= 0)
+	perf_control_baseline(perf_control, perf_monitor.last_line);
+	perf_monitor_window_user(PERF_WINDOW_BASELINE, false);
+
+	flight_recorder_clocks(flight_recorder, runtime_tuning.frame_counter, cpu_mhz, gpu_mhz, gpu_util, fps);
+	flight_recorder_flush(flight_recorder);
+	bench_window(cpu_mhz, gpu_mhz, gpu_util, ps);
+	coherence_profile_window(coherence_profile, double(elapsed_ms) / 1000.0);
+	rdp_stats_window();
+	fb_sync_window(double(elapsed_ms) / 1000.0);
+	soft_rdp_window(soft_rdp, double(elapsed_ms) / 1000.0, perf_monitor.frames_in_window);
+
+	if (battery_saver.enabled)
 	{
-		fprintf(stderr,
-		        "[perf] path=%s fps=%.1f cpu=%dMHz gpu_freq=%dMHz "
-		        "stage_ms(avg gap=%.2f scanout=%.2f render=%.2f flip=%.2f total=%.2f "
-		        "max_gap=%.2f max_total=%.2f)\n",
-		        path_tag, fps, cpu_mhz, gpu_mhz,
-		        avg_gap_ms, avg_scanout_ms, avg_render_ms, avg_flip_ms, avg_total_ms,
-		        max_gap_ms, max_total_ms);
+		// 5% slack so VI rate jitter does not read as a miss.
+		const double vi_rate = gfx_info.PAL ? 50.0 : 60.0;
+		const double target_fps = 0.95 * vi_rate / double(runtime_tuning.frame_skip + 1);
+		battery_saver_update(battery_saver, fps, target_fps, gpu_util);
 	}
-	else if (cpu_mhz >= 0)
+
+	perf_monitor_reset_window(now_ms);
+}
+
+// ---------------------------------------------------------------------------
+// CRT effects fused into the display scale pass
+// ---------------------------------------------------------------------------
+//
+// With an effect level set, the scanout -> display image blit is replaced by
+// one compute dispatch that samples the scanout, applies the effects and
+// writes the DMA-buf image directly, so each display pixel is still read
+// and written once. Hand-assembled SPIR-V 1.0 of:
+//
+//   layout(local_size_x = 8, local_size_y = 8) in;
+//   layout(set = 0, binding = 0) uniform sampler2D uSource;
+//   layout(set = 0, binding = 1, rgba8) writeonly uniform image2D uTarget;
+//   layout(push_constant) uniform Registers {
+//       vec2 inv_dst_size; vec2 src_size; uvec2 dst_size;
+//       float scanline; float mask; float bloom;
+//   } r;
+//   void main() {
+//       uvec2 coord = gl_GlobalInvocationID.xy;
+//       if (any(greaterThanEqual(coord, r.dst_size)))
+//           return;
+//       vec2 uv = (vec2(coord) + 0.5) * r.inv_dst_size;
+//       vec3 c = textureLod(uSource, uv, 0.0).rgb;
+//       float luma = dot(c, vec3(0.299, 0.587, 0.114));
+//       float f = fract(uv.y * r.src_size.y) - 0.5;
+//       float beam = 1.0 - r.scanline * (1.0 - r.bloom * luma) * f * f * 4.0;
+//       vec3 mask = mix(vec3(1.0 - r.mask), vec3(1.0), equal(uvec3(coord.x % 3u), uvec3(0, 1, 2)));
+//       imageStore(uTarget, ivec2(coord), vec4(c * beam * mask, 1.0));
+//   }
+static const uint32_t crt_scale_spv[] = {
+	0x07230203, 0x00010000, 0x00000000, 0x00000067, 0x00000000, 0x00020011,
+	0x00000001, 0x0006000b, 0x00000001, 0x4c534c47, 0x6474732e, 0x3035342e,
+	0x00000000, 0x0003000e, 0x00000000, 0x00000001, 0x0006000f, 0x00000005,
+	0x00000002, 0x6e69616d, 0x00000000, 0x00000003, 0x00060010, 0x00000002,
+	0x00000011, 0x00000008, 0x00000008, 0x00000001, 0x00040047, 0x00000003,
+	0x0000000b, 0x0000001c, 0x00040047, 0x00000004, 0x00000022, 0x00000000,
+	0x00040047, 0x00000004, 0x00000021, 0x00000000, 0x00040047, 0x00000005,
+	0x00000022, 0x00000000, 0x00040047, 0x00000005, 0x00000021, 0x00000001,
+	0x00030047, 0x00000005, 0x00000019, 0x00030047, 0x00000007, 0x00000002,
+	0x00050048, 0x00000007, 0x00000000, 0x00000023, 0x00000000, 0x00050048,
+	0x00000007, 0x00000001, 0x00000023, 0x00000008, 0x00050048, 0x00000007,
+	0x00000002, 0x00000023, 0x00000010, 0x00050048, 0x00000007, 0x00000003,
+	0x00000023, 0x00000018, 0x00050048, 0x00000007, 0x00000004, 0x00000023,
+	0x0000001c, 0x00050048, 0x00000007, 0x00000005, 0x00000023, 0x00000020,
+	0x00020013, 0x00000008, 0x00030021, 0x00000009, 0x00000008, 0x00030016,
+	0x0000000a, 0x00000020, 0x00040017, 0x0000000b, 0x0000000a, 0x00000002,
+	0x00040017, 0x0000000c, 0x0000000a, 0x00000003, 0x00040017, 0x0000000d,
+	0x0000000a, 0x00000004, 0x00040015, 0x0000000e, 0x00000020, 0x00000000,
+	0x00040017, 0x0000000f, 0x0000000e, 0x00000002, 0x00040017, 0x00000010,
+	0x0000000e, 0x00000003, 0x00040015, 0x00000011, 0x00000020, 0x00000001,
+	0x00040017, 0x00000012, 0x00000011, 0x00000002, 0x00020014, 0x00000013,
+	0x00040017, 0x00000014, 0x00000013, 0x00000002, 0x00040017, 0x00000015,
+	0x00000013, 0x00000003, 0x00090019, 0x00000016, 0x0000000a, 0x00000001,
+	0x00000000, 0x00000000, 0x00000000, 0x00000001, 0x00000000, 0x0003001b,
+	0x00000017, 0x00000016, 0x00090019, 0x00000018, 0x0000000a, 0x00000001,
+	0x00000000, 0x00000000, 0x00000000, 0x00000002, 0x00000004, 0x0008001e,
+	0x00000007, 0x0000000b, 0x0000000b, 0x0000000f, 0x0000000a, 0x0000000a,
+	0x0000000a, 0x00040020, 0x00000019, 0x00000001, 0x00000010, 0x00040020,
+	0x0000001a, 0x00000000, 0x00000017, 0x00040020, 0x0000001b, 0x00000000,
+	0x00000018, 0x00040020, 0x0000001c, 0x00000009, 0x00000007, 0x00040020,
+	0x0000001d, 0x00000009, 0x0000000b, 0x00040020, 0x0000001e, 0x00000009,
+	0x0000000f, 0x00040020, 0x0000001f, 0x00000009, 0x0000000a, 0x0004002b,
+	0x00000011, 0x00000020, 0x00000000, 0x0004002b, 0x00000011, 0x00000021,
+	0x00000001, 0x0004002b, 0x00000011, 0x00000022, 0x00000002, 0x0004002b,
+	0x00000011, 0x00000023, 0x00000003, 0x0004002b, 0x00000011, 0x00000024,
+	0x00000004, 0x0004002b, 0x00000011, 0x00000025, 0x00000005, 0x0004002b,
+	0x0000000e, 0x00000026, 0x00000000, 0x0004002b, 0x0000000e, 0x00000027,
+	0x00000001, 0x0004002b, 0x0000000e, 0x00000028, 0x00000002, 0x0004002b,
+	0x0000000e, 0x00000029, 0x00000003, 0x0004002b, 0x0000000a, 0x0000002a,
+	0x00000000, 0x0004002b, 0x0000000a, 0x0000002b, 0x3f000000, 0x0004002b,
+	0x0000000a, 0x0000002c, 0x3f800000, 0x0004002b, 0x0000000a, 0x0000002d,
+	0x40800000, 0x0004002b, 0x0000000a, 0x0000002e, 0x3e991687, 0x0004002b,
+	0x0000000a, 0x0000002f, 0x3f1645a2, 0x0004002b, 0x0000000a, 0x00000030,
+	0x3de978d5, 0x0005002c, 0x0000000b, 0x00000031, 0x0000002b, 0x0000002b,
+	0x0006002c, 0x0000000c, 0x00000032, 0x0000002e, 0x0000002f, 0x00000030,
+	0x0006002c, 0x0000000c, 0x00000033, 0x0000002c, 0x0000002c, 0x0000002c,
+	0x0006002c, 0x00000010, 0x00000034, 0x00000026, 0x00000027, 0x00000028,
+	0x0004003b, 0x00000019, 0x00000003, 0x00000001, 0x0004003b, 0x0000001a,
+	0x00000004, 0x00000000, 0x0004003b, 0x0000001b, 0x00000005, 0x00000000,
+	0x0004003b, 0x0000001c, 0x00000006, 0x00000009, 0x00050036, 0x00000008,
+	0x00000002, 0x00000000, 0x00000009, 0x000200f8, 0x00000035, 0x0004003d,
+	0x00000010, 0x00000038, 0x00000003, 0x0007004f, 0x0000000f, 0x00000039,
+	0x00000038, 0x00000038, 0x00000000, 0x00000001, 0x00050041, 0x0000001e,
+	0x0000003a, 0x00000006, 0x00000022, 0x0004003d, 0x0000000f, 0x0000003b,
+	0x0000003a, 0x000500ae, 0x00000014, 0x0000003c, 0x00000039, 0x0000003b,
+	0x0004009a, 0x00000013, 0x0000003d, 0x0000003c, 0x000300f7, 0x00000037,
+	0x00000000, 0x000400fa, 0x0000003d, 0x00000037, 0x00000036, 0x000200f8,
+	0x00000036, 0x00040070, 0x0000000b, 0x0000003e, 0x00000039, 0x00050081,
+	0x0000000b, 0x0000003f, 0x0000003e, 0x00000031, 0x00050041, 0x0000001d,
+	0x00000040, 0x00000006, 0x00000020, 0x0004003d, 0x0000000b, 0x00000041,
+	0x00000040, 0x00050085, 0x0000000b, 0x00000042, 0x0000003f, 0x00000041,
+	0x0004003d, 0x00000017, 0x00000043, 0x00000004, 0x00070058, 0x0000000d,
+	0x00000044, 0x00000043, 0x00000042, 0x00000002, 0x0000002a, 0x0008004f,
+	0x0000000c, 0x00000045, 0x00000044, 0x00000044, 0x00000000, 0x00000001,
+	0x00000002, 0x00050094, 0x0000000a, 0x00000046, 0x00000045, 0x00000032,
+	0x00050051, 0x0000000a, 0x00000047, 0x00000042, 0x00000001, 0x00050041,
+	0x0000001d, 0x00000048, 0x00000006, 0x00000021, 0x0004003d, 0x0000000b,
+	0x00000049, 0x00000048, 0x00050051, 0x0000000a, 0x0000004a, 0x00000049,
+	0x00000001, 0x00050085, 0x0000000a, 0x0000004b, 0x00000047, 0x0000004a,
+	0x0006000c, 0x0000000a, 0x0000004c, 0x00000001, 0x0000000a, 0x0000004b,
+	0x00050083, 0x0000000a, 0x0000004d, 0x0000004c, 0x0000002b, 0x00050041,
+	0x0000001f, 0x0000004e, 0x00000006, 0x00000023, 0x0004003d, 0x0000000a,
+	0x0000004f, 0x0000004e, 0x00050041, 0x0000001f, 0x00000050, 0x00000006,
+	0x00000024, 0x0004003d, 0x0000000a, 0x00000051, 0x00000050, 0x00050041,
+	0x0000001f, 0x00000052, 0x00000006, 0x00000025, 0x0004003d, 0x0000000a,
+	0x00000053, 0x00000052, 0x00050085, 0x0000000a, 0x00000054, 0x00000053,
+	0x00000046, 0x00050083, 0x0000000a, 0x00000055, 0x0000002c, 0x00000054,
+	0x00050085, 0x0000000a, 0x00000056, 0x0000004f, 0x00000055, 0x00050085,
+	0x0000000a, 0x00000057, 0x0000004d, 0x0000004d, 0x00050085, 0x0000000a,
+	0x00000058, 0x00000056, 0x00000057, 0x00050085, 0x0000000a, 0x00000059,
+	0x00000058, 0x0000002d, 0x00050083, 0x0000000a, 0x0000005a, 0x0000002c,
+	0x00000059, 0x00050051, 0x0000000e, 0x0000005b, 0x00000039, 0x00000000,
+	0x00050089, 0x0000000e, 0x0000005c, 0x0000005b, 0x00000029, 0x00060050,
+	0x00000010, 0x0000005d, 0x0000005c, 0x0000005c, 0x0000005c, 0x000500aa,
+	0x00000015, 0x0000005e, 0x0000005d, 0x00000034, 0x00050083, 0x0000000a,
+	0x0000005f, 0x0000002c, 0x00000051, 0x00060050, 0x0000000c, 0x00000060,
+	0x0000005f, 0x0000005f, 0x0000005f, 0x000600a9, 0x0000000c, 0x00000061,
+	0x0000005e, 0x00000033, 0x00000060, 0x0005008e, 0x0000000c, 0x00000062,
+	0x00000045, 0x0000005a, 0x00050085, 0x0000000c, 0x00000063, 0x00000062,
+	0x00000061, 0x00050050, 0x0000000d, 0x00000064, 0x00000063, 0x0000002c,
+	0x0004003d, 0x00000018, 0x00000065, 0x00000005, 0x0004007c, 0x00000012,
+	0x00000066, 0x00000039, 0x00040063, 0x00000065, 0x00000066, 0x00000064,
+	0x000200f9, 0x00000037, 0x000200f8, 0x00000037, 0x000100fd, 0x00010038,
+};
+
+struct CrtRegisters
+{
+	float inv_dst_size[2];
+	float src_size[2];
+	uint32_t dst_size[2];
+	float scanline;
+	float mask;
+	float bloom;
+};
+
+struct CrtPass
+{
+	// 0 = plain blit, 1 = scanlines, 2 = + aperture mask, 3 = + beam bloom
+	int level = 0;
+	bool storage_display = false; // display images were imported with STORAGE usage
+	bool failed = false;
+	Vulkan::Program *program = nullptr;
+
+	// Scale-pass time (submit to fence) per level, for the close report
+	uint64_t sum_us[4] = {};
+	uint32_t frames[4] = {};
+};
+
+static CrtPass crt_pass;
+static const char *const crt_level_names[4] = { "off", "scanlines", "mask", "bloom" };
+
+static void init_crt()
+{
+	const char *env = getenv("G64_CRT");
+	if (env && env[0] >= '0' && env[0] <= '3' && env[1] == '\0')
+		crt_pass.level = env[0] - '0';
+	else if (gfx_info.crt)
+		crt_pass.level = 2;
+	// The effects are the costliest of the optional per-frame passes the
+	// battery saver turns off (see init_power()).
+	if (crt_pass.level > 0 && battery_saver.enabled)
 	{
-		fprintf(stderr,
-		        "[perf] path=%s fps=%.1f cpu=%dMHz "
-		        "stage_ms(avg gap=%.2f scanout=%.2f render=%.2f flip=%.2f total=%.2f "
-		        "max_gap=%.2f max_total=%.2f)\n",
-		        path_tag, fps, cpu_mhz,
-		        avg_gap_ms, avg_scanout_ms, avg_render_ms, avg_flip_ms, avg_total_ms,
-		        max_gap_ms, max_total_ms);
+		fprintf(stderr, "[crt] Battery saver on, effects off\n");
+		crt_pass.level = 0;
 	}
-	else
+	if (crt_pass.level > 0)
+		fprintf(stderr, "[crt] Effect level %d (%s), fused into the display scale pass\n",
+		        crt_pass.level, crt_level_names[crt_pass.level]);
+}
+
+static bool crt_pass_ready(Vulkan::Device &device)
+{
+	if (crt_pass.program)
+		return true;
+	if (crt_pass.failed || !crt_pass.storage_display)
+		return false;
+
+	Vulkan::ResourceLayout layout;
+	layout.sets[0].sampled_image_mask = 1u << 0;
+	layout.sets[0].storage_image_mask = 1u << 1;
+	layout.sets[0].fp_mask = (1u << 0) | (1u << 1);
+	layout.sets[0].array_size[0] = 1;
+	layout.sets[0].array_size[1] = 1;
+	layout.push_constant_size = sizeof(CrtRegisters);
+
+	Vulkan::Shader *shader = device.request_shader(crt_scale_spv, sizeof(crt_scale_spv), &layout);
+	crt_pass.program = shader ? device.request_program(shader) : nullptr;
+	if (!crt_pass.program)
 	{
-		fprintf(stderr,
-		        "[perf] path=%s fps=%.1f "
-		        "stage_ms(avg gap=%.2f scanout=%.2f render=%.2f flip=%.2f total=%.2f "
-		        "max_gap=%.2f max_total=%.2f)\n",
-		        path_tag, fps,
-		        avg_gap_ms, avg_scanout_ms, avg_render_ms, avg_flip_ms, avg_total_ms,
-		        max_gap_ms, max_total_ms);
+		fprintf(stderr, "[crt] Failed to create the CRT scale program, using the plain blit\n");
+		crt_pass.failed = true;
+		return false;
 	}
+	return true;
+}
 
-	perf_monitor.window_start_ms = now_ms;
-	perf_monitor.frames_in_window = 0;
-	perf_monitor.sum_frame_gap_us = 0;
-	perf_monitor.sum_scanout_us = 0;
-	perf_monitor.sum_render_us = 0;
-	perf_monitor.sum_flip_us = 0;
-	perf_monitor.sum_total_us = 0;
-	perf_monitor.max_frame_gap_us = 0;
-	perf_monitor.max_scanout_us = 0;
-	perf_monitor.max_render_us = 0;
-	perf_monitor.max_flip_us = 0;
-	perf_monitor.max_total_us = 0;
+// Records scanout -> display with effects. dst must be in GENERAL layout.
+// The scanout is upscale times the VI resolution; the scanlines follow the
+// VI lines, so src_size is the native size.
+static void crt_pass_record(Vulkan::CommandBuffer &cmd, const Vulkan::Image &src, const Vulkan::Image &dst,
+                            uint32_t dst_width, uint32_t dst_height, uint32_t upscale)
+{
+	static const CrtRegisters levels[4] = {
+		{ {}, {}, {}, 0.00f, 0.00f, 0.0f },
+		{ {}, {}, {}, 0.45f, 0.00f, 0.0f },
+		{ {}, {}, {}, 0.45f, 0.20f, 0.0f },
+		{ {}, {}, {}, 0.55f, 0.20f, 0.6f },
+	};
+	CrtRegisters regs = levels[crt_pass.level];
+	regs.inv_dst_size[0] = 1.0f / float(dst_width);
+	regs.inv_dst_size[1] = 1.0f / float(dst_height);
+	const uint32_t scale = upscale ? upscale : 1;
+	regs.src_size[0] = float(src.get_width() / scale);
+	regs.src_size[1] = float(src.get_height() / scale);
+	regs.dst_size[0] = dst_width;
+	regs.dst_size[1] = dst_height;
+
+	cmd.set_program(crt_pass.program);
+	cmd.set_texture(0, 0, src.get_view(), Vulkan::StockSampler::NearestClamp);
+	cmd.set_storage_texture(0, 1, dst.get_view());
+	cmd.push_constants(&regs, 0, sizeof(regs));
+	cmd.dispatch((dst_width + 7) / 8, (dst_height + 7) / 8, 1);
+}
+
+static void crt_pass_frame(uint64_t scale_us)
+{
+	const int level = crt_pass.program ? crt_pass.level : 0;
+	crt_pass.sum_us[level] += scale_us;
+	crt_pass.frames[level]++;
+}
+
+// Added GPU time per level is measured against level 0 (the plain blit);
+// switch levels at runtime with "set crt N" to get every level in one session.
+static void crt_pass_report()
+{
+	if (crt_pass.frames[1] + crt_pass.frames[2] + crt_pass.frames[3] == 0)
+		return;
+
+	const double off_ms = crt_pass.frames[0] ? crt_pass.sum_us[0] / (1000.0 * crt_pass.frames[0]) : -1.0;
+	char text[256] = {};
+	size_t off = 0;
+	for (int level = 0; level < 4 && off < sizeof(text); level++)
+	{
+		if (!crt_pass.frames[level])
+			continue;
+		const double ms = crt_pass.sum_us[level] / (1000.0 * crt_pass.frames[level]);
+		off += snprintf(text + off, sizeof(text) - off, " %s=%.3fms", crt_level_names[level], ms);
+		if (level > 0 && off_ms >= 0.0 && off < sizeof(text))
+			off += snprintf(text + off, sizeof(text) - off, "(%+.3f)", ms - off_ms);
+	}
+	fprintf(stderr, "[crt] Scale pass avg by level:%s\n", text);
 }
 
 // ---------------------------------------------------------------------------
@@ -461,6 +1117,7 @@ struct GpuDisplayBuffer
 	Vulkan::ImageHandle image;
 	uint32_t drm_fb_id = 0;
 	uint32_t gem_handle = 0;
+	uint64_t size = 0;
 };
 
 static GpuDisplayBuffer gpu_display_bufs[2];
@@ -565,10 +1222,35 @@ static bool init_gpu_display(Vulkan::Device &device)
 		            | Vulkan::IMAGE_MISC_NO_DEFAULT_VIEWS_BIT;
 		img_ci.external.memory_handle_type =
 			VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
-		img_ci.external.handle = dmabuf_fd;  // Granite imports (and closes) the fd
 		img_ci.pnext = &drm_mod;
 
-		auto image = device.create_image(img_ci);
+		// The CRT pass writes the display image as a storage image. Linear
+		// storage images are optional, so fall back to blit-only on reject.
+		Vulkan::ImageHandle image;
+		const bool want_storage = crt_pass.level > 0 || runtime_tuning.control_enabled;
+		if (want_storage && (i == 0 || crt_pass.storage_display))
+		{
+			Vulkan::ImageCreateInfo storage_ci = img_ci;
+			storage_ci.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+			storage_ci.misc &= ~Vulkan::IMAGE_MISC_NO_DEFAULT_VIEWS_BIT;
+			storage_ci.external.handle = dup(dmabuf_fd);
+			image = device.create_image(storage_ci);
+			if (!image && storage_ci.external.handle >= 0)
+				close(storage_ci.external.handle);
+			crt_pass.storage_display = bool(image);
+			if (!image)
+				fprintf(stderr, "[gpu_display] Storage import rejected, CRT effects unavailable\n");
+		}
+		if (image)
+		{
+			close(dmabuf_fd);
+			dmabuf_fd = -1;
+		}
+		else
+		{
+			img_ci.external.handle = dmabuf_fd; // Granite imports (and closes) the fd
+			image = device.create_image(img_ci);
+		}
 		if (!image)
 		{
 			fprintf(stderr, "[gpu_display] Failed to import DMA-buf into Vulkan (buf %d)\n", i);
@@ -585,6 +1267,7 @@ static bool init_gpu_display(Vulkan::Device &device)
 		gpu_display_bufs[i].image = std::move(image);
 		gpu_display_bufs[i].drm_fb_id = fb_id;
 		gpu_display_bufs[i].gem_handle = gem_handle;
+		gpu_display_bufs[i].size = create_req.size;
 	}
 
 	gpu_display_ready = true;
@@ -611,72 +1294,1425 @@ static void cleanup_gpu_display()
 			drmIoctl(drm_display.fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy_req);
 			gpu_display_bufs[i].gem_handle = 0;
 		}
+		gpu_display_bufs[i].size = 0;
 	}
 	gpu_display_ready = false;
 	gpu_display_failed = false;
 }
 
-#define MESSAGE_TIME 3000 // 3 seconds
+// ---------------------------------------------------------------------------
+// Memory telemetry
+// ---------------------------------------------------------------------------
 
-static const unsigned cmd_len_lut[64] = {
-	1, 1, 1, 1, 1, 1, 1, 1,
-	4, 6, 12, 14, 12, 14, 20, 22,
-	1, 1, 1, 1, 1, 1, 1, 1,
-	1, 1, 1, 1, 1, 1, 1, 1,
-	1, 1, 1, 1, 2, 2, 1, 1,
-	1, 1, 1, 1, 1, 1, 1, 1,
-	1, 1, 1, 1, 1, 1, 1, 1,
-	1, 1, 1, 1, 1, 1, 1, 1,
+struct MemorySnapshot
+{
+	// /proc/self/smaps_rollup and /proc/self/status, in KiB
+	int64_t rss_kb = -1;
+	int64_t pss_kb = -1;
+	int64_t pss_anon_kb = -1;
+	int64_t pss_file_kb = -1;
+	int64_t swap_kb = -1;
+	int64_t hwm_kb = -1; // kernel-tracked RSS peak (VmHWM)
+
+	// Vulkan heaps. device_usage comes from VK_EXT_memory_budget when the
+	// driver exposes it; otherwise Granite reports its own tracked usage.
+	uint32_t heap_count = 0;
+	uint64_t heap_usage[VK_MAX_MEMORY_HEAPS] = {};
+	uint64_t heap_tracked[VK_MAX_MEMORY_HEAPS] = {};
+	uint64_t heap_budget[VK_MAX_MEMORY_HEAPS] = {};
+	bool heap_device_local[VK_MAX_MEMORY_HEAPS] = {};
+
+	// Buffers owned by this file
+	uint64_t drm_dumb_bytes = 0;
+	uint64_t scanout_pixels_bytes = 0;
+	uint64_t rdp_device_bytes = 0;
+	uint64_t rdram_bytes = 0;
 };
 
-bool sdl_event_filter(void *userdata, SDL_Event *event)
+struct MemoryTelemetry
 {
-	if (event->type == SDL_EVENT_WINDOW_CLOSE_REQUESTED)
+	bool enabled = true;
+	bool initialized = false;
+	MemorySnapshot last;
+	int64_t peak_pss_kb = 0;
+	uint64_t peak_vk_bytes = 0;
+	uint64_t peak_drm_dumb_bytes = 0;
+	uint64_t peak_scanout_pixels_bytes = 0;
+};
+
+static MemoryTelemetry memory_telemetry;
+
+// Parse "<key>   <value> kB" from a /proc text file. Returns -1 if absent.
+static int64_t parse_proc_kb(const char *text, const char *key)
+{
+	const size_t key_len = strlen(key);
+	for (const char *line = text; line && *line; )
 	{
-		callback.paused = false;
-		callback.emu_running = false;
+		if (strncmp(line, key, key_len) == 0)
+			return strtoll(line + key_len, nullptr, 10);
+		line = strchr(line, '\n');
+		if (line)
+			line++;
 	}
-	else if (event->type == SDL_EVENT_KEY_DOWN && !event->key.repeat)
+	return -1;
+}
+
+static void sample_memory(MemorySnapshot &m)
+{
+	char text[4096] = {};
+	if (read_text_file("/proc/self/smaps_rollup", text, sizeof(text)))
 	{
-		switch (event->key.scancode)
+		m.rss_kb = parse_proc_kb(text, "Rss:");
+		m.pss_kb = parse_proc_kb(text, "Pss:");
+		m.pss_anon_kb = parse_proc_kb(text, "Pss_Anon:");
+		m.pss_file_kb = parse_proc_kb(text, "Pss_File:");
+		m.swap_kb = parse_proc_kb(text, "Swap:");
+	}
+	if (read_text_file("/proc/self/status", text, sizeof(text)))
+	{
+		m.hwm_kb = parse_proc_kb(text, "VmHWM:");
+		if (m.rss_kb < 0)
+			m.rss_kb = parse_proc_kb(text, "VmRSS:");
+	}
+
+	m.heap_count = 0;
+	if (wsi)
+	{
+		auto &device = wsi->get_device();
+		const VkPhysicalDeviceMemoryProperties &props = device.get_memory_properties();
+		HeapBudget budgets[VK_MAX_MEMORY_HEAPS] = {};
+		device.get_memory_budget(budgets);
+		m.heap_count = props.memoryHeapCount;
+		for (uint32_t i = 0; i < m.heap_count; i++)
 		{
-		case SDL_SCANCODE_RETURN:
-			if (event->key.mod & SDL_KMOD_ALT)
-			{
-				gfx_info.fullscreen = !gfx_info.fullscreen;
-				SDL_SetWindowFullscreen(window, gfx_info.fullscreen);
-			}
-			break;
-		case SDL_SCANCODE_F:
-			if (event->key.mod & SDL_KMOD_ALT)
-			{
-				callback.enable_speedlimiter = !callback.enable_speedlimiter;
-			}
-			break;
-		case SDL_SCANCODE_P:
-			if (event->key.mod & SDL_KMOD_ALT)
-			{
-				callback.paused = !callback.paused;
-			}
-			break;
-		case SDL_SCANCODE_ESCAPE:
-			if (gfx_info.fullscreen)
-				callback.emu_running = false;
-			break;
-		case SDL_SCANCODE_F4:
-			crop_letterbox = !crop_letterbox;
-			break;
-		case SDL_SCANCODE_F5:
-			callback.save_state = true;
-			break;
-		case SDL_SCANCODE_F7:
-			callback.load_state = true;
-			break;
-		case SDL_SCANCODE_LEFTBRACKET:
-			callback.lower_volume = true;
-			break;
-		case SDL_SCANCODE_RIGHTBRACKET:
-			callback.raise_volume = true;
+			m.heap_usage[i] = budgets[i].device_usage;
+			m.heap_tracked[i] = budgets[i].tracked_usage;
+			m.heap_budget[i] = budgets[i].budget_size;
+			m.heap_device_local[i] = (props.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		}
+	}
+
+	m.drm_dumb_bytes = drm_display_dumb_bytes(drm_display);
+	for (const auto &buf : gpu_display_bufs)
+		m.drm_dumb_bytes += buf.size;
+	m.scanout_pixels_bytes = scanout_pixels.capacity() * sizeof(RDP::RGBA) +
+	                         soft_rdp.scanout.capacity() * sizeof(uint32_t);
+	m.rdp_device_bytes = sizeof(rdp_device);
+	m.rdram_bytes = gfx_info.RDRAM_SIZE;
+}
+
+static void update_memory_peaks(const MemorySnapshot &m)
+{
+	uint64_t vk_total = 0;
+	for (uint32_t i = 0; i < m.heap_count; i++)
+		vk_total += m.heap_usage[i];
+
+	if (m.pss_kb > memory_telemetry.peak_pss_kb)
+		memory_telemetry.peak_pss_kb = m.pss_kb;
+	if (vk_total > memory_telemetry.peak_vk_bytes)
+		memory_telemetry.peak_vk_bytes = vk_total;
+	if (m.drm_dumb_bytes > memory_telemetry.peak_drm_dumb_bytes)
+		memory_telemetry.peak_drm_dumb_bytes = m.drm_dumb_bytes;
+	if (m.scanout_pixels_bytes > memory_telemetry.peak_scanout_pixels_bytes)
+		memory_telemetry.peak_scanout_pixels_bytes = m.scanout_pixels_bytes;
+}
+
+static double kb_to_mib(int64_t kb)
+{
+	return kb < 0 ? -1.0 : double(kb) / 1024.0;
+}
+
+static double bytes_to_mib(uint64_t bytes)
+{
+	return double(bytes) / (1024.0 * 1024.0);
+}
+
+static void log_memory(const char *when, const MemorySnapshot &m)
+{
+	char heaps[256] = {};
+	size_t off = 0;
+	for (uint32_t i = 0; i < m.heap_count && off < sizeof(heaps); i++)
+	{
+		off += snprintf(heaps + off, sizeof(heaps) - off, " vk_heap%u%s=%.1f/%.1fMiB(granite=%.1f)",
+		                i, m.heap_device_local[i] ? "_local" : "",
+		                bytes_to_mib(m.heap_usage[i]), bytes_to_mib(m.heap_budget[i]),
+		                bytes_to_mib(m.heap_tracked[i]));
+	}
+
+	fprintf(stderr,
+	        "[mem] %s rss=%.1fMiB pss=%.1fMiB (anon=%.1f file=%.1f swap=%.1f)%s "
+	        "drm_dumb=%.1fMiB scanout_pixels=%.2fMiB rdp_device=%.2fMiB rdram=%.1fMiB "
+	        "peak(rss=%.1f pss=%.1f vk=%.1f drm_dumb=%.1f scanout_pixels=%.2f)MiB\n",
+	        when, kb_to_mib(m.rss_kb), kb_to_mib(m.pss_kb),
+	        kb_to_mib(m.pss_anon_kb), kb_to_mib(m.pss_file_kb), kb_to_mib(m.swap_kb),
+	        heaps,
+	        bytes_to_mib(m.drm_dumb_bytes), bytes_to_mib(m.scanout_pixels_bytes),
+	        bytes_to_mib(m.rdp_device_bytes), bytes_to_mib(m.rdram_bytes),
+	        kb_to_mib(m.hwm_kb), kb_to_mib(memory_telemetry.peak_pss_kb),
+	        bytes_to_mib(memory_telemetry.peak_vk_bytes),
+	        bytes_to_mib(memory_telemetry.peak_drm_dumb_bytes),
+	        bytes_to_mib(memory_telemetry.peak_scanout_pixels_bytes));
+}
+
+static void memory_telemetry_report(const char *when)
+{
+	if (!memory_telemetry.initialized)
+	{
+		const char *env = getenv("G64_MEM_TELEMETRY");
+		memory_telemetry.enabled = !(env && env[0] == '0');
+		memory_telemetry.initialized = true;
+	}
+	if (!memory_telemetry.enabled)
+		return;
+
+	sample_memory(memory_telemetry.last);
+	update_memory_peaks(memory_telemetry.last);
+	log_memory(when, memory_telemetry.last);
+}
+
+// ---------------------------------------------------------------------------
+// Batched command enqueue
+// ---------------------------------------------------------------------------
+
+// Complete commands are contiguous in rdp_device.cmd_data, so
+// rdp_process_commands() only records where a run starts and how long each
+// command is, then hands the whole run over in one call. Runs end at
+// SyncFull, at color/depth image changes, at COMMAND_BATCH_MAX_COMMANDS and
+// before the command buffer is reset.
+#define COMMAND_BATCH_MAX_COMMANDS 256
+
+struct CommandBatch
+{
+	bool batched = false; // processor->enqueue_commands() available and not disabled
+	bool timed = false;   // G64_ENQUEUE_STATS=1: time every enqueue call
+	const uint32_t *start = nullptr;
+	std::vector<unsigned> counts;
+
+	uint64_t commands = 0;
+	uint64_t calls = 0;
+	uint64_t enqueue_ns = 0;
+};
+
+static CommandBatch command_batch;
+
+static uint64_t monotonic_ns()
+{
+	struct timespec ts = {};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+static void init_command_batch()
+{
+#ifdef RDP_HAS_ENQUEUE_COMMANDS
+	// G64_ENQUEUE_BATCH=0 goes back to one enqueue call per command.
+	const char *env = getenv("G64_ENQUEUE_BATCH");
+	command_batch.batched = !(env && env[0] == '0');
+#endif
+	command_batch.timed = env_enabled("G64_ENQUEUE_STATS");
+	command_batch.counts.reserve(COMMAND_BATCH_MAX_COMMANDS);
+	fprintf(stderr, "[enqueue] mode=%s%s\n", command_batch.batched ? "batched" : "per-command",
+	        command_batch.timed ? " (timed)" : "");
+}
+
+// Enqueue num_commands complete commands laid out back to back at words.
+static void enqueue_command_run(const uint32_t *words, const unsigned *counts, unsigned num_commands)
+{
+	const uint64_t start_ns = command_batch.timed ? monotonic_ns() : 0;
+	if (soft_rdp.enabled)
+	{
+		soft_rdp_enqueue(soft_rdp, num_commands, counts, words);
+		command_batch.calls++;
+	}
+#ifdef RDP_HAS_ENQUEUE_COMMANDS
+	else if (command_batch.batched)
+	{
+		processor->enqueue_commands(num_commands, counts, words);
+		command_batch.calls++;
+	}
+#endif
+	else
+	{
+		for (unsigned c = 0; c < num_commands; c++)
+		{
+			processor->enqueue_command(counts[c], words);
+			words += counts[c];
+		}
+		command_batch.calls += num_commands;
+	}
+	command_batch.commands += num_commands;
+	if (command_batch.timed)
+		command_batch.enqueue_ns += monotonic_ns() - start_ns;
+}
+
+static void command_batch_flush()
+{
+	if (command_batch.counts.empty())
+		return;
+	enqueue_command_run(command_batch.start, command_batch.counts.data(), unsigned(command_batch.counts.size()));
+	command_batch.counts.clear();
+}
+
+static void command_batch_add(const uint32_t *words, unsigned count)
+{
+	if (command_batch.counts.empty())
+		command_batch.start = words;
+	command_batch.counts.push_back(count);
+	if (command_batch.counts.size() >= COMMAND_BATCH_MAX_COMMANDS)
+		command_batch_flush();
+}
+
+static void command_batch_report()
+{
+	if (!command_batch.commands)
+		return;
+	char cost[48] = {};
+	if (command_batch.timed)
+		snprintf(cost, sizeof(cost), " ns_per_cmd=%.1f",
+		         double(command_batch.enqueue_ns) / double(command_batch.commands));
+	fprintf(stderr, "[enqueue] mode=%s commands=%llu calls=%llu cmds_per_call=%.1f%s\n",
+	        command_batch.batched ? "batched" : "per-command",
+	        (unsigned long long)command_batch.commands, (unsigned long long)command_batch.calls,
+	        double(command_batch.commands) / double(command_batch.calls ? command_batch.calls : 1), cost);
+}
+
+// ---------------------------------------------------------------------------
+// RDP command statistics
+// ---------------------------------------------------------------------------
+
+// Everything is derived from per-opcode counts, so the command loop only
+// pays one increment per command. Frames are VI frames (rdp_render_frame()
+// calls), including frames dropped by frame skip.
+struct RdpStatsCounters
+{
+	uint64_t ops[64] = {};
+	uint64_t bytes = 0;
+	uint64_t fb_switches = 0; // SetColorImage to a different address
+};
+
+struct RdpStats
+{
+	bool enabled = false;
+	uint32_t last_color_image = ~0u;
+
+	RdpStatsCounters frame;  // current frame
+	RdpStatsCounters window; // sum over the perf window
+	RdpStatsCounters total;  // session
+	uint32_t window_frames = 0;
+	uint64_t total_frames = 0;
+	uint64_t window_max_tris = 0;
+	uint64_t max_tris = 0;
+};
+
+static RdpStats rdp_stats;
+
+static void init_rdp_stats()
+{
+	rdp_stats.enabled = env_enabled("G64_RDP_STATS");
+	perf_monitor_window_user(PERF_WINDOW_RDP_STATS, rdp_stats.enabled);
+	if (rdp_stats.enabled)
+		fprintf(stderr, "[rdp_stats] Counting RDP commands per frame\n");
+}
+
+static uint64_t rdp_stats_triangles(const RdpStatsCounters &c, unsigned required_bits)
+{
+	// Triangle opcodes 0x08-0x0f: bit 2 shade, bit 1 texture, bit 0 z-buffer.
+	uint64_t n = 0;
+	for (unsigned op = 0x08; op <= 0x0f; op++)
+		if ((op & required_bits) == required_bits)
+			n += c.ops[op];
+	return n;
+}
+
+static uint64_t rdp_stats_rects(const RdpStatsCounters &c)
+{
+	return c.ops[unsigned(RDP::Op::TextureRectangle)] + c.ops[unsigned(RDP::Op::TextureRectangleFlip)];
+}
+
+static uint64_t rdp_stats_loads(const RdpStatsCounters &c)
+{
+	return c.ops[unsigned(RDP::Op::LoadTile)] + c.ops[unsigned(RDP::Op::LoadBlock)] +
+	       c.ops[unsigned(RDP::Op::LoadTLut)];
+}
+
+static void rdp_stats_add(RdpStatsCounters &dst, const RdpStatsCounters &src)
+{
+	for (unsigned op = 0; op < 64; op++)
+		dst.ops[op] += src.ops[op];
+	dst.bytes += src.bytes;
+	dst.fb_switches += src.fb_switches;
+}
+
+// Close the current frame. Called once per rdp_render_frame().
+static void rdp_stats_frame()
+{
+	if (!rdp_stats.enabled)
+		return;
+	const uint64_t tris = rdp_stats_triangles(rdp_stats.frame, 0);
+	if (tris > rdp_stats.window_max_tris)
+		rdp_stats.window_max_tris = tris;
+	if (tris > rdp_stats.max_tris)
+		rdp_stats.max_tris = tris;
+	rdp_stats_add(rdp_stats.window, rdp_stats.frame);
+	rdp_stats_add(rdp_stats.total, rdp_stats.frame);
+	rdp_stats.window_frames++;
+	rdp_stats.total_frames++;
+	rdp_stats.frame = RdpStatsCounters();
+}
+
+static void rdp_stats_window()
+{
+	if (!rdp_stats.enabled || rdp_stats.window_frames == 0)
+		return;
+	const RdpStatsCounters &w = rdp_stats.window;
+	const double frames = double(rdp_stats.window_frames);
+	fprintf(stderr, "[rdp_stats] per_frame tris=%.0f (shade=%.0f tex=%.0f z=%.0f) rects=%.0f fill_rects=%.0f "
+	                "loads=%.0f tlut=%.0f fb_switches=%.1f sync_full=%.1f kb=%.1f max_tris=%llu\n",
+	        double(rdp_stats_triangles(w, 0)) / frames,
+	        double(rdp_stats_triangles(w, 4)) / frames,
+	        double(rdp_stats_triangles(w, 2)) / frames,
+	        double(rdp_stats_triangles(w, 1)) / frames,
+	        double(rdp_stats_rects(w)) / frames,
+	        double(w.ops[unsigned(RDP::Op::FillRectangle)]) / frames,
+	        double(rdp_stats_loads(w)) / frames,
+	        double(w.ops[unsigned(RDP::Op::LoadTLut)]) / frames,
+	        double(w.fb_switches) / frames,
+	        double(w.ops[unsigned(RDP::Op::SyncFull)]) / frames,
+	        double(w.bytes) / (1024.0 * frames),
+	        (unsigned long long)rdp_stats.window_max_tris);
+	rdp_stats.window = RdpStatsCounters();
+	rdp_stats.window_frames = 0;
+	rdp_stats.window_max_tris = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Framebuffer coherence modes
+// ---------------------------------------------------------------------------
+
+// How rdp_check_framebuffers() keeps CPU accesses coherent with queued RDP
+// work (G64_COHERENCE, the per-game "Framebuffer Sync" setting):
+//   strict   a dirty hit waits for the newest SyncFull (upstream behaviour)
+//   async    dirty ranges per SyncFull, retired without blocking (below)
+//   relaxed  no CPU-side sync at all, for games that never read back what
+//            the RDP drew; the dirty test is skipped too
+// Every mode reports its syncs and the time they stalled the CPU, so a
+// game can be checked in strict or async before it is switched to relaxed.
+enum FbSyncMode : uint8_t
+{
+	FB_SYNC_STRICT = 0,
+	FB_SYNC_ASYNC = 1,
+	FB_SYNC_RELAXED = 2,
+	FB_SYNC_MODES
+};
+
+static const char *const fb_sync_mode_names[FB_SYNC_MODES] = {
+	"strict",
+	"async",
+	"relaxed",
+};
+
+struct FbSyncCounters
+{
+	uint64_t checks = 0; // rdp_check_framebuffers() calls
+	uint64_t hits = 0;   // ... that overlapped the dirty map
+	uint64_t syncs = 0;  // ... that blocked on the timeline
+	uint64_t sync_us = 0;
+};
+
+struct FbSync
+{
+	FbSyncMode mode = FB_SYNC_STRICT;
+	uint64_t start_us = 0;
+	FbSyncCounters window;
+	FbSyncCounters total;
+};
+
+static FbSync fb_sync;
+
+// Async mode: SyncFull already hands everything queued so far to the GPU
+// (signal_timeline()), so by the time the CPU touches a framebuffer the
+// results are usually back in RDRAM. Strict mode cannot tell: a dirty hit
+// waits for the newest SyncFull and only then clears the map. Here each
+// dirty range remembers the SyncFull that covers it. Retired SyncFulls are
+// found with a non-blocking timeline query and their ranges dropped from
+// the map; a hit waits only for the SyncFull covering the ranges it
+// overlaps. A shadow of the strict-mode map tells which accesses strict
+// mode would have blocked on; the avoided stall time runs from such an
+// access until its SyncFull is seen retired, so it is an upper bound.
+#define ASYNC_WRITEBACK_MAX_RANGES 256
+
+struct AsyncWritebackRange
+{
+	uint32_t begin; // 8-byte units, [begin, end)
+	uint32_t end;
+	uint64_t signal; // 0 until the SyncFull that covers it
+};
+
+struct AsyncWritebackCounters
+{
+	uint64_t queries = 0;       // non-blocking timeline queries
+	uint64_t early_retires = 0; // ranges dropped without anyone waiting
+	uint64_t avoided = 0;       // accesses strict mode would have blocked on
+	uint64_t avoided_us = 0;
+};
+
+struct AsyncWriteback
+{
+	bool enabled = false;
+	std::vector<AsyncWritebackRange> ranges; // oldest first
+	bool overflow = false;          // ranges not tracked: behave as strict mode
+	uint64_t retired = 0;           // highest signal known to have retired
+	std::vector<bool> strict_dirty; // rdram_dirty as strict mode would have it
+	uint64_t strict_signal = 0;     // sync_signal as strict mode would have it
+	uint64_t avoid_signal = 0;      // signal an avoided access would have waited for
+	uint64_t avoid_start_us = 0;
+	AsyncWritebackCounters window;
+	AsyncWritebackCounters total;
+};
+
+static AsyncWriteback async_writeback;
+
+static void init_fb_sync()
+{
+	fb_sync = FbSync();
+	async_writeback = AsyncWriteback();
+	fb_sync.start_us = monotonic_us();
+
+	const char *name = getenv("G64_COHERENCE");
+	if (name && name[0])
+	{
+		int mode = 0;
+		while (mode < FB_SYNC_MODES && strcmp(name, fb_sync_mode_names[mode]) != 0)
+			mode++;
+		if (mode == FB_SYNC_MODES)
+			fprintf(stderr, "[fb_sync] Unknown G64_COHERENCE=%s, using strict\n", name);
+		else if (soft_rdp.enabled && mode != FB_SYNC_STRICT)
+			fprintf(stderr, "[fb_sync] Software RDP is coherent at SyncFull, ignoring G64_COHERENCE=%s\n", name);
+		else
+			fb_sync.mode = FbSyncMode(mode);
+	}
+	fprintf(stderr, "[fb_sync] Framebuffer coherence: %s\n", fb_sync_mode_names[fb_sync.mode]);
+	flight_recorder_event(flight_recorder, 0, "fb_sync %s", fb_sync_mode_names[fb_sync.mode]);
+	perf_monitor_window_user(PERF_WINDOW_FB_SYNC, fb_sync.mode != FB_SYNC_STRICT);
+
+	if (fb_sync.mode != FB_SYNC_ASYNC)
+		return;
+	async_writeback.enabled = true;
+	async_writeback.ranges.reserve(ASYNC_WRITEBACK_MAX_RANGES);
+	async_writeback.strict_dirty.assign(gfx_info.RDRAM_SIZE >> 3, false);
+#ifndef RDP_HAS_TIMELINE_QUERY
+	fprintf(stderr, "[fb_sync] No timeline query in parallel-rdp, async retires on waits only\n");
+#endif
+}
+
+static bool fb_sync_active()
+{
+	return fb_sync.mode != FB_SYNC_STRICT;
+}
+
+static bool async_writeback_reached(uint64_t signal)
+{
+	if (signal <= async_writeback.retired)
+		return true;
+#ifdef RDP_HAS_TIMELINE_QUERY
+	async_writeback.window.queries++;
+	if (processor->timeline_reached(signal))
+	{
+		async_writeback.retired = signal;
+		return true;
+	}
+#endif
+	return false;
+}
+
+static void async_writeback_settle(uint64_t now_us)
+{
+	AsyncWriteback &a = async_writeback;
+	if (a.avoid_signal && a.avoid_signal <= a.retired)
+	{
+		a.window.avoided_us += now_us - a.avoid_start_us;
+		a.avoid_signal = 0;
+	}
+}
+
+// Everything is covered by a retired SyncFull: clear the map as a strict
+// wait would have.
+static void async_writeback_clear()
+{
+	async_writeback.ranges.clear();
+	async_writeback.overflow = false;
+	rdram_dirty.assign(gfx_info.RDRAM_SIZE >> 3, false);
+	sync_signal = 0;
+}
+
+// Drop ranges whose SyncFull has retired and rebuild the dirty map from
+// the rest.
+static void async_writeback_retire()
+{
+	AsyncWriteback &a = async_writeback;
+	const uint64_t retired = a.retired;
+	a.ranges.erase(std::remove_if(a.ranges.begin(), a.ranges.end(),
+	                              [retired](const AsyncWritebackRange &r) { return r.signal && r.signal <= retired; }),
+	               a.ranges.end());
+
+	rdram_dirty.assign(gfx_info.RDRAM_SIZE >> 3, false);
+	bool pending = false;
+	for (const AsyncWritebackRange &r : a.ranges)
+	{
+		std::fill(rdram_dirty.begin() + r.begin, rdram_dirty.begin() + r.end, true);
+		pending |= r.signal != 0;
+	}
+	// Ranges queued after the last SyncFull get armed by the next one.
+	if (!pending)
+		sync_signal = 0;
+}
+
+// Replay an access ([begin, end) in 8-byte units) against the strict-mode
+// state. Where strict mode would have blocked on a SyncFull that has not
+// retired yet, start the avoided-stall clock.
+static void async_writeback_shadow(uint32_t begin, uint32_t end)
+{
+	AsyncWriteback &a = async_writeback;
+	if (a.avoid_signal && async_writeback_reached(a.avoid_signal))
+		async_writeback_settle(monotonic_us());
+	if (!a.strict_signal || begin >= a.strict_dirty.size())
+		return;
+	end = std::min(end, static_cast<uint32_t>(a.strict_dirty.size()));
+	if (std::find(a.strict_dirty.begin() + begin, a.strict_dirty.begin() + end, true) == a.strict_dirty.begin() + end)
+		return;
+
+	if (!async_writeback_reached(a.strict_signal))
+	{
+		a.window.avoided++;
+		if (!a.avoid_signal)
+		{
+			a.avoid_signal = a.strict_signal;
+			a.avoid_start_us = monotonic_us();
+		}
+	}
+	a.strict_dirty.assign(a.strict_dirty.size(), false);
+	a.strict_signal = 0;
+}
+
+// Non-blocking: drop whatever has retired since the last look.
+static void async_writeback_poll()
+{
+	AsyncWriteback &a = async_writeback;
+	if (a.overflow)
+	{
+		if (!async_writeback_reached(sync_signal))
+			return;
+		async_writeback_clear();
+	}
+	else
+	{
+		if (a.ranges.empty() || !a.ranges.front().signal || !async_writeback_reached(a.ranges.front().signal))
+			return;
+		async_writeback_reached(sync_signal);
+		async_writeback_retire();
+	}
+	a.window.early_retires++;
+	async_writeback_settle(monotonic_us());
+}
+
+// A CPU access overlapped the dirty map ([begin, end) in 8-byte units).
+// Returns true if it had to block.
+static bool async_writeback_hit(uint32_t begin, uint32_t end)
+{
+	AsyncWriteback &a = async_writeback;
+
+	uint64_t needed = 0;
+	bool untracked = a.overflow;
+	for (const AsyncWritebackRange &r : a.ranges)
+	{
+		if (r.begin >= end || begin >= r.end)
+			continue;
+		if (r.signal)
+			needed = std::max(needed, r.signal);
+		else
+			untracked = true;
+	}
+	// Work queued after the last SyncFull has no signal of its own. As in
+	// strict mode, the newest SyncFull covers it.
+	if (untracked)
+		needed = sync_signal;
+
+	bool waited = false;
+	if (needed && !async_writeback_reached(needed))
+	{
+		const uint64_t wait_start_us = monotonic_us();
+		processor->wait_for_timeline(needed);
+		a.retired = std::max(a.retired, needed);
+		fb_sync.window.syncs++;
+		fb_sync.window.sync_us += monotonic_us() - wait_start_us;
+		waited = true;
+		// Blocked on the same SyncFull strict mode would have: nothing avoided.
+		if (a.avoid_signal && needed >= a.avoid_signal)
+		{
+			if (a.window.avoided)
+				a.window.avoided--;
+			a.avoid_signal = 0;
+		}
+	}
+
+	if (untracked)
+		async_writeback_clear();
+	else
+		async_writeback_retire();
+	async_writeback_settle(monotonic_us());
+	return waited;
+}
+
+// A range marked by rdp_process_commands().
+static void async_writeback_mark(uint32_t begin, uint32_t end)
+{
+	AsyncWriteback &a = async_writeback;
+	std::fill(a.strict_dirty.begin() + begin, a.strict_dirty.begin() + end, true);
+	if (a.overflow)
+		return;
+	for (auto it = a.ranges.rbegin(); it != a.ranges.rend() && !it->signal; ++it)
+		if (it->begin <= begin && end <= it->end)
+			return;
+	if (a.ranges.size() >= ASYNC_WRITEBACK_MAX_RANGES)
+	{
+		a.overflow = true;
+		return;
+	}
+	a.ranges.push_back({ begin, end, 0 });
+}
+
+// SyncFull: signal covers every range marked since the previous one.
+static void async_writeback_sync(uint64_t signal)
+{
+	AsyncWriteback &a = async_writeback;
+	for (auto it = a.ranges.rbegin(); it != a.ranges.rend() && !it->signal; ++it)
+		it->signal = signal;
+	a.strict_signal = signal;
+}
+
+// The dirty map was cleared behind our back (full wait, new processor).
+static void async_writeback_reset()
+{
+	AsyncWriteback &a = async_writeback;
+	if (!a.enabled)
+		return;
+	a.ranges.clear();
+	a.overflow = false;
+	a.retired = 0;
+	a.strict_dirty.assign(gfx_info.RDRAM_SIZE >> 3, false);
+	a.strict_signal = 0;
+	a.avoid_signal = 0;
+}
+
+static void fb_sync_accumulate()
+{
+	FbSyncCounters &t = fb_sync.total;
+	const FbSyncCounters &w = fb_sync.window;
+	t.checks += w.checks;
+	t.hits += w.hits;
+	t.syncs += w.syncs;
+	t.sync_us += w.sync_us;
+	fb_sync.window = FbSyncCounters();
+
+	AsyncWritebackCounters &at = async_writeback.total;
+	const AsyncWritebackCounters &aw = async_writeback.window;
+	at.queries += aw.queries;
+	at.early_retires += aw.early_retires;
+	at.avoided += aw.avoided;
+	at.avoided_us += aw.avoided_us;
+	async_writeback.window = AsyncWritebackCounters();
+}
+
+static void fb_sync_log(const char *label, const FbSyncCounters &c, const AsyncWritebackCounters &a, double s)
+{
+	char extra[128] = {};
+	if (fb_sync.mode == FB_SYNC_ASYNC)
+		snprintf(extra, sizeof(extra), " avoided=%llu avoided_ms_per_s=%.2f early_retires=%.0f/s queries=%.0f/s%s",
+		         (unsigned long long)a.avoided, double(a.avoided_us) / 1000.0 / s,
+		         double(a.early_retires) / s, double(a.queries) / s,
+		         async_writeback.overflow ? " overflow" : "");
+	fprintf(stderr, "[fb_sync] %smode=%s checks=%.0f/s hits=%llu syncs=%llu stall_ms=%.2f stall_ms_per_s=%.2f%s\n",
+	        label, fb_sync_mode_names[fb_sync.mode], double(c.checks) / s, (unsigned long long)c.hits,
+	        (unsigned long long)c.syncs, double(c.sync_us) / 1000.0, double(c.sync_us) / 1000.0 / s, extra);
+}
+
+static void fb_sync_window(double elapsed_s)
+{
+	if (!fb_sync_active() && perf_monitor.log_level == 0)
+	{
+		fb_sync_accumulate();
+		return;
+	}
+	fb_sync_log("", fb_sync.window, async_writeback.window, elapsed_s > 0.0 ? elapsed_s : 1.0);
+	fb_sync_accumulate();
+}
+
+static void fb_sync_report()
+{
+	fb_sync_accumulate();
+	const double s = std::max(1e-3, double(monotonic_us() - fb_sync.start_us) / 1e6);
+	fb_sync_log("session ", fb_sync.total, async_writeback.total, s);
+	fb_sync.total = FbSyncCounters();
+	async_writeback.total = AsyncWritebackCounters();
+}
+
+// ---------------------------------------------------------------------------
+// Display-list memoization
+// ---------------------------------------------------------------------------
+
+static DisplayListCache dl_cache;
+
+static void init_display_list_cache()
+{
+	// The skip decision polls the GPU timeline; the software RDP has none.
+	dl_cache.enabled = env_enabled("G64_DL_CACHE") && !soft_rdp.enabled;
+#ifndef RDP_HAS_TIMELINE_QUERY
+	if (dl_cache.enabled)
+	{
+		fprintf(stderr, "[dlcache] No timeline query in parallel-rdp, memoization disabled\n");
+		dl_cache.enabled = false;
+	}
+#endif
+	if (dl_cache.enabled)
+		fprintf(stderr, "[dlcache] Display-list memoization enabled\n");
+}
+
+static bool dl_cache_retired(uint64_t signal)
+{
+#ifdef RDP_HAS_TIMELINE_QUERY
+	return signal && processor->timeline_reached(signal);
+#else
+	(void)signal;
+	return false;
+#endif
+}
+
+// Take the deferred hash of the last rendered candidate if its list has
+// retired. Anything that may write its ranges must run this first and
+// drop the hash if it is still pending.
+static void dl_cache_settle()
+{
+	if (dl_cache.pending.signal && dl_cache_retired(dl_cache.pending.signal))
+		display_list_cache_complete(dl_cache, gfx_info.RDRAM, gfx_info.RDRAM_SIZE);
+}
+
+static bool is_draw_command(uint32_t command)
+{
+	switch (RDP::Op(command))
+	{
+	case RDP::Op::FillTriangle:
+	case RDP::Op::FillZBufferTriangle:
+	case RDP::Op::TextureTriangle:
+	case RDP::Op::TextureZBufferTriangle:
+	case RDP::Op::ShadeTriangle:
+	case RDP::Op::ShadeZBufferTriangle:
+	case RDP::Op::ShadeTextureTriangle:
+	case RDP::Op::ShadeTextureZBufferTriangle:
+	case RDP::Op::TextureRectangle:
+	case RDP::Op::TextureRectangleFlip:
+	case RDP::Op::FillRectangle:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void dl_cache_enqueue(bool draws)
+{
+	if (draws)
+	{
+		enqueue_command_run(dl_cache.words.data(), dl_cache.command_words.data(),
+		                    unsigned(dl_cache.command_words.size()));
+		return;
+	}
+
+	const uint32_t *words = dl_cache.words.data();
+	for (uint32_t count : dl_cache.command_words)
+	{
+		if (!is_draw_command((words[0] >> 24) & 63))
+			processor->enqueue_command(count, words);
+		words += count;
+	}
+}
+
+// Pass buffered commands through uncached. Anything that scans out, waits
+// for the RDP or replaces the processor must see them enqueued first.
+static void dl_cache_drain()
+{
+	if (dl_cache.words.empty())
+		return;
+	dl_cache_settle();
+	display_list_cache_drop_pending(dl_cache);
+	dl_cache_enqueue(true);
+	display_list_cache_clear(dl_cache);
+	// Only the next SyncFull covers these.
+	dl_cache.prior_signal = 0;
+}
+
+// Called at SyncFull, before the list's timeline is signaled.
+static void dl_cache_flush()
+{
+	int entry = display_list_cache_match(dl_cache);
+	if (entry < 0)
+	{
+		dl_cache_drain();
+		return;
+	}
+
+	// A repeated stream. RDRAM holds the state it starts from only once
+	// everything before it has retired; never wait for that here.
+	dl_cache_settle();
+	if (!dl_cache_retired(dl_cache.prior_signal))
+	{
+		dl_cache.busy++;
+		dl_cache_drain();
+		return;
+	}
+
+	uint64_t pre_hash = display_list_cache_state_hash(dl_cache, gfx_info.RDRAM, gfx_info.RDRAM_SIZE);
+	if (display_list_cache_should_skip(dl_cache, entry, pre_hash))
+	{
+		dl_cache_enqueue(false);
+		display_list_cache_clear(dl_cache);
+		return;
+	}
+
+	dl_cache_enqueue(true);
+	display_list_cache_defer(dl_cache, entry, pre_hash);
+	display_list_cache_clear(dl_cache);
+}
+
+// ---------------------------------------------------------------------------
+// Frame output checksums
+// ---------------------------------------------------------------------------
+
+// The checksum covers the VI scanout (RGBA8, native size) rather than the
+// display buffer, so the GPU, CPU and null presentation paths are comparable
+// with each other. tools/checksum_diff.sh finds the first mismatching frame.
+struct FrameChecksum
+{
+	bool enabled = false;
+	FILE *out = nullptr;
+	Vulkan::BufferHandle readback;
+	bool pending = false;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint64_t frames = 0;
+};
+
+static FrameChecksum frame_checksum;
+
+static void init_frame_checksum()
+{
+	const char *env = getenv("G64_FRAME_CHECKSUM");
+	if (!env || !env[0])
+		return;
+
+	// "1" logs to stderr, anything starting with '/' is a path.
+	const char *path = env[0] == '/' ? env : nullptr;
+	if (!path && !env_enabled("G64_FRAME_CHECKSUM"))
+		return;
+
+	frame_checksum.out = stderr;
+	if (path)
+	{
+		frame_checksum.out = fopen(path, "w");
+		if (!frame_checksum.out)
+		{
+			fprintf(stderr, "[checksum] Cannot open %s: %s\n", path, strerror(errno));
+			return;
+		}
+	}
+	frame_checksum.enabled = true;
+	fprintf(stderr, "[checksum] Logging per-frame scanout checksums to %s\n", path ? path : "stderr");
+}
+
+// FNV-1a over 32-bit pixels.
+static uint64_t frame_checksum_hash(const uint8_t *pixels, uint32_t width, uint32_t height, size_t stride)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		const uint8_t *row = pixels + size_t(y) * stride;
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint32_t pixel;
+			memcpy(&pixel, row + size_t(x) * 4, sizeof(pixel));
+			hash ^= pixel;
+			hash *= 0x100000001B3ull;
+		}
+	}
+	return hash;
+}
+
+static void frame_checksum_log(const uint8_t *pixels, uint32_t width, uint32_t height, size_t stride,
+                               const char *path_tag)
+{
+	// rdp_render_frame() has already advanced the counter for this frame.
+	const uint32_t frame = runtime_tuning.frame_counter - 1;
+	fprintf(frame_checksum.out, "[checksum] frame=%u size=%ux%u fnv=%016llx path=%s\n",
+	        frame, width, height,
+	        (unsigned long long)frame_checksum_hash(pixels, width, height, stride), path_tag);
+	frame_checksum.frames++;
+}
+
+// Copy the scanout into a host-visible buffer at the end of cmd. The image
+// is returned to the layout the scanout handed it over in.
+static void frame_checksum_record(Vulkan::Device &device, Vulkan::CommandBuffer &cmd, const Vulkan::Image &image)
+{
+	const uint32_t width = image.get_width();
+	const uint32_t height = image.get_height();
+	const VkDeviceSize size = VkDeviceSize(width) * height * 4;
+	if (!frame_checksum.readback || frame_checksum.readback->get_create_info().size < size)
+	{
+		Vulkan::BufferCreateInfo info = {};
+		info.domain = Vulkan::BufferDomain::CachedHost;
+		info.size = size;
+		info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		frame_checksum.readback = device.create_buffer(info);
+		if (!frame_checksum.readback)
+			return;
+	}
+
+	cmd.image_barrier(image,
+	                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+	                  VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 0,
+	                  VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+	cmd.copy_image_to_buffer(*frame_checksum.readback, image, 0,
+	                         { 0, 0, 0 }, { width, height, 1 }, 0, 0,
+	                         { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 });
+	cmd.image_barrier(image,
+	                  VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	                  VK_PIPELINE_STAGE_2_COPY_BIT, 0,
+	                  VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 0);
+	cmd.barrier(VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+	            VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+
+	frame_checksum.width = width;
+	frame_checksum.height = height;
+	frame_checksum.pending = true;
+}
+
+// Hash the copy recorded by frame_checksum_record(). Call after the fence.
+static void frame_checksum_finish(Vulkan::Device &device, const char *path_tag)
+{
+	if (!frame_checksum.pending)
+		return;
+	frame_checksum.pending = false;
+
+	auto *pixels = static_cast<const uint8_t *>(
+		device.map_host_buffer(*frame_checksum.readback, Vulkan::MEMORY_ACCESS_READ_BIT));
+	if (!pixels)
+		return;
+	frame_checksum_log(pixels, frame_checksum.width, frame_checksum.height,
+	                   size_t(frame_checksum.width) * 4, path_tag);
+	device.unmap_host_buffer(*frame_checksum.readback, Vulkan::MEMORY_ACCESS_READ_BIT);
+}
+
+static void frame_checksum_cleanup()
+{
+	if (!frame_checksum.enabled)
+		return;
+	fprintf(stderr, "[checksum] %llu frames checksummed\n", (unsigned long long)frame_checksum.frames);
+	if (frame_checksum.out && frame_checksum.out != stderr)
+		fclose(frame_checksum.out);
+	frame_checksum.out = nullptr;
+	frame_checksum.readback.reset();
+	frame_checksum.enabled = false;
+}
+
+// ---------------------------------------------------------------------------
+// Fixed-length benchmark run
+// ---------------------------------------------------------------------------
+
+struct BenchMean
+{
+	double sum = 0.0;
+	uint32_t count = 0;
+};
+
+struct BenchRun
+{
+	bool enabled = false;
+	bool null_present = false;
+	bool started = false;
+	bool finished = false;
+	bool reported = false;
+	int state_slot = -1;
+	uint32_t frames = 0;         // measured frames
+	uint32_t warmup_frames = 60; // presented frames discarded first
+	uint32_t seen = 0;
+	char json_path[256] = {};
+	const char *path_tag = "none";
+
+	// Baselines taken when measurement starts
+	uint64_t start_us = 0;
+	uint64_t end_us = 0;
+	uint64_t vblank_wait_start_us = 0;
+	uint32_t flip_busy_start = 0;
+	long minflt_start = 0;
+	long majflt_start = 0;
+	uint64_t vblank_wait_us = 0;
+	uint32_t flip_busy = 0;
+	long minflt = 0;
+	long majflt = 0;
+	uint64_t enqueue_commands_start = 0;
+	uint64_t enqueue_calls_start = 0;
+	uint64_t enqueue_ns_start = 0;
+	uint64_t enqueue_commands = 0;
+	uint64_t enqueue_calls = 0;
+	uint64_t enqueue_ns = 0;
+	RdpStatsCounters rdp_start;
+	RdpStatsCounters rdp;
+	uint64_t rdp_frames_start = 0;
+	uint64_t rdp_frames = 0;
+
+	// Per presented frame, microseconds
+	std::vector<uint32_t> gap_us;
+	std::vector<uint32_t> scanout_us;
+	std::vector<uint32_t> render_us;
+	std::vector<uint32_t> flip_us;
+	std::vector<uint32_t> total_us;
+
+	// Per perf window (~1 s)
+	BenchMean cpu_mhz;
+	BenchMean gpu_mhz;
+	BenchMean gpu_util;
+	BenchMean watts;
+	BenchMean mj_per_frame;
+};
+
+static BenchRun bench;
+
+// Must run before DRM init: the null backend never opens the display.
+static void init_bench()
+{
+	const char *env = getenv("G64_BENCH_FRAMES");
+	long frames = env ? strtol(env, nullptr, 10) : 0;
+	if (frames <= 0)
+		return;
+
+	bench.enabled = true;
+	bench.frames = uint32_t(frames);
+
+	const char *warmup = getenv("G64_BENCH_WARMUP");
+	if (warmup && warmup[0])
+		bench.warmup_frames = uint32_t(strtoul(warmup, nullptr, 10));
+
+	const char *present = getenv("G64_BENCH_PRESENT");
+	bench.null_present = present && strcmp(present, "null") == 0;
+
+	const char *state = getenv("G64_BENCH_STATE");
+	if (state && state[0] >= '0' && state[0] <= '9' && state[1] == '\0')
+		bench.state_slot = state[0] - '0';
+
+	const char *json = getenv("G64_BENCH_JSON");
+	snprintf(bench.json_path, sizeof(bench.json_path), "%s",
+	         json && json[0] ? json : "/tmp/gopher64-bench.json");
+
+	bench.gap_us.reserve(bench.frames);
+	bench.scanout_us.reserve(bench.frames);
+	bench.render_us.reserve(bench.frames);
+	bench.flip_us.reserve(bench.frames);
+	bench.total_us.reserve(bench.frames);
+
+	fprintf(stderr, "[bench] %u frames after %u warm-up, present=%s, state=%d, json=%s\n",
+	        bench.frames, bench.warmup_frames, bench.null_present ? "null" : "display",
+	        bench.state_slot, bench.json_path);
+	flight_recorder_event(flight_recorder, 0, "bench frames=%u warmup=%u", bench.frames, bench.warmup_frames);
+}
+
+static bool bench_active()
+{
+	return bench.started && !bench.finished;
+}
+
+static void bench_sample_counters(uint64_t &vblank_wait_us, uint32_t &flip_busy, long &minflt, long &majflt)
+{
+	struct rusage ru = {};
+	getrusage(RUSAGE_SELF, &ru);
+	vblank_wait_us = drm_display.vblank_wait_us;
+	flip_busy = drm_display.flip_busy_count;
+	minflt = ru.ru_minflt;
+	majflt = ru.ru_majflt;
+}
+
+static void bench_mark_start()
+{
+	bench.started = true;
+	bench.start_us = monotonic_us();
+	bench_sample_counters(bench.vblank_wait_start_us, bench.flip_busy_start,
+	                      bench.minflt_start, bench.majflt_start);
+	bench.enqueue_commands_start = command_batch.commands;
+	bench.enqueue_calls_start = command_batch.calls;
+	bench.enqueue_ns_start = command_batch.enqueue_ns;
+	bench.rdp_start = rdp_stats.total;
+	bench.rdp_frames_start = rdp_stats.total_frames;
+	perf_monitor_reset_window(monotonic_ms());
+	perf_monitor_window_user(PERF_WINDOW_BENCH, true);
+	flight_recorder_event(flight_recorder, runtime_tuning.frame_counter, "bench start");
+}
+
+static void bench_mark_end()
+{
+	bench.finished = true;
+	bench.end_us = monotonic_us();
+	uint64_t vblank_wait_us = 0;
+	uint32_t flip_busy = 0;
+	long minflt = 0;
+	long majflt = 0;
+	bench_sample_counters(vblank_wait_us, flip_busy, minflt, majflt);
+	bench.vblank_wait_us = vblank_wait_us - bench.vblank_wait_start_us;
+	bench.flip_busy = flip_busy - bench.flip_busy_start;
+	bench.minflt = minflt - bench.minflt_start;
+	bench.majflt = majflt - bench.majflt_start;
+	bench.enqueue_commands = command_batch.commands - bench.enqueue_commands_start;
+	bench.enqueue_calls = command_batch.calls - bench.enqueue_calls_start;
+	bench.enqueue_ns = command_batch.enqueue_ns - bench.enqueue_ns_start;
+	bench.rdp = rdp_stats.total;
+	for (unsigned op = 0; op < 64; op++)
+		bench.rdp.ops[op] -= bench.rdp_start.ops[op];
+	bench.rdp.bytes -= bench.rdp_start.bytes;
+	bench.rdp.fb_switches -= bench.rdp_start.fb_switches;
+	bench.rdp_frames = rdp_stats.total_frames - bench.rdp_frames_start;
+	perf_monitor_window_user(PERF_WINDOW_BENCH, false);
+}
+
+static void bench_frame(const char *path_tag, uint64_t frame_gap_us, uint64_t scanout_us,
+                        uint64_t render_us, uint64_t flip_us, uint64_t total_us)
+{
+	if (!bench.enabled || bench.finished)
+		return;
+
+	if (!bench.started)
+	{
+		if (bench.seen++ < bench.warmup_frames)
+			return;
+		bench_mark_start();
+	}
+
+	bench.path_tag = path_tag;
+	bench.gap_us.push_back(uint32_t(std::min<uint64_t>(frame_gap_us, UINT32_MAX)));
+	bench.scanout_us.push_back(uint32_t(std::min<uint64_t>(scanout_us, UINT32_MAX)));
+	bench.render_us.push_back(uint32_t(std::min<uint64_t>(render_us, UINT32_MAX)));
+	bench.flip_us.push_back(uint32_t(std::min<uint64_t>(flip_us, UINT32_MAX)));
+	bench.total_us.push_back(uint32_t(std::min<uint64_t>(total_us, UINT32_MAX)));
+	if (bench.total_us.size() >= bench.frames)
+		bench_mark_end();
+}
+
+static void bench_window(int cpu_mhz, int gpu_mhz, int gpu_util, const PowerSample &ps)
+{
+	if (!bench_active())
+		return;
+
+	auto add = [](BenchMean &m, double v) {
+		m.sum += v;
+		m.count++;
+	};
+	if (cpu_mhz >= 0)
+		add(bench.cpu_mhz, cpu_mhz);
+	if (gpu_mhz >= 0)
+		add(bench.gpu_mhz, gpu_mhz);
+	if (gpu_util >= 0)
+		add(bench.gpu_util, gpu_util);
+	if (ps.valid && !ps.charging)
+	{
+		add(bench.watts, ps.watts);
+		add(bench.mj_per_frame, ps.mj_per_frame);
+	}
+}
+
+static void bench_json_mean(FILE *f, const char *key, const BenchMean &m, const char *sep)
+{
+	if (m.count)
+		fprintf(f, "\"%s\": %.2f%s", key, m.sum / m.count, sep);
+	else
+		fprintf(f, "\"%s\": null%s", key, sep);
+}
+
+static void bench_json_stage(FILE *f, const char *key, std::vector<uint32_t> &v, const char *sep)
+{
+	if (v.empty())
+	{
+		fprintf(f, "    \"%s\": null%s\n", key, sep);
+		return;
+	}
+	std::sort(v.begin(), v.end());
+	uint64_t sum = 0;
+	for (uint32_t us : v)
+		sum += us;
+	auto pct = [&v](double p) {
+		return v[size_t(p * double(v.size() - 1) + 0.5)] / 1000.0;
+	};
+	fprintf(f, "    \"%s\": {\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}%s\n",
+	        key, double(sum) / (1000.0 * double(v.size())), pct(0.50), pct(0.90), pct(0.99),
+	        v.back() / 1000.0, sep);
+}
+
+// Writes the summary once; called when the run completes or, with
+// "complete": false, when the game is closed early.
+static void bench_write_report()
+{
+	if (!bench.enabled || bench.reported)
+		return;
+	bench.reported = true;
+	if (bench.started && !bench.finished)
+		bench_mark_end();
+
+	FILE *f = fopen(bench.json_path, "w");
+	if (!f)
+	{
+		fprintf(stderr, "[bench] Cannot write %s: %s\n", bench.json_path, strerror(errno));
+		return;
+	}
+
+	const size_t frames = bench.total_us.size();
+	const double wall_s = bench.started ? double(bench.end_us - bench.start_us) / 1e6 : 0.0;
+	const double fps = wall_s > 0.0 ? double(frames) / wall_s : 0.0;
+
+	MemorySnapshot m;
+	sample_memory(m);
+	update_memory_peaks(m);
+	uint64_t vk_bytes = 0;
+	for (uint32_t i = 0; i < m.heap_count; i++)
+		vk_bytes += m.heap_usage[i];
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"complete\": %s,\n", frames >= bench.frames ? "true" : "false");
+	fprintf(f, "  \"frames\": %zu,\n  \"frames_requested\": %u,\n  \"warmup_frames\": %u,\n",
+	        frames, bench.frames, bench.warmup_frames);
+	fprintf(f, "  \"config\": {\"present\": \"%s\", \"path\": \"%s\", \"upscale\": %u, \"frame_skip\": %u, "
+	           "\"pal\": %s, \"battery_saver\": %s, \"crt\": %d, \"dl_cache\": %s, \"frame_checksum\": %s, \"state_slot\": %d},\n",
+	        bench.null_present ? "null" : "display", bench.path_tag, gfx_info.upscale,
+	        runtime_tuning.frame_skip, gfx_info.PAL ? "true" : "false",
+	        battery_saver.enabled ? "true" : "false", crt_pass.program ? crt_pass.level : 0,
+	        dl_cache.enabled ? "true" : "false", frame_checksum.enabled ? "true" : "false",
+	        bench.state_slot);
+	fprintf(f, "  \"wall_s\": %.3f,\n  \"displayed_fps\": %.2f,\n", wall_s, fps);
+	fprintf(f, "  \"stages_ms\": {\n");
+	bench_json_stage(f, "gap", bench.gap_us, ",");
+	bench_json_stage(f, "scanout", bench.scanout_us, ",");
+	bench_json_stage(f, "render", bench.render_us, ",");
+	bench_json_stage(f, "flip", bench.flip_us, ",");
+	bench_json_stage(f, "total", bench.total_us, "");
+	fprintf(f, "  },\n");
+	fprintf(f, "  \"waits\": {\"vblank_wait_ms\": %.3f, \"vblank_wait_ms_per_frame\": %.3f, \"flip_busy\": %u},\n",
+	        bench.vblank_wait_us / 1000.0, frames ? bench.vblank_wait_us / (1000.0 * double(frames)) : 0.0,
+	        bench.flip_busy);
+	fprintf(f, "  \"memory\": {\"minor_faults\": %ld, \"major_faults\": %ld, \"minor_faults_per_frame\": %.1f, "
+	           "\"rss_mib\": %.1f, \"pss_mib\": %.1f, \"hwm_mib\": %.1f, \"peak_pss_mib\": %.1f, "
+	           "\"vk_mib\": %.1f, \"peak_vk_mib\": %.1f, \"drm_dumb_mib\": %.1f},\n",
+	        bench.minflt, bench.majflt, frames ? double(bench.minflt) / double(frames) : 0.0,
+	        kb_to_mib(m.rss_kb), kb_to_mib(m.pss_kb), kb_to_mib(m.hwm_kb),
+	        kb_to_mib(memory_telemetry.peak_pss_kb), bytes_to_mib(vk_bytes),
+	        bytes_to_mib(memory_telemetry.peak_vk_bytes), bytes_to_mib(m.drm_dumb_bytes));
+	fprintf(f, "  \"enqueue\": {\"mode\": \"%s\", \"commands\": %llu, \"calls\": %llu, \"commands_per_frame\": %.1f",
+	        command_batch.batched ? "batched" : "per-command", (unsigned long long)bench.enqueue_commands,
+	        (unsigned long long)bench.enqueue_calls,
+	        frames ? double(bench.enqueue_commands) / double(frames) : 0.0);
+	if (command_batch.timed && bench.enqueue_commands)
+		fprintf(f, ", \"ns_per_command\": %.1f", double(bench.enqueue_ns) / double(bench.enqueue_commands));
+	fprintf(f, "},\n");
+	if (rdp_stats.enabled && bench.rdp_frames)
+	{
+		const RdpStatsCounters &r = bench.rdp;
+		const double vi_frames = double(bench.rdp_frames);
+		fprintf(f, "  \"rdp_per_frame\": {\"triangles\": %.1f, \"shade_triangles\": %.1f, "
+		           "\"texture_triangles\": %.1f, \"zbuffer_triangles\": %.1f, \"rectangles\": %.1f, "
+		           "\"fill_rectangles\": %.1f, \"texture_loads\": %.1f, \"tlut_loads\": %.1f, "
+		           "\"fb_switches\": %.2f, \"sync_full\": %.2f, \"command_kb\": %.2f, \"vi_frames\": %llu},\n",
+		        double(rdp_stats_triangles(r, 0)) / vi_frames,
+		        double(rdp_stats_triangles(r, 4)) / vi_frames,
+		        double(rdp_stats_triangles(r, 2)) / vi_frames,
+		        double(rdp_stats_triangles(r, 1)) / vi_frames,
+		        double(rdp_stats_rects(r)) / vi_frames,
+		        double(r.ops[unsigned(RDP::Op::FillRectangle)]) / vi_frames,
+		        double(rdp_stats_loads(r)) / vi_frames,
+		        double(r.ops[unsigned(RDP::Op::LoadTLut)]) / vi_frames,
+		        double(r.fb_switches) / vi_frames,
+		        double(r.ops[unsigned(RDP::Op::SyncFull)]) / vi_frames,
+		        double(r.bytes) / (1024.0 * vi_frames),
+		        (unsigned long long)bench.rdp_frames);
+	}
+	fprintf(f, "  \"clocks\": {");
+	bench_json_mean(f, "cpu_mhz", bench.cpu_mhz, ", ");
+	bench_json_mean(f, "gpu_mhz", bench.gpu_mhz, ", ");
+	bench_json_mean(f, "gpu_util", bench.gpu_util, "");
+	fprintf(f, "},\n");
+	fprintf(f, "  \"power\": {");
+	bench_json_mean(f, "watts", bench.watts, ", ");
+	bench_json_mean(f, "mj_per_frame", bench.mj_per_frame, "");
+	fprintf(f, "}\n}\n");
+	fclose(f);
+
+	fprintf(stderr, "[bench] %zu frames in %.2fs (%.2f FPS, path=%s) -> %s\n",
+	        frames, wall_s, fps, bench.path_tag, bench.json_path);
+	flight_recorder_event(flight_recorder, runtime_tuning.frame_counter, "bench done frames=%zu fps=%.1f",
+	                      frames, fps);
+}
+
+#define MESSAGE_TIME 3000 // 3 seconds
+
+static const unsigned cmd_len_lut[64] = {
+	1, 1, 1, 1, 1, 1, 1, 1,
+	4, 6, 12, 14, 12, 14, 20, 22,
+	1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 2, 2, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1,
+};
+
+bool sdl_event_filter(void *userdata, SDL_Event *event)
+{
+	if (event->type == SDL_EVENT_WINDOW_CLOSE_REQUESTED)
+	{
+		callback.paused = false;
+		callback.emu_running = false;
+	}
+	else if (event->type == SDL_EVENT_KEY_DOWN && !event->key.repeat)
+	{
+		switch (event->key.scancode)
+		{
+		case SDL_SCANCODE_RETURN:
+			if ((event->key.mod & SDL_KMOD_ALT) && window)
+			{
+				gfx_info.fullscreen = !gfx_info.fullscreen;
+				SDL_SetWindowFullscreen(window, gfx_info.fullscreen);
+			}
+			break;
+		case SDL_SCANCODE_F:
+			if (event->key.mod & SDL_KMOD_ALT)
+			{
+				callback.enable_speedlimiter = !callback.enable_speedlimiter;
+			}
+			break;
+		case SDL_SCANCODE_P:
+			if (event->key.mod & SDL_KMOD_ALT)
+			{
+				callback.paused = !callback.paused;
+			}
+			break;
+		case SDL_SCANCODE_ESCAPE:
+			if (gfx_info.fullscreen)
+				callback.emu_running = false;
+			break;
+		case SDL_SCANCODE_F4:
+			crop_letterbox = !crop_letterbox;
+			break;
+		case SDL_SCANCODE_F5:
+			callback.save_state = true;
+			break;
+		case SDL_SCANCODE_F7:
+			callback.load_state = true;
+			break;
+		case SDL_SCANCODE_LEFTBRACKET:
+			callback.lower_volume = true;
+			break;
+		case SDL_SCANCODE_RIGHTBRACKET:
+			callback.raise_volume = true;
 			break;
 		case SDL_SCANCODE_SLASH:
 			callback.frame_advance = true;
@@ -704,7 +2740,258 @@ bool sdl_event_filter(void *userdata, SDL_Event *event)
 		}
 	}
 
-	return 0;
+	return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Flight recorder
+// ---------------------------------------------------------------------------
+
+static void init_flight_recorder()
+{
+	const char *path = nullptr;
+	if (!env_path_or_default("G64_FLIGHT_RECORDER", &path))
+		return;
+
+	uint32_t seconds = 0;
+	const char *seconds_env = getenv("G64_FLIGHT_RECORDER_SECONDS");
+	if (seconds_env)
+		seconds = uint32_t(strtoul(seconds_env, nullptr, 10));
+
+	if (!flight_recorder_init(flight_recorder, path, seconds))
+		return;
+	flight_recorder_event(flight_recorder, 0, "init upscale=%u", gfx_info.upscale);
+	perf_monitor_window_user(PERF_WINDOW_FLIGHT_RECORDER, true);
+}
+
+// G64_STALL_WATCHDOG=1 uses STALL_WATCHDOG_DEFAULT_MS, other numbers are
+// the threshold in milliseconds. Needs the flight recorder.
+static void init_stall_watchdog()
+{
+	const char *env = getenv("G64_STALL_WATCHDOG");
+	if (!env || !env[0])
+		return;
+	uint32_t threshold_ms = uint32_t(strtoul(env, nullptr, 10));
+	if (threshold_ms <= 1)
+	{
+		if (!env_enabled("G64_STALL_WATCHDOG"))
+			return;
+		threshold_ms = STALL_WATCHDOG_DEFAULT_MS;
+	}
+	stall_watchdog_init(stall_watchdog, flight_recorder, threshold_ms);
+}
+
+// Worker threads report here as they start and exit: parallel-rdp's
+// command ring and timeline workers (declared there by apply_patches.sh)
+// and the soft_rdp band workers.
+void rdp_thread_started(const char *name)
+{
+	stall_watchdog_register_thread(stall_watchdog, name);
+}
+
+void rdp_thread_stopped()
+{
+	stall_watchdog_unregister_thread(stall_watchdog);
+}
+
+static void init_coherence_profile()
+{
+	const char *path = nullptr;
+	if (!env_path_or_default("G64_COHERENCE_PROFILE", &path))
+		return;
+
+	coherence_profile_init(coherence_profile, path);
+	perf_monitor_window_user(PERF_WINDOW_COHERENCE, coherence_profile.enabled);
+}
+
+// ---------------------------------------------------------------------------
+// Runtime control socket
+// ---------------------------------------------------------------------------
+
+static void init_runtime_control()
+{
+	const char *path = nullptr;
+	if (!env_path_or_default("G64_CONTROL_SOCKET", &path))
+		return;
+
+	runtime_tuning.control_enabled = perf_control_init(perf_control, path);
+}
+
+static void set_upscale(uint32_t upscale)
+{
+	if (soft_rdp.enabled)
+	{
+		fprintf(stderr, "[soft_rdp] Upscaling not supported, ignoring upscale=%u\n", upscale);
+		return;
+	}
+
+	// The processor bakes the upscale factor in at construction, so swap it
+	// out. All queued RDP work is drained first; VI state is replayed from
+	// the shadow at the next latch because the core only rewrites VI
+	// registers on change.
+	processor->wait_for_timeline(processor->signal_timeline());
+	wsi->get_device().wait_idle();
+
+	gfx_info.upscale = upscale;
+	rdp_new_processor(gfx_info);
+}
+
+static bool set_thread_placement(bool big_cores)
+{
+	cpu_set_t set;
+	if (big_cores)
+	{
+		build_big_core_set(set);
+	}
+	else
+	{
+		CPU_ZERO(&set);
+		long cpus = sysconf(_SC_NPROCESSORS_CONF);
+		for (long cpu = 0; cpu < cpus && cpu < CPU_SETSIZE; cpu++)
+			CPU_SET(cpu, &set);
+	}
+
+	int moved = set_affinity_all_threads(set);
+	if (moved <= 0)
+		return false;
+
+	runtime_tuning.pin_big_cores = big_cores;
+	fprintf(stderr, "[interface] Moved %d threads to %s\n", moved,
+	        big_cores ? "performance cores (CPU4-CPU7)" : "all cores");
+	return true;
+}
+
+static void report_runtime_state(int client)
+{
+	perf_control_reply(perf_control, client,
+	                   "state present=%s frameskip=%u pacing=%s limiter=%s pin=%s upscale=%u telemetry=%d crt=%d",
+	                   runtime_tuning.force_cpu_present ? "cpu" : "gpu",
+	                   runtime_tuning.frame_skip,
+	                   drm_display.debug_no_vblank_sync ? "novsync" : frame_pacing_names[drm_display.pacing.policy],
+	                   callback.enable_speedlimiter ? "on" : "off",
+	                   runtime_tuning.pin_big_cores ? "big" : "all",
+	                   gfx_info.upscale,
+	                   perf_monitor.log_level,
+	                   crt_pass.level);
+}
+
+static bool apply_control_setting(const char *key, const char *value)
+{
+	if (strcmp(key, "present") == 0)
+	{
+		if (strcmp(value, "gpu") != 0 && strcmp(value, "cpu") != 0)
+			return false;
+		runtime_tuning.force_cpu_present = strcmp(value, "cpu") == 0;
+		return true;
+	}
+	if (strcmp(key, "frameskip") == 0)
+	{
+		char *end = nullptr;
+		long n = strtol(value, &end, 10);
+		if (end == value || *end != '\0' || n < 0 || n > 4)
+			return false;
+		runtime_tuning.frame_skip = uint32_t(n);
+		runtime_tuning.frame_counter = 0;
+		return true;
+	}
+	if (strcmp(key, "pacing") == 0)
+	{
+		if (strcmp(value, "novsync") == 0)
+		{
+			drm_display.debug_no_vblank_sync = true;
+			return true;
+		}
+		FramePacingPolicy policy = FRAME_PACING_VSYNC;
+		if (!frame_pacing_parse(value, policy))
+			return false;
+		drm_display.debug_no_vblank_sync = false;
+		drm_display.pacing.policy = policy;
+		callback.enable_speedlimiter = frame_pacing_core_limiter(drm_display.pacing);
+		return true;
+	}
+	if (strcmp(key, "limiter") == 0)
+	{
+		if (strcmp(value, "on") != 0 && strcmp(value, "off") != 0)
+			return false;
+		callback.enable_speedlimiter = strcmp(value, "on") == 0;
+		return true;
+	}
+	if (strcmp(key, "pin") == 0)
+	{
+		if (strcmp(value, "big") != 0 && strcmp(value, "all") != 0)
+			return false;
+		return set_thread_placement(strcmp(value, "big") == 0);
+	}
+	if (strcmp(key, "upscale") == 0)
+	{
+		char *end = nullptr;
+		long n = strtol(value, &end, 10);
+		if (end == value || *end != '\0' || (n != 1 && n != 2 && n != 4 && n != 8))
+			return false;
+		if (uint32_t(n) != gfx_info.upscale)
+			set_upscale(uint32_t(n));
+		return true;
+	}
+	if (strcmp(key, "telemetry") == 0)
+	{
+		if (value[0] < '0' || value[0] > '2' || value[1] != '\0')
+			return false;
+		perf_monitor.log_level = value[0] - '0';
+		perf_monitor_window_user(PERF_WINDOW_LOG, perf_monitor.log_level > 0);
+		return true;
+	}
+	if (strcmp(key, "crt") == 0)
+	{
+		if (value[0] < '0' || value[0] > '3' || value[1] != '\0')
+			return false;
+		if (value[0] != '0' && ((!crt_pass.storage_display && gpu_display_ready) || battery_saver.enabled))
+			return false;
+		crt_pass.level = value[0] - '0';
+		return true;
+	}
+	return false;
+}
+
+// Called at the frame boundary, before any scanout work for the new frame.
+static void poll_runtime_control()
+{
+	if (!runtime_tuning.control_enabled)
+		return;
+
+	PerfControlCommand cmd;
+	while (perf_control_poll(perf_control, cmd))
+	{
+		if (strcmp(cmd.verb, "get") == 0)
+		{
+			report_runtime_state(cmd.client);
+			continue;
+		}
+
+		if (strcmp(cmd.verb, "set") != 0 || !cmd.key[0] || !cmd.value[0])
+		{
+			perf_control_reply(perf_control, cmd.client,
+			                   "error usage: get | set <present|frameskip|pacing|limiter|pin|upscale|telemetry|crt> <value>");
+			continue;
+		}
+
+		if (!apply_control_setting(cmd.key, cmd.value))
+		{
+			perf_control_reply(perf_control, cmd.client, "error %s=%s rejected", cmd.key, cmd.value);
+			continue;
+		}
+
+		fprintf(stderr, "[perf_control] Applied %s=%s\n", cmd.key, cmd.value);
+		flight_recorder_event(flight_recorder, runtime_tuning.frame_counter, "set %s=%s", cmd.key, cmd.value);
+		perf_control_reply(perf_control, cmd.client, "ok %s=%s", cmd.key, cmd.value);
+		perf_control_defer_until_baseline(perf_control, cmd.client);
+
+		// Start a fresh window so the acknowledged baseline only covers
+		// frames produced with the new setting.
+		perf_monitor_reset_window(monotonic_ms());
+	}
+	// Each applied set waits for a baseline; a client that closed while
+	// waiting no longer does.
+	perf_monitor_window_user(PERF_WINDOW_BASELINE, perf_control_baseline_pending(perf_control));
 }
 
 void rdp_new_processor(GFX_INFO _gfx_info)
@@ -713,11 +3000,20 @@ void rdp_new_processor(GFX_INFO _gfx_info)
 
 	sync_signal = 0;
 	rdram_dirty.assign(gfx_info.RDRAM_SIZE >> 3, false);
+	async_writeback_reset();
+	vi_shadow.push_all = true;
 
+	if (soft_rdp.enabled)
+	{
+		soft_rdp_flush(soft_rdp);
+		return;
+	}
 	if (processor)
 	{
+		dl_cache_drain();
 		delete processor;
 	}
+	display_list_cache_forget_signals(dl_cache);
 	RDP::CommandProcessorFlags flags = 0;
 
 	if (gfx_info.upscale == 2)
@@ -739,42 +3035,27 @@ void rdp_new_processor(GFX_INFO _gfx_info)
 	processor = new RDP::CommandProcessor(wsi->get_device(), gfx_info.RDRAM, 0, gfx_info.RDRAM_SIZE, gfx_info.RDRAM_SIZE / 2, flags);
 }
 
-void rdp_init(void *_window, GFX_INFO _gfx_info, const void *font, size_t font_size)
+// Vulkan for compute only (no WSI surface/swapchain) and the processor.
+// Returns nullptr on success, else what failed.
+static const char *init_vulkan_processor(bool sdl_no_video, const char *&vulkan_loader,
+                                         uint64_t &processor_start_us)
 {
-	memset(&rdp_device, 0, sizeof(RDP_DEVICE));
-
-	window = (SDL_Window *)_window;
-	SDL_SyncWindow(window);
-	bool result = SDL_AddEventWatch(sdl_event_filter, nullptr);
-	if (!result)
-	{
-		printf("Could not add event watch.\n");
-		return;
-	}
-
-	gfx_info = _gfx_info;
-	maybe_pin_to_big_cores();
-
-	// Initialize DRM display for scanout
-	if (!drm_display_init(drm_display))
-	{
-		printf("[interface] Failed to initialize DRM display\n");
-		rdp_close();
-		return;
-	}
-
-	// Initialize Vulkan for compute only (no WSI surface/swapchain)
 	wsi = new WSI;
 	wsi_platform = new SDL_WSIPlatform;
 	wsi_platform->set_window(window);
 	wsi->set_platform(wsi_platform);
 
 	Context::SystemHandles handles = {};
-	if (!::Vulkan::Context::init_loader((PFN_vkGetInstanceProcAddr)SDL_Vulkan_GetVkGetInstanceProcAddr()))
+	// SDL only has a loader when its video driver loaded Vulkan. Otherwise
+	// pass null and Granite dlopen()s libvulkan.so.1 (GRANITE_VULKAN_LIBRARY).
+	PFN_vkGetInstanceProcAddr get_instance_proc_addr = nullptr;
+	if (!sdl_no_video)
+		get_instance_proc_addr = (PFN_vkGetInstanceProcAddr)SDL_Vulkan_GetVkGetInstanceProcAddr();
+	vulkan_loader = get_instance_proc_addr ? "sdl" : "direct";
+	if (!::Vulkan::Context::init_loader(get_instance_proc_addr))
 	{
 		printf("[interface] Failed to init Vulkan loader\n");
-		rdp_close();
-		return;
+		return "vulkan loader";
 	}
 
 	// Use init_context_from_platform + init_device instead of init_simple.
@@ -783,21 +3064,106 @@ void rdp_init(void *_window, GFX_INFO _gfx_info, const void *font, size_t font_s
 	if (!wsi->init_context_from_platform(1, handles))
 	{
 		printf("[interface] Failed to create Vulkan context\n");
-		rdp_close();
-		return;
+		return "vulkan context";
 	}
 	if (!wsi->init_device())
 	{
 		printf("[interface] Failed to create Vulkan device\n");
-		rdp_close();
-		return;
+		return "vulkan device";
 	}
 
+	flight_recorder_event(flight_recorder, 0, "vulkan device ready");
+	processor_start_us = monotonic_us();
 	rdp_new_processor(gfx_info);
 
 	if (!processor->device_is_supported())
 	{
 		printf("[interface] GPU device not supported by parallel-rdp\n");
+		return "device not supported";
+	}
+	return nullptr;
+}
+
+// Drop whatever Vulkan state exists and render on the CPU instead.
+static bool start_soft_rdp(const char *reason)
+{
+	if (processor)
+	{
+		delete processor;
+		processor = nullptr;
+	}
+	if (wsi)
+	{
+		delete wsi;
+		wsi = nullptr;
+	}
+	if (wsi_platform)
+	{
+		delete wsi_platform;
+		wsi_platform = nullptr;
+	}
+
+	const char *threads_env = getenv("G64_SOFT_RDP_THREADS");
+	const unsigned threads = threads_env ? unsigned(atoi(threads_env)) : 0;
+	soft_rdp.thread_started = rdp_thread_started;
+	soft_rdp.thread_stopped = rdp_thread_stopped;
+	if (!soft_rdp_init(soft_rdp, gfx_info.RDRAM, gfx_info.RDRAM_SIZE, threads))
+		return false;
+	fprintf(stderr, "[soft_rdp] Rendering on the CPU (%s)\n", reason);
+	flight_recorder_event(flight_recorder, 0, "soft rdp (%s)", reason);
+	rdp_new_processor(gfx_info);
+	return true;
+}
+
+void rdp_init(void *_window, GFX_INFO _gfx_info, const void *font, size_t font_size)
+{
+	memset(&rdp_device, 0, sizeof(RDP_DEVICE));
+	vi_shadow = ViShadow();
+	crtc_offload = CrtcOffload();
+
+	uint64_t init_start_us = monotonic_us();
+	double core_startup_ms = process_age_ms();
+
+	// The window is never presented to (output goes through DRM), so with
+	// G64_SDL_NO_VIDEO the interface does not touch SDL video at all.
+	bool sdl_no_video = env_enabled("G64_SDL_NO_VIDEO");
+	window = sdl_no_video ? nullptr : (SDL_Window *)_window;
+	if (window)
+		SDL_SyncWindow(window);
+	bool result = SDL_AddEventWatch(sdl_event_filter, nullptr);
+	if (!result)
+	{
+		printf("Could not add event watch.\n");
+		return;
+	}
+
+	gfx_info = _gfx_info;
+	maybe_pin_to_big_cores();
+	init_flight_recorder();
+	init_stall_watchdog();
+	log_allocator();
+	init_power();
+	init_bench();
+	init_crt();
+
+	// Initialize DRM display for scanout
+	uint64_t drm_start_us = monotonic_us();
+	if (!bench.null_present && !drm_display_init(drm_display))
+	{
+		printf("[interface] Failed to initialize DRM display\n");
+		rdp_close();
+		return;
+	}
+	if (!bench.null_present)
+		init_crtc_offload();
+	uint64_t vulkan_start_us = monotonic_us();
+	uint64_t processor_start_us = vulkan_start_us;
+	const char *vulkan_loader = "none";
+	const char *vulkan_failure = env_enabled("G64_SOFT_RDP")
+	                                 ? "G64_SOFT_RDP=1"
+	                                 : init_vulkan_processor(sdl_no_video, vulkan_loader, processor_start_us);
+	if (vulkan_failure && !start_soft_rdp(vulkan_failure))
+	{
 		rdp_close();
 		return;
 	}
@@ -811,35 +3177,111 @@ void rdp_init(void *_window, GFX_INFO _gfx_info, const void *font, size_t font_s
 	}
 
 	// No wsi->begin_frame() — we manage frame context directly
-	auto &device = wsi->get_device();
-	device.next_frame_context();
+	if (wsi)
+		wsi->get_device().next_frame_context();
 
 	callback.emu_running = true;
 	const char *disable_speed_limiter_env = getenv("G64_DISABLE_SPEED_LIMITER");
 	callback.enable_speedlimiter = !(disable_speed_limiter_env && disable_speed_limiter_env[0] == '1');
 	if (!callback.enable_speedlimiter)
 		fprintf(stderr, "[interface] Speed limiter disabled via G64_DISABLE_SPEED_LIMITER=1\n");
+	init_frame_pacing();
 	callback.paused = false;
 	callback.save_state_slot = 0;
 	crop_letterbox = false;
+	if (bench.enabled)
+	{
+		callback.enable_speedlimiter = false;
+		if (bench.state_slot >= 0)
+		{
+			callback.save_state_slot = bench.state_slot;
+			callback.load_state = true;
+		}
+	}
+
+	init_runtime_control();
+	init_command_batch();
+	init_rdp_stats();
+	init_vi_lite_present();
+	init_display_list_cache();
+	init_frame_checksum();
+	init_coherence_profile();
+	init_fb_sync();
+	uint64_t init_end_us = monotonic_us();
+	fprintf(stderr, "[interface] Startup ms: core=%.1f pre_drm=%.1f drm=%.1f vulkan=%.1f processor=%.1f rdp_init=%.1f "
+	                "(sdl_video=%s vulkan_loader=%s drm_master=%d)\n",
+	        core_startup_ms,
+	        double(drm_start_us - init_start_us) / 1000.0,
+	        double(vulkan_start_us - drm_start_us) / 1000.0,
+	        double(processor_start_us - vulkan_start_us) / 1000.0,
+	        double(init_end_us - processor_start_us) / 1000.0,
+	        double(init_end_us - init_start_us) / 1000.0,
+	        sdl_no_video ? "off" : (SDL_GetCurrentVideoDriver() ? SDL_GetCurrentVideoDriver() : "none"),
+	        vulkan_loader, drm_display.is_master ? 1 : 0);
+	flight_recorder_event(flight_recorder, 0, "startup core=%.0fms rdp_init=%.0fms",
+	                      core_startup_ms, double(init_end_us - init_start_us) / 1000.0);
+	flight_recorder_event(flight_recorder, 0, "init complete");
+	memory_telemetry_report("init");
 
 	messages = std::queue<std::string>();
 	message_timer = 0;
 
-	fprintf(stderr, "[interface] Init complete: Vulkan compute + DRM scanout\n");
+	fprintf(stderr, "[interface] Init complete: %s + DRM scanout\n",
+	        soft_rdp.enabled ? "software RDP" : "Vulkan compute");
 }
 
 void rdp_close()
 {
+	stall_watchdog_report(stall_watchdog);
+	stall_watchdog_cleanup(stall_watchdog);
+	stall_watchdog_emu_registered = false;
+
 	if (wsi)
 	{
 		auto &device = wsi->get_device();
 		device.wait_idle();
 	}
 
+	perf_control_cleanup(perf_control);
+	runtime_tuning.control_enabled = false;
+
+	flight_recorder_event(flight_recorder, runtime_tuning.frame_counter, "close");
+	if (wsi || soft_rdp.enabled)
+	{
+		bench_write_report();
+		memory_telemetry_report("close");
+	}
+
+	crt_pass_report();
+	crt_pass.program = nullptr;
+	if (vi_shadow.writes)
+		fprintf(stderr, "[vi] register writes=%llu pushed=%llu\n",
+		        (unsigned long long)vi_shadow.writes, (unsigned long long)vi_shadow.pushes);
+	if (vi_lite_present.enabled)
+		fprintf(stderr, "[vi_lite] frames=%llu waits=%llu wait_ms=%.1f fallbacks=%llu\n",
+		        (unsigned long long)vi_lite_present.frames, (unsigned long long)vi_lite_present.waits,
+		        double(vi_lite_present.wait_us) / 1000.0, (unsigned long long)vi_lite_present.fallbacks);
+	vi_lite_present = ViLitePresent();
+	if (drm_display.pacing_drops)
+		fprintf(stderr, "[drm_display] pacing=%s drops=%u\n",
+		        frame_pacing_names[drm_display.pacing.policy], drm_display.pacing_drops);
+	command_batch_report();
+	display_list_cache_report(dl_cache, "close");
+	display_list_cache_clear(dl_cache);
+	display_list_cache_forget_signals(dl_cache);
+	frame_checksum_cleanup();
+	coherence_profile_dump(coherence_profile);
+	perf_monitor_window_user(PERF_WINDOW_COHERENCE, false);
+	fb_sync_report();
+	soft_rdp_report(soft_rdp);
+	soft_rdp_cleanup(soft_rdp);
 	cleanup_gpu_display();
 	drm_display_cleanup(drm_display);
 
+	power_monitor_report(power_monitor);
+	battery_saver_cleanup(battery_saver);
+	perf_monitor_window_user(PERF_WINDOW_BATTERY_SAVER, false);
+
 	if (message_font)
 	{
 		TTF_CloseFont(message_font);
@@ -860,10 +3302,126 @@ void rdp_close()
 		delete wsi_platform;
 		wsi_platform = nullptr;
 	}
+
+	flight_recorder_cleanup(flight_recorder);
+	perf_monitor_window_user(PERF_WINDOW_FLIGHT_RECORDER, false);
+
+	// Instrumented builds normally write their profile at exit; write it
+	// here too so a session that is killed after the game closes still
+	// contributes a profile.
+	if (__llvm_profile_write_file)
+		__llvm_profile_write_file();
+}
+
+// VI-lite present for the CPU fallback. Only the frame's own RDRAM range is
+// checked against the dirty map: if pending RDP work may write it, the
+// timeline is flushed and waited on, as rdp_check_framebuffers() does for a
+// CPU read. Returns false when the frame needs the full VI.
+static bool render_vi_lite_frame(uint64_t frame_start_us, uint64_t frame_gap_us)
+{
+	ViLiteFrame f;
+	if (!vi_lite_frame(vi_shadow_lite_regs(), f) || f.origin >= gfx_info.RDRAM_SIZE ||
+	    f.bytes() > gfx_info.RDRAM_SIZE - f.origin)
+		return false;
+
+	const uint32_t begin = f.origin >> 3;
+	const uint32_t end = std::min((f.origin + f.bytes() + 7) >> 3, static_cast<uint32_t>(rdram_dirty.size()));
+	if (begin < end && std::find(rdram_dirty.begin() + begin, rdram_dirty.begin() + end, true) != rdram_dirty.begin() + end)
+	{
+		const uint64_t wait_start_us = monotonic_us();
+		processor->wait_for_timeline(processor->signal_timeline());
+		rdram_dirty.assign(gfx_info.RDRAM_SIZE >> 3, false);
+		sync_signal = 0;
+		async_writeback_reset();
+		vi_lite_present.waits++;
+		vi_lite_present.wait_us += monotonic_us() - wait_start_us;
+	}
+	const uint64_t scanout_done_us = monotonic_us();
+
+	static bool logged_first_frame = false;
+	if (!logged_first_frame)
+	{
+		fprintf(stderr, "[vi_lite] First scanout: %ux%u %ubpp origin=0x%06x line=%u\n",
+		        f.width, f.height, f.pixel_bytes * 8, f.origin, f.line);
+		flight_recorder_event(flight_recorder, runtime_tuning.frame_counter, "first scanout vi-lite %ux%u",
+		                      f.width, f.height);
+		logged_first_frame = true;
+	}
+
+	stall_watchdog_stage(stall_watchdog, FLIGHT_STAGE_PRESENT);
+	if (!drm_display_present_rdram(drm_display, gfx_info.RDRAM, gfx_info.RDRAM_SIZE, f))
+		return false;
+	vi_lite_present.frames++;
+	const uint64_t present_done_us = monotonic_us();
+	perf_monitor_frame("vi-lite",
+	                   frame_gap_us,
+	                   scanout_done_us - frame_start_us,
+	                   present_done_us - scanout_done_us,
+	                   0,
+	                   present_done_us - frame_start_us);
+	return true;
+}
+
+// Software RDP: VI-lite scanout of RDRAM -> DRM dumb buffer. Everything up
+// to the last SyncFull is already in RDRAM; draws queued since are flushed
+// first so the frame is not older than the GPU path's would be.
+static void render_soft_frame()
+{
+	vi_shadow_latch();
+	crtc_offload_frame();
+	soft_rdp_flush(soft_rdp);
+
+	const uint64_t frame_start_us = monotonic_us();
+	static uint64_t prev_frame_start_us = 0;
+	uint64_t frame_gap_us = 0;
+	if (prev_frame_start_us != 0 && frame_start_us > prev_frame_start_us)
+		frame_gap_us = frame_start_us - prev_frame_start_us;
+	prev_frame_start_us = frame_start_us;
+
+	const ViLiteRegs vi = vi_shadow_lite_regs();
+	unsigned width = 0, height = 0;
+	if (!soft_rdp_scanout(soft_rdp, vi, width, height))
+		return;
+	const uint64_t scanout_done_us = monotonic_us();
+
+	static bool logged_first_frame = false;
+	if (!logged_first_frame)
+	{
+		fprintf(stderr, "[soft_rdp] First scanout: %ux%u (VI-lite)\n", width, height);
+		flight_recorder_event(flight_recorder, runtime_tuning.frame_counter, "first scanout soft %ux%u",
+		                      width, height);
+		logged_first_frame = true;
+	}
+
+	const uint8_t *pixels = reinterpret_cast<const uint8_t *>(soft_rdp.scanout.data());
+	const uint32_t stride = width * sizeof(uint32_t);
+	if (frame_checksum.enabled)
+		frame_checksum_log(pixels, width, height, stride, "soft");
+
+	if (bench.null_present)
+	{
+		perf_monitor_frame("soft-null", frame_gap_us, scanout_done_us - frame_start_us, 0, 0,
+		                   scanout_done_us - frame_start_us);
+		return;
+	}
+	stall_watchdog_stage(stall_watchdog, FLIGHT_STAGE_PRESENT);
+	if (drm_display_present(drm_display, pixels, width, height, stride))
+	{
+		const uint64_t present_done_us = monotonic_us();
+		perf_monitor_frame("soft",
+		                   frame_gap_us,
+		                   scanout_done_us - frame_start_us,
+		                   present_done_us - scanout_done_us,
+		                   0,
+		                   present_done_us - frame_start_us);
+	}
 }
 
 static void render_frame(Vulkan::Device &device)
 {
+	vi_shadow_latch();
+	crtc_offload_frame();
+
 	RDP::ScanoutOptions options = {};
 	const uint64_t frame_start_us = monotonic_us();
 	static uint64_t prev_frame_start_us = 0;
@@ -874,6 +3432,15 @@ static void render_frame(Vulkan::Device &device)
 	options.persist_frame_on_invalid_input = true;
 	options.blend_previous_frame = true;
 	options.upscale_deinterlacing = false;
+	if (battery_saver.enabled)
+	{
+		// Optional post passes: cheap individually, but they run every
+		// presented frame and none of them is needed for a playable image.
+		options.blend_previous_frame = false;
+		options.vi.dither_filter = false;
+		options.vi.divot_filter = false;
+		options.vi.gamma_dither = false;
+	}
 
 	if (crop_letterbox && gfx_info.widescreen)
 	{
@@ -890,10 +3457,39 @@ static void render_frame(Vulkan::Device &device)
 		}
 	}
 
+	// ---------------------------------------------------------------
+	// Benchmark null backend: scanout only, waited on, never displayed
+	// ---------------------------------------------------------------
+	if (bench.null_present)
+	{
+		auto scanout_image = processor->scanout(options);
+		const uint64_t scanout_done_us = monotonic_us();
+		if (!scanout_image)
+			return;
+
+		// Wait for the scanout work so "render" holds its GPU time, as the
+		// blit does on the display path.
+		auto cmd = device.request_command_buffer();
+		if (frame_checksum.enabled)
+			frame_checksum_record(device, *cmd, *scanout_image);
+		Vulkan::Fence fence;
+		device.submit(cmd, &fence);
+		fence->wait();
+		const uint64_t gpu_done_us = monotonic_us();
+		frame_checksum_finish(device, "null");
+		perf_monitor_frame("null",
+		                   frame_gap_us,
+		                   scanout_done_us - frame_start_us,
+		                   gpu_done_us - scanout_done_us,
+		                   0,
+		                   gpu_done_us - frame_start_us);
+		return;
+	}
+
 	// ---------------------------------------------------------------
 	// Zero-copy GPU path: scanout → GPU blit → DMA-buf → DRM flip
 	// ---------------------------------------------------------------
-	if (init_gpu_display(device))
+	if (!runtime_tuning.force_cpu_present && init_gpu_display(device))
 	{
 		auto scanout_image = processor->scanout(options);
 		const uint64_t scanout_done_us = monotonic_us();
@@ -906,47 +3502,76 @@ static void render_frame(Vulkan::Device &device)
 			fprintf(stderr, "[gpu_display] First scanout: %ux%u -> %ux%u (GPU blit)\n",
 			        scanout_image->get_width(), scanout_image->get_height(),
 			        drm_display.display_width, drm_display.display_height);
+			flight_recorder_event(flight_recorder, runtime_tuning.frame_counter, "first scanout gpu %ux%u",
+			                      scanout_image->get_width(), scanout_image->get_height());
 			logged_gpu_first = true;
 		}
 
 		auto &dst_buf = gpu_display_bufs[gpu_display_idx];
 		auto cmd = device.request_command_buffer();
 
-		// Transition display image to TRANSFER_DST
-		cmd->image_barrier(*dst_buf.image,
-		                   VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		                   VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, 0,
-		                   VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
-
-		// GPU blit: scale + copy (same format, no swizzle needed)
-		VkOffset3D src_offset0 = { 0, 0, 0 };
-		VkOffset3D src_extent = {
-			static_cast<int32_t>(scanout_image->get_width()),
-			static_cast<int32_t>(scanout_image->get_height()), 1
-		};
-		VkOffset3D dst_offset0 = { 0, 0, 0 };
-		VkOffset3D dst_extent = {
-			static_cast<int32_t>(drm_display.display_width),
-			static_cast<int32_t>(drm_display.display_height), 1
-		};
-
-		cmd->blit_image(*dst_buf.image, *scanout_image,
-		                dst_offset0, dst_extent,
-		                src_offset0, src_extent,
-		                0, 0, 0, 0, 1,
-		                VK_FILTER_NEAREST);
+		if (crt_pass.level > 0 && crt_pass_ready(device))
+		{
+			// The scanout was made visible to fragment shading; extend that to compute.
+			cmd->image_barrier(*scanout_image,
+			                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			                   VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, 0,
+			                   VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+			cmd->image_barrier(*dst_buf.image,
+			                   VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+			                   VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, 0,
+			                   VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+			crt_pass_record(*cmd, *scanout_image, *dst_buf.image,
+			                drm_display.display_width, drm_display.display_height, gfx_info.upscale);
+			cmd->image_barrier(*dst_buf.image,
+			                   VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+			                   VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			                   VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, 0);
+		}
+		else
+		{
+			// Transition display image to TRANSFER_DST
+			cmd->image_barrier(*dst_buf.image,
+			                   VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			                   VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, 0,
+			                   VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+			// GPU blit: scale + copy (same format, no swizzle needed)
+			VkOffset3D src_offset0 = { 0, 0, 0 };
+			VkOffset3D src_extent = {
+				static_cast<int32_t>(scanout_image->get_width()),
+				static_cast<int32_t>(scanout_image->get_height()), 1
+			};
+			VkOffset3D dst_offset0 = { 0, 0, 0 };
+			VkOffset3D dst_extent = {
+				static_cast<int32_t>(drm_display.display_width),
+				static_cast<int32_t>(drm_display.display_height), 1
+			};
+
+			cmd->blit_image(*dst_buf.image, *scanout_image,
+			                dst_offset0, dst_extent,
+			                src_offset0, src_extent,
+			                0, 0, 0, 0, 1,
+			                VK_FILTER_NEAREST);
+
+			// Barrier: make writes visible to external (DRM) consumer
+			cmd->image_barrier(*dst_buf.image,
+			                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+			                   VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			                   VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, 0);
+		}
 
-		// Barrier: make writes visible to external (DRM) consumer
-		cmd->image_barrier(*dst_buf.image,
-		                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
-		                   VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
-		                   VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, 0);
+		if (frame_checksum.enabled)
+			frame_checksum_record(device, *cmd, *scanout_image);
 
 		Vulkan::Fence fence;
 		device.submit(cmd, &fence);
 		fence->wait();
 		const uint64_t gpu_done_us = monotonic_us();
+		crt_pass_frame(gpu_done_us - scanout_done_us);
+		frame_checksum_finish(device, "gpu-dmabuf");
 
+		stall_watchdog_stage(stall_watchdog, FLIGHT_STAGE_PRESENT);
 		if (drm_display_flip(drm_display, dst_buf.drm_fb_id))
 		{
 			const uint64_t flip_done_us = monotonic_us();
@@ -964,6 +3589,13 @@ static void render_frame(Vulkan::Device &device)
 	// ---------------------------------------------------------------
 	// Fallback: CPU readback + NEON blit (if GPU display failed)
 	// ---------------------------------------------------------------
+	if (vi_lite_present.enabled && !frame_checksum.enabled && !options.crop_rect.enable)
+	{
+		if (render_vi_lite_frame(frame_start_us, frame_gap_us))
+			return;
+		vi_lite_present.fallbacks++;
+	}
+
 	unsigned width = 0, height = 0;
 	processor->scanout_sync(scanout_pixels, width, height, options);
 	const uint64_t scanout_done_us = monotonic_us();
@@ -986,9 +3618,16 @@ static void render_frame(Vulkan::Device &device)
 	{
 		fprintf(stderr, "[rdp] First scanout: %ux%u, %zu pixels, src_stride=%u (CPU fallback)\n",
 		        width, height, scanout_pixels.size(), src_stride);
+		flight_recorder_event(flight_recorder, runtime_tuning.frame_counter, "first scanout cpu %ux%u",
+		                      width, height);
 		logged_first_frame = true;
 	}
 
+	if (frame_checksum.enabled)
+		frame_checksum_log(reinterpret_cast<const uint8_t *>(scanout_pixels.data()), width, height,
+		                   src_stride, "cpu-fallback");
+
+	stall_watchdog_stage(stall_watchdog, FLIGHT_STAGE_PRESENT);
 	if (drm_display_present(drm_display,
 	                        reinterpret_cast<const uint8_t *>(scanout_pixels.data()),
 	                        width, height, src_stride))
@@ -1005,18 +3644,53 @@ static void render_frame(Vulkan::Device &device)
 
 void rdp_set_vi_register(uint32_t reg, uint32_t value)
 {
-	processor->set_vi_register(RDP::VIRegister(reg), value);
+	if (reg >= VI_REGS_COUNT)
+	{
+		if (processor)
+			processor->set_vi_register(RDP::VIRegister(reg), value);
+		return;
+	}
+	vi_shadow.regs[reg] = value;
+	vi_shadow.dirty |= 1u << reg;
+	vi_shadow.writes++;
 }
 
 void rdp_render_frame()
 {
-	auto &device = wsi->get_device();
-	render_frame(device);
+	poll_runtime_control();
+
+	const uint32_t frame = runtime_tuning.frame_counter++;
+	// Emulation, render and present run on the thread calling us; the RDP
+	// worker threads register themselves (rdp_thread_started()).
+	if (stall_watchdog.enabled && !stall_watchdog_emu_registered)
+		stall_watchdog_emu_registered = stall_watchdog_register_thread(stall_watchdog, "emu", true);
+	stall_watchdog_frame(stall_watchdog, frame);
+	rdp_stats_frame();
+	if (!frame_pacing_render(drm_display.pacing, frame, runtime_tuning.frame_skip))
+	{
+		stall_watchdog_stage(stall_watchdog, FLIGHT_STAGE_EMULATION);
+		return;
+	}
+
+	dl_cache_drain();
+	if (soft_rdp.enabled)
+		render_soft_frame();
+	else
+		render_frame(wsi->get_device());
+	stall_watchdog_stage(stall_watchdog, FLIGHT_STAGE_EMULATION);
+
+	if (bench.finished && !bench.reported)
+	{
+		bench_write_report();
+		callback.emu_running = false;
+	}
 }
 
 void rdp_update_screen()
 {
 	// No WSI swapchain — manage frame context directly
+	if (!wsi)
+		return;
 	auto &device = wsi->get_device();
 	device.end_frame_context();
 	device.next_frame_context();
@@ -1035,24 +3709,79 @@ CALL_BACK rdp_check_callback()
 
 void rdp_check_framebuffers(uint32_t address, uint32_t length)
 {
+	fb_sync.window.checks++;
+	// Hash the last rendered candidate before the CPU can change its result.
+	if (dl_cache.pending.signal)
+	{
+		dl_cache_settle();
+		if (display_list_cache_pending_overlaps(dl_cache, address, address + length))
+			display_list_cache_drop_pending(dl_cache);
+	}
+
+	if (fb_sync.mode == FB_SYNC_RELAXED)
+	{
+		if (coherence_profile.enabled)
+			coherence_profile_check(coherence_profile, address, length, false, 0);
+		return;
+	}
+
+	if (async_writeback.enabled)
+	{
+		async_writeback_shadow(address >> 3, (address >> 3) + ((length + 7) >> 3));
+		// Everything queued up to the last SyncFull may already be back in RDRAM.
+		if (sync_signal)
+			async_writeback_poll();
+	}
+
 	if (sync_signal)
 	{
+		const uint32_t byte_address = address;
+		const uint32_t byte_length = length;
 		address >>= 3;
 		length = (length + 7) >> 3;
 
 		if (address >= rdram_dirty.size())
+		{
+			if (coherence_profile.enabled)
+				coherence_profile_check(coherence_profile, byte_address, byte_length, true, 0);
 			return;
+		}
 
 		uint32_t end_addr = std::min(address + length, static_cast<uint32_t>(rdram_dirty.size()));
 
 		auto it = std::find(rdram_dirty.begin() + address, rdram_dirty.begin() + end_addr, true);
-		if (it != rdram_dirty.begin() + end_addr)
+		const bool hit = it != rdram_dirty.begin() + end_addr;
+		if (coherence_profile.enabled)
+		{
+			const uint32_t scanned = uint32_t(it - (rdram_dirty.begin() + address)) + (hit ? 1 : 0);
+			coherence_profile_check(coherence_profile, byte_address, byte_length, true, scanned);
+		}
+		if (hit)
+			fb_sync.window.hits++;
+		if (hit && async_writeback.enabled)
+		{
+			const uint64_t wait_start_us = coherence_profile.enabled ? monotonic_us() : 0;
+			const bool waited = async_writeback_hit(address, end_addr);
+			if (coherence_profile.enabled)
+				coherence_profile_hit(coherence_profile, byte_address, waited, monotonic_us() - wait_start_us);
+		}
+		else if (hit)
 		{
+			const uint64_t wait_start_us = monotonic_us();
 			processor->wait_for_timeline(sync_signal);
 			rdram_dirty.assign(gfx_info.RDRAM_SIZE >> 3, false);
 			sync_signal = 0;
+			const uint64_t wait_us = monotonic_us() - wait_start_us;
+			fb_sync.window.syncs++;
+			fb_sync.window.sync_us += wait_us;
+			if (coherence_profile.enabled)
+				coherence_profile_hit(coherence_profile, byte_address, true, wait_us);
 		}
 	}
+	else if (coherence_profile.enabled)
+	{
+		coherence_profile_check(coherence_profile, address, length, false, 0);
+	}
 }
 
 size_t rdp_state_size()
@@ -1062,7 +3791,11 @@ size_t rdp_state_size()
 
 void rdp_save_state(uint8_t *state)
 {
-	processor->wait_for_timeline(processor->signal_timeline());
+	dl_cache_drain();
+	if (soft_rdp.enabled)
+		soft_rdp_flush(soft_rdp);
+	else
+		processor->wait_for_timeline(processor->signal_timeline());
 	memcpy(state, &rdp_device, sizeof(RDP_DEVICE));
 }
 
@@ -1096,6 +3829,21 @@ uint32_t pixel_size(uint32_t pixel_type, uint32_t area)
 	}
 }
 
+// Mark [offset_address, end_addr) (8-byte units) as used by queued RDP work,
+// so CPU access to it waits for the RDP.
+static void mark_rdram_dirty(CoherenceMarkKind kind, uint32_t offset_address, uint32_t end_addr)
+{
+	const bool already_dirty = rdram_dirty[offset_address];
+	if (!already_dirty)
+		std::fill(rdram_dirty.begin() + offset_address, rdram_dirty.begin() + end_addr, true);
+	if (dl_cache.enabled)
+		display_list_cache_add_range(dl_cache, offset_address << 3, end_addr << 3);
+	if (coherence_profile.enabled)
+		coherence_profile_mark(coherence_profile, kind, offset_address << 3, end_addr << 3, already_dirty);
+	if (async_writeback.enabled)
+		async_writeback_mark(offset_address, end_addr);
+}
+
 uint64_t rdp_process_commands()
 {
 	uint64_t interrupt_timer = 0;
@@ -1150,12 +3898,33 @@ uint64_t rdp_process_commands()
 
 		if (rdp_device.cmd_ptr - rdp_device.cmd_cur - cmd_length < 0)
 		{
+			command_batch_flush();
 			*gfx_info.DPC_START_REG = *gfx_info.DPC_CURRENT_REG = *gfx_info.DPC_END_REG;
 			return interrupt_timer;
 		}
 
+		if (rdp_stats.enabled)
+		{
+			rdp_stats.frame.ops[command]++;
+			rdp_stats.frame.bytes += cmd_length * 8;
+		}
+
 		if (command >= 8)
-			processor->enqueue_command(cmd_length * 2, &rdp_device.cmd_data[2 * rdp_device.cmd_cur]);
+		{
+			if (dl_cache.enabled)
+			{
+				display_list_cache_add(dl_cache, &rdp_device.cmd_data[2 * rdp_device.cmd_cur], cmd_length * 2);
+				if (dl_cache.words.size() > DISPLAY_LIST_CACHE_MAX_WORDS)
+					dl_cache_drain();
+			}
+			else
+				command_batch_add(&rdp_device.cmd_data[2 * rdp_device.cmd_cur], cmd_length * 2);
+		}
+		else
+		{
+			// Skipped words would break the run.
+			command_batch_flush();
+		}
 
 		switch (RDP::Op(command))
 		{
@@ -1172,19 +3941,19 @@ uint64_t rdp_process_commands()
 		case RDP::Op::FillRectangle:
 		{
 			uint32_t offset_address = (rdp_device.frame_buffer_info.framebuffer_address + pixel_size(rdp_device.frame_buffer_info.framebuffer_pixel_size, rdp_device.frame_buffer_info.framebuffer_y_offset * rdp_device.frame_buffer_info.framebuffer_width)) >> 3;
-			if (offset_address < rdram_dirty.size() && !rdram_dirty[offset_address])
+			if (offset_address < rdram_dirty.size())
 			{
 				uint32_t end_addr = std::min(offset_address + ((pixel_size(rdp_device.frame_buffer_info.framebuffer_pixel_size, rdp_device.frame_buffer_info.framebuffer_width * rdp_device.frame_buffer_info.framebuffer_height) + 7) >> 3), static_cast<uint32_t>(rdram_dirty.size()));
-				std::fill(rdram_dirty.begin() + offset_address, rdram_dirty.begin() + end_addr, true);
+				mark_rdram_dirty(COHERENCE_MARK_COLOR, offset_address, end_addr);
 			}
 
 			if (rdp_device.frame_buffer_info.depth_buffer_enabled)
 			{
 				offset_address = (rdp_device.frame_buffer_info.depthbuffer_address + pixel_size(2, rdp_device.frame_buffer_info.framebuffer_y_offset * rdp_device.frame_buffer_info.framebuffer_width)) >> 3;
-				if (offset_address < rdram_dirty.size() && !rdram_dirty[offset_address])
+				if (offset_address < rdram_dirty.size())
 				{
 					uint32_t end_addr = std::min(offset_address + ((pixel_size(2, rdp_device.frame_buffer_info.framebuffer_width * rdp_device.frame_buffer_info.framebuffer_height) + 7) >> 3), static_cast<uint32_t>(rdram_dirty.size()));
-					std::fill(rdram_dirty.begin() + offset_address, rdram_dirty.begin() + end_addr, true);
+					mark_rdram_dirty(COHERENCE_MARK_DEPTH, offset_address, end_addr);
 				}
 			}
 		}
@@ -1194,11 +3963,11 @@ uint64_t rdp_process_commands()
 		{
 			uint32_t upper_left_t = (w1 & 0xFFF) >> 2;
 			uint32_t offset_address = (rdp_device.frame_buffer_info.texture_address + pixel_size(rdp_device.frame_buffer_info.texture_pixel_size, upper_left_t * rdp_device.frame_buffer_info.texture_width)) >> 3;
-			if (offset_address < rdram_dirty.size() && !rdram_dirty[offset_address])
+			if (offset_address < rdram_dirty.size())
 			{
 				uint32_t lower_right_t = (w2 & 0xFFF) >> 2;
 				uint32_t end_addr = std::min(offset_address + ((pixel_size(rdp_device.frame_buffer_info.texture_pixel_size, (lower_right_t - upper_left_t) * rdp_device.frame_buffer_info.texture_width) + 7) >> 3), static_cast<uint32_t>(rdram_dirty.size()));
-				std::fill(rdram_dirty.begin() + offset_address, rdram_dirty.begin() + end_addr, true);
+				mark_rdram_dirty(COHERENCE_MARK_TEXTURE, offset_address, end_addr);
 			}
 		}
 		break;
@@ -1207,20 +3976,27 @@ uint64_t rdp_process_commands()
 			uint32_t upper_left_s = ((w1 >> 12) & 0xFFF);
 			uint32_t upper_left_t = (w1 & 0xFFF);
 			uint32_t offset_address = (rdp_device.frame_buffer_info.texture_address + pixel_size(rdp_device.frame_buffer_info.texture_pixel_size, upper_left_s + upper_left_t * rdp_device.frame_buffer_info.texture_width)) >> 3;
-			if (offset_address < rdram_dirty.size() && !rdram_dirty[offset_address])
+			if (offset_address < rdram_dirty.size())
 			{
 				uint32_t lower_right_s = ((w2 >> 12) & 0xFFF);
 				uint32_t end_addr = std::min(offset_address + ((pixel_size(rdp_device.frame_buffer_info.texture_pixel_size, lower_right_s - upper_left_s) + 7) >> 3), static_cast<uint32_t>(rdram_dirty.size()));
-				std::fill(rdram_dirty.begin() + offset_address, rdram_dirty.begin() + end_addr, true);
+				mark_rdram_dirty(COHERENCE_MARK_TEXTURE, offset_address, end_addr);
 			}
 		}
 		break;
 		case RDP::Op::SetColorImage:
+			command_batch_flush();
 			rdp_device.frame_buffer_info.framebuffer_address = (w2 & 0x00FFFFFF);
+			if (rdp_stats.enabled && rdp_stats.last_color_image != rdp_device.frame_buffer_info.framebuffer_address)
+			{
+				rdp_stats.last_color_image = rdp_device.frame_buffer_info.framebuffer_address;
+				rdp_stats.frame.fb_switches++;
+			}
 			rdp_device.frame_buffer_info.framebuffer_pixel_size = (w1 >> 19) & 0x3;
 			rdp_device.frame_buffer_info.framebuffer_width = (w1 & 0x3FF) + 1;
 			break;
 		case RDP::Op::SetMaskImage:
+			command_batch_flush();
 			rdp_device.frame_buffer_info.depthbuffer_address = (w2 & 0x00FFFFFF);
 			break;
 		case RDP::Op::SetTextureImage:
@@ -1255,7 +4031,21 @@ uint64_t rdp_process_commands()
 		}
 		break;
 		case RDP::Op::SyncFull:
-			sync_signal = processor->signal_timeline();
+			command_batch_flush();
+			if (dl_cache.enabled)
+				dl_cache_flush();
+			// The software RDP finishes the list here, so RDRAM is current
+			// before the interrupt and no CPU access has to wait.
+			if (soft_rdp.enabled)
+				soft_rdp_flush(soft_rdp);
+			else
+			{
+				sync_signal = processor->signal_timeline();
+				if (async_writeback.enabled)
+					async_writeback_sync(sync_signal);
+				if (dl_cache.enabled)
+					display_list_cache_signaled(dl_cache, sync_signal);
+			}
 
 			interrupt_timer = rdp_device.region;
 			if (interrupt_timer == 0)
@@ -1268,6 +4058,7 @@ uint64_t rdp_process_commands()
 		rdp_device.cmd_cur += cmd_length;
 	}
 
+	command_batch_flush();
 	rdp_device.cmd_ptr = 0;
 	rdp_device.cmd_cur = 0;
 	*gfx_info.DPC_CURRENT_REG = *gfx_info.DPC_END_REG;
@@ -0,0 +1,225 @@
+/*
+ * Runtime performance control channel for tg5050
+ *
+ * Non-blocking Unix stream socket. All socket work happens on the caller's
+ * thread inside perf_control_poll(), so command handling never races the
+ * frame loop: the interface polls at the frame boundary and applies changes
+ * there.
+ */
+
+#include "perf_control.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static void close_client(PerfControl::Client &cl)
+{
+	if (cl.fd >= 0)
+		close(cl.fd);
+	cl.fd = -1;
+	cl.len = 0;
+	cl.awaiting_baseline = false;
+}
+
+bool perf_control_init(PerfControl &c, const char *path)
+{
+	if (!path || !path[0])
+		path = PERF_CONTROL_DEFAULT_PATH;
+
+	struct sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path))
+	{
+		fprintf(stderr, "[perf_control] Socket path too long: %s\n", path);
+		return false;
+	}
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+	snprintf(c.path, sizeof(c.path), "%s", path);
+
+	c.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (c.listen_fd < 0)
+	{
+		fprintf(stderr, "[perf_control] socket: %s\n", strerror(errno));
+		return false;
+	}
+
+	// A stale socket from a crashed session would make bind() fail.
+	unlink(path);
+	if (bind(c.listen_fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 ||
+	    listen(c.listen_fd, PERF_CONTROL_MAX_CLIENTS) < 0)
+	{
+		fprintf(stderr, "[perf_control] bind/listen %s: %s\n", path, strerror(errno));
+		close(c.listen_fd);
+		c.listen_fd = -1;
+		return false;
+	}
+
+	fprintf(stderr, "[perf_control] Listening on %s\n", path);
+	return true;
+}
+
+static void accept_clients(PerfControl &c)
+{
+	for (;;)
+	{
+		int fd = accept4(c.listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0)
+			return;
+
+		PerfControl::Client *slot = nullptr;
+		for (auto &cl : c.clients)
+		{
+			if (cl.fd < 0)
+			{
+				slot = &cl;
+				break;
+			}
+		}
+		if (!slot)
+		{
+			static const char busy[] = "error too many clients\n";
+			(void)!write(fd, busy, sizeof(busy) - 1);
+			close(fd);
+			continue;
+		}
+		slot->fd = fd;
+		slot->len = 0;
+		slot->awaiting_baseline = false;
+	}
+}
+
+static bool parse_line(char *line, PerfControlCommand &cmd)
+{
+	cmd.verb[0] = cmd.key[0] = cmd.value[0] = '\0';
+	int n = sscanf(line, "%15s %31s %63s", cmd.verb, cmd.key, cmd.value);
+	return n >= 1;
+}
+
+bool perf_control_poll(PerfControl &c, PerfControlCommand &cmd)
+{
+	if (c.listen_fd < 0)
+		return false;
+
+	accept_clients(c);
+
+	for (int i = 0; i < PERF_CONTROL_MAX_CLIENTS; i++)
+	{
+		PerfControl::Client &cl = c.clients[i];
+		if (cl.fd < 0)
+			continue;
+
+		// Drain a complete line already buffered before reading more.
+		for (;;)
+		{
+			char *nl = static_cast<char *>(memchr(cl.buf, '\n', cl.len));
+			if (nl)
+			{
+				*nl = '\0';
+				if (nl > cl.buf && nl[-1] == '\r')
+					nl[-1] = '\0';
+				bool ok = parse_line(cl.buf, cmd);
+				size_t consumed = size_t(nl - cl.buf) + 1;
+				memmove(cl.buf, cl.buf + consumed, cl.len - consumed);
+				cl.len -= consumed;
+				if (ok)
+				{
+					cmd.client = i;
+					return true;
+				}
+				continue;
+			}
+
+			if (cl.len >= sizeof(cl.buf) - 1)
+			{
+				perf_control_reply(c, i, "error line too long");
+				close_client(cl);
+				break;
+			}
+
+			ssize_t n = read(cl.fd, cl.buf + cl.len, sizeof(cl.buf) - 1 - cl.len);
+			if (n > 0)
+			{
+				cl.len += size_t(n);
+				continue;
+			}
+			if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+			{
+				// Peer closed. Keep it if it still waits for a baseline
+				// (half-closed "echo cmd | nc" style clients).
+				if (n == 0 && cl.awaiting_baseline)
+					break;
+				close_client(cl);
+			}
+			break;
+		}
+	}
+
+	return false;
+}
+
+void perf_control_reply(PerfControl &c, int client, const char *fmt, ...)
+{
+	if (client < 0 || client >= PERF_CONTROL_MAX_CLIENTS || c.clients[client].fd < 0)
+		return;
+
+	char line[512];
+	va_list ap;
+	va_start(ap, fmt);
+	int n = vsnprintf(line, sizeof(line) - 1, fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		return;
+	if (size_t(n) > sizeof(line) - 2)
+		n = int(sizeof(line) - 2);
+	line[n++] = '\n';
+
+	// Replies are tiny; a client that cannot take one line is dropped.
+	if (send(c.clients[client].fd, line, size_t(n), MSG_NOSIGNAL) != n)
+		close_client(c.clients[client]);
+}
+
+void perf_control_defer_until_baseline(PerfControl &c, int client)
+{
+	if (client < 0 || client >= PERF_CONTROL_MAX_CLIENTS || c.clients[client].fd < 0)
+		return;
+	c.clients[client].awaiting_baseline = true;
+}
+
+bool perf_control_baseline_pending(const PerfControl &c)
+{
+	for (const auto &cl : c.clients)
+		if (cl.fd >= 0 && cl.awaiting_baseline)
+			return true;
+	return false;
+}
+
+void perf_control_baseline(PerfControl &c, const char *line)
+{
+	for (int i = 0; i < PERF_CONTROL_MAX_CLIENTS; i++)
+	{
+		PerfControl::Client &cl = c.clients[i];
+		if (cl.fd < 0 || !cl.awaiting_baseline)
+			continue;
+		perf_control_reply(c, i, "baseline %s", line);
+		close_client(cl);
+	}
+}
+
+void perf_control_cleanup(PerfControl &c)
+{
+	for (auto &cl : c.clients)
+		close_client(cl);
+
+	if (c.listen_fd >= 0)
+	{
+		close(c.listen_fd);
+		c.listen_fd = -1;
+		unlink(c.path);
+	}
+}
@@ -0,0 +1,70 @@
+/*
+ * Runtime performance control channel for tg5050
+ *
+ * Listens on a Unix stream socket for line-based commands so tuning knobs
+ * can be changed without relaunching:
+ *
+ *   set <key> <value>   queue a change (applied at the next frame boundary)
+ *   get                 report current knob values
+ *
+ * Clients that issued a "set" are kept open until the next perf window
+ * completes, then receive the new perf baseline line and are closed.
+ *
+ * Usage: init() -> poll() once per frame -> cleanup()
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define PERF_CONTROL_DEFAULT_PATH "/tmp/gopher64-control.sock"
+#define PERF_CONTROL_MAX_CLIENTS 4
+
+struct PerfControl
+{
+	int listen_fd = -1;
+	char path[108] = {};
+
+	struct Client
+	{
+		int fd = -1;
+		char buf[256] = {};
+		size_t len = 0;
+		bool awaiting_baseline = false;
+	};
+
+	Client clients[PERF_CONTROL_MAX_CLIENTS] = {};
+};
+
+struct PerfControlCommand
+{
+	int client = -1;
+	char verb[16] = {};
+	char key[32] = {};
+	char value[64] = {};
+};
+
+// Create the listening socket. path == nullptr uses PERF_CONTROL_DEFAULT_PATH.
+// Returns true on success.
+bool perf_control_init(PerfControl &c, const char *path);
+
+// Accept pending clients and return the next complete command line, if any.
+// Never blocks. Call in a loop until it returns false.
+bool perf_control_poll(PerfControl &c, PerfControlCommand &cmd);
+
+// Send a reply line ("\n" appended) to a client.
+void perf_control_reply(PerfControl &c, int client, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+// Keep the client open until the next perf_control_baseline() call.
+void perf_control_defer_until_baseline(PerfControl &c, int client);
+
+// True if at least one client is waiting for a perf baseline.
+bool perf_control_baseline_pending(const PerfControl &c);
+
+// Send the perf baseline line to all waiting clients and close them.
+void perf_control_baseline(PerfControl &c, const char *line);
+
+// Close all clients and the listening socket, unlink the socket path.
+void perf_control_cleanup(PerfControl &c);
@@ -0,0 +1,336 @@
+/*
+ * Battery power telemetry and battery-saver clock capping for tg5050
+ *
+ * Everything is plain sysfs I/O done once per perf window (~1 Hz) on the
+ * render thread, so there is no extra thread and no locking.
+ */
+
+#include "power_monitor.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
+
+#ifndef POWER_SUPPLY_DIR
+#define POWER_SUPPLY_DIR "/sys/class/power_supply"
+#endif
+
+static bool read_line(const char *path, char *out, size_t out_size)
+{
+	FILE *f = fopen(path, "r");
+	if (!f)
+		return false;
+	bool ok = fgets(out, int(out_size), f) != nullptr;
+	fclose(f);
+	if (ok)
+		out[strcspn(out, "\r\n")] = '\0';
+	return ok;
+}
+
+static bool read_ll(const char *path, long long &value)
+{
+	char text[64];
+	if (!path[0] || !read_line(path, text, sizeof(text)))
+		return false;
+	char *end = nullptr;
+	value = strtoll(text, &end, 10);
+	return end != text;
+}
+
+static void set_path_if_readable(char *dst, size_t dst_size, const char *dir, const char *name)
+{
+	char path[320];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	if (access(path, R_OK) == 0)
+		snprintf(dst, dst_size, "%s", path);
+}
+
+bool power_monitor_init(PowerMonitor &p)
+{
+	DIR *dir = opendir(POWER_SUPPLY_DIR);
+	if (!dir)
+		return false;
+
+	while (struct dirent *ent = readdir(dir))
+	{
+		if (ent->d_name[0] == '.')
+			continue;
+
+		char supply[288];
+		char path[300];
+		char type[32];
+		snprintf(supply, sizeof(supply), "%s/%s", POWER_SUPPLY_DIR, ent->d_name);
+		snprintf(path, sizeof(path), "%s/type", supply);
+		if (!read_line(path, type, sizeof(type)) || strcmp(type, "Battery") != 0)
+			continue;
+
+		set_path_if_readable(p.power_path, sizeof(p.power_path), supply, "power_now");
+		set_path_if_readable(p.voltage_path, sizeof(p.voltage_path), supply, "voltage_now");
+		set_path_if_readable(p.current_path, sizeof(p.current_path), supply, "current_now");
+		set_path_if_readable(p.status_path, sizeof(p.status_path), supply, "status");
+		set_path_if_readable(p.energy_path, sizeof(p.energy_path), supply, "energy_now");
+		if (!p.energy_path[0])
+		{
+			set_path_if_readable(p.energy_path, sizeof(p.energy_path), supply, "charge_now");
+			p.energy_is_charge = p.energy_path[0] != '\0';
+		}
+
+		p.available = p.power_path[0] || (p.voltage_path[0] && p.current_path[0]);
+		if (p.available)
+		{
+			fprintf(stderr, "[power] Battery telemetry from %s (%s)\n", supply,
+			        p.power_path[0] ? "power_now" : "voltage_now*current_now");
+			break;
+		}
+	}
+
+	closedir(dir);
+	return p.available;
+}
+
+PowerSample power_monitor_sample(PowerMonitor &p, double elapsed_s, uint32_t frames)
+{
+	PowerSample s;
+	if (!p.available)
+		return s;
+
+	long long raw = 0;
+	if (read_ll(p.power_path, raw))
+	{
+		s.watts = double(llabs(raw)) / 1e6;
+	}
+	else
+	{
+		long long uv = 0;
+		long long ua = 0;
+		if (!read_ll(p.voltage_path, uv) || !read_ll(p.current_path, ua))
+			return s;
+		// Drivers disagree on the sign of current_now while discharging.
+		s.watts = (double(uv) / 1e6) * (double(llabs(ua)) / 1e6);
+	}
+
+	char status[32] = {};
+	if (p.status_path[0] && read_line(p.status_path, status, sizeof(status)))
+		s.charging = strcmp(status, "Charging") == 0;
+
+	s.valid = true;
+	if (frames > 0)
+		s.mj_per_frame = s.watts * elapsed_s * 1000.0 / double(frames);
+
+	// While charging current_now is the charge current, not our draw.
+	if (!s.charging)
+	{
+		p.session_energy_j += s.watts * elapsed_s;
+		p.session_seconds += elapsed_s;
+		p.session_frames += frames;
+	}
+	return s;
+}
+
+void power_monitor_report(const PowerMonitor &p)
+{
+	if (!p.available || p.session_seconds <= 0.0 || p.session_frames == 0)
+		return;
+
+	const double avg_w = p.session_energy_j / p.session_seconds;
+	const double mj_per_frame = p.session_energy_j * 1000.0 / double(p.session_frames);
+
+	char remaining[64] = {};
+	long long energy = 0;
+	if (avg_w > 0.0 && read_ll(p.energy_path, energy))
+	{
+		double wh = double(energy) / 1e6;
+		long long uv = 0;
+		if (p.energy_is_charge)
+			wh = read_ll(p.voltage_path, uv) ? wh * double(uv) / 1e6 : 0.0;
+		if (wh > 0.0)
+			snprintf(remaining, sizeof(remaining), " battery=%.2fWh est_remaining=%.0fmin", wh, wh / avg_w * 60.0);
+	}
+
+	fprintf(stderr, "[power] session avg=%.2fW energy/frame=%.1fmJ frames=%llu time=%.0fs%s\n",
+	        avg_w, mj_per_frame, (unsigned long long)p.session_frames, p.session_seconds, remaining);
+}
+
+// ---------------------------------------------------------------------------
+// Battery saver clock caps
+// ---------------------------------------------------------------------------
+
+static bool clock_cap_init(ClockCap &cap, const char *dir, const char *available_name, const char *max_name)
+{
+	char path[160];
+	char text[512];
+	snprintf(path, sizeof(path), "%s/%s", dir, available_name);
+	if (!read_line(path, text, sizeof(text)))
+		return false;
+
+	for (char *tok = strtok(text, " \t"); tok; tok = strtok(nullptr, " \t"))
+	{
+		unsigned long f = strtoul(tok, nullptr, 10);
+		if (f > 0)
+			cap.freqs.push_back(uint32_t(f));
+	}
+	std::sort(cap.freqs.begin(), cap.freqs.end());
+	cap.freqs.erase(std::unique(cap.freqs.begin(), cap.freqs.end()), cap.freqs.end());
+
+	snprintf(cap.max_path, sizeof(cap.max_path), "%s/%s", dir, max_name);
+	long long original = 0;
+	if (cap.freqs.empty() || access(cap.max_path, W_OK) != 0 || !read_ll(cap.max_path, original))
+	{
+		cap.freqs.clear();
+		return false;
+	}
+
+	cap.original_max = uint32_t(original);
+	cap.index = 0;
+	for (size_t i = 0; i < cap.freqs.size(); i++)
+		if (cap.freqs[i] <= cap.original_max)
+			cap.index = int(i);
+	return true;
+}
+
+static bool clock_cap_set(ClockCap &cap, int index)
+{
+	if (cap.freqs.empty() || index < 0 || index >= int(cap.freqs.size()) || index == cap.index)
+		return false;
+
+	FILE *f = fopen(cap.max_path, "w");
+	if (!f)
+		return false;
+	bool ok = fprintf(f, "%u", cap.freqs[index]) > 0;
+	ok = (fclose(f) == 0) && ok;
+	if (!ok)
+	{
+		fprintf(stderr, "[power] Cannot write %s: %s\n", cap.max_path, strerror(errno));
+		return false;
+	}
+	cap.index = index;
+	return true;
+}
+
+static void clock_cap_restore(ClockCap &cap)
+{
+	if (cap.freqs.empty() || !cap.original_max)
+		return;
+	FILE *f = fopen(cap.max_path, "w");
+	if (f)
+	{
+		fprintf(f, "%u", cap.original_max);
+		fclose(f);
+	}
+	cap.freqs.clear();
+	cap.index = -1;
+}
+
+bool battery_saver_init(BatterySaver &s)
+{
+	const char *cpu_dirs[] = {
+		"/sys/devices/system/cpu/cpufreq/policy0",
+		"/sys/devices/system/cpu/cpufreq/policy4"
+	};
+	for (const char *dir : cpu_dirs)
+		if (clock_cap_init(s.cpu[s.cpu_count], dir, "scaling_available_frequencies", "scaling_max_freq"))
+			s.cpu_count++;
+
+	const char *gpu_dirs[] = {
+		"/sys/class/devfreq/1800000.gpu",
+		"/sys/devices/platform/soc@3000000/1800000.gpu/devfreq/1800000.gpu"
+	};
+	for (const char *dir : gpu_dirs)
+	{
+		if (clock_cap_init(s.gpu, dir, "available_frequencies", "max_freq"))
+		{
+			s.gpu_available = true;
+			break;
+		}
+	}
+
+	fprintf(stderr, "[power] Battery saver clock caps: cpu_policies=%d gpu=%s\n",
+	        s.cpu_count, s.gpu_available ? "yes" : "no");
+	return s.cpu_count > 0 || s.gpu_available;
+}
+
+static bool step_cpu(BatterySaver &s, int dir)
+{
+	bool changed = false;
+	for (int i = 0; i < s.cpu_count; i++)
+		changed |= clock_cap_set(s.cpu[i], s.cpu[i].index + dir);
+	return changed;
+}
+
+static bool step_gpu(BatterySaver &s, int dir)
+{
+	return s.gpu_available && clock_cap_set(s.gpu, s.gpu.index + dir);
+}
+
+void battery_saver_update(BatterySaver &s, double fps, double target_fps, int gpu_util)
+{
+	if (!s.enabled)
+		return;
+
+	bool changed = false;
+	const char *reason = "";
+	if (fps < target_fps)
+	{
+		// Missed the target: back off immediately and stay put for a while
+		// so a single slow scene does not make the caps oscillate.
+		changed |= step_cpu(s, +1);
+		if (gpu_util < 0 || gpu_util >= 70)
+			changed |= step_gpu(s, +1);
+		s.stable_windows = 0;
+		s.hold_windows = 10;
+		reason = "raise";
+	}
+	else if (s.hold_windows > 0)
+	{
+		s.hold_windows--;
+	}
+	else if (gpu_util > 85)
+	{
+		changed |= step_gpu(s, +1);
+		reason = "raise gpu";
+	}
+	else if (++s.stable_windows >= 3)
+	{
+		s.stable_windows = 0;
+		changed |= step_cpu(s, -1);
+		if (gpu_util < 60)
+			changed |= step_gpu(s, -1);
+		reason = "lower";
+	}
+
+	if (changed)
+	{
+		fprintf(stderr, "[power] Battery saver %s: cpu_max=%dMHz gpu_max=%dMHz (fps=%.1f target=%.1f gpu=%d%%)\n",
+		        reason, battery_saver_cpu_mhz(s), battery_saver_gpu_mhz(s), fps, target_fps, gpu_util);
+	}
+}
+
+int battery_saver_cpu_mhz(const BatterySaver &s)
+{
+	// Report the big cluster when present; it runs the emulation thread.
+	if (s.cpu_count == 0)
+		return -1;
+	const ClockCap &cap = s.cpu[s.cpu_count - 1];
+	return cap.index >= 0 ? int(cap.freqs[cap.index] / 1000) : -1;
+}
+
+int battery_saver_gpu_mhz(const BatterySaver &s)
+{
+	if (!s.gpu_available || s.gpu.index < 0)
+		return -1;
+	return int(s.gpu.freqs[s.gpu.index] / 1000000);
+}
+
+void battery_saver_cleanup(BatterySaver &s)
+{
+	for (int i = 0; i < s.cpu_count; i++)
+		clock_cap_restore(s.cpu[i]);
+	clock_cap_restore(s.gpu);
+	s.cpu_count = 0;
+	s.gpu_available = false;
+	s.enabled = false;
+}
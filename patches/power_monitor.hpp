@@ -0,0 +1,86 @@
+/*
+ * Battery power telemetry and battery-saver clock capping for tg5050
+ *
+ * PowerMonitor reads the battery's voltage/current (or power_now) from
+ * /sys/class/power_supply once per perf window and turns it into average
+ * watts and energy per presented frame, plus a session total.
+ *
+ * BatterySaver walks the CPU cluster and GPU devfreq max clocks down one
+ * available step at a time while the target frame rate holds, and back up
+ * when it does not, so it settles on the lowest clocks that sustain it.
+ * Original limits are restored by battery_saver_cleanup().
+ *
+ * Usage: init() -> sample()/update() once per perf window -> cleanup()
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct PowerMonitor
+{
+	bool available = false;
+	char power_path[160] = {};   // power_now (uW), preferred when present
+	char voltage_path[160] = {}; // voltage_now (uV)
+	char current_path[160] = {}; // current_now (uA)
+	char status_path[160] = {};
+	char energy_path[160] = {};  // energy_now (uWh) or charge_now (uAh)
+	bool energy_is_charge = false;
+
+	// Session totals (discharging windows only)
+	double session_energy_j = 0.0;
+	double session_seconds = 0.0;
+	uint64_t session_frames = 0;
+};
+
+struct PowerSample
+{
+	bool valid = false;
+	bool charging = false;
+	double watts = 0.0;
+	double mj_per_frame = 0.0;
+};
+
+// Find the battery under /sys/class/power_supply. Returns false if none.
+bool power_monitor_init(PowerMonitor &p);
+
+// Read instantaneous power and attribute it to a window of `frames`
+// presented frames over `elapsed_s` seconds.
+PowerSample power_monitor_sample(PowerMonitor &p, double elapsed_s, uint32_t frames);
+
+// Log the session average and an estimated remaining play time.
+void power_monitor_report(const PowerMonitor &p);
+
+// One max-frequency knob (cpufreq policy or devfreq device).
+struct ClockCap
+{
+	char max_path[160] = {};
+	std::vector<uint32_t> freqs; // ascending, in the knob's native unit
+	int index = -1;              // current cap, index into freqs
+	uint32_t original_max = 0;
+};
+
+struct BatterySaver
+{
+	bool enabled = false;
+	ClockCap cpu[2]; // policy0 (little), policy4 (big) when present
+	int cpu_count = 0;
+	ClockCap gpu;
+	bool gpu_available = false;
+	uint32_t stable_windows = 0;
+	uint32_t hold_windows = 0;
+};
+
+// Discover clock knobs. Returns false when nothing can be capped.
+bool battery_saver_init(BatterySaver &s);
+
+// Adjust caps after a perf window. gpu_util < 0 means unknown.
+void battery_saver_update(BatterySaver &s, double fps, double target_fps, int gpu_util);
+
+// Current caps in MHz for logging; -1 when not capped.
+int battery_saver_cpu_mhz(const BatterySaver &s);
+int battery_saver_gpu_mhz(const BatterySaver &s);
+
+// Restore the original max clocks.
+void battery_saver_cleanup(BatterySaver &s);
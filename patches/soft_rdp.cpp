@@ -0,0 +1,1379 @@
+/*
+ * Software RDP for tg5050
+ *
+ * RDRAM is kept in host-order 32-bit words (as parallel-rdp and the core
+ * see it), so on this little-endian target byte n of a word lives at
+ * n ^ 3 and halfword n at n ^ 2. TMEM is a plain byte array in RDP order
+ * without the odd-line interleave: loads and sampling here agree on the
+ * layout, which is all that matters for a CPU-only pipeline.
+ */
+
+#include "soft_rdp.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+enum SoftRdpOp
+{
+	OP_FILL_TRIANGLE = 0x08,
+	OP_SHADE_TEXTURE_Z_BUFFER_TRIANGLE = 0x0f,
+	OP_TEXTURE_RECTANGLE = 0x24,
+	OP_TEXTURE_RECTANGLE_FLIP = 0x25,
+	OP_SET_SCISSOR = 0x2d,
+	OP_SET_PRIM_DEPTH = 0x2e,
+	OP_SET_OTHER_MODES = 0x2f,
+	OP_LOAD_TLUT = 0x30,
+	OP_SET_TILE_SIZE = 0x32,
+	OP_LOAD_BLOCK = 0x33,
+	OP_LOAD_TILE = 0x34,
+	OP_SET_TILE = 0x35,
+	OP_FILL_RECTANGLE = 0x36,
+	OP_SET_FILL_COLOR = 0x37,
+	OP_SET_FOG_COLOR = 0x38,
+	OP_SET_BLEND_COLOR = 0x39,
+	OP_SET_PRIM_COLOR = 0x3a,
+	OP_SET_ENV_COLOR = 0x3b,
+	OP_SET_COMBINE = 0x3c,
+	OP_SET_TEXTURE_IMAGE = 0x3d,
+	OP_SET_MASK_IMAGE = 0x3e,
+	OP_SET_COLOR_IMAGE = 0x3f,
+};
+
+enum
+{
+	CYCLE_1 = 0,
+	CYCLE_2 = 1,
+	CYCLE_COPY = 2,
+	CYCLE_FILL = 3,
+};
+
+enum
+{
+	FORMAT_RGBA = 0,
+	FORMAT_YUV = 1,
+	FORMAT_CI = 2,
+	FORMAT_IA = 3,
+	FORMAT_I = 4,
+};
+
+// Flushes are forced before the pending list gets this long.
+#define SOFT_RDP_MAX_PRIMS 65536
+
+struct SoftRdpWorkers
+{
+	std::vector<std::thread> threads;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	uint64_t generation = 0;
+	unsigned running = 0;
+	bool quit = false;
+
+	// Current flush
+	SoftRdp *rdp = nullptr;
+	std::atomic<int32_t> next_band{ 0 };
+	int32_t band_count = 0;
+};
+
+struct Color
+{
+	int r, g, b, a;
+};
+
+static uint64_t now_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000ull + uint64_t(ts.tv_nsec) / 1000ull;
+}
+
+// ---------------------------------------------------------------------------
+// RDRAM and pixel formats
+// ---------------------------------------------------------------------------
+
+static inline uint8_t rdram_read8(const SoftRdp &r, uint32_t address)
+{
+	return r.rdram[(address & r.rdram_mask) ^ 3];
+}
+
+static inline uint16_t rdram_read16(const SoftRdp &r, uint32_t address)
+{
+	return *reinterpret_cast<const uint16_t *>(r.rdram + ((address & r.rdram_mask & ~1u) ^ 2));
+}
+
+static inline uint32_t rdram_read32(const SoftRdp &r, uint32_t address)
+{
+	return *reinterpret_cast<const uint32_t *>(r.rdram + (address & r.rdram_mask & ~3u));
+}
+
+static inline void rdram_write8(const SoftRdp &r, uint32_t address, uint8_t value)
+{
+	r.rdram[(address & r.rdram_mask) ^ 3] = value;
+}
+
+static inline void rdram_write16(const SoftRdp &r, uint32_t address, uint16_t value)
+{
+	*reinterpret_cast<uint16_t *>(r.rdram + ((address & r.rdram_mask & ~1u) ^ 2)) = value;
+}
+
+static inline void rdram_write32(const SoftRdp &r, uint32_t address, uint32_t value)
+{
+	*reinterpret_cast<uint32_t *>(r.rdram + (address & r.rdram_mask & ~3u)) = value;
+}
+
+static inline int clamp8(int v)
+{
+	return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+static inline Color gray(int v)
+{
+	return { v, v, v, v };
+}
+
+static inline Color unpack_rgba32(uint32_t v)
+{
+	return { int(v >> 24), int((v >> 16) & 0xff), int((v >> 8) & 0xff), int(v & 0xff) };
+}
+
+static inline Color unpack_rgba16(uint32_t v)
+{
+	const int r = (v >> 11) & 0x1f, g = (v >> 6) & 0x1f, b = (v >> 1) & 0x1f;
+	return { (r << 3) | (r >> 2), (g << 3) | (g >> 2), (b << 3) | (b >> 2), (v & 1) ? 255 : 0 };
+}
+
+static inline uint16_t pack_rgba16(const Color &c, bool alpha)
+{
+	return uint16_t(((c.r >> 3) << 11) | ((c.g >> 3) << 6) | ((c.b >> 3) << 1) | (alpha ? 1 : 0));
+}
+
+// Bytes per color image pixel; 0 for 4bpp, which the RDP cannot render to.
+static inline uint32_t pixel_bytes(uint32_t size)
+{
+	return size ? 1u << (size - 1) : 0;
+}
+
+// Depth is 18 bits in the pipeline and stored as 3-bit exponent, 11-bit
+// mantissa and 2-bit dz. dz is always written as 0 here.
+static const uint32_t z_base[8] = { 0x00000, 0x20000, 0x30000, 0x38000, 0x3c000, 0x3e000, 0x3f000, 0x3f800 };
+static const uint32_t z_shift[8] = { 6, 5, 4, 3, 2, 1, 0, 0 };
+
+static inline uint32_t z_decompress(uint16_t stored)
+{
+	const uint32_t c = stored >> 2;
+	const uint32_t e = c >> 11;
+	return z_base[e] | ((c & 0x7ff) << z_shift[e]);
+}
+
+static inline uint16_t z_compress(uint32_t z)
+{
+	uint32_t e = 0;
+	while (e < 7 && (z & (0x20000u >> e)))
+		e++;
+	return uint16_t(((e << 11) | ((z >> z_shift[e]) & 0x7ff)) << 2);
+}
+
+// ---------------------------------------------------------------------------
+// Texturing
+// ---------------------------------------------------------------------------
+
+static Color tlut_entry(const SoftRdpState &st, const uint8_t *tmem, uint32_t index)
+{
+	// Entries live in the upper half, one per 64-bit word.
+	const uint32_t address = 2048 + (index & 0xff) * 8;
+	const uint32_t v = (uint32_t(tmem[address]) << 8) | tmem[address + 1];
+	if ((st.modes_hi >> 14) & 1)
+		return { int(v >> 8), int(v >> 8), int(v >> 8), int(v & 0xff) };
+	return unpack_rgba16(v);
+}
+
+static Color fetch_texel(const SoftRdpState &st, const uint8_t *tmem, const SoftRdpTile &tile, uint32_t s, uint32_t t)
+{
+	const uint32_t mask = SOFT_RDP_TMEM_SIZE - 1;
+	const uint32_t base = tile.tmem * 8;
+	const uint32_t stride = tile.line * 8;
+	const bool tlut = (st.modes_hi >> 15) & 1;
+
+	switch (tile.size)
+	{
+	case 0:
+	{
+		const uint8_t byte = tmem[(base + t * stride + (s >> 1)) & mask];
+		const uint32_t nibble = (s & 1) ? (byte & 0xf) : (byte >> 4);
+		if (tlut)
+			return tlut_entry(st, tmem, (tile.palette << 4) | nibble);
+		if (tile.format == FORMAT_IA)
+			return { int(nibble >> 1) * 255 / 7, int(nibble >> 1) * 255 / 7, int(nibble >> 1) * 255 / 7,
+			         (nibble & 1) ? 255 : 0 };
+		return gray(int(nibble) * 17);
+	}
+	case 1:
+	{
+		const uint8_t byte = tmem[(base + t * stride + s) & mask];
+		if (tlut)
+			return tlut_entry(st, tmem, byte);
+		if (tile.format == FORMAT_IA)
+			return { (byte >> 4) * 17, (byte >> 4) * 17, (byte >> 4) * 17, (byte & 0xf) * 17 };
+		return gray(byte);
+	}
+	case 2:
+	{
+		const uint32_t address = (base + t * stride + s * 2) & mask;
+		const uint32_t v = (uint32_t(tmem[address]) << 8) | tmem[(address + 1) & mask];
+		if (tile.format == FORMAT_IA)
+			return { int(v >> 8), int(v >> 8), int(v >> 8), int(v & 0xff) };
+		if (tile.format == FORMAT_YUV)
+			return gray(int(v >> 8));
+		return unpack_rgba16(v);
+	}
+	default:
+	{
+		// 32-bit rows are twice the tile line (the hardware splits them
+		// across both TMEM halves).
+		const uint32_t address = (base + t * stride * 2 + s * 4) & mask;
+		return { tmem[address], tmem[(address + 1) & mask], tmem[(address + 2) & mask], tmem[(address + 3) & mask] };
+	}
+	}
+}
+
+// c: texel coordinate in 10.5. lo/hi: tile bounds in 10.2. Returns the
+// texel index after shift, clamp and mirror/wrap.
+static uint32_t tile_coord(int32_t c, uint32_t shift, uint32_t lo, uint32_t hi, bool clamp, bool mirror,
+                           uint32_t mask)
+{
+	if (shift < 11)
+		c >>= shift;
+	else
+		c <<= 16 - shift;
+	int32_t texel = (c - int32_t(lo << 3)) >> 5;
+
+	if (clamp || mask == 0)
+	{
+		const int32_t max = (int32_t(hi) - int32_t(lo)) >> 2;
+		if (texel < 0)
+			texel = 0;
+		else if (max >= 0 && texel > max)
+			texel = max;
+	}
+	if (mask)
+	{
+		const uint32_t bits = mask > 10 ? 10 : mask;
+		if (mirror && (texel & (1 << bits)))
+			texel = ~texel;
+		texel &= (1 << bits) - 1;
+	}
+	return uint32_t(texel);
+}
+
+static Color sample_tile(const SoftRdpState &st, const uint8_t *tmem, uint32_t tile_index, int32_t s, int32_t t)
+{
+	const SoftRdpTile &tile = st.tiles[tile_index & 7];
+	const uint32_t ts = tile_coord(s, tile.shift_s, tile.sl, tile.sh, tile.clamp_s, tile.mirror_s, tile.mask_s);
+	const uint32_t tt = tile_coord(t, tile.shift_t, tile.tl, tile.th, tile.clamp_t, tile.mirror_t, tile.mask_t);
+	return fetch_texel(st, tmem, tile, ts, tt);
+}
+
+// ---------------------------------------------------------------------------
+// Color combiner and blender
+// ---------------------------------------------------------------------------
+
+struct CombineInputs
+{
+	Color combined, tex0, tex1, prim, shade, env;
+	int prim_lod_frac;
+	int noise;
+};
+
+static Color combine_color(const CombineInputs &in, unsigned sel)
+{
+	switch (sel)
+	{
+	case 0:
+		return in.combined;
+	case 1:
+		return in.tex0;
+	case 2:
+		return in.tex1;
+	case 3:
+		return in.prim;
+	case 4:
+		return in.shade;
+	case 5:
+		return in.env;
+	default:
+		return gray(0);
+	}
+}
+
+static Color combine_sub_a(const CombineInputs &in, unsigned sel)
+{
+	if (sel == 6)
+		return gray(255);
+	if (sel == 7)
+		return gray(in.noise);
+	return combine_color(in, sel);
+}
+
+// Key center and K4 (6, 7) read as zero.
+static Color combine_sub_b(const CombineInputs &in, unsigned sel)
+{
+	return combine_color(in, sel);
+}
+
+static Color combine_mul(const CombineInputs &in, unsigned sel)
+{
+	switch (sel)
+	{
+	case 7:
+		return gray(in.combined.a);
+	case 8:
+		return gray(in.tex0.a);
+	case 9:
+		return gray(in.tex1.a);
+	case 10:
+		return gray(in.prim.a);
+	case 11:
+		return gray(in.shade.a);
+	case 12:
+		return gray(in.env.a);
+	case 14:
+		return gray(in.prim_lod_frac);
+	default:
+		// Key scale, LOD fraction and K5 read as zero.
+		return combine_color(in, sel);
+	}
+}
+
+static Color combine_add(const CombineInputs &in, unsigned sel)
+{
+	return sel == 6 ? gray(255) : combine_color(in, sel);
+}
+
+static int combine_alpha(const CombineInputs &in, unsigned sel)
+{
+	switch (sel)
+	{
+	case 0:
+		return in.combined.a;
+	case 1:
+		return in.tex0.a;
+	case 2:
+		return in.tex1.a;
+	case 3:
+		return in.prim.a;
+	case 4:
+		return in.shade.a;
+	case 5:
+		return in.env.a;
+	case 6:
+		return 255;
+	default:
+		return 0;
+	}
+}
+
+static int combine_alpha_mul(const CombineInputs &in, unsigned sel)
+{
+	if (sel == 0)
+		return 0; // LOD fraction
+	if (sel == 6)
+		return in.prim_lod_frac;
+	return sel == 7 ? 0 : combine_alpha(in, sel);
+}
+
+// (a - b) * c + d with c in 0..255 standing for 0..1.
+static inline int combine_op(int a, int b, int c, int d)
+{
+	c += c >> 7;
+	return clamp8(((a - b) * c + (d << 8) + 0x80) >> 8);
+}
+
+static Color combine_cycle(const SoftRdpCombineCycle &cc, const CombineInputs &in)
+{
+	const Color a = combine_sub_a(in, cc.sub_a_rgb);
+	const Color b = combine_sub_b(in, cc.sub_b_rgb);
+	const Color c = combine_mul(in, cc.mul_rgb);
+	const Color d = combine_add(in, cc.add_rgb);
+	return {
+		combine_op(a.r, b.r, c.r, d.r),
+		combine_op(a.g, b.g, c.g, d.g),
+		combine_op(a.b, b.b, c.b, d.b),
+		combine_op(combine_alpha(in, cc.sub_a_alpha), combine_alpha(in, cc.sub_b_alpha),
+		           combine_alpha_mul(in, cc.mul_alpha), combine_alpha(in, cc.add_alpha)),
+	};
+}
+
+static SoftRdpCombineCycle decode_combine(uint32_t hi, uint32_t lo, unsigned cycle)
+{
+	SoftRdpCombineCycle cc;
+	if (cycle == 0)
+	{
+		cc.sub_a_rgb = (hi >> 20) & 0xf;
+		cc.mul_rgb = (hi >> 15) & 0x1f;
+		cc.sub_a_alpha = (hi >> 12) & 7;
+		cc.mul_alpha = (hi >> 9) & 7;
+		cc.sub_b_rgb = (lo >> 28) & 0xf;
+		cc.add_rgb = (lo >> 15) & 7;
+		cc.sub_b_alpha = (lo >> 12) & 7;
+		cc.add_alpha = (lo >> 9) & 7;
+	}
+	else
+	{
+		cc.sub_a_rgb = (hi >> 5) & 0xf;
+		cc.mul_rgb = hi & 0x1f;
+		cc.sub_b_rgb = (lo >> 24) & 0xf;
+		cc.sub_a_alpha = (lo >> 21) & 7;
+		cc.mul_alpha = (lo >> 18) & 7;
+		cc.add_rgb = (lo >> 6) & 7;
+		cc.sub_b_alpha = (lo >> 3) & 7;
+		cc.add_alpha = lo & 7;
+	}
+	return cc;
+}
+
+// One blender cycle: (P * A + M * B) / 1.0, the force-blend formula.
+// pixel is the combiner output (cycle 0) or the first cycle's result.
+static Color blend_cycle(const SoftRdpState &st, unsigned cycle, const Color &pixel, const Color &memory,
+                         int shade_alpha, bool blend)
+{
+	const uint32_t shift = cycle ? 0 : 2;
+	const uint32_t m1a = (st.modes_lo >> (28 + shift)) & 3;
+	const uint32_t m1b = (st.modes_lo >> (24 + shift)) & 3;
+	const uint32_t m2a = (st.modes_lo >> (20 + shift)) & 3;
+	const uint32_t m2b = (st.modes_lo >> (16 + shift)) & 3;
+
+	const Color fog = unpack_rgba32(st.fog_color);
+	const Color inputs[4] = { pixel, memory, unpack_rgba32(st.blend_color), fog };
+	const Color &p = inputs[m1a];
+	if (!blend)
+		return p;
+	const Color &m = inputs[m2a];
+
+	const int alphas[4] = { pixel.a, fog.a, shade_alpha, 0 };
+	const int a = alphas[m1b];
+	const int b = m2b == 0 ? 255 - a : (m2b == 1 ? memory.a : (m2b == 2 ? 255 : 0));
+	return {
+		clamp8((p.r * a + m.r * b + 127) / 255),
+		clamp8((p.g * a + m.g * b + 127) / 255),
+		clamp8((p.b * a + m.b * b + 127) / 255),
+		pixel.a,
+	};
+}
+
+// ---------------------------------------------------------------------------
+// Pixel pipeline
+// ---------------------------------------------------------------------------
+
+// Per-draw constants, decoded from the state snapshot once per band.
+struct Pipe
+{
+	const SoftRdp *r;
+	const SoftRdpState *st;
+	const uint8_t *tmem;
+	uint32_t cycle;
+	uint32_t bytes; // color image bytes per pixel
+	uint32_t tile;
+	bool textured;
+	bool persp;
+	bool z_compare;
+	bool z_update;
+	bool z_prim;
+	uint32_t z_mode;
+	bool force_blend;
+	bool alpha_compare;
+	bool dither_alpha;
+	Color prim, env;
+	int prim_lod_frac;
+	int alpha_threshold;
+};
+
+static Pipe make_pipe(const SoftRdp &r, const SoftRdpPrim &p)
+{
+	const SoftRdpState &st = r.states[p.state];
+	Pipe pp;
+	pp.r = &r;
+	pp.st = &st;
+	pp.tmem = r.tmems.empty() ? nullptr : &r.tmems[size_t(p.tmem) * SOFT_RDP_TMEM_SIZE];
+	pp.cycle = (st.modes_hi >> 20) & 3;
+	pp.bytes = pixel_bytes(st.color_size);
+	pp.tile = p.tile;
+	const bool rect = p.op == OP_TEXTURE_RECTANGLE || p.op == OP_TEXTURE_RECTANGLE_FLIP;
+	pp.textured = pp.tmem && (rect || (p.op >= OP_FILL_TRIANGLE && p.op <= OP_SHADE_TEXTURE_Z_BUFFER_TRIANGLE &&
+	                                    (p.op & 2)));
+	pp.persp = !rect && ((st.modes_hi >> 19) & 1);
+	pp.z_compare = (st.modes_lo >> 4) & 1;
+	pp.z_update = (st.modes_lo >> 5) & 1;
+	// Rectangles carry no depth of their own.
+	pp.z_prim = rect || p.op == OP_FILL_RECTANGLE || ((st.modes_lo >> 2) & 1);
+	pp.z_mode = (st.modes_lo >> 10) & 3;
+	pp.force_blend = (st.modes_lo >> 14) & 1;
+	pp.alpha_compare = st.modes_lo & 1;
+	pp.dither_alpha = (st.modes_lo >> 1) & 1;
+	pp.prim = unpack_rgba32(st.prim_color);
+	pp.env = unpack_rgba32(st.env_color);
+	pp.prim_lod_frac = int(st.prim_lod_frac);
+	pp.alpha_threshold = int(st.blend_color & 0xff);
+	return pp;
+}
+
+static inline int pixel_noise(int32_t x, int32_t y)
+{
+	uint32_t h = uint32_t(x) * 0x9E3779B1u ^ uint32_t(y) * 0x85EBCA77u;
+	h ^= h >> 15;
+	return int((h * 0x2C1B3C6Du) >> 24);
+}
+
+static Color read_color(const Pipe &pp, uint32_t address)
+{
+	switch (pp.bytes)
+	{
+	case 4:
+		return unpack_rgba32(rdram_read32(*pp.r, address));
+	case 2:
+		return unpack_rgba16(rdram_read16(*pp.r, address));
+	default:
+		return gray(rdram_read8(*pp.r, address));
+	}
+}
+
+// alpha: coverage bit for 16bpp, alpha byte for 32bpp.
+static void write_color(const Pipe &pp, uint32_t address, const Color &c, int alpha)
+{
+	switch (pp.bytes)
+	{
+	case 4:
+		rdram_write32(*pp.r, address, (uint32_t(c.r) << 24) | (uint32_t(c.g) << 16) | (uint32_t(c.b) << 8) |
+		                                  uint32_t(alpha));
+		break;
+	case 2:
+		rdram_write16(*pp.r, address, pack_rgba16(c, alpha != 0));
+		break;
+	default:
+		rdram_write8(*pp.r, address, uint8_t(c.r));
+		break;
+	}
+}
+
+static void fill_pixel(const Pipe &pp, uint32_t address, int32_t x)
+{
+	const uint32_t fill = pp.st->fill_color;
+	switch (pp.bytes)
+	{
+	case 4:
+		rdram_write32(*pp.r, address, fill);
+		break;
+	case 2:
+		rdram_write16(*pp.r, address, uint16_t((x & 1) ? fill : fill >> 16));
+		break;
+	default:
+		rdram_write8(*pp.r, address, uint8_t(fill >> (8 * (3 - (x & 3)))));
+		break;
+	}
+}
+
+// attr: r, g, b, a, s, t, w, z at this pixel (s/t in 10.5 texels, z in
+// 18-bit units).
+static void shade_pixel(const Pipe &pp, int32_t x, int32_t y, const float *attr)
+{
+	const SoftRdpState &st = *pp.st;
+	const uint32_t index = uint32_t(y) * st.color_width + uint32_t(x);
+	const uint32_t address = st.color_address + index * pp.bytes;
+
+	if (pp.cycle == CYCLE_FILL)
+	{
+		fill_pixel(pp, address, x);
+		return;
+	}
+
+	CombineInputs in;
+	in.tex0 = in.tex1 = gray(0);
+	if (pp.textured)
+	{
+		float s = attr[4], t = attr[5];
+		if (pp.persp)
+		{
+			const float w = attr[6] > 1.0f ? attr[6] : 1.0f;
+			s = s * 32768.0f / w;
+			t = t * 32768.0f / w;
+		}
+		const int32_t si = int32_t(floorf(s)), ti = int32_t(floorf(t));
+		in.tex0 = sample_tile(st, pp.tmem, pp.tile, si, ti);
+		in.tex1 = pp.cycle == CYCLE_2 ? sample_tile(st, pp.tmem, pp.tile + 1, si, ti) : in.tex0;
+	}
+
+	if (pp.cycle == CYCLE_COPY)
+	{
+		if (pp.alpha_compare && in.tex0.a == 0)
+			return;
+		write_color(pp, address, in.tex0, pp.bytes == 4 ? in.tex0.a : in.tex0.a != 0);
+		return;
+	}
+
+	in.shade = { clamp8(int(attr[0])), clamp8(int(attr[1])), clamp8(int(attr[2])), clamp8(int(attr[3])) };
+	in.prim = pp.prim;
+	in.env = pp.env;
+	in.prim_lod_frac = pp.prim_lod_frac;
+	in.noise = pixel_noise(x, y);
+	in.combined = gray(0);
+
+	Color c;
+	if (pp.cycle == CYCLE_2)
+	{
+		in.combined = combine_cycle(st.combine[0], in);
+		c = combine_cycle(st.combine[1], in);
+	}
+	else
+	{
+		c = combine_cycle(st.combine[1], in);
+	}
+
+	if (pp.alpha_compare && c.a < (pp.dither_alpha ? in.noise : pp.alpha_threshold))
+		return;
+
+	if (pp.z_compare || pp.z_update)
+	{
+		const uint32_t z_address = st.depth_address + index * 2;
+		int32_t z = pp.z_prim ? int32_t(st.prim_z) : int32_t(attr[7]);
+		z = z < 0 ? 0 : (z > 0x3ffff ? 0x3ffff : z);
+		if (pp.z_compare)
+		{
+			const int32_t old_z = int32_t(z_decompress(rdram_read16(*pp.r, z_address)));
+			bool pass;
+			switch (pp.z_mode)
+			{
+			case 1: // interpenetrating
+				pass = z <= old_z;
+				break;
+			case 3: // decal
+				pass = std::abs(z - old_z) <= 0x40;
+				break;
+			default:
+				pass = z < old_z;
+				break;
+			}
+			if (!pass)
+				return;
+		}
+		if (pp.z_update)
+			rdram_write16(*pp.r, z_address, z_compress(uint32_t(z)));
+	}
+
+	const Color memory = read_color(pp, address);
+	if (pp.cycle == CYCLE_2)
+	{
+		const Color first = blend_cycle(st, 0, c, memory, in.shade.a, true);
+		c = blend_cycle(st, 1, first, memory, in.shade.a, pp.force_blend);
+	}
+	else
+	{
+		c = blend_cycle(st, 0, c, memory, in.shade.a, pp.force_blend);
+	}
+	// Full coverage: alpha bit set for 16bpp, coverage 7 for 32bpp.
+	write_color(pp, address, c, pp.bytes == 4 ? 0xe0 : 1);
+}
+
+// ---------------------------------------------------------------------------
+// Rasterization
+// ---------------------------------------------------------------------------
+
+static void draw_rectangle(const Pipe &pp, const SoftRdpPrim &p, int32_t y0, int32_t y1, int32_t x0, int32_t x1)
+{
+	float attr[8] = {};
+	for (int32_t y = y0; y < y1; y++)
+	{
+		const float dy = float(y - p.rect_y0);
+		for (int32_t x = x0; x < x1; x++)
+		{
+			const float dx = float(x - p.rect_x0);
+			if (p.flip)
+			{
+				attr[4] = p.rect_s + p.rect_dsdx * dy;
+				attr[5] = p.rect_t + p.rect_dtdy * dx;
+			}
+			else
+			{
+				attr[4] = p.rect_s + p.rect_dsdx * dx;
+				attr[5] = p.rect_t + p.rect_dtdy * dy;
+			}
+			shade_pixel(pp, x, y, attr);
+		}
+	}
+}
+
+static void draw_triangle(const Pipe &pp, const SoftRdpPrim &p, int32_t y0, int32_t y1, int32_t clip_x0,
+                          int32_t clip_x1)
+{
+	const float y_top = float(p.yh >> 2);
+	const float y_mid = float(p.ym) * 0.25f;
+	float attr[8];
+
+	for (int32_t y = y0; y < y1; y++)
+	{
+		// Span of the four subscanlines of this row that are inside the triangle.
+		float lo = 1e30f, hi = -1e30f;
+		for (int32_t k = 0; k < 4; k++)
+		{
+			const int32_t sy = y * 4 + k;
+			if (sy < p.yh || sy >= p.yl)
+				continue;
+			const float fy = float(sy) * 0.25f;
+			const float major = p.xh + p.dxhdy * (fy - y_top);
+			const float minor = sy < p.ym ? p.xm + p.dxmdy * (fy - y_top) : p.xl + p.dxldy * (fy - y_mid);
+			lo = std::min(lo, std::min(major, minor));
+			hi = std::max(hi, std::max(major, minor));
+		}
+		if (hi <= lo)
+			continue;
+
+		int32_t x0 = int32_t(floorf(lo + 0.5f));
+		int32_t x1 = int32_t(floorf(hi + 0.5f));
+		if (x1 == x0)
+			x1 = x0 + 1; // keep slivers visible
+		x0 = std::max(x0, clip_x0);
+		x1 = std::min(x1, clip_x1);
+		if (x1 <= x0)
+			continue;
+
+		const float dy = float(y) - p.y_ref;
+		const float dx = float(x0) - p.x_ref;
+		for (int i = 0; i < 8; i++)
+			attr[i] = p.base[i] + p.dy[i] * dy + p.dx[i] * dx;
+		for (int32_t x = x0; x < x1; x++)
+		{
+			shade_pixel(pp, x, y, attr);
+			for (int i = 0; i < 8; i++)
+				attr[i] += p.dx[i];
+		}
+	}
+}
+
+static void draw_prim(const SoftRdp &r, const SoftRdpPrim &p, int32_t band_y0, int32_t band_y1)
+{
+	const SoftRdpState &st = r.states[p.state];
+	const int32_t y0 = std::max({ p.y0, band_y0, int32_t(st.scissor_y0 >> 2) });
+	const int32_t y1 = std::min({ p.y1, band_y1, int32_t(st.scissor_y1 >> 2) });
+	if (y1 <= y0 || !pixel_bytes(st.color_size))
+		return;
+
+	const Pipe pp = make_pipe(r, p);
+	const int32_t clip_x0 = int32_t(st.scissor_x0 >> 2);
+	const int32_t clip_x1 = std::min(int32_t(st.scissor_x1 >> 2), int32_t(st.color_width));
+	if (p.op >= OP_FILL_TRIANGLE && p.op <= OP_SHADE_TEXTURE_Z_BUFFER_TRIANGLE)
+		draw_triangle(pp, p, y0, y1, clip_x0, clip_x1);
+	else
+		draw_rectangle(pp, p, y0, y1, std::max(p.rect_x0, clip_x0), std::min(p.rect_x1, clip_x1));
+}
+
+static void run_bands(SoftRdpWorkers &w)
+{
+	const SoftRdp &r = *w.rdp;
+	for (;;)
+	{
+		const int32_t band = w.next_band.fetch_add(1);
+		if (band >= w.band_count)
+			return;
+		const int32_t y0 = r.rows_begin + band * SOFT_RDP_BAND_ROWS;
+		const int32_t y1 = std::min(y0 + SOFT_RDP_BAND_ROWS, r.rows_end);
+		for (const SoftRdpPrim &p : r.prims)
+			if (p.y1 > y0 && p.y0 < y1)
+				draw_prim(r, p, y0, y1);
+	}
+}
+
+static void worker_main(SoftRdpWorkers *w, unsigned index)
+{
+	const SoftRdp &r = *w->rdp;
+	if (r.thread_started)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "soft-rdp-%u", index);
+		r.thread_started(name);
+	}
+
+	uint64_t seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> hold(w->lock);
+			w->wake.wait(hold, [&] { return w->quit || w->generation != seen; });
+			if (w->quit)
+				break;
+			seen = w->generation;
+		}
+		run_bands(*w);
+		{
+			std::lock_guard<std::mutex> hold(w->lock);
+			if (--w->running == 0)
+				w->done.notify_one();
+		}
+	}
+
+	if (r.thread_stopped)
+		r.thread_stopped();
+}
+
+// ---------------------------------------------------------------------------
+// Command decoding
+// ---------------------------------------------------------------------------
+
+static inline int32_t sext14(uint32_t v)
+{
+	return int32_t(v << 18) >> 18;
+}
+
+static inline float fixed16(uint32_t v)
+{
+	return float(int32_t(v)) * (1.0f / 65536.0f);
+}
+
+// Shade and texture blocks: 16 words holding four channels as integer
+// parts, d/dx integer, fractions, d/dx fractions, d/de integer, d/dy
+// integer, d/de fractions, d/dy fractions (two 16-bit halves per word).
+static void decode_attributes(const uint32_t *w, float *base, float *dx, float *de, unsigned first, unsigned count)
+{
+	for (unsigned i = 0; i < count; i++)
+	{
+		const unsigned word = i >> 1;
+		const unsigned shift = (i & 1) ? 0 : 16;
+		auto value = [&](unsigned int_word, unsigned frac_word) {
+			const uint32_t hi = (w[int_word + word] >> shift) & 0xffff;
+			const uint32_t lo = (w[frac_word + word] >> shift) & 0xffff;
+			return fixed16((hi << 16) | lo);
+		};
+		base[first + i] = value(0, 4);
+		dx[first + i] = value(2, 6);
+		de[first + i] = value(8, 12);
+	}
+}
+
+static void mark_pending(SoftRdp &r, const SoftRdpPrim &p)
+{
+	const SoftRdpState &st = r.state;
+	const uint32_t stride = st.color_width * pixel_bytes(st.color_size);
+	uint32_t begin = st.color_address + uint32_t(p.y0) * stride;
+	uint32_t end = st.color_address + uint32_t(p.y1) * stride;
+	if ((st.modes_lo >> 5) & 1)
+	{
+		begin = std::min(begin, st.depth_address + uint32_t(p.y0) * st.color_width * 2);
+		end = std::max(end, st.depth_address + uint32_t(p.y1) * st.color_width * 2);
+	}
+	if (r.prims.size() == 1)
+	{
+		r.rows_begin = p.y0;
+		r.rows_end = p.y1;
+		r.pending_begin = begin;
+		r.pending_end = end;
+		return;
+	}
+	r.rows_begin = std::min(r.rows_begin, p.y0);
+	r.rows_end = std::max(r.rows_end, p.y1);
+	r.pending_begin = std::min(r.pending_begin, begin);
+	r.pending_end = std::max(r.pending_end, end);
+}
+
+// Appends a draw that sees the current state (and TMEM if it samples).
+static SoftRdpPrim &new_prim(SoftRdp &r, uint32_t op, bool textured)
+{
+	if (r.state_dirty || r.states.empty())
+	{
+		r.states.push_back(r.state);
+		r.state_dirty = false;
+	}
+	if (textured && (r.tmem_dirty || r.tmems.empty()))
+	{
+		r.tmems.insert(r.tmems.end(), r.tmem, r.tmem + SOFT_RDP_TMEM_SIZE);
+		r.tmem_dirty = false;
+	}
+	r.prims.emplace_back();
+	SoftRdpPrim &p = r.prims.back();
+	p.op = uint8_t(op);
+	p.state = uint32_t(r.states.size() - 1);
+	p.tmem = r.tmems.empty() ? 0 : uint32_t(r.tmems.size() / SOFT_RDP_TMEM_SIZE - 1);
+	return p;
+}
+
+static void finish_prim(SoftRdp &r, SoftRdpPrim &p)
+{
+	p.y0 = std::max({ p.y0, int32_t(r.state.scissor_y0 >> 2), 0 });
+	p.y1 = std::min(p.y1, int32_t(r.state.scissor_y1 >> 2));
+	if (p.y1 <= p.y0)
+	{
+		r.prims.pop_back();
+		return;
+	}
+	mark_pending(r, p);
+	if (r.prims.size() >= SOFT_RDP_MAX_PRIMS)
+		soft_rdp_flush(r);
+}
+
+static void decode_triangle(SoftRdp &r, uint32_t op, const uint32_t *w)
+{
+	SoftRdpPrim &p = new_prim(r, op, (op & 2) != 0);
+	p.tile = (w[0] >> 16) & 7;
+	p.yl = sext14(w[0]);
+	p.ym = sext14(w[1] >> 16);
+	p.yh = sext14(w[1]);
+	p.xl = fixed16(w[2]);
+	p.dxldy = fixed16(w[3]);
+	p.xh = fixed16(w[4]);
+	p.dxhdy = fixed16(w[5]);
+	p.xm = fixed16(w[6]);
+	p.dxmdy = fixed16(w[7]);
+	p.y0 = p.yh >> 2;
+	p.y1 = (p.yl + 3) >> 2;
+
+	// Attributes are given on the major edge at the first scanline and
+	// step by d/de along it; rewrite as d/dy against x_ref = xh.
+	p.x_ref = p.xh;
+	p.y_ref = float(p.yh >> 2);
+	float de[8] = {};
+	const uint32_t *attr = w + 8;
+	if (op & 4)
+	{
+		decode_attributes(attr, p.base, p.dx, de, 0, 4);
+		attr += 16;
+	}
+	if (op & 2)
+	{
+		decode_attributes(attr, p.base, p.dx, de, 4, 3);
+		attr += 16;
+	}
+	else
+	{
+		p.base[6] = 1.0f;
+	}
+	if (op & 1)
+	{
+		// Z, dz/dx, dz/de, dz/dy in s15.16; the pipeline uses 18 bits.
+		p.base[7] = fixed16(attr[0]) * 8.0f;
+		p.dx[7] = fixed16(attr[1]) * 8.0f;
+		de[7] = fixed16(attr[2]) * 8.0f;
+	}
+	for (int i = 0; i < 8; i++)
+		p.dy[i] = de[i] - p.dx[i] * p.dxhdy;
+
+	r.window.triangles++;
+	finish_prim(r, p);
+}
+
+static void decode_rectangle(SoftRdp &r, uint32_t op, const uint32_t *w)
+{
+	const bool textured = op != OP_FILL_RECTANGLE;
+	SoftRdpPrim &p = new_prim(r, op, textured);
+	const uint32_t xl = (w[0] >> 12) & 0xfff, yl = w[0] & 0xfff;
+	const uint32_t xh = (w[1] >> 12) & 0xfff, yh = w[1] & 0xfff;
+	const uint32_t cycle = (r.state.modes_hi >> 20) & 3;
+
+	// Fill and copy modes include the lower-right edge.
+	if (cycle == CYCLE_FILL || cycle == CYCLE_COPY)
+	{
+		p.rect_x0 = int32_t(xh >> 2);
+		p.rect_y0 = int32_t(yh >> 2);
+		p.rect_x1 = int32_t(xl >> 2) + 1;
+		p.rect_y1 = int32_t(yl >> 2) + 1;
+	}
+	else
+	{
+		p.rect_x0 = int32_t((xh + 3) >> 2);
+		p.rect_y0 = int32_t((yh + 3) >> 2);
+		p.rect_x1 = int32_t((xl + 3) >> 2);
+		p.rect_y1 = int32_t((yl + 3) >> 2);
+	}
+	p.y0 = p.rect_y0;
+	p.y1 = p.rect_y1;
+
+	if (textured)
+	{
+		p.tile = (w[1] >> 24) & 7;
+		p.flip = op == OP_TEXTURE_RECTANGLE_FLIP;
+		const float s = float(int16_t(w[2] >> 16));
+		const float t = float(int16_t(w[2] & 0xffff));
+		// s5.10 per pixel -> 10.5; copy mode moves four pixels per step.
+		p.rect_dsdx = float(int16_t(w[3] >> 16)) / 32.0f;
+		p.rect_dtdy = float(int16_t(w[3] & 0xffff)) / 32.0f;
+		if (cycle == CYCLE_COPY)
+			p.rect_dsdx *= 0.25f;
+		const float fx = float(p.rect_x0) - float(xh) * 0.25f;
+		const float fy = float(p.rect_y0) - float(yh) * 0.25f;
+		p.rect_s = s + p.rect_dsdx * (p.flip ? fy : fx);
+		p.rect_t = t + p.rect_dtdy * (p.flip ? fx : fy);
+	}
+
+	r.window.rectangles++;
+	finish_prim(r, p);
+}
+
+// Loads read RDRAM now; anything pending that may write it goes first.
+static void flush_if_pending_overlaps(SoftRdp &r, uint32_t begin, uint32_t end)
+{
+	if (!r.prims.empty() && begin < r.pending_end && r.pending_begin < end)
+		soft_rdp_flush(r);
+}
+
+static uint32_t texture_image_address(const SoftRdp &r, uint32_t s, uint32_t t)
+{
+	return r.texture_address + (((t * r.texture_width + s) << r.texture_size) >> 1);
+}
+
+static void load_tile(SoftRdp &r, const SoftRdpTile &tile)
+{
+	const uint32_t s0 = tile.sl >> 2, t0 = tile.tl >> 2, s1 = tile.sh >> 2, t1 = tile.th >> 2;
+	if (s1 < s0 || t1 < t0)
+		return;
+	const uint32_t row_bytes = std::min<uint32_t>((((s1 - s0 + 1) << r.texture_size) >> 1), SOFT_RDP_TMEM_SIZE);
+	const uint32_t stride = tile.line * 8 * (r.texture_size == 3 ? 2 : 1);
+	flush_if_pending_overlaps(r, texture_image_address(r, s0, t0), texture_image_address(r, s0, t1) + row_bytes);
+
+	for (uint32_t t = 0; t <= t1 - t0; t++)
+	{
+		const uint32_t src = texture_image_address(r, s0, t0 + t);
+		const uint32_t dst = tile.tmem * 8 + t * stride;
+		for (uint32_t i = 0; i < row_bytes; i++)
+			r.tmem[(dst + i) & (SOFT_RDP_TMEM_SIZE - 1)] = rdram_read8(r, src + i);
+	}
+	r.tmem_dirty = true;
+}
+
+static void load_block(SoftRdp &r, const SoftRdpTile &tile, uint32_t sl, uint32_t tl, uint32_t sh)
+{
+	if (sh < sl)
+		return;
+	const uint32_t bytes = std::min<uint32_t>((((sh - sl + 1) << r.texture_size) >> 1), SOFT_RDP_TMEM_SIZE);
+	const uint32_t src = texture_image_address(r, sl, tl);
+	flush_if_pending_overlaps(r, src, src + bytes);
+
+	const uint32_t dst = tile.tmem * 8;
+	for (uint32_t i = 0; i < bytes; i++)
+		r.tmem[(dst + i) & (SOFT_RDP_TMEM_SIZE - 1)] = rdram_read8(r, src + i);
+	r.tmem_dirty = true;
+}
+
+static void load_tlut(SoftRdp &r, const SoftRdpTile &tile, uint32_t sl, uint32_t sh)
+{
+	if (sh < sl)
+		return;
+	const uint32_t count = std::min<uint32_t>(sh - sl + 1, 256);
+	const uint32_t src = r.texture_address + sl * 2;
+	flush_if_pending_overlaps(r, src, src + count * 2);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const uint32_t dst = (tile.tmem * 8 + i * 8) & (SOFT_RDP_TMEM_SIZE - 2);
+		r.tmem[dst] = rdram_read8(r, src + i * 2);
+		r.tmem[dst + 1] = rdram_read8(r, src + i * 2 + 1);
+	}
+	r.tmem_dirty = true;
+}
+
+static void set_tile_size(SoftRdpTile &tile, const uint32_t *w)
+{
+	tile.sl = (w[0] >> 12) & 0xfff;
+	tile.tl = w[0] & 0xfff;
+	tile.sh = (w[1] >> 12) & 0xfff;
+	tile.th = w[1] & 0xfff;
+}
+
+static void decode_command(SoftRdp &r, const uint32_t *w)
+{
+	const uint32_t op = (w[0] >> 24) & 63;
+	SoftRdpState &st = r.state;
+
+	if (op >= OP_FILL_TRIANGLE && op <= OP_SHADE_TEXTURE_Z_BUFFER_TRIANGLE)
+	{
+		decode_triangle(r, op, w);
+		return;
+	}
+
+	switch (op)
+	{
+	case OP_TEXTURE_RECTANGLE:
+	case OP_TEXTURE_RECTANGLE_FLIP:
+	case OP_FILL_RECTANGLE:
+		decode_rectangle(r, op, w);
+		return;
+	case OP_SET_SCISSOR:
+		st.scissor_x0 = (w[0] >> 12) & 0xfff;
+		st.scissor_y0 = w[0] & 0xfff;
+		st.scissor_x1 = (w[1] >> 12) & 0xfff;
+		st.scissor_y1 = w[1] & 0xfff;
+		break;
+	case OP_SET_PRIM_DEPTH:
+		st.prim_z = ((w[1] >> 16) & 0x7fff) << 3;
+		break;
+	case OP_SET_OTHER_MODES:
+		st.modes_hi = w[0];
+		st.modes_lo = w[1];
+		break;
+	case OP_SET_TILE:
+	{
+		SoftRdpTile &tile = st.tiles[(w[1] >> 24) & 7];
+		tile.format = (w[0] >> 21) & 7;
+		tile.size = (w[0] >> 19) & 3;
+		tile.line = (w[0] >> 9) & 0x1ff;
+		tile.tmem = w[0] & 0x1ff;
+		tile.palette = (w[1] >> 20) & 0xf;
+		tile.clamp_t = (w[1] >> 19) & 1;
+		tile.mirror_t = (w[1] >> 18) & 1;
+		tile.mask_t = (w[1] >> 14) & 0xf;
+		tile.shift_t = (w[1] >> 10) & 0xf;
+		tile.clamp_s = (w[1] >> 9) & 1;
+		tile.mirror_s = (w[1] >> 8) & 1;
+		tile.mask_s = (w[1] >> 4) & 0xf;
+		tile.shift_s = w[1] & 0xf;
+		break;
+	}
+	case OP_SET_TILE_SIZE:
+		set_tile_size(st.tiles[(w[1] >> 24) & 7], w);
+		break;
+	case OP_LOAD_TILE:
+	{
+		SoftRdpTile &tile = st.tiles[(w[1] >> 24) & 7];
+		set_tile_size(tile, w);
+		load_tile(r, tile);
+		break;
+	}
+	case OP_LOAD_BLOCK:
+		load_block(r, st.tiles[(w[1] >> 24) & 7], (w[0] >> 12) & 0xfff, w[0] & 0xfff, (w[1] >> 12) & 0xfff);
+		return;
+	case OP_LOAD_TLUT:
+		load_tlut(r, st.tiles[(w[1] >> 24) & 7], ((w[0] >> 12) & 0xfff) >> 2, ((w[1] >> 12) & 0xfff) >> 2);
+		return;
+	case OP_SET_FILL_COLOR:
+		st.fill_color = w[1];
+		break;
+	case OP_SET_FOG_COLOR:
+		st.fog_color = w[1];
+		break;
+	case OP_SET_BLEND_COLOR:
+		st.blend_color = w[1];
+		break;
+	case OP_SET_PRIM_COLOR:
+		st.prim_color = w[1];
+		st.prim_lod_frac = w[0] & 0xff;
+		break;
+	case OP_SET_ENV_COLOR:
+		st.env_color = w[1];
+		break;
+	case OP_SET_COMBINE:
+		st.combine[0] = decode_combine(w[0], w[1], 0);
+		st.combine[1] = decode_combine(w[0], w[1], 1);
+		break;
+	case OP_SET_TEXTURE_IMAGE:
+		r.texture_address = w[1] & 0x00ffffff;
+		r.texture_size = (w[0] >> 19) & 3;
+		r.texture_width = (w[0] & 0x3ff) + 1;
+		return;
+	case OP_SET_MASK_IMAGE:
+	case OP_SET_COLOR_IMAGE:
+	{
+		// Bands are rows of one color image, so a new target starts a new flush.
+		const uint32_t address = w[1] & 0x00ffffff;
+		const bool changed = op == OP_SET_MASK_IMAGE
+		                         ? address != st.depth_address
+		                         : (address != st.color_address || ((w[0] >> 19) & 3) != st.color_size ||
+		                            (w[0] & 0x3ff) + 1 != st.color_width);
+		if (!changed)
+			return;
+		if (!r.prims.empty())
+			soft_rdp_flush(r);
+		if (op == OP_SET_MASK_IMAGE)
+		{
+			st.depth_address = address;
+		}
+		else
+		{
+			st.color_address = address;
+			st.color_size = (w[0] >> 19) & 3;
+			st.color_width = (w[0] & 0x3ff) + 1;
+		}
+		break;
+	}
+	default:
+		// Syncs, keys and YUV conversion
+		return;
+	}
+	r.state_dirty = true;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+bool soft_rdp_init(SoftRdp &r, uint8_t *rdram, uint32_t rdram_size, unsigned threads)
+{
+	if (!rdram || !rdram_size || (rdram_size & (rdram_size - 1)))
+	{
+		fprintf(stderr, "[soft_rdp] RDRAM size %u not supported\n", rdram_size);
+		return false;
+	}
+	r.rdram = rdram;
+	r.rdram_mask = rdram_size - 1;
+
+	if (threads == 0)
+	{
+		const long online = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = online > 0 ? unsigned(online) : 1;
+	}
+	r.threads = std::min<unsigned>(std::max<unsigned>(threads, 1), SOFT_RDP_MAX_THREADS);
+
+	r.workers = new SoftRdpWorkers;
+	r.workers->rdp = &r;
+	for (unsigned i = 1; i < r.threads; i++)
+		r.workers->threads.emplace_back(worker_main, r.workers, i);
+
+	r.prims.reserve(4096);
+	r.enabled = true;
+	fprintf(stderr, "[soft_rdp] Software RDP: %u threads, %d-row bands\n", r.threads, SOFT_RDP_BAND_ROWS);
+	return true;
+}
+
+void soft_rdp_enqueue(SoftRdp &r, unsigned num_commands, const unsigned *word_counts, const uint32_t *words)
+{
+	for (unsigned c = 0; c < num_commands; c++)
+	{
+		decode_command(r, words);
+		words += word_counts[c];
+	}
+	r.window.commands += num_commands;
+}
+
+void soft_rdp_flush(SoftRdp &r)
+{
+	if (r.prims.empty())
+		return;
+	const uint64_t start_us = now_us();
+
+	SoftRdpWorkers &w = *r.workers;
+	w.band_count = (r.rows_end - r.rows_begin + SOFT_RDP_BAND_ROWS - 1) / SOFT_RDP_BAND_ROWS;
+	w.next_band.store(0);
+	if (w.threads.empty() || w.band_count < 2)
+	{
+		run_bands(w);
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> hold(w.lock);
+			w.running = unsigned(w.threads.size());
+			w.generation++;
+		}
+		w.wake.notify_all();
+		run_bands(w);
+		std::unique_lock<std::mutex> hold(w.lock);
+		w.done.wait(hold, [&] { return w.running == 0; });
+	}
+
+	r.prims.clear();
+	r.states.clear();
+	r.tmems.clear();
+	r.state_dirty = true;
+	r.tmem_dirty = true;
+	r.window.flushes++;
+	r.window.raster_us += now_us() - start_us;
+}
+
+bool soft_rdp_scanout(SoftRdp &r, const ViLiteRegs &vi, unsigned &width, unsigned &height)
+{
+	width = height = 0;
+	ViLiteFrame f;
+	if (!vi_lite_frame(vi, f))
+		return false;
+
+	const uint64_t start_us = now_us();
+	const uint32_t w = f.width, h = f.height;
+	r.scanout.resize(size_t(w) * h);
+	for (uint32_t y = 0; y < h; y++)
+	{
+		uint32_t *out = &r.scanout[size_t(y) * w];
+		const uint32_t row = f.origin + y * f.line * f.pixel_bytes;
+		if (f.pixel_bytes == 4)
+		{
+			for (uint32_t x = 0; x < w; x++)
+			{
+				const uint32_t v = rdram_read32(r, row + x * 4);
+				// RGBA8 in memory order
+				out[x] = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | 0xff000000u;
+			}
+		}
+		else
+		{
+			for (uint32_t x = 0; x < w; x++)
+			{
+				const Color c = unpack_rgba16(rdram_read16(r, row + x * 2));
+				out[x] = uint32_t(c.r) | (uint32_t(c.g) << 8) | (uint32_t(c.b) << 16) | 0xff000000u;
+			}
+		}
+	}
+	width = w;
+	height = h;
+	r.window.scanout_us += now_us() - start_us;
+	return true;
+}
+
+static void add_counters(SoftRdpCounters &dst, const SoftRdpCounters &src)
+{
+	dst.commands += src.commands;
+	dst.triangles += src.triangles;
+	dst.rectangles += src.rectangles;
+	dst.flushes += src.flushes;
+	dst.raster_us += src.raster_us;
+	dst.scanout_us += src.scanout_us;
+}
+
+void soft_rdp_window(SoftRdp &r, double elapsed_s, uint32_t frames)
+{
+	if (!r.enabled)
+		return;
+	const SoftRdpCounters &w = r.window;
+	const double f = frames ? double(frames) : 1.0;
+	fprintf(stderr, "[soft_rdp] threads=%u tris/frame=%.0f rects/frame=%.0f flushes/frame=%.1f "
+	                "raster_ms/frame=%.2f scanout_ms/frame=%.2f busy=%.0f%%\n",
+	        r.threads, double(w.triangles) / f, double(w.rectangles) / f, double(w.flushes) / f,
+	        double(w.raster_us) / (1000.0 * f), double(w.scanout_us) / (1000.0 * f),
+	        elapsed_s > 0.0 ? double(w.raster_us) / (elapsed_s * 10000.0) : 0.0);
+	add_counters(r.total, r.window);
+	r.window = SoftRdpCounters();
+}
+
+void soft_rdp_report(const SoftRdp &r)
+{
+	if (!r.enabled)
+		return;
+	SoftRdpCounters t = r.total;
+	add_counters(t, r.window);
+	fprintf(stderr, "[soft_rdp] threads=%u commands=%llu triangles=%llu rectangles=%llu flushes=%llu "
+	                "raster_ms=%.1f scanout_ms=%.1f\n",
+	        r.threads, (unsigned long long)t.commands, (unsigned long long)t.triangles,
+	        (unsigned long long)t.rectangles, (unsigned long long)t.flushes,
+	        double(t.raster_us) / 1000.0, double(t.scanout_us) / 1000.0);
+}
+
+void soft_rdp_cleanup(SoftRdp &r)
+{
+	if (r.workers)
+	{
+		{
+			std::lock_guard<std::mutex> hold(r.workers->lock);
+			r.workers->quit = true;
+		}
+		r.workers->wake.notify_all();
+		for (auto &t : r.workers->threads)
+			t.join();
+		delete r.workers;
+		r.workers = nullptr;
+	}
+	r.prims = std::vector<SoftRdpPrim>();
+	r.states = std::vector<SoftRdpState>();
+	r.tmems = std::vector<uint8_t>();
+	r.scanout = std::vector<uint32_t>();
+	r.enabled = false;
+}
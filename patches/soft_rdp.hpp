@@ -0,0 +1,174 @@
+/*
+ * Software RDP for tg5050
+ *
+ * A CPU rasterizer fed by the same command stream as parallel-rdp, used
+ * when Vulkan is unusable (or forced with G64_SOFT_RDP=1) and as a CPU-side
+ * comparison point. It writes color and depth straight into RDRAM, so the
+ * VI-lite scanout below reads the result the same way the core does.
+ *
+ * Commands are decoded on the emulation thread: state and TMEM loads are
+ * applied in order, draws are recorded with a snapshot of the state and
+ * TMEM they saw. At a flush the recorded draws are replayed by a small
+ * thread pool, each thread taking horizontal bands of the color image and
+ * running every draw clipped to its band, so per-pixel order is preserved
+ * without locks.
+ *
+ * Covered: fill, copy, 1- and 2-cycle modes; fill/texture rectangles and
+ * all eight triangle types; the color combiner, blender, alpha compare and
+ * compressed Z; RGBA, IA, I and CI textures (point sampled, TLUT, clamp,
+ * wrap and mirror). Not covered: anti-aliasing, dithering, bilinear
+ * filtering, LOD/mipmaps, YUV and the VI filters.
+ *
+ * Usage: init() -> enqueue() per command run -> flush() at SyncFull and
+ *        before scanout -> scanout() per frame -> window()/report() ->
+ *        cleanup()
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vi_lite.hpp"
+
+#define SOFT_RDP_MAX_THREADS 8
+// Rows per unit of work handed to a thread
+#define SOFT_RDP_BAND_ROWS 16
+#define SOFT_RDP_TMEM_SIZE 4096
+
+struct SoftRdpTile
+{
+	uint32_t format = 0;
+	uint32_t size = 0;
+	uint32_t line = 0; // 64-bit words per row
+	uint32_t tmem = 0; // 64-bit word address
+	uint32_t palette = 0;
+	bool clamp_s = false, mirror_s = false, clamp_t = false, mirror_t = false;
+	uint32_t mask_s = 0, shift_s = 0, mask_t = 0, shift_t = 0;
+	uint32_t sl = 0, tl = 0, sh = 0, th = 0; // 10.2
+};
+
+struct SoftRdpCombineCycle
+{
+	uint8_t sub_a_rgb, sub_b_rgb, mul_rgb, add_rgb;
+	uint8_t sub_a_alpha, sub_b_alpha, mul_alpha, add_alpha;
+};
+
+// Everything a draw reads besides TMEM.
+struct SoftRdpState
+{
+	uint32_t modes_hi = 0; // SetOtherModes words
+	uint32_t modes_lo = 0;
+	SoftRdpCombineCycle combine[2] = {};
+	uint32_t fill_color = 0;
+	uint32_t fog_color = 0;
+	uint32_t blend_color = 0;
+	uint32_t prim_color = 0;
+	uint32_t env_color = 0;
+	uint32_t prim_lod_frac = 0;
+	uint32_t prim_z = 0; // 18-bit
+	uint32_t scissor_x0 = 0, scissor_y0 = 0, scissor_x1 = 0, scissor_y1 = 0; // 10.2
+	uint32_t color_address = 0;
+	uint32_t color_size = 2; // 0: 4bpp ... 3: 32bpp
+	uint32_t color_width = 320;
+	uint32_t depth_address = 0;
+	SoftRdpTile tiles[8];
+};
+
+// A draw, decoded once on the emulation thread. Edges and attributes are
+// in pixels; attribute i is base[i] + dx[i] * (x - x_ref) + dy[i] * (y - y_ref).
+struct SoftRdpPrim
+{
+	uint8_t op = 0;
+	uint8_t tile = 0;
+	bool flip = false; // TextureRectangleFlip
+	uint32_t state = 0;
+	uint32_t tmem = 0;
+	int32_t y0 = 0, y1 = 0; // rows touched, [y0, y1)
+
+	// Rectangles (pixel bounds [x0, x1) x [y0, y1); s/t at the first pixel
+	// and their per-pixel steps, in 10.5 texels)
+	int32_t rect_x0 = 0, rect_y0 = 0, rect_x1 = 0, rect_y1 = 0;
+	float rect_s = 0.0f, rect_t = 0.0f, rect_dsdx = 0.0f, rect_dtdy = 0.0f;
+
+	// Triangles (y in quarter lines)
+	int32_t yh = 0, ym = 0, yl = 0;
+	float xh = 0.0f, dxhdy = 0.0f, xm = 0.0f, dxmdy = 0.0f, xl = 0.0f, dxldy = 0.0f;
+	float x_ref = 0.0f, y_ref = 0.0f;
+	// r, g, b, a, s, t, w, z
+	float base[8] = {};
+	float dx[8] = {};
+	float dy[8] = {};
+};
+
+struct SoftRdpCounters
+{
+	uint64_t commands = 0;
+	uint64_t triangles = 0;
+	uint64_t rectangles = 0;
+	uint64_t flushes = 0;
+	uint64_t raster_us = 0;  // wall time spent in flushes
+	uint64_t scanout_us = 0;
+};
+
+struct SoftRdpWorkers;
+
+struct SoftRdp
+{
+	bool enabled = false;
+	uint8_t *rdram = nullptr;
+	uint32_t rdram_mask = 0; // RDRAM size is a power of two
+	unsigned threads = 1;    // including the emulation thread
+
+	// Current state, and whether draws already saw it
+	SoftRdpState state;
+	uint8_t tmem[SOFT_RDP_TMEM_SIZE] = {};
+	bool state_dirty = true;
+	bool tmem_dirty = true;
+	uint32_t texture_address = 0; // SetTextureImage, only read by loads
+	uint32_t texture_size = 0;
+	uint32_t texture_width = 1;
+
+	// Pending draws and their snapshots
+	std::vector<SoftRdpPrim> prims;
+	std::vector<SoftRdpState> states;
+	std::vector<uint8_t> tmems; // SOFT_RDP_TMEM_SIZE bytes each
+	// Rows covered by pending draws, and the RDRAM they may write (bytes,
+	// [begin, end)) so a load from it flushes first
+	int32_t rows_begin = 0;
+	int32_t rows_end = 0;
+	uint32_t pending_begin = 0;
+	uint32_t pending_end = 0;
+
+	std::vector<uint32_t> scanout; // RGBA8 for the display path
+	SoftRdpWorkers *workers = nullptr;
+	// Optional, set before init(): called on each worker thread as it
+	// starts and right before it exits (stall watchdog registration).
+	void (*thread_started)(const char *name) = nullptr;
+	void (*thread_stopped)() = nullptr;
+
+	SoftRdpCounters total;
+	SoftRdpCounters window;
+};
+
+// threads == 0 picks one per online CPU (at most SOFT_RDP_MAX_THREADS).
+bool soft_rdp_init(SoftRdp &r, uint8_t *rdram, uint32_t rdram_size, unsigned threads);
+
+// Decode num_commands complete commands laid out back to back at words.
+void soft_rdp_enqueue(SoftRdp &r, unsigned num_commands, const unsigned *word_counts, const uint32_t *words);
+
+// Rasterize every pending draw into RDRAM. Returns when all are written.
+void soft_rdp_flush(SoftRdp &r);
+
+// Convert the VI framebuffer into r.scanout (native size, RGBA8).
+// Returns false while the VI is blank or misconfigured.
+bool soft_rdp_scanout(SoftRdp &r, const ViLiteRegs &vi, unsigned &width, unsigned &height);
+
+// Log the window as one "[soft_rdp]" line and start a new one.
+void soft_rdp_window(SoftRdp &r, double elapsed_s, uint32_t frames);
+
+// Session totals for the log.
+void soft_rdp_report(const SoftRdp &r);
+
+void soft_rdp_cleanup(SoftRdp &r);
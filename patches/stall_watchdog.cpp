@@ -0,0 +1,453 @@
+/*
+ * Slow-frame stack capture for tg5050
+ *
+ * The signal handler only follows the frame-pointer chain and makes plain
+ * stores into the thread's slot: no unwinder, no locks, no allocation.
+ * Every frame record it reads lies between the interrupted stack pointer
+ * and the top of the thread's stack, so a register that does not hold a
+ * frame pointer ends the walk instead of faulting. Address resolution with
+ * dladdr(), the flight recorder writes and the log line all happen on the
+ * watchdog thread.
+ */
+
+#include "stall_watchdog.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <mutex>
+#include <thread>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define STALL_WATCHDOG_SIGNAL SIGPROF
+// How long the watchdog waits for all threads to deliver their stacks.
+#define STALL_WATCHDOG_CAPTURE_TIMEOUT_US 20000ull
+
+struct StallWatchdogWorker
+{
+	std::thread thread;
+	std::mutex lock;
+	std::condition_variable wake;
+	bool quit = false;
+	uint32_t poll_us = 0;
+	// Held while claiming or releasing a slot and for a whole capture, so
+	// a slot cannot change hands while its stack is being collected.
+	std::mutex threads_lock;
+};
+
+static StallWatchdog *active_watchdog;
+static struct sigaction previous_action;
+
+uint64_t stall_watchdog_now_us()
+{
+	struct timespec ts = {};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000ull + uint64_t(ts.tv_nsec) / 1000ull;
+}
+
+static int32_t current_tid()
+{
+	return int32_t(syscall(SYS_gettid));
+}
+
+// The interrupted instruction, then the return address of each frame
+// record (saved frame pointer, return address) up the stack.
+static int32_t walk_frame_pointers(const ucontext_t *uc, uintptr_t stack_top, uintptr_t *pcs)
+{
+#if defined(__aarch64__)
+	const uintptr_t pc = uintptr_t(uc->uc_mcontext.pc);
+	const uintptr_t sp = uintptr_t(uc->uc_mcontext.sp);
+	uintptr_t fp = uintptr_t(uc->uc_mcontext.regs[29]);
+#elif defined(__x86_64__)
+	const uintptr_t pc = uintptr_t(uc->uc_mcontext.gregs[REG_RIP]);
+	const uintptr_t sp = uintptr_t(uc->uc_mcontext.gregs[REG_RSP]);
+	uintptr_t fp = uintptr_t(uc->uc_mcontext.gregs[REG_RBP]);
+#else
+	const uintptr_t pc = 0, sp = 0;
+	uintptr_t fp = 0;
+#endif
+	int32_t depth = 0;
+	if (!pc)
+		return 0;
+	pcs[depth++] = pc;
+	while (depth < STALL_WATCHDOG_MAX_DEPTH && fp >= sp && stack_top > 2 * sizeof(uintptr_t) &&
+	       fp <= stack_top - 2 * sizeof(uintptr_t) && !(fp & (sizeof(uintptr_t) - 1)))
+	{
+		const uintptr_t *record = reinterpret_cast<const uintptr_t *>(fp);
+		const uintptr_t next = record[0];
+		const uintptr_t ret = record[1];
+		if (!ret)
+			break;
+		pcs[depth++] = ret;
+		// Frames only get older going up; anything else is not a chain.
+		if (next <= fp)
+			break;
+		fp = next;
+	}
+	return depth;
+}
+
+static void stack_signal_handler(int, siginfo_t *, void *ucontext)
+{
+	int saved_errno = errno;
+	StallWatchdog *w = active_watchdog;
+	if (w)
+	{
+		const int32_t tid = current_tid();
+		for (uint32_t i = 0; i < STALL_WATCHDOG_MAX_THREADS; i++)
+		{
+			StallWatchdogThread &t = w->threads[i];
+			if (!__atomic_load_n(&t.active, __ATOMIC_ACQUIRE) || t.tid != tid)
+				continue;
+
+			t.depth = ucontext ? walk_frame_pointers(static_cast<const ucontext_t *>(ucontext),
+			                                         t.stack_top, t.pcs) : 0;
+			__atomic_store_n(&t.done, 1u, __ATOMIC_RELEASE);
+			break;
+		}
+	}
+	errno = saved_errno;
+}
+
+// Writes the innermost `limit` frames; the records keep the full depth
+// as their frame count, so a cut stack shows as one.
+static void write_stack(StallWatchdog &w, uint32_t frame, uint32_t slot, int32_t limit)
+{
+	const StallWatchdogThread &t = w.threads[slot];
+	const uint8_t frames = uint8_t(t.depth);
+	for (int32_t k = 0; k < t.depth && k < limit; k++)
+	{
+		const uintptr_t pc = t.pcs[k];
+		// Return addresses point after the call; step back into it so
+		// addr2line names the calling line. The innermost frame and the
+		// syscall return of a blocked thread are exact.
+		const uintptr_t lookup = k > 0 ? pc - 1 : pc;
+
+		Dl_info info = {};
+		if (!dladdr(reinterpret_cast<void *>(lookup), &info) || !info.dli_fbase)
+		{
+			flight_recorder_stack(*w.recorder, frame, t.tid, uint8_t(slot), uint8_t(k), frames,
+			                      false, lookup, "?");
+			continue;
+		}
+		if (info.dli_sname && info.dli_saddr)
+		{
+			flight_recorder_stack(*w.recorder, frame, t.tid, uint8_t(slot), uint8_t(k), frames,
+			                      true, lookup - uintptr_t(info.dli_saddr), info.dli_sname);
+			continue;
+		}
+		const char *module = info.dli_fname ? strrchr(info.dli_fname, '/') : nullptr;
+		module = module ? module + 1 : (info.dli_fname ? info.dli_fname : "?");
+		flight_recorder_stack(*w.recorder, frame, t.tid, uint8_t(slot), uint8_t(k), frames,
+		                      false, lookup - uintptr_t(info.dli_fbase), module);
+	}
+}
+
+// The user-space return address of a thread blocked in a system call, from
+// "nr args... sp pc" in /proc/self/task/<tid>/syscall. 0 while the thread
+// runs ("running"), is blocked outside a syscall ("-1 sp pc") or if the
+// file cannot be read.
+static uintptr_t blocked_syscall_pc(int32_t tid)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/self/task/%d/syscall", tid);
+	const int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return 0;
+	char text[256];
+	const ssize_t n = read(fd, text, sizeof(text) - 1);
+	close(fd);
+	if (n <= 0)
+		return 0;
+	text[n] = '\0';
+
+	char *end = nullptr;
+	const long nr = strtol(text, &end, 10);
+	if (end == text || nr < 0)
+		return 0;
+	const char *last = strrchr(text, ' ');
+	return last ? uintptr_t(strtoull(last + 1, nullptr, 16)) : 0;
+}
+
+// How many frames of each delivered stack fit in the capture's record
+// budget. The frame loop's thread goes first and keeps what the others'
+// first few frames leave, but at least half; the others split the rest.
+static void plan_stack_limits(const StallWatchdog &w, const bool *delivered, int32_t *limits)
+{
+	const int32_t min_share = 4;
+	int32_t budget = STALL_WATCHDOG_MAX_STACK_RECORDS;
+	int32_t reserved = 0;
+	uint32_t others = 0;
+	for (uint32_t i = 0; i < STALL_WATCHDOG_MAX_THREADS; i++)
+	{
+		if (!delivered[i] || w.threads[i].frame_loop)
+			continue;
+		reserved += std::min(w.threads[i].depth, min_share);
+		others++;
+	}
+
+	for (uint32_t i = 0; i < STALL_WATCHDOG_MAX_THREADS; i++)
+	{
+		if (!delivered[i] || !w.threads[i].frame_loop)
+			continue;
+		limits[i] = std::min(w.threads[i].depth, std::max(budget - reserved, budget / 2));
+		budget -= limits[i];
+	}
+	for (uint32_t i = 0; i < STALL_WATCHDOG_MAX_THREADS; i++)
+	{
+		if (!delivered[i] || w.threads[i].frame_loop)
+			continue;
+		limits[i] = std::min(w.threads[i].depth, std::max(budget / int32_t(others), std::min(budget, 1)));
+		budget -= limits[i];
+		others--;
+	}
+}
+
+static void capture(StallWatchdog &w, uint32_t frame, uint64_t elapsed_us, uint64_t now_us)
+{
+	const uint32_t stage = __atomic_load_n(&w.stage, __ATOMIC_ACQUIRE);
+	const uint64_t stage_start_us = __atomic_load_n(&w.stage_start_us, __ATOMIC_RELAXED);
+	const uint64_t stage_us = now_us > stage_start_us ? now_us - stage_start_us : 0;
+
+	std::lock_guard<std::mutex> hold(w.worker->threads_lock);
+	bool signaled[STALL_WATCHDOG_MAX_THREADS] = {};
+	uint32_t count = 0;
+	uint32_t waiting = 0;
+	uint32_t blocked = 0;
+	const pid_t pid = getpid();
+	for (uint32_t i = 0; i < STALL_WATCHDOG_MAX_THREADS; i++)
+	{
+		StallWatchdogThread &t = w.threads[i];
+		if (!t.active)
+			continue;
+		__atomic_store_n(&t.done, 0u, __ATOMIC_RELAXED);
+		t.depth = 0;
+		t.blocked = 0;
+		count++;
+		// Leave sleeping threads asleep: the signal would end the
+		// limiter's sleep early and shift the frame being measured.
+		const uintptr_t pc = blocked_syscall_pc(t.tid);
+		if (pc)
+		{
+			t.pcs[0] = pc;
+			t.depth = 1;
+			t.blocked = 1;
+			blocked++;
+			continue;
+		}
+		if (syscall(SYS_tgkill, pid, t.tid, STALL_WATCHDOG_SIGNAL) != 0)
+		{
+			fprintf(stderr, "[stall] tgkill(%s) failed: %s\n", t.name, strerror(errno));
+			continue;
+		}
+		signaled[i] = true;
+		waiting++;
+	}
+
+	uint32_t delivered = 0;
+	const uint64_t deadline_us = stall_watchdog_now_us() + STALL_WATCHDOG_CAPTURE_TIMEOUT_US;
+	for (;;)
+	{
+		delivered = 0;
+		for (uint32_t i = 0; i < STALL_WATCHDOG_MAX_THREADS; i++)
+			if (signaled[i])
+				delivered += __atomic_load_n(&w.threads[i].done, __ATOMIC_ACQUIRE);
+		if (delivered == waiting || stall_watchdog_now_us() >= deadline_us)
+			break;
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+
+	bool stacks[STALL_WATCHDOG_MAX_THREADS] = {};
+	for (uint32_t i = 0; i < STALL_WATCHDOG_MAX_THREADS; i++)
+		stacks[i] = w.threads[i].blocked ||
+		            (signaled[i] && __atomic_load_n(&w.threads[i].done, __ATOMIC_ACQUIRE));
+	int32_t limits[STALL_WATCHDOG_MAX_THREADS] = {};
+	plan_stack_limits(w, stacks, limits);
+
+	const FlightStage flight_stage = stage < FLIGHT_STAGES ? FlightStage(stage) : FLIGHT_STAGE_EMULATION;
+	flight_recorder_stall(*w.recorder, frame, flight_stage, elapsed_us, w.threshold_us, stage_us,
+	                      delivered + blocked);
+	for (uint32_t i = 0; i < STALL_WATCHDOG_MAX_THREADS; i++)
+		if (w.threads[i].frame_loop && stacks[i])
+			write_stack(w, frame, i, limits[i]);
+	for (uint32_t i = 0; i < STALL_WATCHDOG_MAX_THREADS; i++)
+		if (!w.threads[i].frame_loop && stacks[i])
+			write_stack(w, frame, i, limits[i]);
+
+	fprintf(stderr, "[stall] frame=%u at %.1fms in %s (%.1fms), %u/%u stacks (%u blocked)\n",
+	        frame, elapsed_us / 1000.0, flight_recorder_stage_names[flight_stage], stage_us / 1000.0,
+	        delivered + blocked, count, blocked);
+	w.captures++;
+}
+
+static void watchdog_thread(StallWatchdog *w)
+{
+	StallWatchdogWorker &worker = *w->worker;
+	std::unique_lock<std::mutex> hold(worker.lock);
+	while (!worker.quit)
+	{
+		worker.wake.wait_for(hold, std::chrono::microseconds(worker.poll_us));
+		if (worker.quit)
+			break;
+
+		const uint32_t frame = __atomic_load_n(&w->frame, __ATOMIC_ACQUIRE);
+		const uint64_t start_us = __atomic_load_n(&w->frame_start_us, __ATOMIC_RELAXED);
+		if (!start_us || frame == w->captured_frame)
+			continue;
+		const uint64_t now_us = stall_watchdog_now_us();
+		const uint64_t elapsed_us = now_us > start_us ? now_us - start_us : 0;
+		if (elapsed_us < w->threshold_us)
+			continue;
+		// The frame loop may have moved on while we were reading.
+		if (__atomic_load_n(&w->frame, __ATOMIC_ACQUIRE) != frame)
+			continue;
+
+		w->captured_frame = frame;
+		w->stalls++;
+		if (elapsed_us > w->max_elapsed_us)
+			w->max_elapsed_us = elapsed_us;
+		if (w->last_capture_us && now_us - w->last_capture_us < STALL_WATCHDOG_MIN_INTERVAL_US)
+		{
+			w->rate_limited++;
+			continue;
+		}
+		w->last_capture_us = now_us;
+
+		hold.unlock();
+		capture(*w, frame, elapsed_us, now_us);
+		hold.lock();
+	}
+}
+
+bool stall_watchdog_init(StallWatchdog &w, FlightRecorder &recorder, uint32_t threshold_ms)
+{
+	if (!flight_recorder_active(recorder))
+	{
+		fprintf(stderr, "[stall] Flight recorder not active, watchdog disabled\n");
+		return false;
+	}
+	if (active_watchdog)
+		return false;
+
+	struct sigaction sa = {};
+	sa.sa_sigaction = stack_signal_handler;
+	sa.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(STALL_WATCHDOG_SIGNAL, &sa, &previous_action) != 0)
+	{
+		fprintf(stderr, "[stall] sigaction failed: %s\n", strerror(errno));
+		return false;
+	}
+
+	w.threshold_us = (threshold_ms ? threshold_ms : STALL_WATCHDOG_DEFAULT_MS) * 1000u;
+	w.recorder = &recorder;
+	w.worker = new StallWatchdogWorker();
+	// Poll at a quarter of the threshold: captures land at most 25% late.
+	w.worker->poll_us = std::min(20000u, std::max(2000u, w.threshold_us / 4));
+	active_watchdog = &w;
+	__atomic_store_n(&w.enabled, true, __ATOMIC_RELEASE);
+	w.worker->thread = std::thread(watchdog_thread, &w);
+
+	fprintf(stderr, "[stall] Capturing stacks of frames over %.0fms (poll %.1fms)\n",
+	        w.threshold_us / 1000.0, w.worker->poll_us / 1000.0);
+	flight_recorder_event(recorder, 0, "stall watchdog %ums", w.threshold_us / 1000u);
+	return true;
+}
+
+bool stall_watchdog_register_thread(StallWatchdog &w, const char *name, bool frame_loop)
+{
+	if (!__atomic_load_n(&w.enabled, __ATOMIC_ACQUIRE))
+		return false;
+
+	// The frame-pointer walk never reads past the top of the stack.
+	uintptr_t stack_top = 0;
+	pthread_attr_t attr;
+	if (pthread_getattr_np(pthread_self(), &attr) == 0)
+	{
+		void *stack = nullptr;
+		size_t size = 0;
+		if (pthread_attr_getstack(&attr, &stack, &size) == 0)
+			stack_top = uintptr_t(stack) + size;
+		pthread_attr_destroy(&attr);
+	}
+
+	std::lock_guard<std::mutex> hold(w.worker->threads_lock);
+	for (uint32_t i = 0; i < STALL_WATCHDOG_MAX_THREADS; i++)
+	{
+		StallWatchdogThread &t = w.threads[i];
+		if (t.active)
+			continue;
+		t.tid = current_tid();
+		memset(t.name, 0, sizeof(t.name));
+		strncpy(t.name, name, sizeof(t.name) - 1);
+		t.stack_top = stack_top;
+		t.frame_loop = frame_loop;
+		t.blocked = 0;
+		__atomic_store_n(&t.active, 1u, __ATOMIC_RELEASE);
+		fprintf(stderr, "[stall] Watching thread %s (tid %d)\n", t.name, t.tid);
+		return true;
+	}
+	fprintf(stderr, "[stall] All %d thread slots taken, not watching %s\n", STALL_WATCHDOG_MAX_THREADS, name);
+	return false;
+}
+
+void stall_watchdog_unregister_thread(StallWatchdog &w)
+{
+	if (!__atomic_load_n(&w.enabled, __ATOMIC_ACQUIRE))
+		return;
+
+	std::lock_guard<std::mutex> hold(w.worker->threads_lock);
+	const int32_t tid = current_tid();
+	for (uint32_t i = 0; i < STALL_WATCHDOG_MAX_THREADS; i++)
+	{
+		StallWatchdogThread &t = w.threads[i];
+		if (!t.active || t.tid != tid)
+			continue;
+		__atomic_store_n(&t.active, 0u, __ATOMIC_RELEASE);
+		return;
+	}
+}
+
+void stall_watchdog_report(const StallWatchdog &w)
+{
+	if (!w.enabled)
+		return;
+	fprintf(stderr, "[stall] %llu frames over %.0fms (max %.1fms), %llu captured, %llu rate-limited\n",
+	        (unsigned long long)w.stalls, w.threshold_us / 1000.0, w.max_elapsed_us / 1000.0,
+	        (unsigned long long)w.captures, (unsigned long long)w.rate_limited);
+}
+
+void stall_watchdog_cleanup(StallWatchdog &w)
+{
+	if (!w.worker)
+		return;
+	__atomic_store_n(&w.enabled, false, __ATOMIC_RELEASE);
+
+	{
+		std::lock_guard<std::mutex> hold(w.worker->lock);
+		w.worker->quit = true;
+	}
+	w.worker->wake.notify_all();
+	if (w.worker->thread.joinable())
+		w.worker->thread.join();
+	delete w.worker;
+	w.worker = nullptr;
+
+	active_watchdog = nullptr;
+	// A request still pending for a thread that never got to run would
+	// otherwise kill the process under the default action.
+	if (!(previous_action.sa_flags & SA_SIGINFO) && previous_action.sa_handler == SIG_DFL)
+		previous_action.sa_handler = SIG_IGN;
+	sigaction(STALL_WATCHDOG_SIGNAL, &previous_action, nullptr);
+	w = StallWatchdog();
+}
@@ -0,0 +1,129 @@
+/*
+ * Slow-frame stack capture for tg5050
+ *
+ * A watchdog thread polls the frame loop's progress. When the current frame
+ * (rdp_render_frame() entry to the next entry) runs past the threshold, it
+ * signals every registered thread that is running; each one walks its own
+ * frame pointers in the signal handler. A thread blocked in a system call
+ * (the speed limiter's sleep, a condition wait) is not signaled, so the
+ * capture does not cut its wait short; its stack is the one return address
+ * the kernel reports in /proc/self/task/<tid>/syscall. The watchdog thread
+ * then resolves the addresses and writes a STALL record (stage and time
+ * spent so far) followed by STACK records into the flight recorder, at
+ * most STALL_WATCHDOG_MAX_STACK_RECORDS per capture, the frame loop's
+ * thread first. The frame's complete stage timings follow in its FRAME
+ * record once it ends.
+ *
+ * Stacks are module offsets (or exported symbol offsets) so they can be
+ * resolved with addr2line against the unstripped binaries. Code built
+ * without frame pointers ends the walk early; ./build.sh --frame-pointers
+ * keeps them. At most one capture is taken per frame and per
+ * STALL_WATCHDOG_MIN_INTERVAL_US, so a long hitch cannot flood the ring.
+ *
+ * The capture signal is SIGPROF with SA_RESTART. A thread that starts to
+ * sleep between the check and the signal can still see that one sleep end
+ * early. Do not combine with a SIGPROF-based profiler.
+ *
+ * Threads register themselves, at any time after init() and from any
+ * thread: the frame loop's thread, parallel-rdp's command ring and
+ * timeline workers (hooked in by apply_patches.sh) and the soft_rdp band
+ * workers. A thread that exits before cleanup() unregisters first.
+ *
+ * Usage: init() -> register_thread() on each watched thread ->
+ *        frame()/stage() from the frame loop -> unregister_thread() on
+ *        exiting threads -> report() -> cleanup()
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "flight_recorder.hpp"
+
+#define STALL_WATCHDOG_DEFAULT_MS 50
+#define STALL_WATCHDOG_MAX_THREADS 16
+#define STALL_WATCHDOG_MAX_DEPTH 32
+#define STALL_WATCHDOG_MIN_INTERVAL_US 1000000ull
+// STACK records per capture, across all threads (the ring keeps
+// FLIGHT_RECORDER_RECORDS_PER_SECOND records per second of history).
+#define STALL_WATCHDOG_MAX_STACK_RECORDS 48
+
+struct StallWatchdogThread
+{
+	int32_t tid = 0;
+	char name[16] = {};
+	uintptr_t stack_top = 0; // end of the thread's stack, 0 if unknown
+	uint32_t frame_loop = 0; // the thread calling frame(), captured first
+	uintptr_t pcs[STALL_WATCHDOG_MAX_DEPTH] = {};
+	int32_t depth = 0;
+	uint32_t done = 0;    // set by the signal handler
+	uint32_t blocked = 0; // in a system call, pcs[0] from /proc
+	uint32_t active = 0;  // set once the fields above are written
+};
+
+struct StallWatchdogWorker;
+
+struct StallWatchdog
+{
+	bool enabled = false;
+	uint32_t threshold_us = 0;
+	FlightRecorder *recorder = nullptr;
+	StallWatchdogWorker *worker = nullptr;
+
+	// Written by the frame loop, read by the watchdog thread.
+	uint32_t frame = 0;
+	uint64_t frame_start_us = 0;
+	uint32_t stage = FLIGHT_STAGE_EMULATION;
+	uint64_t stage_start_us = 0;
+
+	// Claimed and released under the worker's lock; the signal handler
+	// only reads slots whose active flag it sees set.
+	StallWatchdogThread threads[STALL_WATCHDOG_MAX_THREADS];
+
+	// Stats (watchdog thread)
+	uint32_t captured_frame = ~0u;
+	uint64_t last_capture_us = 0;
+	uint64_t stalls = 0;
+	uint64_t captures = 0;
+	uint64_t rate_limited = 0;
+	uint64_t max_elapsed_us = 0;
+};
+
+// Install the capture signal handler and start the watchdog thread. The
+// flight recorder must already be active. Returns false (and leaves the
+// watchdog disabled) otherwise.
+bool stall_watchdog_init(StallWatchdog &w, FlightRecorder &recorder, uint32_t threshold_ms);
+
+// Watch the calling thread. name is for the log; frame_loop marks the
+// thread that calls frame(), whose stack is written first. Thread safe.
+bool stall_watchdog_register_thread(StallWatchdog &w, const char *name, bool frame_loop = false);
+
+// Stop watching the calling thread, before it exits. Thread safe.
+void stall_watchdog_unregister_thread(StallWatchdog &w);
+
+uint64_t stall_watchdog_now_us();
+
+// A new frame starts; it is in the render stage until told otherwise.
+inline void stall_watchdog_frame(StallWatchdog &w, uint32_t frame)
+{
+	if (!w.enabled)
+		return;
+	const uint64_t now = stall_watchdog_now_us();
+	__atomic_store_n(&w.stage, uint32_t(FLIGHT_STAGE_RENDER), __ATOMIC_RELAXED);
+	__atomic_store_n(&w.stage_start_us, now, __ATOMIC_RELAXED);
+	__atomic_store_n(&w.frame_start_us, now, __ATOMIC_RELAXED);
+	__atomic_store_n(&w.frame, frame, __ATOMIC_RELEASE);
+}
+
+inline void stall_watchdog_stage(StallWatchdog &w, FlightStage stage)
+{
+	if (!w.enabled)
+		return;
+	__atomic_store_n(&w.stage_start_us, stall_watchdog_now_us(), __ATOMIC_RELAXED);
+	__atomic_store_n(&w.stage, uint32_t(stage), __ATOMIC_RELEASE);
+}
+
+void stall_watchdog_report(const StallWatchdog &w);
+
+// Stop the thread and restore the previous signal handler.
+void stall_watchdog_cleanup(StallWatchdog &w);
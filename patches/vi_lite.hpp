@@ -0,0 +1,76 @@
+/*
+ * VI-lite framebuffer geometry for tg5050
+ *
+ * Works out which part of RDRAM the VI is showing from the raw VI
+ * registers: origin, line length, pixel size and the active image size
+ * (active area times the 2.10 x/y scale). Only the plain 16-bit (RGBA5551)
+ * and 32-bit (RGBA8888) modes are described; the VI filters, interlacing
+ * and sub-pixel scale offsets are not modelled.
+ *
+ * Shared by the software RDP scanout and the direct-from-RDRAM present of
+ * the CPU display fallback.
+ *
+ * Usage: fill ViLiteRegs from the latched VI registers -> vi_lite_frame()
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#define VI_LITE_MAX_WIDTH 1024
+#define VI_LITE_MAX_HEIGHT 1024
+
+struct ViLiteRegs
+{
+	uint32_t status = 0;
+	uint32_t origin = 0;
+	uint32_t width = 0;
+	uint32_t h_start = 0;
+	uint32_t v_start = 0;
+	uint32_t x_scale = 0;
+	uint32_t y_scale = 0;
+};
+
+struct ViLiteFrame
+{
+	uint32_t origin = 0;      // byte address in RDRAM
+	uint32_t line = 0;        // pixels per RDRAM row
+	uint32_t pixel_bytes = 0; // 2 or 4
+	uint32_t width = 0;       // source pixels shown per row
+	uint32_t height = 0;      // source rows shown
+
+	// Bytes of RDRAM the frame reads, from origin.
+	uint32_t bytes() const
+	{
+		return height ? ((height - 1) * line + width) * pixel_bytes : 0;
+	}
+};
+
+// Returns false while the VI is blank or the registers describe nothing
+// showable.
+inline bool vi_lite_frame(const ViLiteRegs &vi, ViLiteFrame &f)
+{
+	f = ViLiteFrame();
+	const uint32_t type = vi.status & 3;
+	if (type < 2)
+		return false;
+
+	const uint32_t h_start = (vi.h_start >> 16) & 0x3ff, h_end = vi.h_start & 0x3ff;
+	const uint32_t v_start = (vi.v_start >> 16) & 0x3ff, v_end = vi.v_start & 0x3ff;
+	if (h_end <= h_start || v_end <= v_start)
+		return false;
+	// Source pixels covered by the active area (x/y scale are 2.10, v in
+	// half lines).
+	const uint32_t w = ((h_end - h_start) * (vi.x_scale & 0xfff)) >> 10;
+	const uint32_t h = (((v_end - v_start) >> 1) * (vi.y_scale & 0xfff)) >> 10;
+	if (w == 0 || h == 0 || w > VI_LITE_MAX_WIDTH || h > VI_LITE_MAX_HEIGHT)
+		return false;
+
+	const uint32_t line = vi.width & 0xfff;
+	f.origin = vi.origin & 0x00ffffff;
+	f.line = line ? line : w;
+	f.pixel_bytes = type == 3 ? 4 : 2;
+	f.width = w;
+	f.height = h;
+	return true;
+}
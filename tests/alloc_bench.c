@@ -0,0 +1,382 @@
+/*
+ * Allocator benchmark for tg5050
+ *
+ * Measures allocation throughput and per-frame latency tails for the
+ * allocation patterns gopher64 produces per emulated frame: bursts of small
+ * short-lived objects, medium command/staging buffers, occasional large
+ * buffer regrowth, and blocks freed on a different thread than the one
+ * that allocated them (parallel-rdp worker <-> emulation thread handoff).
+ *
+ * The same source is linked against the device glibc malloc and against a
+ * statically linked allocator so both can be compared on the device:
+ *
+ *   make tests/alloc_bench tests/alloc_bench_mimalloc
+ *   ./alloc_bench --json > system.json
+ *   ./alloc_bench_mimalloc --json > mimalloc.json
+ *
+ * A recorded workload can be replayed instead of the synthetic one:
+ *
+ *   ./alloc_bench --trace workload.txt
+ *
+ * Trace format, one op per line ("#" starts a comment):
+ *   a <id> <size>    allocate
+ *   r <id> <size>    realloc
+ *   f <id>           free
+ *   frame            end of frame (latency sample boundary)
+ *
+ * Cross-compile:
+ *   clang --target=aarch64-unknown-linux-gnu --sysroot=$SYSROOT \
+ *     -fuse-ld=lld -O2 -o alloc_bench alloc_bench.c -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#ifndef ALLOC_BENCH_ALLOCATOR
+#define ALLOC_BENCH_ALLOCATOR "system"
+#endif
+
+#define MAX_THREADS 8
+#define LIVE_SLOTS 4096
+#define HANDOFF_SLOTS 1024
+
+static int g_frames = 3600;
+static int g_threads = 2;
+static int g_json = 0;
+static uint32_t g_seed = 0x6f706865;
+static const char *g_trace_path = NULL;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t xorshift(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+/* Touch the block so the allocator cannot hand out untouched pages for free. */
+static void touch(void *p, size_t size) {
+    volatile uint8_t *b = (volatile uint8_t *)p;
+    b[0] = 1;
+    if (size > 1) b[size - 1] = 1;
+}
+
+/* Single-producer single-consumer ring for cross-thread frees. */
+struct handoff {
+    void *slots[HANDOFF_SLOTS];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+};
+
+static int handoff_push(struct handoff *h, void *p) {
+    uint32_t head = __atomic_load_n(&h->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= HANDOFF_SLOTS) return 0;
+    h->slots[head % HANDOFF_SLOTS] = p;
+    __atomic_store_n(&h->head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static void *handoff_pop(struct handoff *h) {
+    uint32_t tail = __atomic_load_n(&h->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&h->head, __ATOMIC_ACQUIRE);
+    if (tail == head) return NULL;
+    void *p = h->slots[tail % HANDOFF_SLOTS];
+    __atomic_store_n(&h->tail, tail + 1, __ATOMIC_RELEASE);
+    return p;
+}
+
+struct worker {
+    int index;
+    pthread_t thread;
+    struct handoff *inbox;  /* blocks allocated by the previous thread */
+    struct handoff *outbox; /* blocks this thread hands to the next one */
+    uint64_t *frame_ns;
+    uint64_t ops;
+};
+
+static struct handoff g_handoff[MAX_THREADS];
+
+static void *synthetic_worker(void *arg) {
+    struct worker *w = (struct worker *)arg;
+    uint32_t rng = g_seed ^ (uint32_t)(w->index * 0x9e3779b9u);
+    void *live[LIVE_SLOTS] = { 0 };
+    size_t live_size[LIVE_SLOTS] = { 0 };
+    void *big = NULL;
+    size_t big_size = 0;
+
+    for (int frame = 0; frame < g_frames; frame++) {
+        uint64_t t0 = now_ns();
+        uint64_t ops = 0;
+
+        /* Small short-lived objects: closures, strings, handles. */
+        for (int i = 0; i < 600; i++) {
+            size_t size = 16 + (xorshift(&rng) % 240);
+            void *p = malloc(size);
+            touch(p, size);
+            uint32_t slot = xorshift(&rng) % LIVE_SLOTS;
+            if (live[slot]) {
+                free(live[slot]);
+                ops++;
+            }
+            live[slot] = p;
+            live_size[slot] = size;
+            ops++;
+        }
+
+        /* Medium buffers: command chunks, staging, vectors that grow. */
+        for (int i = 0; i < 24; i++) {
+            uint32_t slot = xorshift(&rng) % LIVE_SLOTS;
+            size_t size = 1024 + (xorshift(&rng) % (63 * 1024));
+            void *p = live[slot] ? realloc(live[slot], size) : malloc(size);
+            touch(p, size);
+            live[slot] = p;
+            live_size[slot] = size;
+            ops++;
+        }
+
+        /* Occasional large regrowth, like scanout_pixels on a resolution change. */
+        if ((xorshift(&rng) % 120) == 0) {
+            size_t size = (256u << 10) + (xorshift(&rng) % (4u << 20));
+            void *p = realloc(big, size);
+            touch(p, size);
+            big = p;
+            big_size = size;
+            ops++;
+        }
+
+        /* Cross-thread frees. */
+        if (w->outbox) {
+            for (int i = 0; i < 64; i++) {
+                size_t size = 32 + (xorshift(&rng) % 2048);
+                void *p = malloc(size);
+                touch(p, size);
+                if (!handoff_push(w->outbox, p)) free(p);
+                ops++;
+            }
+        }
+        if (w->inbox) {
+            void *p;
+            while ((p = handoff_pop(w->inbox)) != NULL) {
+                free(p);
+                ops++;
+            }
+        }
+
+        w->frame_ns[frame] = now_ns() - t0;
+        w->ops += ops;
+    }
+
+    for (int i = 0; i < LIVE_SLOTS; i++) free(live[i]);
+    (void)live_size;
+    (void)big_size;
+    free(big);
+    return NULL;
+}
+
+/* ---- trace replay ---------------------------------------------------- */
+
+struct trace_op {
+    char kind; /* 'a', 'r', 'f', 'F' (frame) */
+    uint32_t id;
+    size_t size;
+};
+
+static struct trace_op *load_trace(const char *path, size_t *count, uint32_t *max_id, int *frames) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+
+    size_t cap = 1 << 16, n = 0;
+    struct trace_op *ops = malloc(cap * sizeof(*ops));
+    char line[128];
+    *max_id = 0;
+    *frames = 0;
+    while (fgets(line, sizeof(line), f)) {
+        struct trace_op op = { 0 };
+        unsigned long id = 0, size = 0;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (strncmp(line, "frame", 5) == 0) {
+            op.kind = 'F';
+            (*frames)++;
+        } else if ((line[0] == 'a' || line[0] == 'r') && sscanf(line + 1, "%lu %lu", &id, &size) == 2) {
+            op.kind = line[0];
+            op.id = (uint32_t)id;
+            op.size = size;
+        } else if (line[0] == 'f' && sscanf(line + 1, "%lu", &id) == 1) {
+            op.kind = 'f';
+            op.id = (uint32_t)id;
+        } else {
+            fprintf(stderr, "Bad trace line: %s", line);
+            continue;
+        }
+        if (op.kind != 'F' && op.id > *max_id) *max_id = op.id;
+        if (n == cap) {
+            cap *= 2;
+            ops = realloc(ops, cap * sizeof(*ops));
+        }
+        ops[n++] = op;
+    }
+    fclose(f);
+    *count = n;
+    return ops;
+}
+
+static int replay_trace(struct worker *w) {
+    size_t count = 0;
+    uint32_t max_id = 0;
+    int frames = 0;
+    struct trace_op *ops = load_trace(g_trace_path, &count, &max_id, &frames);
+    if (!ops) return -1;
+    if (frames == 0) {
+        fprintf(stderr, "Trace has no 'frame' markers\n");
+        free(ops);
+        return -1;
+    }
+
+    void **blocks = calloc((size_t)max_id + 1, sizeof(void *));
+    free(w->frame_ns);
+    w->frame_ns = calloc((size_t)frames, sizeof(uint64_t));
+    g_frames = frames;
+
+    int frame = 0;
+    uint64_t t0 = now_ns();
+    for (size_t i = 0; i < count; i++) {
+        const struct trace_op *op = &ops[i];
+        switch (op->kind) {
+        case 'a':
+            free(blocks[op->id]);
+            blocks[op->id] = malloc(op->size ? op->size : 1);
+            touch(blocks[op->id], op->size ? op->size : 1);
+            break;
+        case 'r':
+            blocks[op->id] = realloc(blocks[op->id], op->size ? op->size : 1);
+            touch(blocks[op->id], op->size ? op->size : 1);
+            break;
+        case 'f':
+            free(blocks[op->id]);
+            blocks[op->id] = NULL;
+            break;
+        case 'F':
+            w->frame_ns[frame++] = now_ns() - t0;
+            t0 = now_ns();
+            continue;
+        }
+        w->ops++;
+    }
+
+    for (uint32_t i = 0; i <= max_id; i++) free(blocks[i]);
+    free(blocks);
+    free(ops);
+    return 0;
+}
+
+/* ---- reporting ------------------------------------------------------- */
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile_us(const uint64_t *sorted, size_t n, double p) {
+    size_t idx = (size_t)(p * (double)(n - 1) + 0.5);
+    return (double)sorted[idx] / 1000.0;
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) g_frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) g_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) g_seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) g_trace_path = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0) g_json = 1;
+        else {
+            fprintf(stderr, "Usage: %s [--frames N] [--threads N] [--seed N] [--trace FILE] [--json]\n", argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (g_frames < 1) g_frames = 1;
+    if (g_threads < 1) g_threads = 1;
+    if (g_threads > MAX_THREADS) g_threads = MAX_THREADS;
+    if (g_trace_path) g_threads = 1;
+    if (!g_seed) g_seed = 1;
+
+    struct worker workers[MAX_THREADS];
+    memset(workers, 0, sizeof(workers));
+    for (int i = 0; i < g_threads; i++) {
+        workers[i].index = i;
+        workers[i].frame_ns = calloc((size_t)g_frames, sizeof(uint64_t));
+        if (g_threads > 1) {
+            workers[i].outbox = &g_handoff[i];
+            workers[i].inbox = &g_handoff[(i + g_threads - 1) % g_threads];
+        }
+    }
+
+    uint64_t start = now_ns();
+    if (g_trace_path) {
+        if (replay_trace(&workers[0]) < 0) return 1;
+    } else {
+        for (int i = 0; i < g_threads; i++)
+            pthread_create(&workers[i].thread, NULL, synthetic_worker, &workers[i]);
+        for (int i = 0; i < g_threads; i++)
+            pthread_join(workers[i].thread, NULL);
+    }
+    double elapsed_s = (double)(now_ns() - start) / 1e9;
+
+    /* Drain blocks still parked in the handoff rings. */
+    for (int i = 0; i < g_threads; i++) {
+        void *p;
+        while ((p = handoff_pop(&g_handoff[i])) != NULL) free(p);
+    }
+
+    size_t samples = (size_t)g_frames * (size_t)g_threads;
+    uint64_t *all = malloc(samples * sizeof(uint64_t));
+    uint64_t total_ops = 0;
+    for (int i = 0; i < g_threads; i++) {
+        memcpy(all + (size_t)i * (size_t)g_frames, workers[i].frame_ns, (size_t)g_frames * sizeof(uint64_t));
+        total_ops += workers[i].ops;
+        free(workers[i].frame_ns);
+    }
+    qsort(all, samples, sizeof(uint64_t), cmp_u64);
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    double mops = (double)total_ops / elapsed_s / 1e6;
+    double p50 = percentile_us(all, samples, 0.50);
+    double p99 = percentile_us(all, samples, 0.99);
+    double p999 = percentile_us(all, samples, 0.999);
+    double max = (double)all[samples - 1] / 1000.0;
+
+    if (g_json) {
+        printf("{\"allocator\":\"%s\",\"workload\":\"%s\",\"threads\":%d,\"frames\":%d,"
+               "\"ops\":%llu,\"elapsed_s\":%.3f,\"mops_per_s\":%.3f,"
+               "\"frame_us\":{\"p50\":%.2f,\"p99\":%.2f,\"p999\":%.2f,\"max\":%.2f},"
+               "\"max_rss_kb\":%ld}\n",
+               ALLOC_BENCH_ALLOCATOR, g_trace_path ? g_trace_path : "synthetic", g_threads, g_frames,
+               (unsigned long long)total_ops, elapsed_s, mops, p50, p99, p999, max, ru.ru_maxrss);
+    } else {
+        printf("allocator=%s workload=%s threads=%d frames=%d\n",
+               ALLOC_BENCH_ALLOCATOR, g_trace_path ? g_trace_path : "synthetic", g_threads, g_frames);
+        printf("  throughput: %.3f Mops/s (%llu ops in %.3fs)\n", mops, (unsigned long long)total_ops, elapsed_s);
+        printf("  frame alloc time us: p50=%.2f p99=%.2f p99.9=%.2f max=%.2f\n", p50, p99, p999, max);
+        printf("  max RSS: %ld KiB\n", ru.ru_maxrss);
+    }
+
+    free(all);
+    return 0;
+}
@@ -8,9 +8,19 @@
  * If this works, gopher64 can render at N64 native resolution and let
  * the display controller upscale — zero CPU overhead for scaling.
  *
+ * --bench sweeps format x source size x plane x API and measures flips per
+ * second, submit-to-vblank latency, EBUSY rate and missed vblanks, printing
+ * one JSON document to stdout (or --json FILE). Use it as the baseline when
+ * choosing the runtime display path (G64_DRM_DISABLE_PLANE / _USE_OVERLAY).
+ *
  * Cross-compile:
  *   clang --target=aarch64-unknown-linux-gnu --sysroot=$SYSROOT \
  *     -fuse-ld=lld -o drm_plane_scale_test drm_plane_scale_test.c -ldrm
+ *
+ * Host build against the simulated display in mock_drm.c (no DRM device):
+ *   cc $(pkg-config --cflags libdrm) -o drm_plane_scale_test.host \
+ *     drm_plane_scale_test.c mock_drm.c
+ *   ./drm_plane_scale_test.host --device /dev/zero --bench --bench-flips 30
  */
 
 #include <stdio.h>
@@ -22,6 +32,7 @@
 #include <errno.h>
 #include <signal.h>
 #include <time.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <drm_fourcc.h>
@@ -37,6 +48,11 @@ static int g_force_dmabuf_sync = 0;
 static int g_use_atomic_plane = 0;
 static int g_format_sweep = 0;
 static int g_test_padded_pitch = 0;
+static int g_bench = 0;
+static int g_bench_flips = 120;
+static int g_format_explicit = 0;
+static const char *g_json_path = NULL;
+static const char *g_device_path = "/dev/dri/card0";
 static void sighandler(int sig) { (void)sig; g_running = 0; }
 
 enum pack_mode {
@@ -419,6 +435,351 @@ static void run_format_sweep(int fd, uint32_t plane_id, uint32_t crtc_id,
     g_use_addfb2 = saved_addfb2;
 }
 
+/*
+ * Flip benchmark (--bench)
+ *
+ * Every cell flips between two pre-filled buffers as fast as the API allows
+ * and records, per flip, the time from submit to the vblank that latched it.
+ * Atomic and page-flip cells use the flip event timestamp; legacy SetPlane
+ * uses drmWaitVBlank (the last vblank if the call blocked through one, the
+ * next one otherwise).
+ */
+enum flip_api { API_SETPLANE = 0, API_ATOMIC, API_PAGEFLIP, API_COUNT };
+static const char *k_api_names[API_COUNT] = { "setplane", "atomic", "pageflip" };
+
+struct plane_props {
+    uint32_t fb_id, crtc_id, crtc_x, crtc_y, crtc_w, crtc_h, src_x, src_y, src_w, src_h;
+};
+
+struct flip_wait {
+    int pending;
+    uint64_t vblank_us;
+    unsigned seq;
+};
+
+struct bench_ctx {
+    int fd;
+    uint32_t crtc_id, crtc_index, conn_id;
+    drmModeModeInfo *mode;
+    struct fb *bg;
+    FILE *json;
+    int cells;
+    struct flip_wait wait; /* outlives a cell so a late event never hits a dead stack slot */
+};
+
+struct bench_result {
+    char error[96];
+    int flips, attempts, ebusy, missed_vblanks;
+    double seconds;
+    uint64_t *lat_us;
+};
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static int load_plane_props(int fd, uint32_t plane_id, struct plane_props *p) {
+    p->fb_id   = get_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, "FB_ID");
+    p->crtc_id = get_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_ID");
+    p->crtc_x  = get_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_X");
+    p->crtc_y  = get_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_Y");
+    p->crtc_w  = get_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_W");
+    p->crtc_h  = get_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_H");
+    p->src_x   = get_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_X");
+    p->src_y   = get_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_Y");
+    p->src_w   = get_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_W");
+    p->src_h   = get_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_H");
+    return (p->fb_id && p->crtc_id && p->crtc_x && p->crtc_y && p->crtc_w &&
+            p->crtc_h && p->src_x && p->src_y && p->src_w && p->src_h) ? 0 : -1;
+}
+
+/* Atomic commit of one plane; full == 0 only updates FB_ID (the flip itself). */
+static int commit_plane_atomic(int fd, uint32_t plane_id, const struct plane_props *p, int full,
+                               uint32_t crtc_id, uint32_t fb_id, uint32_t dst_w, uint32_t dst_h,
+                               uint32_t src_w, uint32_t src_h, uint32_t flags, void *user) {
+    drmModeAtomicReq *req = drmModeAtomicAlloc();
+    if (!req) return -1;
+    int ok = drmModeAtomicAddProperty(req, plane_id, p->fb_id, fb_id) >= 0;
+    if (full) {
+        ok = ok &&
+             drmModeAtomicAddProperty(req, plane_id, p->crtc_id, crtc_id) >= 0 &&
+             drmModeAtomicAddProperty(req, plane_id, p->crtc_x, 0) >= 0 &&
+             drmModeAtomicAddProperty(req, plane_id, p->crtc_y, 0) >= 0 &&
+             drmModeAtomicAddProperty(req, plane_id, p->crtc_w, dst_w) >= 0 &&
+             drmModeAtomicAddProperty(req, plane_id, p->crtc_h, dst_h) >= 0 &&
+             drmModeAtomicAddProperty(req, plane_id, p->src_x, 0) >= 0 &&
+             drmModeAtomicAddProperty(req, plane_id, p->src_y, 0) >= 0 &&
+             drmModeAtomicAddProperty(req, plane_id, p->src_w, (uint64_t)src_w << 16) >= 0 &&
+             drmModeAtomicAddProperty(req, plane_id, p->src_h, (uint64_t)src_h << 16) >= 0;
+    }
+    int err = -1;
+    if (ok)
+        err = drmModeAtomicCommit(fd, req, flags, user);
+    else
+        errno = EINVAL;
+    drmModeAtomicFree(req);
+    return err;
+}
+
+static void page_flip_handler(int fd, unsigned int seq, unsigned int sec, unsigned int usec, void *data) {
+    (void)fd;
+    struct flip_wait *w = data;
+    w->pending = 0;
+    w->seq = seq;
+    w->vblank_us = (uint64_t)sec * 1000000ull + usec;
+}
+
+static int wait_flip_event(int fd, struct flip_wait *w) {
+    drmEventContext ev = { 0 };
+    ev.version = 2;
+    ev.page_flip_handler = page_flip_handler;
+    while (w->pending) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int r = poll(&pfd, 1, 500);
+        if (r <= 0) {
+            if (r == 0) errno = ETIMEDOUT;
+            return -1;
+        }
+        if (drmHandleEvent(fd, &ev) != 0) return -1;
+    }
+    return 0;
+}
+
+static uint32_t vblank_crtc_flags(uint32_t crtc_index) {
+    if (crtc_index == 0) return 0;
+    if (crtc_index == 1) return DRM_VBLANK_SECONDARY;
+    return (crtc_index << DRM_VBLANK_HIGH_CRTC_SHIFT) & DRM_VBLANK_HIGH_CRTC_MASK;
+}
+
+static int query_vblank(int fd, uint32_t crtc_index, unsigned relative, uint64_t *ts_us, unsigned *seq) {
+    drmVBlank vbl;
+    memset(&vbl, 0, sizeof(vbl));
+    vbl.request.type = (drmVBlankSeqType)(DRM_VBLANK_RELATIVE | vblank_crtc_flags(crtc_index));
+    vbl.request.sequence = relative;
+    if (drmWaitVBlank(fd, &vbl) != 0) return -1;
+    *ts_us = (uint64_t)vbl.reply.tval_sec * 1000000ull + (uint64_t)vbl.reply.tval_usec;
+    *seq = vbl.reply.sequence;
+    return 0;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Write s as a JSON string literal (error text comes from strerror()). */
+static void json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static void json_result(struct bench_ctx *ctx, const char *format, uint32_t src_w, uint32_t src_h,
+                        const char *plane, enum flip_api api, struct bench_result *r) {
+    uint32_t dst_w = ctx->mode->hdisplay, dst_h = ctx->mode->vdisplay;
+    fprintf(ctx->json, "%s\n    {\"format\":\"%s\",\"src\":[%u,%u],\"dst\":[%u,%u],\"scale\":[%.3f,%.3f],"
+            "\"plane\":\"%s\",\"api\":\"%s\"",
+            ctx->cells++ ? "," : "", format, src_w, src_h, dst_w, dst_h,
+            (double)dst_w / src_w, (double)dst_h / src_h, plane, k_api_names[api]);
+    if (r->error[0]) {
+        fprintf(ctx->json, ",\"status\":\"unsupported\",\"error\":");
+        json_string(ctx->json, r->error);
+        fputc('}', ctx->json);
+        return;
+    }
+
+    double mean = 0;
+    for (int i = 0; i < r->flips; i++) mean += (double)r->lat_us[i];
+    mean = r->flips ? mean / r->flips : 0;
+    qsort(r->lat_us, (size_t)r->flips, sizeof(uint64_t), cmp_u64);
+#define PCT(p) (r->flips ? r->lat_us[(size_t)((p) * (r->flips - 1) + 0.5)] : 0)
+    fprintf(ctx->json, ",\"status\":\"ok\",\"flips\":%d,\"seconds\":%.3f,\"flips_per_s\":%.2f,"
+            "\"latency_us\":{\"mean\":%.0f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"max\":%llu},"
+            "\"attempts\":%d,\"ebusy\":%d,\"ebusy_rate\":%.4f,\"missed_vblanks\":%d}",
+            r->flips, r->seconds, r->seconds > 0 ? r->flips / r->seconds : 0.0, mean,
+            (unsigned long long)PCT(0.50), (unsigned long long)PCT(0.90),
+            (unsigned long long)PCT(0.99), (unsigned long long)PCT(1.0),
+            r->attempts, r->ebusy, r->attempts ? (double)r->ebusy / r->attempts : 0.0,
+            r->missed_vblanks);
+#undef PCT
+}
+
+static void bench_cell(struct bench_ctx *ctx, int format_index, uint32_t src_w, uint32_t src_h,
+                       uint32_t plane_id, const char *plane_name, enum flip_api api) {
+    int fd = ctx->fd;
+    uint32_t dst_w = ctx->mode->hdisplay, dst_h = ctx->mode->vdisplay;
+    struct fb bufs[2] = { { 0 }, { 0 } };
+    struct plane_props props;
+    struct bench_result r;
+    memset(&r, 0, sizeof(r));
+    r.lat_us = calloc((size_t)g_bench_flips, sizeof(uint64_t));
+
+    g_format_index = format_index;
+    fprintf(stderr, "  %s %ux%u -> %ux%u %s/%s ... ", k_formats[format_index].name,
+            src_w, src_h, dst_w, dst_h, plane_name, k_api_names[api]);
+
+    if (!r.lat_us) {
+        snprintf(r.error, sizeof(r.error), "latency buffer: %s", strerror(errno));
+        goto done;
+    }
+
+    if (fb_create(fd, &bufs[0], src_w, src_h) < 0 || fb_create(fd, &bufs[1], src_w, src_h) < 0) {
+        snprintf(r.error, sizeof(r.error), "addfb2: %s", strerror(errno));
+        goto done;
+    }
+    fb_fill_pattern(&bufs[0]);
+    fb_fill_color(&bufs[1], 64, 128, 192);
+    fb_flush(&bufs[0]);
+    fb_flush(&bufs[1]);
+
+    /* Put buffer 0 on screen with the full plane state. */
+    int err = 0;
+    if (api == API_ATOMIC) {
+        if (load_plane_props(fd, plane_id, &props) < 0) {
+            snprintf(r.error, sizeof(r.error), "missing plane properties");
+            goto done;
+        }
+        err = commit_plane_atomic(fd, plane_id, &props, 1, ctx->crtc_id, bufs[0].id,
+                                  dst_w, dst_h, src_w, src_h, 0, NULL);
+    } else if (api == API_PAGEFLIP) {
+        err = drmModeSetCrtc(fd, ctx->crtc_id, bufs[0].id, 0, 0, &ctx->conn_id, 1, ctx->mode);
+    } else {
+        err = drmModeSetPlane(fd, plane_id, ctx->crtc_id, bufs[0].id, 0, 0, 0, dst_w, dst_h,
+                              0, 0, src_w << 16, src_h << 16);
+    }
+    if (err < 0) {
+        snprintf(r.error, sizeof(r.error), "setup: %s", strerror(errno));
+        goto done;
+    }
+
+    unsigned last_seq = 0;
+    uint64_t start = now_us();
+    /* EBUSY retries count as attempts; cap them so a wedged flip cannot hang the sweep. */
+    while (r.flips < g_bench_flips && r.attempts < g_bench_flips * 8 && g_running) {
+        struct fb *cur = &bufs[(r.flips + 1) & 1];
+        struct flip_wait *w = &ctx->wait;
+        uint64_t submit = now_us();
+        uint64_t vblank = 0;
+        unsigned seq = 0;
+
+        r.attempts++;
+        w->pending = 1;
+        if (api == API_ATOMIC)
+            err = commit_plane_atomic(fd, plane_id, &props, 0, ctx->crtc_id, cur->id, 0, 0, 0, 0,
+                                      DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, w);
+        else if (api == API_PAGEFLIP)
+            err = drmModePageFlip(fd, ctx->crtc_id, cur->id, DRM_MODE_PAGE_FLIP_EVENT, w);
+        else
+            err = drmModeSetPlane(fd, plane_id, ctx->crtc_id, cur->id, 0, 0, 0, dst_w, dst_h,
+                                  0, 0, src_w << 16, src_h << 16);
+
+        if (err < 0 && errno == EBUSY) {
+            /* Previous flip still queued: wait a vblank and resubmit, as the runtime does. */
+            r.ebusy++;
+            query_vblank(fd, ctx->crtc_index, 1, &vblank, &seq);
+            continue;
+        }
+        if (err < 0) {
+            snprintf(r.error, sizeof(r.error), "flip %d: %s", r.flips, strerror(errno));
+            break;
+        }
+
+        if (api == API_SETPLANE) {
+            if (query_vblank(fd, ctx->crtc_index, 0, &vblank, &seq) == 0 && vblank < submit)
+                query_vblank(fd, ctx->crtc_index, 1, &vblank, &seq);
+        } else {
+            if (wait_flip_event(fd, w) < 0) {
+                snprintf(r.error, sizeof(r.error), "flip event: %s", strerror(errno));
+                break;
+            }
+            vblank = w->vblank_us;
+            seq = w->seq;
+        }
+
+        if (r.flips > 0 && seq > last_seq + 1)
+            r.missed_vblanks += (int)(seq - last_seq - 1);
+        last_seq = seq;
+        r.lat_us[r.flips++] = vblank > submit ? vblank - submit : 0;
+    }
+    r.seconds = (double)(now_us() - start) / 1e6;
+
+done:
+    if (r.error[0])
+        fprintf(stderr, "unsupported (%s)\n", r.error);
+    else
+        fprintf(stderr, "%.1f flips/s, ebusy=%d, missed=%d\n",
+                r.seconds > 0 ? r.flips / r.seconds : 0.0, r.ebusy, r.missed_vblanks);
+    json_result(ctx, k_formats[format_index].name, src_w, src_h, plane_name, api, &r);
+
+    /* Back to the background on the primary plane, overlay off. */
+    if (strcmp(plane_name, "overlay") == 0)
+        drmModeSetPlane(fd, plane_id, ctx->crtc_id, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    drmModeSetCrtc(fd, ctx->crtc_id, ctx->bg->id, 0, 0, &ctx->conn_id, 1, ctx->mode);
+    fb_destroy(fd, &bufs[1]);
+    fb_destroy(fd, &bufs[0]);
+    free(r.lat_us);
+}
+
+static int run_flip_bench(int fd, uint32_t crtc_id, uint32_t crtc_index, uint32_t conn_id,
+                          drmModeModeInfo *mode, struct fb *bg,
+                          uint32_t primary_plane, uint32_t overlay_plane) {
+    struct bench_ctx ctx = { fd, crtc_id, crtc_index, conn_id, mode, bg, stdout, 0, { 0, 0, 0 } };
+    if (g_json_path) {
+        ctx.json = fopen(g_json_path, "w");
+        if (!ctx.json) {
+            fprintf(stderr, "  [FAIL] open %s: %s\n", g_json_path, strerror(errno));
+            return -1;
+        }
+    }
+
+    const uint32_t sizes[][2] = { { 320, 240 }, { 640, 240 }, { 640, 480 }, { mode->hdisplay, mode->vdisplay } };
+    const struct { const char *name; uint32_t id; } planes[] = {
+        { "primary", primary_plane }, { "overlay", overlay_plane }
+    };
+    int saved_format = g_format_index;
+    int saved_addfb2 = g_use_addfb2;
+    g_use_addfb2 = 1;
+
+    fprintf(stderr, "\n--- Flip benchmark (%d flips per cell) ---\n", g_bench_flips);
+    fprintf(ctx.json, "{\"display\":{\"width\":%u,\"height\":%u,\"refresh_hz\":%u},"
+            "\"config\":{\"flips_per_cell\":%d,\"msync\":%s,\"dmabuf_sync\":%s},\"results\":[",
+            mode->hdisplay, mode->vdisplay, mode->vrefresh, g_bench_flips,
+            g_force_msync ? "true" : "false", g_force_dmabuf_sync ? "true" : "false");
+
+    for (int f = 0; f < (int)(sizeof(k_formats) / sizeof(k_formats[0])) && g_running; f++) {
+        if (g_format_explicit && f != saved_format) continue;
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && g_running; s++) {
+            for (size_t p = 0; p < sizeof(planes) / sizeof(planes[0]) && g_running; p++) {
+                if (!planes[p].id) continue;
+                for (int api = 0; api < API_COUNT && g_running; api++) {
+                    /* Legacy page flip cannot scale or target an overlay. */
+                    if (api == API_PAGEFLIP &&
+                        (p != 0 || sizes[s][0] != mode->hdisplay || sizes[s][1] != mode->vdisplay))
+                        continue;
+                    bench_cell(&ctx, f, sizes[s][0], sizes[s][1], planes[p].id, planes[p].name,
+                               (enum flip_api)api);
+                }
+            }
+        }
+    }
+
+    fprintf(ctx.json, "\n]}\n");
+    if (ctx.json != stdout) fclose(ctx.json);
+    g_format_index = saved_format;
+    g_use_addfb2 = saved_addfb2;
+    return 0;
+}
+
 int main(int argc, char **argv) {
     int fd = -1;
     drmModeRes *res = NULL;
@@ -439,6 +800,10 @@ int main(int argc, char **argv) {
         else if (strcmp(argv[i], "--atomic-plane") == 0) g_use_atomic_plane = 1;
         else if (strcmp(argv[i], "--format-sweep") == 0) g_format_sweep = 1;
         else if (strcmp(argv[i], "--test-padded-pitch") == 0) g_test_padded_pitch = 1;
+        else if (strcmp(argv[i], "--bench") == 0) g_bench = 1;
+        else if (strcmp(argv[i], "--bench-flips") == 0 && i + 1 < argc) g_bench_flips = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) g_json_path = argv[++i];
+        else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) g_device_path = argv[++i];
         else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
             int idx = find_format_index(argv[++i]);
             if (idx < 0) {
@@ -446,9 +811,10 @@ int main(int argc, char **argv) {
                 return 1;
             }
             g_format_index = idx;
+            g_format_explicit = 1;
         }
         if (strcmp(argv[i], "--help") == 0) {
-            fprintf(stderr, "Usage: %s [--fast] [--msync] [--addfb2] [--dmabuf-sync] [--atomic-plane] [--format <xr24|xb24|rx24|bx24>] [--format-sweep] [--test-padded-pitch]\n", argv[0]);
+            fprintf(stderr, "Usage: %s [--fast] [--msync] [--addfb2] [--dmabuf-sync] [--atomic-plane] [--format <xr24|xb24|rx24|bx24>] [--format-sweep] [--test-padded-pitch] [--bench [--bench-flips N] [--json FILE]] [--device PATH]\n", argv[0]);
             fprintf(stderr, "Tests DRM plane scaling (320x240/640x240/640x480 -> 1280x720).\n");
             fprintf(stderr, "  --msync  force msync() after CPU writes to dumb buffers\n");
             fprintf(stderr, "  --addfb2 use drmModeAddFB2 with selected format instead of legacy AddFB\n");
@@ -457,10 +823,16 @@ int main(int argc, char **argv) {
             fprintf(stderr, "  --format select AddFB2 format (xr24 default)\n");
             fprintf(stderr, "  --format-sweep cycle through xr24/xb24/rx24/bx24 on-plane\n");
             fprintf(stderr, "  --test-padded-pitch add focused test: FB 1280x240, SRC rect 640x240\n");
+            fprintf(stderr, "  --bench  flip benchmark over format x size x plane x API, JSON to stdout\n");
+            fprintf(stderr, "           (--format limits it to one format)\n");
+            fprintf(stderr, "  --bench-flips flips per benchmark cell (default 120)\n");
+            fprintf(stderr, "  --json   write benchmark JSON to FILE instead of stdout\n");
+            fprintf(stderr, "  --device DRM device node (default /dev/dri/card0)\n");
             return 0;
         }
     }
 
+    if (g_bench_flips < 1) g_bench_flips = 1;
     if ((g_format_index != 0 || g_format_sweep) && !g_use_addfb2) {
         fprintf(stderr, "  [INFO] forcing --addfb2 for selected/sweep format mode\n");
         g_use_addfb2 = 1;
@@ -479,16 +851,16 @@ int main(int argc, char **argv) {
         g_format_sweep ? "on" : "off",
         g_test_padded_pitch ? "on" : "off");
 
-    fd = open("/dev/dri/card0", O_RDWR | O_CLOEXEC);
-    if (fd < 0) { fprintf(stderr, "  [FAIL] open card0: %s\n", strerror(errno)); return 1; }
-    fprintf(stderr, "  [PASS] Opened /dev/dri/card0\n");
+    fd = open(g_device_path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) { fprintf(stderr, "  [FAIL] open %s: %s\n", g_device_path, strerror(errno)); return 1; }
+    fprintf(stderr, "  [PASS] Opened %s\n", g_device_path);
 
     /* Must enable universal planes to see overlay/cursor planes */
     if (drmSetClientCap(fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) < 0)
         fprintf(stderr, "  [WARN] DRM_CLIENT_CAP_UNIVERSAL_PLANES: %s\n", strerror(errno));
     else
         fprintf(stderr, "  [PASS] Universal planes enabled\n");
-    if (g_use_atomic_plane) {
+    if (g_use_atomic_plane || g_bench) {
         if (drmSetClientCap(fd, DRM_CLIENT_CAP_ATOMIC, 1) < 0)
             fprintf(stderr, "  [WARN] DRM_CLIENT_CAP_ATOMIC: %s\n", strerror(errno));
         else
@@ -589,6 +961,12 @@ int main(int argc, char **argv) {
     fprintf(stderr, "  [PASS] Background displayed\n");
     msleep(500);
 
+    if (g_bench) {
+        ret = run_flip_bench(fd, crtc_id, crtc_index, conn->connector_id, mode, &bg,
+                             primary_plane, overlay_plane) == 0 ? 0 : 1;
+        goto cleanup;
+    }
+
     if (g_format_sweep) {
         uint32_t sweep_plane = primary_plane ? primary_plane : overlay_plane;
         if (!sweep_plane) {
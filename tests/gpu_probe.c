@@ -3,6 +3,9 @@
  * Tests all viable rendering + display paths to determine
  * what works for getting accelerated graphics on screen.
  *
+ * --bench [--iterations N] [--json FILE] skips the capability scan and times
+ * the Vulkan/DRM operations the frame loop uses, emitting JSON.
+ *
  * Cross-compile with:
  *   clang --target=aarch64-unknown-linux-gnu --sysroot=$SYSROOT \
  *     -fuse-ld=lld -o gpu_probe gpu_probe.c -ldl
@@ -15,6 +18,9 @@
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 
@@ -1191,25 +1197,1116 @@ static void test_vk_external_memory(void) {
 }
 
 
+/* ===== Vulkan microbenchmarks (--bench) =====
+ *
+ * Times the operations the frame loop is built from, on a compute+graphics
+ * queue with no WSI: empty submit and fence round trip, sync_file export and
+ * signal latency, vkCmdBlitImage and an equivalent compute dispatch scaling
+ * 320x240 -> 1280x720, DRM dumb buffer -> dma-buf -> AddFB2 / Vulkan import,
+ * and CPU read bandwidth from cached vs uncached host-visible memory after a
+ * GPU write. GPU times are wall-clock submit-to-fence, so they include the
+ * submit/wake overhead measured separately in "submit".
+ *
+ * JSON goes to stdout (or --json FILE); progress goes to stderr.
+ */
+typedef struct VkFence_T*               VkFence;
+typedef struct VkShaderModule_T*        VkShaderModule;
+typedef struct VkPipeline_T*            VkPipeline;
+typedef struct VkPipelineLayout_T*      VkPipelineLayout;
+typedef struct VkPipelineCache_T*       VkPipelineCache;
+typedef struct VkDescriptorSetLayout_T* VkDescriptorSetLayout;
+typedef struct VkDescriptorPool_T*      VkDescriptorPool;
+typedef struct VkDescriptorSet_T*       VkDescriptorSet;
+
+#define VK_STRUCTURE_TYPE_APPLICATION_INFO 0
+#define VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE 6
+#define VK_STRUCTURE_TYPE_FENCE_CREATE_INFO 8
+#define VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO 14
+#define VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO 16
+#define VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO 18
+#define VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO 29
+#define VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO 30
+#define VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO 32
+#define VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO 33
+#define VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO 34
+#define VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET 35
+#define VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER 45
+#define VK_STRUCTURE_TYPE_MEMORY_BARRIER 46
+#define VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO 1000072000
+#define VK_STRUCTURE_TYPE_IMPORT_MEMORY_FD_INFO_KHR 1000074000
+#define VK_STRUCTURE_TYPE_MEMORY_FD_PROPERTIES_KHR 1000074001
+#define VK_STRUCTURE_TYPE_EXPORT_FENCE_CREATE_INFO 1000113000
+#define VK_STRUCTURE_TYPE_FENCE_GET_FD_INFO_KHR 1000115001
+
+#define VK_MEMORY_PROPERTY_HOST_CACHED_BIT 0x00000008
+#define VK_BUFFER_USAGE_TRANSFER_DST_BIT 0x00000002
+#define VK_IMAGE_USAGE_TRANSFER_SRC_BIT 0x00000001
+#define VK_IMAGE_USAGE_TRANSFER_DST_BIT 0x00000002
+#define VK_FORMAT_R8G8B8A8_UNORM 37
+#define VK_IMAGE_TYPE_2D 1
+#define VK_IMAGE_TILING_OPTIMAL 0
+#define VK_SAMPLE_COUNT_1_BIT 1
+#define VK_IMAGE_LAYOUT_UNDEFINED 0
+#define VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL 6
+#define VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL 7
+#define VK_IMAGE_ASPECT_COLOR_BIT 0x00000001
+#define VK_FILTER_NEAREST 0
+#define VK_FILTER_LINEAR 1
+#define VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT 0x00000001
+#define VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT 0x00000800
+#define VK_PIPELINE_STAGE_TRANSFER_BIT 0x00001000
+#define VK_PIPELINE_STAGE_HOST_BIT 0x00004000
+#define VK_ACCESS_SHADER_READ_BIT 0x00000020
+#define VK_ACCESS_SHADER_WRITE_BIT 0x00000040
+#define VK_ACCESS_TRANSFER_READ_BIT 0x00000800
+#define VK_ACCESS_TRANSFER_WRITE_BIT 0x00001000
+#define VK_ACCESS_HOST_READ_BIT 0x00002000
+#define VK_SHADER_STAGE_COMPUTE_BIT 0x00000020
+#define VK_DESCRIPTOR_TYPE_STORAGE_BUFFER 7
+#define VK_PIPELINE_BIND_POINT_COMPUTE 1
+#define VK_QUEUE_FAMILY_IGNORED (~0u)
+#define VK_WHOLE_SIZE (~0ull)
+#define VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT 0x00000200
+#define VK_EXTERNAL_FENCE_HANDLE_TYPE_SYNC_FD_BIT 0x00000008
+#define VK_API_VERSION_1_1 ((1u << 22) | (1u << 12))
+
+typedef struct {
+    uint32_t sType; const void *pNext;
+    const char *pApplicationName; uint32_t applicationVersion;
+    const char *pEngineName; uint32_t engineVersion; uint32_t apiVersion;
+} VkApplicationInfo;
+
+typedef struct { VkDeviceSize size; VkDeviceSize alignment; uint32_t memoryTypeBits; } VkMemoryRequirements;
+typedef struct { uint32_t sType; const void *pNext; VkDeviceSize allocationSize; uint32_t memoryTypeIndex; } VkMemoryAllocateInfo;
+typedef struct { uint32_t sType; const void *pNext; VkDeviceMemory memory; VkDeviceSize offset; VkDeviceSize size; } VkMappedMemoryRange;
+
+typedef struct {
+    uint32_t sType; const void *pNext; uint32_t flags; VkDeviceSize size; uint32_t usage;
+    uint32_t sharingMode; uint32_t queueFamilyIndexCount; const uint32_t *pQueueFamilyIndices;
+} VkBufferCreateInfo;
+
+typedef struct {
+    uint32_t sType; const void *pNext; uint32_t flags; uint32_t imageType; uint32_t format;
+    VkExtent3D extent; uint32_t mipLevels; uint32_t arrayLayers; uint32_t samples; uint32_t tiling;
+    uint32_t usage; uint32_t sharingMode; uint32_t queueFamilyIndexCount; const uint32_t *pQueueFamilyIndices;
+    uint32_t initialLayout;
+} VkImageCreateInfo;
+
+typedef struct { uint32_t sType; const void *pNext; VkCommandPool commandPool; uint32_t level; uint32_t commandBufferCount; } VkCommandBufferAllocateInfo;
+typedef struct { uint32_t sType; const void *pNext; uint32_t flags; const void *pInheritanceInfo; } VkCommandBufferBeginInfo;
+
+typedef struct {
+    uint32_t sType; const void *pNext;
+    uint32_t waitSemaphoreCount; const void *pWaitSemaphores; const uint32_t *pWaitDstStageMask;
+    uint32_t commandBufferCount; const VkCommandBuffer *pCommandBuffers;
+    uint32_t signalSemaphoreCount; const void *pSignalSemaphores;
+} VkSubmitInfo;
+
+typedef struct { uint32_t sType; const void *pNext; uint32_t flags; } VkFenceCreateInfo;
+typedef struct { uint32_t sType; const void *pNext; uint32_t handleTypes; } VkExportFenceCreateInfo;
+typedef struct { uint32_t sType; const void *pNext; VkFence fence; uint32_t handleType; } VkFenceGetFdInfoKHR;
+
+typedef struct { uint32_t sType; const void *pNext; uint32_t handleTypes; } VkExternalMemoryBufferCreateInfo;
+typedef struct { uint32_t sType; const void *pNext; uint32_t handleType; int fd; } VkImportMemoryFdInfoKHR;
+typedef struct { uint32_t sType; void *pNext; uint32_t memoryTypeBits; } VkMemoryFdPropertiesKHR;
+
+typedef struct { uint32_t aspectMask; uint32_t baseMipLevel; uint32_t levelCount; uint32_t baseArrayLayer; uint32_t layerCount; } VkImageSubresourceRange;
+typedef struct { uint32_t aspectMask; uint32_t mipLevel; uint32_t baseArrayLayer; uint32_t layerCount; } VkImageSubresourceLayers;
+typedef struct { int32_t x, y, z; } VkOffset3D;
+typedef struct { VkImageSubresourceLayers srcSubresource; VkOffset3D srcOffsets[2]; VkImageSubresourceLayers dstSubresource; VkOffset3D dstOffsets[2]; } VkImageBlit;
+typedef struct { uint32_t sType; const void *pNext; uint32_t srcAccessMask; uint32_t dstAccessMask; } VkMemoryBarrier;
+
+typedef struct {
+    uint32_t sType; const void *pNext; uint32_t srcAccessMask; uint32_t dstAccessMask;
+    uint32_t oldLayout; uint32_t newLayout; uint32_t srcQueueFamilyIndex; uint32_t dstQueueFamilyIndex;
+    VkImage image; VkImageSubresourceRange subresourceRange;
+} VkImageMemoryBarrier;
+
+typedef struct { uint32_t sType; const void *pNext; uint32_t flags; size_t codeSize; const uint32_t *pCode; } VkShaderModuleCreateInfo;
+typedef struct { uint32_t binding; uint32_t descriptorType; uint32_t descriptorCount; uint32_t stageFlags; const void *pImmutableSamplers; } VkDescriptorSetLayoutBinding;
+typedef struct { uint32_t sType; const void *pNext; uint32_t flags; uint32_t bindingCount; const VkDescriptorSetLayoutBinding *pBindings; } VkDescriptorSetLayoutCreateInfo;
+
+typedef struct {
+    uint32_t sType; const void *pNext; uint32_t flags;
+    uint32_t setLayoutCount; const VkDescriptorSetLayout *pSetLayouts;
+    uint32_t pushConstantRangeCount; const void *pPushConstantRanges;
+} VkPipelineLayoutCreateInfo;
+
+typedef struct {
+    uint32_t sType; const void *pNext; uint32_t flags; uint32_t stage;
+    VkShaderModule module; const char *pName; const void *pSpecializationInfo;
+} VkPipelineShaderStageCreateInfo;
+
+typedef struct {
+    uint32_t sType; const void *pNext; uint32_t flags; VkPipelineShaderStageCreateInfo stage;
+    VkPipelineLayout layout; VkPipeline basePipelineHandle; int32_t basePipelineIndex;
+} VkComputePipelineCreateInfo;
+
+typedef struct { uint32_t type; uint32_t descriptorCount; } VkDescriptorPoolSize;
+typedef struct { uint32_t sType; const void *pNext; uint32_t flags; uint32_t maxSets; uint32_t poolSizeCount; const VkDescriptorPoolSize *pPoolSizes; } VkDescriptorPoolCreateInfo;
+typedef struct { uint32_t sType; const void *pNext; VkDescriptorPool descriptorPool; uint32_t descriptorSetCount; const VkDescriptorSetLayout *pSetLayouts; } VkDescriptorSetAllocateInfo;
+typedef struct { VkBuffer buffer; VkDeviceSize offset; VkDeviceSize range; } VkDescriptorBufferInfo;
+
+typedef struct {
+    uint32_t sType; const void *pNext; VkDescriptorSet dstSet; uint32_t dstBinding; uint32_t dstArrayElement;
+    uint32_t descriptorCount; uint32_t descriptorType; const void *pImageInfo;
+    const VkDescriptorBufferInfo *pBufferInfo; const void *pTexelBufferView;
+} VkWriteDescriptorSet;
+
+typedef PFN_vkVoidFunction (*PFN_vkGetDeviceProcAddr)(VkDevice, const char*);
+typedef VkResult (*PFN_vkCreateImage)(VkDevice, const VkImageCreateInfo*, const void*, VkImage*);
+typedef void (*PFN_vkDestroyImage)(VkDevice, VkImage, const void*);
+typedef void (*PFN_vkGetImageMemoryRequirements)(VkDevice, VkImage, VkMemoryRequirements*);
+typedef VkResult (*PFN_vkBindImageMemory)(VkDevice, VkImage, VkDeviceMemory, VkDeviceSize);
+typedef VkResult (*PFN_vkInvalidateMappedMemoryRanges)(VkDevice, uint32_t, const VkMappedMemoryRange*);
+typedef VkResult (*PFN_vkAllocateCommandBuffers)(VkDevice, const VkCommandBufferAllocateInfo*, VkCommandBuffer*);
+typedef VkResult (*PFN_vkBeginCommandBuffer)(VkCommandBuffer, const VkCommandBufferBeginInfo*);
+typedef VkResult (*PFN_vkEndCommandBuffer)(VkCommandBuffer);
+typedef VkResult (*PFN_vkResetCommandBuffer)(VkCommandBuffer, uint32_t);
+typedef VkResult (*PFN_vkQueueSubmit)(VkQueue, uint32_t, const VkSubmitInfo*, VkFence);
+typedef VkResult (*PFN_vkCreateFence)(VkDevice, const VkFenceCreateInfo*, const void*, VkFence*);
+typedef void (*PFN_vkDestroyFence)(VkDevice, VkFence, const void*);
+typedef VkResult (*PFN_vkWaitForFences)(VkDevice, uint32_t, const VkFence*, VkBool32, uint64_t);
+typedef VkResult (*PFN_vkResetFences)(VkDevice, uint32_t, const VkFence*);
+typedef VkResult (*PFN_vkGetFenceFdKHR)(VkDevice, const VkFenceGetFdInfoKHR*, int*);
+typedef VkResult (*PFN_vkGetMemoryFdPropertiesKHR)(VkDevice, uint32_t, int, VkMemoryFdPropertiesKHR*);
+typedef void (*PFN_vkCmdPipelineBarrier)(VkCommandBuffer, uint32_t, uint32_t, uint32_t, uint32_t, const VkMemoryBarrier*,
+                                         uint32_t, const void*, uint32_t, const VkImageMemoryBarrier*);
+typedef void (*PFN_vkCmdBlitImage)(VkCommandBuffer, VkImage, uint32_t, VkImage, uint32_t, uint32_t, const VkImageBlit*, uint32_t);
+typedef void (*PFN_vkCmdFillBuffer)(VkCommandBuffer, VkBuffer, VkDeviceSize, VkDeviceSize, uint32_t);
+typedef void (*PFN_vkCmdBindPipeline)(VkCommandBuffer, uint32_t, VkPipeline);
+typedef void (*PFN_vkCmdBindDescriptorSets)(VkCommandBuffer, uint32_t, VkPipelineLayout, uint32_t, uint32_t,
+                                            const VkDescriptorSet*, uint32_t, const uint32_t*);
+typedef void (*PFN_vkCmdDispatch)(VkCommandBuffer, uint32_t, uint32_t, uint32_t);
+typedef VkResult (*PFN_vkCreateShaderModule)(VkDevice, const VkShaderModuleCreateInfo*, const void*, VkShaderModule*);
+typedef void (*PFN_vkDestroyShaderModule)(VkDevice, VkShaderModule, const void*);
+typedef VkResult (*PFN_vkCreateDescriptorSetLayout)(VkDevice, const VkDescriptorSetLayoutCreateInfo*, const void*, VkDescriptorSetLayout*);
+typedef void (*PFN_vkDestroyDescriptorSetLayout)(VkDevice, VkDescriptorSetLayout, const void*);
+typedef VkResult (*PFN_vkCreatePipelineLayout)(VkDevice, const VkPipelineLayoutCreateInfo*, const void*, VkPipelineLayout*);
+typedef void (*PFN_vkDestroyPipelineLayout)(VkDevice, VkPipelineLayout, const void*);
+typedef VkResult (*PFN_vkCreateComputePipelines)(VkDevice, VkPipelineCache, uint32_t, const VkComputePipelineCreateInfo*, const void*, VkPipeline*);
+typedef void (*PFN_vkDestroyPipeline)(VkDevice, VkPipeline, const void*);
+typedef VkResult (*PFN_vkCreateDescriptorPool)(VkDevice, const VkDescriptorPoolCreateInfo*, const void*, VkDescriptorPool*);
+typedef void (*PFN_vkDestroyDescriptorPool)(VkDevice, VkDescriptorPool, const void*);
+typedef VkResult (*PFN_vkAllocateDescriptorSets)(VkDevice, const VkDescriptorSetAllocateInfo*, VkDescriptorSet*);
+typedef void (*PFN_vkUpdateDescriptorSets)(VkDevice, uint32_t, const VkWriteDescriptorSet*, uint32_t, const void*);
+
+/* DRM PRIME / AddFB2 (raw ioctls, like test_drm_kms) */
+struct drm_prime_handle { uint32_t handle; uint32_t flags; int32_t fd; };
+struct drm_mode_fb_cmd2 {
+    uint32_t fb_id, width, height, pixel_format, flags;
+    uint32_t handles[4], pitches[4], offsets[4];
+    uint64_t modifier[4];
+};
+#define DRM_IOCTL_PRIME_HANDLE_TO_FD _IOWR('d', 0x2d, struct drm_prime_handle)
+#define DRM_IOCTL_MODE_RMFB          _IOWR('d', 0xAF, unsigned int)
+#define DRM_IOCTL_MODE_ADDFB2        _IOWR('d', 0xB8, struct drm_mode_fb_cmd2)
+#define DRM_FORMAT_XRGB8888 0x34325258
+
+/*
+ * Nearest-neighbour 320x240 -> 1280x720 scale over two storage buffers, the
+ * compute counterpart of the blit below. Hand-assembled SPIR-V 1.0 of:
+ *
+ *   layout(local_size_x = 8, local_size_y = 8) in;
+ *   layout(binding = 0) readonly buffer Src { uint s[]; };
+ *   layout(binding = 1) writeonly buffer Dst { uint d[]; };
+ *   void main() {
+ *       uvec2 p = gl_GlobalInvocationID.xy;
+ *       d[p.y * 1280u + p.x] = s[(p.y / 3u) * 320u + p.x / 4u];
+ *   }
+ */
+static const uint32_t k_scale_spv[] = {
+    0x07230203, 0x00010000, 0x00000000, 0x00000020, 0x00000000, 0x00020011,
+    0x00000001, 0x0003000e, 0x00000000, 0x00000001, 0x0006000f, 0x00000005,
+    0x00000012, 0x6e69616d, 0x00000000, 0x00000006, 0x00060010, 0x00000012,
+    0x00000011, 0x00000008, 0x00000008, 0x00000001, 0x00040047, 0x00000006,
+    0x0000000b, 0x0000001c, 0x00040047, 0x00000007, 0x00000006, 0x00000004,
+    0x00050048, 0x00000008, 0x00000000, 0x00000023, 0x00000000, 0x00030047,
+    0x00000008, 0x00000003, 0x00040047, 0x0000000a, 0x00000022, 0x00000000,
+    0x00040047, 0x0000000a, 0x00000021, 0x00000000, 0x00040047, 0x0000000b,
+    0x00000022, 0x00000000, 0x00040047, 0x0000000b, 0x00000021, 0x00000001,
+    0x00020013, 0x00000001, 0x00030021, 0x00000002, 0x00000001, 0x00040015,
+    0x00000003, 0x00000020, 0x00000000, 0x00040017, 0x00000004, 0x00000003,
+    0x00000003, 0x00040020, 0x00000005, 0x00000001, 0x00000004, 0x0004003b,
+    0x00000005, 0x00000006, 0x00000001, 0x0003001d, 0x00000007, 0x00000003,
+    0x0003001e, 0x00000008, 0x00000007, 0x00040020, 0x00000009, 0x00000002,
+    0x00000008, 0x0004003b, 0x00000009, 0x0000000a, 0x00000002, 0x0004003b,
+    0x00000009, 0x0000000b, 0x00000002, 0x00040020, 0x0000000c, 0x00000002,
+    0x00000003, 0x0004002b, 0x00000003, 0x0000000d, 0x00000000, 0x0004002b,
+    0x00000003, 0x0000000e, 0x00000003, 0x0004002b, 0x00000003, 0x0000000f,
+    0x00000004, 0x0004002b, 0x00000003, 0x00000010, 0x00000140, 0x0004002b,
+    0x00000003, 0x00000011, 0x00000500, 0x00050036, 0x00000001, 0x00000012,
+    0x00000000, 0x00000002, 0x000200f8, 0x00000013, 0x0004003d, 0x00000004,
+    0x00000014, 0x00000006, 0x00050051, 0x00000003, 0x00000015, 0x00000014,
+    0x00000000, 0x00050051, 0x00000003, 0x00000016, 0x00000014, 0x00000001,
+    0x00050086, 0x00000003, 0x00000017, 0x00000015, 0x0000000f, 0x00050086,
+    0x00000003, 0x00000018, 0x00000016, 0x0000000e, 0x00050084, 0x00000003,
+    0x00000019, 0x00000018, 0x00000010, 0x00050080, 0x00000003, 0x0000001a,
+    0x00000019, 0x00000017, 0x00050084, 0x00000003, 0x0000001b, 0x00000016,
+    0x00000011, 0x00050080, 0x00000003, 0x0000001c, 0x0000001b, 0x00000015,
+    0x00060041, 0x0000000c, 0x0000001d, 0x0000000a, 0x0000000d, 0x0000001a,
+    0x0004003d, 0x00000003, 0x0000001e, 0x0000001d, 0x00060041, 0x0000000c,
+    0x0000001f, 0x0000000b, 0x0000000d, 0x0000001c, 0x0003003e, 0x0000001f,
+    0x0000001e, 0x000100fd, 0x00010038,
+};
+
+#define BENCH_SRC_W 320
+#define BENCH_SRC_H 240
+#define BENCH_DST_W 1280
+#define BENCH_DST_H 720
+#define BENCH_GPU_BATCH 16
+
+struct vkbench {
+    void *lib;
+    VkInstance inst;
+    VkPhysicalDevice phys;
+    VkDevice dev;
+    VkQueue queue;
+    uint32_t qf;
+    VkPhysicalDeviceMemoryProperties mem;
+    VkCommandPool pool;
+    VkCommandBuffer cb[2];
+    VkFence fence;
+    int has_fence_fd, has_dmabuf;
+    int iterations;
+    FILE *json;
+
+    PFN_vkDestroyDevice vkDestroyDevice;
+    PFN_vkDestroyInstance vkDestroyInstance;
+    PFN_vkCreateBuffer vkCreateBuffer;
+    PFN_vkDestroyBuffer vkDestroyBuffer;
+    PFN_vkGetBufferMemoryRequirements vkGetBufferMemoryRequirements;
+    PFN_vkBindBufferMemory vkBindBufferMemory;
+    PFN_vkCreateImage vkCreateImage;
+    PFN_vkDestroyImage vkDestroyImage;
+    PFN_vkGetImageMemoryRequirements vkGetImageMemoryRequirements;
+    PFN_vkBindImageMemory vkBindImageMemory;
+    PFN_vkAllocateMemory vkAllocateMemory;
+    PFN_vkFreeMemory vkFreeMemory;
+    PFN_vkMapMemory vkMapMemory;
+    PFN_vkUnmapMemory vkUnmapMemory;
+    PFN_vkInvalidateMappedMemoryRanges vkInvalidateMappedMemoryRanges;
+    PFN_vkCreateCommandPool vkCreateCommandPool;
+    PFN_vkDestroyCommandPool vkDestroyCommandPool;
+    PFN_vkAllocateCommandBuffers vkAllocateCommandBuffers;
+    PFN_vkBeginCommandBuffer vkBeginCommandBuffer;
+    PFN_vkEndCommandBuffer vkEndCommandBuffer;
+    PFN_vkResetCommandBuffer vkResetCommandBuffer;
+    PFN_vkQueueSubmit vkQueueSubmit;
+    PFN_vkQueueWaitIdle vkQueueWaitIdle;
+    PFN_vkCreateFence vkCreateFence;
+    PFN_vkDestroyFence vkDestroyFence;
+    PFN_vkWaitForFences vkWaitForFences;
+    PFN_vkResetFences vkResetFences;
+    PFN_vkGetFenceFdKHR vkGetFenceFdKHR;
+    PFN_vkGetMemoryFdPropertiesKHR vkGetMemoryFdPropertiesKHR;
+    PFN_vkCmdPipelineBarrier vkCmdPipelineBarrier;
+    PFN_vkCmdBlitImage vkCmdBlitImage;
+    PFN_vkCmdFillBuffer vkCmdFillBuffer;
+    PFN_vkCmdBindPipeline vkCmdBindPipeline;
+    PFN_vkCmdBindDescriptorSets vkCmdBindDescriptorSets;
+    PFN_vkCmdDispatch vkCmdDispatch;
+    PFN_vkCreateShaderModule vkCreateShaderModule;
+    PFN_vkDestroyShaderModule vkDestroyShaderModule;
+    PFN_vkCreateDescriptorSetLayout vkCreateDescriptorSetLayout;
+    PFN_vkDestroyDescriptorSetLayout vkDestroyDescriptorSetLayout;
+    PFN_vkCreatePipelineLayout vkCreatePipelineLayout;
+    PFN_vkDestroyPipelineLayout vkDestroyPipelineLayout;
+    PFN_vkCreateComputePipelines vkCreateComputePipelines;
+    PFN_vkDestroyPipeline vkDestroyPipeline;
+    PFN_vkCreateDescriptorPool vkCreateDescriptorPool;
+    PFN_vkDestroyDescriptorPool vkDestroyDescriptorPool;
+    PFN_vkAllocateDescriptorSets vkAllocateDescriptorSets;
+    PFN_vkUpdateDescriptorSets vkUpdateDescriptorSets;
+};
+
+struct bench_stats { int n; double mean, p50, p90, p99, max; };
+
+static double bench_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Sorts v in place. */
+static struct bench_stats bench_stats_of(double *v, int n) {
+    struct bench_stats s = { n, 0, 0, 0, 0, 0 };
+    if (n <= 0) return s;
+    qsort(v, (size_t)n, sizeof(double), cmp_double);
+    for (int i = 0; i < n; i++) s.mean += v[i];
+    s.mean /= n;
+    s.p50 = v[(int)(0.50 * (n - 1) + 0.5)];
+    s.p90 = v[(int)(0.90 * (n - 1) + 0.5)];
+    s.p99 = v[(int)(0.99 * (n - 1) + 0.5)];
+    s.max = v[n - 1];
+    return s;
+}
+
+static void json_stats(FILE *f, const char *key, const struct bench_stats *s) {
+    fprintf(f, "\"%s\":{\"n\":%d,\"mean\":%.2f,\"p50\":%.2f,\"p90\":%.2f,\"p99\":%.2f,\"max\":%.2f}",
+            key, s->n, s->mean, s->p50, s->p90, s->p99, s->max);
+}
+
+static int find_mem_type(const struct vkbench *b, uint32_t type_bits, uint32_t required, uint32_t forbidden) {
+    for (uint32_t i = 0; i < b->mem.memoryTypeCount; i++) {
+        uint32_t flags = b->mem.memoryTypes[i].propertyFlags;
+        if ((type_bits & (1u << i)) && (flags & required) == required && !(flags & forbidden))
+            return (int)i;
+    }
+    return -1;
+}
+
+static VkResult bench_create_buffer(struct vkbench *b, VkDeviceSize size, uint32_t usage,
+                                    uint32_t required, uint32_t forbidden,
+                                    VkBuffer *buf, VkDeviceMemory *mem, int *type_index) {
+    VkBufferCreateInfo ci = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO, NULL, 0, size, usage, 0, 0, NULL };
+    VkResult r = b->vkCreateBuffer(b->dev, &ci, NULL, buf);
+    if (r != VK_SUCCESS) return r;
+
+    VkMemoryRequirements req;
+    b->vkGetBufferMemoryRequirements(b->dev, *buf, &req);
+    int type = find_mem_type(b, req.memoryTypeBits, required, forbidden);
+    if (type < 0) {
+        b->vkDestroyBuffer(b->dev, *buf, NULL);
+        *buf = NULL;
+        return -1; /* VK_ERROR_OUT_OF_HOST_MEMORY stands in for "no such memory type" */
+    }
+    VkMemoryAllocateInfo ai = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL, req.size, (uint32_t)type };
+    r = b->vkAllocateMemory(b->dev, &ai, NULL, mem);
+    if (r == VK_SUCCESS) r = b->vkBindBufferMemory(b->dev, *buf, *mem, 0);
+    if (r != VK_SUCCESS) {
+        if (*mem) b->vkFreeMemory(b->dev, *mem, NULL);
+        b->vkDestroyBuffer(b->dev, *buf, NULL);
+        *buf = NULL; *mem = NULL;
+        return r;
+    }
+    if (type_index) *type_index = type;
+    return VK_SUCCESS;
+}
+
+static VkResult bench_create_image(struct vkbench *b, uint32_t w, uint32_t h, uint32_t usage,
+                                   VkImage *img, VkDeviceMemory *mem) {
+    VkImageCreateInfo ci = {0};
+    ci.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    ci.imageType = VK_IMAGE_TYPE_2D;
+    ci.format = VK_FORMAT_R8G8B8A8_UNORM;
+    ci.extent.width = w; ci.extent.height = h; ci.extent.depth = 1;
+    ci.mipLevels = 1;
+    ci.arrayLayers = 1;
+    ci.samples = VK_SAMPLE_COUNT_1_BIT;
+    ci.tiling = VK_IMAGE_TILING_OPTIMAL;
+    ci.usage = usage;
+    ci.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkResult r = b->vkCreateImage(b->dev, &ci, NULL, img);
+    if (r != VK_SUCCESS) return r;
+
+    VkMemoryRequirements req;
+    b->vkGetImageMemoryRequirements(b->dev, *img, &req);
+    int type = find_mem_type(b, req.memoryTypeBits, 0, 0);
+    VkMemoryAllocateInfo ai = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL, req.size, (uint32_t)type };
+    r = type < 0 ? -1 : b->vkAllocateMemory(b->dev, &ai, NULL, mem);
+    if (r == VK_SUCCESS) r = b->vkBindImageMemory(b->dev, *img, *mem, 0);
+    if (r != VK_SUCCESS) {
+        if (*mem) b->vkFreeMemory(b->dev, *mem, NULL);
+        b->vkDestroyImage(b->dev, *img, NULL);
+        *img = NULL; *mem = NULL;
+    }
+    return r;
+}
+
+static void bench_begin(struct vkbench *b, VkCommandBuffer cb) {
+    VkCommandBufferBeginInfo bi = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL, 0, NULL };
+    b->vkResetCommandBuffer(cb, 0);
+    b->vkBeginCommandBuffer(cb, &bi);
+}
+
+/* Submit one command buffer (or none) and wait for the fence; returns wall us or -1. */
+static double bench_submit_wait(struct vkbench *b, VkCommandBuffer cb) {
+    VkSubmitInfo si = { VK_STRUCTURE_TYPE_SUBMIT_INFO, NULL, 0, NULL, NULL, cb ? 1u : 0u, cb ? &cb : NULL, 0, NULL };
+    double t0 = bench_now_us();
+    if (b->vkQueueSubmit(b->queue, 1, &si, b->fence) != VK_SUCCESS) return -1;
+    VkResult r = b->vkWaitForFences(b->dev, 1, &b->fence, 1, 1000000000ull);
+    double t1 = bench_now_us();
+    b->vkResetFences(b->dev, 1, &b->fence);
+    return r == VK_SUCCESS ? t1 - t0 : -1;
+}
+
+static void bench_memory_barrier(struct vkbench *b, VkCommandBuffer cb, uint32_t src_stage, uint32_t src_access,
+                                  uint32_t dst_stage, uint32_t dst_access) {
+    VkMemoryBarrier mb = { VK_STRUCTURE_TYPE_MEMORY_BARRIER, NULL, src_access, dst_access };
+    b->vkCmdPipelineBarrier(cb, src_stage, dst_stage, 0, 1, &mb, 0, NULL, 0, NULL);
+}
+
+/* Time `batches` submits of cb[1] (BENCH_GPU_BATCH ops) and cb[0] (one op); per-op us. */
+static void bench_time_gpu_op(struct vkbench *b, const char *key, int batches) {
+    double *batch = calloc((size_t)batches, sizeof(double));
+    double *single = calloc((size_t)batches, sizeof(double));
+    int nb = 0, ns = 0;
+    bench_submit_wait(b, b->cb[1]); /* warm-up */
+    for (int i = 0; i < batches; i++) {
+        double t = bench_submit_wait(b, b->cb[1]);
+        if (t >= 0) batch[nb++] = t / BENCH_GPU_BATCH;
+        t = bench_submit_wait(b, b->cb[0]);
+        if (t >= 0) single[ns++] = t;
+    }
+    struct bench_stats sb = bench_stats_of(batch, nb);
+    struct bench_stats ss = bench_stats_of(single, ns);
+    fprintf(b->json, ",\"%s\":{\"status\":\"ok\",\"batch\":%d,", key, BENCH_GPU_BATCH);
+    json_stats(b->json, "per_op_us", &sb);
+    fprintf(b->json, ",");
+    json_stats(b->json, "single_submit_us", &ss);
+    fprintf(b->json, ",\"dst_mpix_per_s\":%.1f}", sb.p50 > 0 ? (double)BENCH_DST_W * BENCH_DST_H / sb.p50 : 0.0);
+    fprintf(stderr, "  [INFO] %s: %.1f us/op batched (p50), %.1f us single submit (p50)\n", key, sb.p50, ss.p50);
+    free(batch);
+    free(single);
+}
+
+static void bench_status(struct vkbench *b, const char *key, const char *status, const char *why, VkResult r) {
+    fprintf(b->json, ",\"%s\":{\"status\":\"%s\",\"error\":\"%s\",\"result\":%d}", key, status, why, r);
+    RESULT_INFO("%s: %s (%s, result=%d)", key, status, why, r);
+}
+
+static void bench_submit(struct vkbench *b) {
+    int n = b->iterations;
+    double *submit = calloc((size_t)n, sizeof(double));
+    double *roundtrip = calloc((size_t)n, sizeof(double));
+    int ns = 0, nr = 0;
+
+    bench_begin(b, b->cb[0]);
+    b->vkEndCommandBuffer(b->cb[0]);
+    VkSubmitInfo si = { VK_STRUCTURE_TYPE_SUBMIT_INFO, NULL, 0, NULL, NULL, 1, &b->cb[0], 0, NULL };
+
+    for (int i = 0; i < n; i++) {
+        double t0 = bench_now_us();
+        if (b->vkQueueSubmit(b->queue, 1, &si, b->fence) != VK_SUCCESS) break;
+        double t1 = bench_now_us();
+        VkResult r = b->vkWaitForFences(b->dev, 1, &b->fence, 1, 1000000000ull);
+        double t2 = bench_now_us();
+        b->vkResetFences(b->dev, 1, &b->fence);
+        submit[ns++] = t1 - t0;
+        if (r == VK_SUCCESS) roundtrip[nr++] = t2 - t0;
+    }
+
+    struct bench_stats s = bench_stats_of(submit, ns);
+    struct bench_stats f = bench_stats_of(roundtrip, nr);
+    fprintf(b->json, ",\"submit\":{");
+    json_stats(b->json, "empty_submit_us", &s);
+    fprintf(b->json, ",");
+    json_stats(b->json, "fence_roundtrip_us", &f);
+    fprintf(b->json, "}");
+    RESULT_INFO("submit: %.1f us/call, fence round trip %.1f us (p50)", s.p50, f.p50);
+    free(submit);
+    free(roundtrip);
+}
+
+static void bench_sync_file(struct vkbench *b) {
+    if (!b->has_fence_fd || !b->vkGetFenceFdKHR) {
+        bench_status(b, "sync_file", "unsupported", "VK_KHR_external_fence_fd", 0);
+        return;
+    }
+
+    VkExportFenceCreateInfo efci = { VK_STRUCTURE_TYPE_EXPORT_FENCE_CREATE_INFO, NULL, VK_EXTERNAL_FENCE_HANDLE_TYPE_SYNC_FD_BIT };
+    VkFenceCreateInfo fci = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, &efci, 0 };
+    VkFence fence = NULL;
+    VkResult r = b->vkCreateFence(b->dev, &fci, NULL, &fence);
+    if (r != VK_SUCCESS) { bench_status(b, "sync_file", "unsupported", "exportable fence", r); return; }
+
+    int n = b->iterations;
+    double *export_us = calloc((size_t)n, sizeof(double));
+    double *signal_us = calloc((size_t)n, sizeof(double));
+    int ne = 0, nsig = 0;
+    VkSubmitInfo si = { VK_STRUCTURE_TYPE_SUBMIT_INFO, NULL, 0, NULL, NULL, 1, &b->cb[0], 0, NULL };
+
+    for (int i = 0; i < n; i++) {
+        double t0 = bench_now_us();
+        if (b->vkQueueSubmit(b->queue, 1, &si, fence) != VK_SUCCESS) break;
+        VkFenceGetFdInfoKHR gi = { VK_STRUCTURE_TYPE_FENCE_GET_FD_INFO_KHR, NULL, fence, VK_EXTERNAL_FENCE_HANDLE_TYPE_SYNC_FD_BIT };
+        int fd = -1;
+        double t1 = bench_now_us();
+        r = b->vkGetFenceFdKHR(b->dev, &gi, &fd);
+        double t2 = bench_now_us();
+        if (r != VK_SUCCESS) {
+            b->vkWaitForFences(b->dev, 1, &fence, 1, 1000000000ull);
+            break;
+        }
+        export_us[ne++] = t2 - t1;
+
+        /* -1 means "already signalled" per the sync_fd export rules. */
+        if (fd >= 0) {
+            struct pollfd pfd = { .fd = fd, .events = POLLIN };
+            if (poll(&pfd, 1, 1000) == 1) signal_us[nsig++] = bench_now_us() - t0;
+            close(fd);
+        } else {
+            signal_us[nsig++] = t2 - t0;
+        }
+        /* Export has copy transference: the fence is already unsignalled again. */
+        b->vkWaitForFences(b->dev, 1, &fence, 1, 0);
+        b->vkResetFences(b->dev, 1, &fence);
+    }
+
+    struct bench_stats e = bench_stats_of(export_us, ne);
+    struct bench_stats s = bench_stats_of(signal_us, nsig);
+    fprintf(b->json, ",\"sync_file\":{\"status\":\"%s\",", ne ? "ok" : "failed");
+    json_stats(b->json, "export_us", &e);
+    fprintf(b->json, ",");
+    json_stats(b->json, "submit_to_poll_wake_us", &s);
+    fprintf(b->json, "}");
+    RESULT_INFO("sync_file: export %.1f us, submit->poll wake %.1f us (p50)", e.p50, s.p50);
+    b->vkDestroyFence(b->dev, fence, NULL);
+    free(export_us);
+    free(signal_us);
+}
+
+static void bench_blit(struct vkbench *b, int batches) {
+    VkImage src = NULL, dst = NULL;
+    VkDeviceMemory src_mem = NULL, dst_mem = NULL;
+    VkResult r = bench_create_image(b, BENCH_SRC_W, BENCH_SRC_H,
+                                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, &src, &src_mem);
+    if (r == VK_SUCCESS)
+        r = bench_create_image(b, BENCH_DST_W, BENCH_DST_H, VK_IMAGE_USAGE_TRANSFER_DST_BIT, &dst, &dst_mem);
+    if (r != VK_SUCCESS) {
+        bench_status(b, "blit_linear", "failed", "image creation", r);
+        goto out;
+    }
+
+    /* One-time layout transitions */
+    VkImageMemoryBarrier ib[2];
+    memset(ib, 0, sizeof(ib));
+    for (int i = 0; i < 2; i++) {
+        ib[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        ib[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        ib[i].srcQueueFamilyIndex = ib[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        ib[i].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        ib[i].subresourceRange.levelCount = 1;
+        ib[i].subresourceRange.layerCount = 1;
+    }
+    ib[0].image = src; ib[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; ib[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    ib[1].image = dst; ib[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL; ib[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bench_begin(b, b->cb[0]);
+    b->vkCmdPipelineBarrier(b->cb[0], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 2, ib);
+    b->vkEndCommandBuffer(b->cb[0]);
+    bench_submit_wait(b, b->cb[0]);
+
+    VkImageBlit region;
+    memset(&region, 0, sizeof(region));
+    region.srcSubresource.aspectMask = region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.srcSubresource.layerCount = region.dstSubresource.layerCount = 1;
+    region.srcOffsets[1].x = BENCH_SRC_W; region.srcOffsets[1].y = BENCH_SRC_H; region.srcOffsets[1].z = 1;
+    region.dstOffsets[1].x = BENCH_DST_W; region.dstOffsets[1].y = BENCH_DST_H; region.dstOffsets[1].z = 1;
+
+    const uint32_t filters[2] = { VK_FILTER_LINEAR, VK_FILTER_NEAREST };
+    const char *keys[2] = { "blit_linear", "blit_nearest" };
+    for (int f = 0; f < 2; f++) {
+        for (int c = 0; c < 2; c++) {
+            int ops = c ? BENCH_GPU_BATCH : 1;
+            bench_begin(b, b->cb[c]);
+            for (int i = 0; i < ops; i++) {
+                if (i > 0)
+                    bench_memory_barrier(b, b->cb[c], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+                b->vkCmdBlitImage(b->cb[c], src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                  dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, filters[f]);
+            }
+            b->vkEndCommandBuffer(b->cb[c]);
+        }
+        bench_time_gpu_op(b, keys[f], batches);
+    }
+
+out:
+    if (dst) b->vkDestroyImage(b->dev, dst, NULL);
+    if (dst_mem) b->vkFreeMemory(b->dev, dst_mem, NULL);
+    if (src) b->vkDestroyImage(b->dev, src, NULL);
+    if (src_mem) b->vkFreeMemory(b->dev, src_mem, NULL);
+}
+
+static void bench_compute(struct vkbench *b, int batches) {
+    VkBuffer src = NULL, dst = NULL;
+    VkDeviceMemory src_mem = NULL, dst_mem = NULL;
+    VkShaderModule module = NULL;
+    VkDescriptorSetLayout dsl = NULL;
+    VkPipelineLayout layout = NULL;
+    VkPipeline pipeline = NULL;
+    VkDescriptorPool dpool = NULL;
+    VkDescriptorSet set = NULL;
+
+    VkResult r = bench_create_buffer(b, BENCH_SRC_W * BENCH_SRC_H * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                     0, 0, &src, &src_mem, NULL);
+    if (r == VK_SUCCESS)
+        r = bench_create_buffer(b, BENCH_DST_W * BENCH_DST_H * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                0, 0, &dst, &dst_mem, NULL);
+    if (r != VK_SUCCESS) { bench_status(b, "compute_nearest", "failed", "buffer creation", r); goto out; }
+
+    VkShaderModuleCreateInfo smci = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, NULL, 0, sizeof(k_scale_spv), k_scale_spv };
+    r = b->vkCreateShaderModule(b->dev, &smci, NULL, &module);
+    if (r != VK_SUCCESS) { bench_status(b, "compute_nearest", "failed", "shader module", r); goto out; }
+
+    VkDescriptorSetLayoutBinding bindings[2] = {
+        { 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, NULL },
+        { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, NULL },
+    };
+    VkDescriptorSetLayoutCreateInfo dslci = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO, NULL, 0, 2, bindings };
+    r = b->vkCreateDescriptorSetLayout(b->dev, &dslci, NULL, &dsl);
+    VkPipelineLayoutCreateInfo plci = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO, NULL, 0, 1, &dsl, 0, NULL };
+    if (r == VK_SUCCESS) r = b->vkCreatePipelineLayout(b->dev, &plci, NULL, &layout);
+    if (r != VK_SUCCESS) { bench_status(b, "compute_nearest", "failed", "pipeline layout", r); goto out; }
+
+    VkComputePipelineCreateInfo cpci;
+    memset(&cpci, 0, sizeof(cpci));
+    cpci.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    cpci.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    cpci.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    cpci.stage.module = module;
+    cpci.stage.pName = "main";
+    cpci.layout = layout;
+    cpci.basePipelineIndex = -1;
+    double t0 = bench_now_us();
+    r = b->vkCreateComputePipelines(b->dev, NULL, 1, &cpci, NULL, &pipeline);
+    double pipeline_us = bench_now_us() - t0;
+    if (r != VK_SUCCESS) { bench_status(b, "compute_nearest", "failed", "compute pipeline", r); goto out; }
+
+    VkDescriptorPoolSize ps = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 };
+    VkDescriptorPoolCreateInfo dpci = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO, NULL, 0, 1, 1, &ps };
+    r = b->vkCreateDescriptorPool(b->dev, &dpci, NULL, &dpool);
+    VkDescriptorSetAllocateInfo dsai = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, NULL, dpool, 1, &dsl };
+    if (r == VK_SUCCESS) r = b->vkAllocateDescriptorSets(b->dev, &dsai, &set);
+    if (r != VK_SUCCESS) { bench_status(b, "compute_nearest", "failed", "descriptor set", r); goto out; }
+
+    VkDescriptorBufferInfo dbi[2] = { { src, 0, VK_WHOLE_SIZE }, { dst, 0, VK_WHOLE_SIZE } };
+    VkWriteDescriptorSet writes[2];
+    memset(writes, 0, sizeof(writes));
+    for (int i = 0; i < 2; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = set;
+        writes[i].dstBinding = (uint32_t)i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &dbi[i];
+    }
+    b->vkUpdateDescriptorSets(b->dev, 2, writes, 0, NULL);
+
+    for (int c = 0; c < 2; c++) {
+        int ops = c ? BENCH_GPU_BATCH : 1;
+        bench_begin(b, b->cb[c]);
+        b->vkCmdBindPipeline(b->cb[c], VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        b->vkCmdBindDescriptorSets(b->cb[c], VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &set, 0, NULL);
+        for (int i = 0; i < ops; i++) {
+            if (i > 0)
+                bench_memory_barrier(b, b->cb[c], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+            b->vkCmdDispatch(b->cb[c], BENCH_DST_W / 8, BENCH_DST_H / 8, 1);
+        }
+        b->vkEndCommandBuffer(b->cb[c]);
+    }
+    RESULT_INFO("compute pipeline creation: %.0f us", pipeline_us);
+    bench_time_gpu_op(b, "compute_nearest", batches);
+
+out:
+    if (pipeline) b->vkDestroyPipeline(b->dev, pipeline, NULL);
+    if (dpool) b->vkDestroyDescriptorPool(b->dev, dpool, NULL);
+    if (layout) b->vkDestroyPipelineLayout(b->dev, layout, NULL);
+    if (dsl) b->vkDestroyDescriptorSetLayout(b->dev, dsl, NULL);
+    if (module) b->vkDestroyShaderModule(b->dev, module, NULL);
+    if (dst) b->vkDestroyBuffer(b->dev, dst, NULL);
+    if (dst_mem) b->vkFreeMemory(b->dev, dst_mem, NULL);
+    if (src) b->vkDestroyBuffer(b->dev, src, NULL);
+    if (src_mem) b->vkFreeMemory(b->dev, src_mem, NULL);
+}
+
+/*
+ * One scanout-sized DRM dumb buffer per iteration: create, export as dma-buf,
+ * AddFB2 + RmFB, and import into Vulkan as buffer memory (the zero-copy path
+ * the runtime would take instead of mmap + memcpy).
+ */
+static void bench_dmabuf(struct vkbench *b, int iterations) {
+    int drm_fd = open("/dev/dri/card0", O_RDWR | O_CLOEXEC);
+    if (drm_fd < 0) { bench_status(b, "dmabuf", "unsupported", "open /dev/dri/card0", errno); return; }
+
+    double *create_us = calloc((size_t)iterations, sizeof(double));
+    double *export_us = calloc((size_t)iterations, sizeof(double));
+    double *addfb_us = calloc((size_t)iterations, sizeof(double));
+    double *rmfb_us = calloc((size_t)iterations, sizeof(double));
+    double *import_us = calloc((size_t)iterations, sizeof(double));
+    int nc = 0, ne = 0, na = 0, nr = 0, ni = 0;
+    int addfb_errno = 0;
+    VkResult import_result = VK_SUCCESS;
+
+    for (int i = 0; i < iterations; i++) {
+        struct drm_mode_create_dumb create = { .width = BENCH_DST_W, .height = BENCH_DST_H, .bpp = 32 };
+        double t0 = bench_now_us();
+        if (ioctl(drm_fd, DRM_IOCTL_MODE_CREATE_DUMB, &create) != 0) break;
+        create_us[nc++] = bench_now_us() - t0;
+
+        struct drm_prime_handle prime = { create.handle, O_CLOEXEC | O_RDWR, -1 };
+        t0 = bench_now_us();
+        int exported = ioctl(drm_fd, DRM_IOCTL_PRIME_HANDLE_TO_FD, &prime) == 0;
+        if (exported) export_us[ne++] = bench_now_us() - t0;
+
+        struct drm_mode_fb_cmd2 fb;
+        memset(&fb, 0, sizeof(fb));
+        fb.width = BENCH_DST_W; fb.height = BENCH_DST_H; fb.pixel_format = DRM_FORMAT_XRGB8888;
+        fb.handles[0] = create.handle; fb.pitches[0] = create.pitch;
+        t0 = bench_now_us();
+        if (ioctl(drm_fd, DRM_IOCTL_MODE_ADDFB2, &fb) == 0) {
+            addfb_us[na++] = bench_now_us() - t0;
+            t0 = bench_now_us();
+            ioctl(drm_fd, DRM_IOCTL_MODE_RMFB, &fb.fb_id);
+            rmfb_us[nr++] = bench_now_us() - t0;
+        } else {
+            addfb_errno = errno;
+        }
+
+        if (exported && b->has_dmabuf && b->vkGetMemoryFdPropertiesKHR && import_result == VK_SUCCESS) {
+            VkExternalMemoryBufferCreateInfo ebci = { VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO, NULL,
+                                                      VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT };
+            VkBufferCreateInfo bci = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO, &ebci, 0, create.size,
+                                       VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 0, 0, NULL };
+            VkBuffer buf = NULL;
+            VkDeviceMemory mem = NULL;
+            int import_fd = dup(prime.fd); /* Vulkan owns the fd on success */
+
+            t0 = bench_now_us();
+            VkMemoryFdPropertiesKHR fdp = { VK_STRUCTURE_TYPE_MEMORY_FD_PROPERTIES_KHR, NULL, 0 };
+            VkResult r = b->vkGetMemoryFdPropertiesKHR(b->dev, VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT, import_fd, &fdp);
+            if (r == VK_SUCCESS) r = b->vkCreateBuffer(b->dev, &bci, NULL, &buf);
+            if (r == VK_SUCCESS) {
+                VkMemoryRequirements req;
+                b->vkGetBufferMemoryRequirements(b->dev, buf, &req);
+                int type = find_mem_type(b, req.memoryTypeBits & fdp.memoryTypeBits, 0, 0);
+                VkImportMemoryFdInfoKHR imp = { VK_STRUCTURE_TYPE_IMPORT_MEMORY_FD_INFO_KHR, NULL,
+                                                VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT, import_fd };
+                VkMemoryAllocateInfo ai = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, &imp, req.size, (uint32_t)type };
+                r = (type < 0 || req.size > create.size) ? -1 : b->vkAllocateMemory(b->dev, &ai, NULL, &mem);
+                if (r == VK_SUCCESS) {
+                    import_fd = -1;
+                    r = b->vkBindBufferMemory(b->dev, buf, mem, 0);
+                }
+            }
+            double dt = bench_now_us() - t0;
+            if (r == VK_SUCCESS) import_us[ni++] = dt;
+            else import_result = r;
+            if (buf) b->vkDestroyBuffer(b->dev, buf, NULL);
+            if (mem) b->vkFreeMemory(b->dev, mem, NULL);
+            if (import_fd >= 0) close(import_fd);
+        }
+
+        if (exported) close(prime.fd);
+        struct drm_mode_destroy_dumb destroy = { create.handle };
+        ioctl(drm_fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy);
+    }
+    close(drm_fd);
+
+    struct bench_stats sc = bench_stats_of(create_us, nc);
+    struct bench_stats se = bench_stats_of(export_us, ne);
+    struct bench_stats sa = bench_stats_of(addfb_us, na);
+    struct bench_stats sr = bench_stats_of(rmfb_us, nr);
+    struct bench_stats si = bench_stats_of(import_us, ni);
+    fprintf(b->json, ",\"dmabuf\":{\"status\":\"%s\",\"size\":[%d,%d],", nc ? "ok" : "failed", BENCH_DST_W, BENCH_DST_H);
+    json_stats(b->json, "dumb_create_us", &sc);
+    fprintf(b->json, ",");
+    json_stats(b->json, "prime_export_us", &se);
+    fprintf(b->json, ",");
+    json_stats(b->json, "addfb2_us", &sa);
+    fprintf(b->json, ",");
+    json_stats(b->json, "rmfb_us", &sr);
+    fprintf(b->json, ",\"addfb2_errno\":%d,", addfb_errno);
+    json_stats(b->json, "vk_import_us", &si);
+    fprintf(b->json, ",\"vk_import\":\"%s\",\"vk_import_result\":%d}",
+            !b->has_dmabuf ? "unsupported" : ni ? "ok" : "failed", import_result);
+    RESULT_INFO("dmabuf: create %.0f us, export %.0f us, AddFB2 %.0f us, Vulkan import %.0f us (p50)",
+                sc.p50, se.p50, sa.p50, si.p50);
+
+    free(create_us); free(export_us); free(addfb_us); free(rmfb_us); free(import_us);
+}
+
+/* CPU read bandwidth after a GPU write, per host-visible memory class. */
+static void bench_readback(struct vkbench *b, int iterations) {
+    const VkDeviceSize size = (VkDeviceSize)BENCH_DST_W * BENCH_DST_H * 4;
+    const struct { const char *name; uint32_t required, forbidden; } classes[2] = {
+        { "cached", VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, 0 },
+        { "uncached", VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT },
+    };
+    uint8_t *dst = malloc((size_t)size);
+    double *mbps = calloc((size_t)iterations, sizeof(double));
+    unsigned sink = 0;
+
+    fprintf(b->json, ",\"readback\":[");
+    for (int c = 0; c < 2; c++) {
+        VkBuffer buf = NULL;
+        VkDeviceMemory mem = NULL;
+        int type = -1;
+        void *map = NULL;
+        fprintf(b->json, "%s{\"memory\":\"%s\"", c ? "," : "", classes[c].name);
+        VkResult r = bench_create_buffer(b, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                         classes[c].required, classes[c].forbidden, &buf, &mem, &type);
+        if (r == VK_SUCCESS) r = b->vkMapMemory(b->dev, mem, 0, VK_WHOLE_SIZE, 0, &map);
+        if (r != VK_SUCCESS || !dst || !mbps) {
+            fprintf(b->json, ",\"status\":\"unsupported\",\"result\":%d}", r);
+            RESULT_INFO("readback %s: no such memory type (result=%d)", classes[c].name, r);
+            if (buf) b->vkDestroyBuffer(b->dev, buf, NULL);
+            if (mem) b->vkFreeMemory(b->dev, mem, NULL);
+            continue;
+        }
+        uint32_t flags = b->mem.memoryTypes[type].propertyFlags;
+
+        bench_begin(b, b->cb[0]);
+        b->vkCmdFillBuffer(b->cb[0], buf, 0, VK_WHOLE_SIZE, 0x80402010u);
+        bench_memory_barrier(b, b->cb[0], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                             VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+        b->vkEndCommandBuffer(b->cb[0]);
+
+        int n = 0;
+        for (int i = 0; i < iterations; i++) {
+            if (bench_submit_wait(b, b->cb[0]) < 0) break;
+            double t0 = bench_now_us();
+            if (!(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+                VkMappedMemoryRange range = { VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, NULL, mem, 0, VK_WHOLE_SIZE };
+                b->vkInvalidateMappedMemoryRanges(b->dev, 1, &range);
+            }
+            memcpy(dst, map, (size_t)size);
+            double dt = bench_now_us() - t0;
+            sink += dst[(size_t)i * 4099 % (size_t)size];
+            if (dt > 0) mbps[n++] = (double)size / dt; /* bytes/us == MB/s */
+        }
+        struct bench_stats s = bench_stats_of(mbps, n);
+        fprintf(b->json, ",\"status\":\"ok\",\"type_index\":%d,\"flags\":\"0x%x\",\"coherent\":%s,\"bytes\":%llu,",
+                type, flags, (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) ? "true" : "false",
+                (unsigned long long)size);
+        json_stats(b->json, "mb_per_s", &s);
+        fprintf(b->json, "}");
+        RESULT_INFO("readback %s (type %d, flags 0x%x): %.0f MB/s (p50), %.0f MB/s best",
+                    classes[c].name, type, flags, s.p50, s.max);
+
+        b->vkUnmapMemory(b->dev, mem);
+        b->vkDestroyBuffer(b->dev, buf, NULL);
+        b->vkFreeMemory(b->dev, mem, NULL);
+    }
+    fprintf(b->json, "]");
+    if (sink == 0x12345678u) fprintf(stderr, " "); /* keep the copies observable */
+    free(mbps);
+    free(dst);
+}
+
+static int has_extension(const VkExtensionProperties *exts, uint32_t count, const char *name) {
+    for (uint32_t i = 0; i < count; i++)
+        if (strcmp(exts[i].extensionName, name) == 0) return 1;
+    return 0;
+}
+
+static int vkbench_init(struct vkbench *b) {
+    b->lib = dlopen("libvulkan.so.1", RTLD_NOW);
+    if (!b->lib) b->lib = dlopen("libvulkan.so", RTLD_NOW);
+    if (!b->lib) b->lib = dlopen("libmali.so", RTLD_NOW);
+    if (!b->lib) { RESULT_FAIL("Cannot load Vulkan library"); return -1; }
+
+    PFN_vkGetInstanceProcAddr getProc = (PFN_vkGetInstanceProcAddr)dlsym(b->lib, "vkGetInstanceProcAddr");
+    if (!getProc) { RESULT_FAIL("vkGetInstanceProcAddr not found"); return -1; }
+    PFN_vkCreateInstance vkCreateInstance = (PFN_vkCreateInstance)getProc(NULL, "vkCreateInstance");
+    PFN_vkEnumerateInstanceExtensionProperties vkEnumInstExt =
+        (PFN_vkEnumerateInstanceExtensionProperties)getProc(NULL, "vkEnumerateInstanceExtensionProperties");
+
+    uint32_t iextCount = 0;
+    vkEnumInstExt(NULL, &iextCount, NULL);
+    VkExtensionProperties *iexts = calloc(iextCount ? iextCount : 1, sizeof(VkExtensionProperties));
+    vkEnumInstExt(NULL, &iextCount, iexts);
+    const char *inst_wanted[] = {
+        "VK_KHR_get_physical_device_properties2",
+        "VK_KHR_external_memory_capabilities",
+        "VK_KHR_external_fence_capabilities",
+    };
+    const char *inst_exts[3];
+    uint32_t inst_ext_count = 0;
+    for (int i = 0; i < 3; i++)
+        if (has_extension(iexts, iextCount, inst_wanted[i])) inst_exts[inst_ext_count++] = inst_wanted[i];
+    free(iexts);
+
+    VkApplicationInfo app = { VK_STRUCTURE_TYPE_APPLICATION_INFO, NULL, "gpu_probe", 1, "gpu_probe", 1, VK_API_VERSION_1_1 };
+    VkInstanceCreateInfo ici = {0};
+    ici.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    ici.pApplicationInfo = &app;
+    ici.enabledExtensionCount = inst_ext_count;
+    ici.ppEnabledExtensionNames = inst_exts;
+    VkResult r = vkCreateInstance(&ici, NULL, &b->inst);
+    if (r != VK_SUCCESS) {
+        /* 1.0-only loader/driver */
+        app.apiVersion = 0;
+        r = vkCreateInstance(&ici, NULL, &b->inst);
+    }
+    if (r != VK_SUCCESS) { RESULT_FAIL("vkCreateInstance: %d", r); return -1; }
+    b->vkDestroyInstance = (PFN_vkDestroyInstance)getProc(b->inst, "vkDestroyInstance");
+
+    PFN_vkEnumeratePhysicalDevices vkEnumDevs = (PFN_vkEnumeratePhysicalDevices)getProc(b->inst, "vkEnumeratePhysicalDevices");
+    PFN_vkGetPhysicalDeviceProperties vkGetProps = (PFN_vkGetPhysicalDeviceProperties)getProc(b->inst, "vkGetPhysicalDeviceProperties");
+    PFN_vkGetPhysicalDeviceQueueFamilyProperties vkGetQFP = (PFN_vkGetPhysicalDeviceQueueFamilyProperties)getProc(b->inst, "vkGetPhysicalDeviceQueueFamilyProperties");
+    PFN_vkGetPhysicalDeviceMemoryProperties vkGetMemProps = (PFN_vkGetPhysicalDeviceMemoryProperties)getProc(b->inst, "vkGetPhysicalDeviceMemoryProperties");
+    PFN_vkEnumerateDeviceExtensionProperties vkEnumDevExt = (PFN_vkEnumerateDeviceExtensionProperties)getProc(b->inst, "vkEnumerateDeviceExtensionProperties");
+    PFN_vkCreateDevice vkCreateDevice = (PFN_vkCreateDevice)getProc(b->inst, "vkCreateDevice");
+    PFN_vkGetDeviceProcAddr getDevProc = (PFN_vkGetDeviceProcAddr)getProc(b->inst, "vkGetDeviceProcAddr");
+    PFN_vkGetDeviceQueue vkGetDeviceQueue = (PFN_vkGetDeviceQueue)getProc(b->inst, "vkGetDeviceQueue");
+
+    uint32_t devCount = 1;
+    if (vkEnumDevs(b->inst, &devCount, &b->phys) < 0 || devCount == 0) { RESULT_FAIL("No physical devices"); return -1; }
+
+    VkPhysicalDeviceProperties props;
+    vkGetProps(b->phys, &props);
+    vkGetMemProps(b->phys, &b->mem);
+
+    uint32_t qfCount = 16;
+    VkQueueFamilyProperties qfProps[16];
+    vkGetQFP(b->phys, &qfCount, qfProps);
+    int qf = -1;
+    for (uint32_t i = 0; i < qfCount && qf < 0; i++)
+        if ((qfProps[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+            qf = (int)i;
+    if (qf < 0) { RESULT_FAIL("No graphics+compute queue family"); return -1; }
+    b->qf = (uint32_t)qf;
+
+    uint32_t extCount = 0;
+    vkEnumDevExt(b->phys, NULL, &extCount, NULL);
+    VkExtensionProperties *exts = calloc(extCount ? extCount : 1, sizeof(VkExtensionProperties));
+    vkEnumDevExt(b->phys, NULL, &extCount, exts);
+    const char *dev_wanted[] = {
+        "VK_KHR_external_memory", "VK_KHR_external_memory_fd", "VK_EXT_external_memory_dma_buf",
+        "VK_KHR_external_fence", "VK_KHR_external_fence_fd",
+    };
+    const char *dev_exts[5];
+    uint32_t dev_ext_count = 0;
+    for (int i = 0; i < 5; i++)
+        if (has_extension(exts, extCount, dev_wanted[i])) dev_exts[dev_ext_count++] = dev_wanted[i];
+    b->has_dmabuf = has_extension(exts, extCount, "VK_KHR_external_memory_fd") &&
+                    has_extension(exts, extCount, "VK_EXT_external_memory_dma_buf");
+    b->has_fence_fd = has_extension(exts, extCount, "VK_KHR_external_fence_fd");
+    free(exts);
+
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo dqci = { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO, NULL, 0, b->qf, 1, &priority };
+    VkDeviceCreateInfo dci = {0};
+    dci.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    dci.queueCreateInfoCount = 1;
+    dci.pQueueCreateInfos = &dqci;
+    dci.enabledExtensionCount = dev_ext_count;
+    dci.ppEnabledExtensionNames = dev_exts;
+    r = vkCreateDevice(b->phys, &dci, NULL, &b->dev);
+    if (r != VK_SUCCESS) { RESULT_FAIL("vkCreateDevice: %d", r); return -1; }
+    vkGetDeviceQueue(b->dev, b->qf, 0, &b->queue);
+
+    /* Device-level entry points skip the loader trampoline, as the runtime does. */
+#define VKB_LOAD(name) b->name = (PFN_##name)getDevProc(b->dev, #name)
+    VKB_LOAD(vkDestroyDevice);
+    VKB_LOAD(vkCreateBuffer); VKB_LOAD(vkDestroyBuffer); VKB_LOAD(vkGetBufferMemoryRequirements); VKB_LOAD(vkBindBufferMemory);
+    VKB_LOAD(vkCreateImage); VKB_LOAD(vkDestroyImage); VKB_LOAD(vkGetImageMemoryRequirements); VKB_LOAD(vkBindImageMemory);
+    VKB_LOAD(vkAllocateMemory); VKB_LOAD(vkFreeMemory); VKB_LOAD(vkMapMemory); VKB_LOAD(vkUnmapMemory);
+    VKB_LOAD(vkInvalidateMappedMemoryRanges);
+    VKB_LOAD(vkCreateCommandPool); VKB_LOAD(vkDestroyCommandPool); VKB_LOAD(vkAllocateCommandBuffers);
+    VKB_LOAD(vkBeginCommandBuffer); VKB_LOAD(vkEndCommandBuffer); VKB_LOAD(vkResetCommandBuffer);
+    VKB_LOAD(vkQueueSubmit); VKB_LOAD(vkQueueWaitIdle);
+    VKB_LOAD(vkCreateFence); VKB_LOAD(vkDestroyFence); VKB_LOAD(vkWaitForFences); VKB_LOAD(vkResetFences);
+    VKB_LOAD(vkGetFenceFdKHR); VKB_LOAD(vkGetMemoryFdPropertiesKHR);
+    VKB_LOAD(vkCmdPipelineBarrier); VKB_LOAD(vkCmdBlitImage); VKB_LOAD(vkCmdFillBuffer);
+    VKB_LOAD(vkCmdBindPipeline); VKB_LOAD(vkCmdBindDescriptorSets); VKB_LOAD(vkCmdDispatch);
+    VKB_LOAD(vkCreateShaderModule); VKB_LOAD(vkDestroyShaderModule);
+    VKB_LOAD(vkCreateDescriptorSetLayout); VKB_LOAD(vkDestroyDescriptorSetLayout);
+    VKB_LOAD(vkCreatePipelineLayout); VKB_LOAD(vkDestroyPipelineLayout);
+    VKB_LOAD(vkCreateComputePipelines); VKB_LOAD(vkDestroyPipeline);
+    VKB_LOAD(vkCreateDescriptorPool); VKB_LOAD(vkDestroyDescriptorPool);
+    VKB_LOAD(vkAllocateDescriptorSets); VKB_LOAD(vkUpdateDescriptorSets);
+#undef VKB_LOAD
+
+    struct { uint32_t sType; const void *pNext; uint32_t flags; uint32_t queueFamilyIndex; } cpci = {
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO, NULL, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, b->qf
+    };
+    r = b->vkCreateCommandPool(b->dev, &cpci, NULL, &b->pool);
+    VkCommandBufferAllocateInfo cbai = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, NULL, b->pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 2 };
+    if (r == VK_SUCCESS) r = b->vkAllocateCommandBuffers(b->dev, &cbai, b->cb);
+    VkFenceCreateInfo fci = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, NULL, 0 };
+    if (r == VK_SUCCESS) r = b->vkCreateFence(b->dev, &fci, NULL, &b->fence);
+    if (r != VK_SUCCESS) { RESULT_FAIL("command pool/buffers/fence: %d", r); return -1; }
+
+    RESULT_PASS("Benchmark device: %s, queue family %u, dma-buf import=%s, sync_fd export=%s",
+                props.deviceName, b->qf, b->has_dmabuf ? "yes" : "no", b->has_fence_fd ? "yes" : "no");
+    fprintf(b->json, "{\"device\":{\"name\":\"%s\",\"api_version\":\"%u.%u.%u\",\"driver_version\":%u,"
+            "\"queue_family\":%u,\"dmabuf_import\":%s,\"sync_fd_export\":%s},\"iterations\":%d",
+            props.deviceName, (props.apiVersion >> 22) & 0x3ff, (props.apiVersion >> 12) & 0x3ff,
+            props.apiVersion & 0xfff, props.driverVersion, b->qf,
+            b->has_dmabuf ? "true" : "false", b->has_fence_fd ? "true" : "false", b->iterations);
+    return 0;
+}
+
+static void vkbench_cleanup(struct vkbench *b) {
+    if (b->dev) {
+        if (b->vkQueueWaitIdle) b->vkQueueWaitIdle(b->queue);
+        if (b->fence) b->vkDestroyFence(b->dev, b->fence, NULL);
+        if (b->pool) b->vkDestroyCommandPool(b->dev, b->pool, NULL);
+        b->vkDestroyDevice(b->dev, NULL);
+    }
+    if (b->inst && b->vkDestroyInstance) b->vkDestroyInstance(b->inst, NULL);
+    if (b->lib) dlclose(b->lib);
+}
+
+static int run_vk_microbench(int iterations, const char *json_path) {
+    TEST_SECTION("VULKAN MICROBENCHMARKS");
+
+    struct vkbench b;
+    memset(&b, 0, sizeof(b));
+    b.iterations = iterations;
+    b.json = stdout;
+    if (json_path && !(b.json = fopen(json_path, "w"))) {
+        RESULT_FAIL("Cannot open %s", json_path);
+        return 1;
+    }
+
+    int ok = vkbench_init(&b) == 0;
+    if (ok) {
+        int batches = iterations / 5 < 5 ? 5 : iterations / 5;
+        bench_submit(&b);
+        bench_sync_file(&b);
+        bench_blit(&b, batches);
+        bench_compute(&b, batches);
+        bench_dmabuf(&b, batches);
+        bench_readback(&b, batches);
+        fprintf(b.json, "}\n");
+    }
+    vkbench_cleanup(&b);
+    if (b.json != stdout) fclose(b.json);
+    return ok ? 0 : 1;
+}
+
+
 /* ===== Main ===== */
 int main(int argc, char **argv) {
     int skip_display_test = 0;
     int skip_headless_caps = 0;
+    int bench = 0;
+    int bench_iterations = 100;
+    const char *json_path = NULL;
 
     /* Allow skipping crashy tests */
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--skip-display") == 0) skip_display_test = 1;
         if (strcmp(argv[i], "--skip-headless-caps") == 0) skip_headless_caps = 1;
         if (strcmp(argv[i], "--safe") == 0) { skip_display_test = 1; skip_headless_caps = 1; }
+        if (strcmp(argv[i], "--bench") == 0) bench = 1;
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) bench_iterations = atoi(argv[++i]);
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_path = argv[++i];
         if (strcmp(argv[i], "--help") == 0) {
-            fprintf(stderr, "Usage: %s [--skip-display] [--skip-headless-caps] [--safe]\n", argv[0]);
+            fprintf(stderr, "Usage: %s [--skip-display] [--skip-headless-caps] [--safe] [--bench [--iterations N] [--json FILE]]\n", argv[0]);
             fprintf(stderr, "  --skip-display        Skip VK_KHR_display test (crashes on Mali)\n");
             fprintf(stderr, "  --skip-headless-caps  Skip headless surface caps query (crashes on Mali)\n");
             fprintf(stderr, "  --safe                Skip all tests known to crash on Mali\n");
+            fprintf(stderr, "  --bench               Run Vulkan/DRM microbenchmarks only, JSON to stdout\n");
+            fprintf(stderr, "  --iterations N        Samples for submit/fence timings (default 100, GPU ops N/5)\n");
+            fprintf(stderr, "  --json FILE           Write benchmark JSON to FILE\n");
             return 0;
         }
     }
 
+    if (bench_iterations < 5) bench_iterations = 5;
+    if (bench) return run_vk_microbench(bench_iterations, json_path);
+
     fprintf(stderr, "=== GPU Capabilities Probe for tg5050 ===\n");
     fprintf(stderr, "=== Testing all viable rendering + display paths ===\n");
     fflush(stderr);
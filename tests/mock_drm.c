@@ -0,0 +1,545 @@
+/*
+ * Mock libdrm for host validation of the DRM tests
+ *
+ * Simulates one 1280x720@60 connector/encoder/CRTC with a primary and an
+ * overlay plane. Vblanks are derived from CLOCK_MONOTONIC, so flips complete
+ * on the simulated vblank grid: blocking commits and SetPlane sleep until the
+ * next vblank, nonblocking commits and page flips queue one event and return
+ * EBUSY while it is pending. Dumb buffers are mapped through the opened
+ * device, so run the test with --device /dev/zero.
+ *
+ * This checks control flow and output format only; the numbers it produces
+ * say nothing about the tg5050 display engine.
+ *
+ * Build (libdrm headers only, no libdrm.so needed):
+ *   cc $(pkg-config --cflags libdrm) -o drm_plane_scale_test.host \
+ *     drm_plane_scale_test.c mock_drm.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <drm_fourcc.h>
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#define MOCK_REFRESH_HZ 60
+#define MOCK_WIDTH 1280
+#define MOCK_HEIGHT 720
+
+enum {
+    MOCK_CONNECTOR_ID = 30,
+    MOCK_ENCODER_ID = 31,
+    MOCK_CRTC_ID = 40,
+    MOCK_PRIMARY_ID = 50,
+    MOCK_OVERLAY_ID = 51,
+    MOCK_PROP_BASE = 100,
+    MOCK_MAX_FBS = 64,
+};
+
+static const char *k_plane_props[] = {
+    "type", "FB_ID", "CRTC_ID", "CRTC_X", "CRTC_Y", "CRTC_W", "CRTC_H",
+    "SRC_X", "SRC_Y", "SRC_W", "SRC_H"
+};
+#define MOCK_PROP_COUNT (sizeof(k_plane_props) / sizeof(k_plane_props[0]))
+
+static const uint32_t k_mock_formats[] = {
+    DRM_FORMAT_XRGB8888, DRM_FORMAT_XBGR8888, DRM_FORMAT_RGBX8888, DRM_FORMAT_BGRX8888
+};
+
+static struct {
+    int initialized;
+    uint64_t epoch_us;
+    int atomic_cap;
+    uint32_t next_handle;
+    uint32_t fbs[MOCK_MAX_FBS];
+    uint32_t crtc_fb;
+    uint32_t plane_fb[2];
+    /* One queued flip event per CRTC, like the kernel */
+    int flip_pending;
+    unsigned flip_seq;
+    void *flip_data;
+} g_mock;
+
+static uint64_t mock_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void mock_init(void) {
+    if (g_mock.initialized) return;
+    g_mock.initialized = 1;
+    g_mock.epoch_us = mock_now_us();
+    g_mock.next_handle = 1;
+}
+
+static uint64_t mock_period_us(void) {
+    return 1000000ull / MOCK_REFRESH_HZ;
+}
+
+static unsigned mock_current_seq(void) {
+    mock_init();
+    return (unsigned)((mock_now_us() - g_mock.epoch_us) / mock_period_us());
+}
+
+static uint64_t mock_seq_time_us(unsigned seq) {
+    return g_mock.epoch_us + (uint64_t)seq * mock_period_us();
+}
+
+static void mock_sleep_until(uint64_t t_us) {
+    uint64_t now = mock_now_us();
+    if (t_us <= now) return;
+    uint64_t d = t_us - now;
+    struct timespec ts = { .tv_sec = (time_t)(d / 1000000), .tv_nsec = (long)(d % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+/* Block until the next vblank and return its sequence number. */
+static unsigned mock_wait_next_vblank(void) {
+    unsigned seq = mock_current_seq() + 1;
+    mock_sleep_until(mock_seq_time_us(seq));
+    return seq;
+}
+
+static int mock_fb_exists(uint32_t id) {
+    if (id == 0) return 1;
+    for (int i = 0; i < MOCK_MAX_FBS; i++)
+        if (g_mock.fbs[i] == id) return 1;
+    return 0;
+}
+
+static int mock_fb_add(uint32_t *id) {
+    static uint32_t next_id = 200;
+    for (int i = 0; i < MOCK_MAX_FBS; i++) {
+        if (!g_mock.fbs[i]) {
+            g_mock.fbs[i] = *id = next_id++;
+            return 0;
+        }
+    }
+    errno = ENOSPC;
+    return -1;
+}
+
+static int mock_plane_index(uint32_t plane_id) {
+    if (plane_id == MOCK_PRIMARY_ID) return 0;
+    if (plane_id == MOCK_OVERLAY_ID) return 1;
+    return -1;
+}
+
+static void mock_set_plane_fb(int index, uint32_t fb_id) {
+    if (index < 0) return;
+    g_mock.plane_fb[index] = fb_id;
+    if (index == 0) g_mock.crtc_fb = fb_id;
+}
+
+/* ------------------------------------------------------------------ */
+/* Core                                                               */
+/* ------------------------------------------------------------------ */
+
+int drmIoctl(int fd, unsigned long request, void *arg) {
+    (void)fd;
+    mock_init();
+    if (request == DRM_IOCTL_MODE_CREATE_DUMB) {
+        struct drm_mode_create_dumb *c = arg;
+        c->handle = g_mock.next_handle++;
+        c->pitch = c->width * ((c->bpp + 7) / 8);
+        c->size = (uint64_t)c->pitch * c->height;
+        return 0;
+    }
+    if (request == DRM_IOCTL_MODE_MAP_DUMB) {
+        struct drm_mode_map_dumb *m = arg;
+        m->offset = 0;
+        return 0;
+    }
+    if (request == DRM_IOCTL_MODE_DESTROY_DUMB)
+        return 0;
+    errno = ENOTTY;
+    return -1;
+}
+
+int drmSetMaster(int fd) { (void)fd; return 0; }
+int drmDropMaster(int fd) { (void)fd; return 0; }
+
+int drmSetClientCap(int fd, uint64_t cap, uint64_t value) {
+    (void)fd;
+    if (cap == DRM_CLIENT_CAP_ATOMIC) g_mock.atomic_cap = value != 0;
+    return 0;
+}
+
+int drmPrimeHandleToFD(int fd, uint32_t handle, uint32_t flags, int *prime_fd) {
+    (void)fd; (void)handle; (void)flags;
+    *prime_fd = -1;
+    errno = ENOSYS;
+    return -1;
+}
+
+int drmWaitVBlank(int fd, drmVBlank *vbl) {
+    (void)fd;
+    unsigned seq = mock_current_seq();
+    if (vbl->request.type & DRM_VBLANK_RELATIVE)
+        seq += vbl->request.sequence;
+    else if (vbl->request.sequence > seq)
+        seq = vbl->request.sequence;
+    mock_sleep_until(mock_seq_time_us(seq));
+
+    uint64_t t = mock_seq_time_us(seq);
+    vbl->reply.sequence = seq;
+    vbl->reply.tval_sec = (long)(t / 1000000);
+    vbl->reply.tval_usec = (long)(t % 1000000);
+    return 0;
+}
+
+int drmHandleEvent(int fd, drmEventContext *evctx) {
+    if (!g_mock.flip_pending) return 0;
+    mock_sleep_until(mock_seq_time_us(g_mock.flip_seq));
+    g_mock.flip_pending = 0;
+
+    uint64_t t = mock_seq_time_us(g_mock.flip_seq);
+    if (evctx->version >= 3 && evctx->page_flip_handler2)
+        evctx->page_flip_handler2(fd, g_mock.flip_seq, (unsigned)(t / 1000000),
+                                  (unsigned)(t % 1000000), MOCK_CRTC_ID, g_mock.flip_data);
+    else if (evctx->page_flip_handler)
+        evctx->page_flip_handler(fd, g_mock.flip_seq, (unsigned)(t / 1000000),
+                                 (unsigned)(t % 1000000), g_mock.flip_data);
+    return 0;
+}
+
+/* Queue a flip event for the next vblank, or fail with EBUSY. */
+static int mock_queue_flip(void *data) {
+    if (g_mock.flip_pending && mock_current_seq() < g_mock.flip_seq) {
+        errno = EBUSY;
+        return -1;
+    }
+    g_mock.flip_pending = 1;
+    g_mock.flip_seq = mock_current_seq() + 1;
+    g_mock.flip_data = data;
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Mode objects                                                       */
+/* ------------------------------------------------------------------ */
+
+static void mock_fill_mode(drmModeModeInfo *m) {
+    memset(m, 0, sizeof(*m));
+    m->clock = 74250;
+    m->hdisplay = MOCK_WIDTH;
+    m->hsync_start = 1390;
+    m->hsync_end = 1430;
+    m->htotal = 1650;
+    m->vdisplay = MOCK_HEIGHT;
+    m->vsync_start = 725;
+    m->vsync_end = 730;
+    m->vtotal = 750;
+    m->vrefresh = MOCK_REFRESH_HZ;
+    m->type = DRM_MODE_TYPE_PREFERRED;
+    snprintf(m->name, sizeof(m->name), "%ux%u", MOCK_WIDTH, MOCK_HEIGHT);
+}
+
+static uint32_t *mock_ids(uint32_t id) {
+    uint32_t *ids = malloc(sizeof(uint32_t));
+    if (ids) ids[0] = id;
+    return ids;
+}
+
+drmModeRes *drmModeGetResources(int fd) {
+    (void)fd;
+    mock_init();
+    drmModeRes *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->count_connectors = 1;
+    r->connectors = mock_ids(MOCK_CONNECTOR_ID);
+    r->count_encoders = 1;
+    r->encoders = mock_ids(MOCK_ENCODER_ID);
+    r->count_crtcs = 1;
+    r->crtcs = mock_ids(MOCK_CRTC_ID);
+    return r;
+}
+
+void drmModeFreeResources(drmModeRes *r) {
+    if (!r) return;
+    free(r->connectors);
+    free(r->encoders);
+    free(r->crtcs);
+    free(r->fbs);
+    free(r);
+}
+
+drmModeConnector *drmModeGetConnector(int fd, uint32_t id) {
+    (void)fd;
+    if (id != MOCK_CONNECTOR_ID) { errno = ENOENT; return NULL; }
+    drmModeConnector *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->connector_id = id;
+    c->encoder_id = MOCK_ENCODER_ID;
+    c->connection = DRM_MODE_CONNECTED;
+    c->count_modes = 1;
+    c->modes = calloc(1, sizeof(drmModeModeInfo));
+    if (c->modes) mock_fill_mode(c->modes);
+    c->count_encoders = 1;
+    c->encoders = mock_ids(MOCK_ENCODER_ID);
+    return c;
+}
+
+void drmModeFreeConnector(drmModeConnector *c) {
+    if (!c) return;
+    free(c->modes);
+    free(c->encoders);
+    free(c);
+}
+
+drmModeEncoder *drmModeGetEncoder(int fd, uint32_t id) {
+    (void)fd;
+    if (id != MOCK_ENCODER_ID) { errno = ENOENT; return NULL; }
+    drmModeEncoder *e = calloc(1, sizeof(*e));
+    if (!e) return NULL;
+    e->encoder_id = id;
+    e->crtc_id = MOCK_CRTC_ID;
+    e->possible_crtcs = 1;
+    return e;
+}
+
+void drmModeFreeEncoder(drmModeEncoder *e) { free(e); }
+
+drmModeCrtc *drmModeGetCrtc(int fd, uint32_t id) {
+    (void)fd;
+    if (id != MOCK_CRTC_ID) { errno = ENOENT; return NULL; }
+    drmModeCrtc *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->crtc_id = id;
+    c->buffer_id = g_mock.crtc_fb;
+    c->width = MOCK_WIDTH;
+    c->height = MOCK_HEIGHT;
+    c->mode_valid = 1;
+    mock_fill_mode(&c->mode);
+    return c;
+}
+
+void drmModeFreeCrtc(drmModeCrtc *c) { free(c); }
+
+drmModePlaneRes *drmModeGetPlaneResources(int fd) {
+    (void)fd;
+    drmModePlaneRes *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->count_planes = 2;
+    r->planes = malloc(2 * sizeof(uint32_t));
+    if (r->planes) {
+        r->planes[0] = MOCK_PRIMARY_ID;
+        r->planes[1] = MOCK_OVERLAY_ID;
+    }
+    return r;
+}
+
+void drmModeFreePlaneResources(drmModePlaneRes *r) {
+    if (!r) return;
+    free(r->planes);
+    free(r);
+}
+
+drmModePlane *drmModeGetPlane(int fd, uint32_t id) {
+    (void)fd;
+    int index = mock_plane_index(id);
+    if (index < 0) { errno = ENOENT; return NULL; }
+    drmModePlane *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    p->plane_id = id;
+    p->possible_crtcs = 1;
+    p->fb_id = g_mock.plane_fb[index];
+    p->crtc_id = p->fb_id ? MOCK_CRTC_ID : 0;
+    p->count_formats = sizeof(k_mock_formats) / sizeof(k_mock_formats[0]);
+    p->formats = malloc(sizeof(k_mock_formats));
+    if (p->formats) memcpy(p->formats, k_mock_formats, sizeof(k_mock_formats));
+    return p;
+}
+
+void drmModeFreePlane(drmModePlane *p) {
+    if (!p) return;
+    free(p->formats);
+    free(p);
+}
+
+drmModeObjectProperties *drmModeObjectGetProperties(int fd, uint32_t id, uint32_t type) {
+    (void)fd;
+    int index = mock_plane_index(id);
+    if (type != DRM_MODE_OBJECT_PLANE || index < 0) { errno = ENOENT; return NULL; }
+    drmModeObjectProperties *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    p->count_props = MOCK_PROP_COUNT;
+    p->props = calloc(MOCK_PROP_COUNT, sizeof(uint32_t));
+    p->prop_values = calloc(MOCK_PROP_COUNT, sizeof(uint64_t));
+    if (!p->props || !p->prop_values) {
+        drmModeFreeObjectProperties(p);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < MOCK_PROP_COUNT; i++)
+        p->props[i] = MOCK_PROP_BASE + i;
+    /* DRM_PLANE_TYPE_OVERLAY=0, PRIMARY=1 */
+    p->prop_values[0] = index == 0 ? 1 : 0;
+    p->prop_values[1] = g_mock.plane_fb[index];
+    return p;
+}
+
+void drmModeFreeObjectProperties(drmModeObjectProperties *p) {
+    if (!p) return;
+    free(p->props);
+    free(p->prop_values);
+    free(p);
+}
+
+drmModePropertyRes *drmModeGetProperty(int fd, uint32_t id) {
+    (void)fd;
+    if (id < MOCK_PROP_BASE || id >= MOCK_PROP_BASE + MOCK_PROP_COUNT) { errno = ENOENT; return NULL; }
+    drmModePropertyRes *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    p->prop_id = id;
+    snprintf(p->name, sizeof(p->name), "%s", k_plane_props[id - MOCK_PROP_BASE]);
+    return p;
+}
+
+void drmModeFreeProperty(drmModePropertyRes *p) { free(p); }
+
+/* ------------------------------------------------------------------ */
+/* Framebuffers and scanout                                           */
+/* ------------------------------------------------------------------ */
+
+int drmModeAddFB(int fd, uint32_t w, uint32_t h, uint8_t depth, uint8_t bpp,
+                 uint32_t pitch, uint32_t handle, uint32_t *id) {
+    (void)fd; (void)depth; (void)handle;
+    if (!w || !h || pitch < w * (bpp / 8u)) { errno = EINVAL; return -1; }
+    return mock_fb_add(id);
+}
+
+int drmModeAddFB2(int fd, uint32_t w, uint32_t h, uint32_t format, const uint32_t handles[4],
+                  const uint32_t pitches[4], const uint32_t offsets[4], uint32_t *id, uint32_t flags) {
+    (void)fd; (void)handles; (void)offsets; (void)flags;
+    int known = 0;
+    for (size_t i = 0; i < sizeof(k_mock_formats) / sizeof(k_mock_formats[0]); i++)
+        if (k_mock_formats[i] == format) known = 1;
+    if (!known || !w || !h || pitches[0] < w * 4) { errno = EINVAL; return -1; }
+    return mock_fb_add(id);
+}
+
+int drmModeRmFB(int fd, uint32_t id) {
+    (void)fd;
+    for (int i = 0; i < MOCK_MAX_FBS; i++) {
+        if (g_mock.fbs[i] == id) {
+            g_mock.fbs[i] = 0;
+            return 0;
+        }
+    }
+    errno = ENOENT;
+    return -1;
+}
+
+int drmModeSetCrtc(int fd, uint32_t crtc_id, uint32_t fb_id, uint32_t x, uint32_t y,
+                   uint32_t *connectors, int count, drmModeModeInfo *mode) {
+    (void)fd; (void)x; (void)y; (void)connectors; (void)count; (void)mode;
+    if (crtc_id != MOCK_CRTC_ID || !mock_fb_exists(fb_id)) { errno = EINVAL; return -1; }
+    mock_set_plane_fb(0, fb_id);
+    mock_wait_next_vblank();
+    return 0;
+}
+
+int drmModeSetPlane(int fd, uint32_t plane_id, uint32_t crtc_id, uint32_t fb_id, uint32_t flags,
+                    int32_t crtc_x, int32_t crtc_y, uint32_t crtc_w, uint32_t crtc_h,
+                    uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h) {
+    (void)fd; (void)flags; (void)crtc_x; (void)crtc_y; (void)src_x; (void)src_y;
+    int index = mock_plane_index(plane_id);
+    if (index < 0 || crtc_id != MOCK_CRTC_ID || !mock_fb_exists(fb_id)) { errno = EINVAL; return -1; }
+    if (fb_id && (!crtc_w || !crtc_h || !src_w || !src_h)) { errno = EINVAL; return -1; }
+    /* Legacy SetPlane goes through a blocking atomic commit. */
+    mock_set_plane_fb(index, fb_id);
+    mock_wait_next_vblank();
+    return 0;
+}
+
+int drmModePageFlip(int fd, uint32_t crtc_id, uint32_t fb_id, uint32_t flags, void *data) {
+    (void)fd;
+    if (crtc_id != MOCK_CRTC_ID || !fb_id || !mock_fb_exists(fb_id)) { errno = EINVAL; return -1; }
+    if (flags & DRM_MODE_PAGE_FLIP_EVENT) {
+        if (mock_queue_flip(data) < 0) return -1;
+    }
+    mock_set_plane_fb(0, fb_id);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Atomic                                                             */
+/* ------------------------------------------------------------------ */
+
+struct mock_atomic_item {
+    uint32_t obj, prop;
+    uint64_t value;
+};
+
+struct _drmModeAtomicReq {
+    int count, capacity;
+    struct mock_atomic_item *items;
+};
+
+drmModeAtomicReq *drmModeAtomicAlloc(void) {
+    return calloc(1, sizeof(drmModeAtomicReq));
+}
+
+void drmModeAtomicFree(drmModeAtomicReq *req) {
+    if (!req) return;
+    free(req->items);
+    free(req);
+}
+
+int drmModeAtomicAddProperty(drmModeAtomicReq *req, uint32_t obj, uint32_t prop, uint64_t value) {
+    if (!req) { errno = EINVAL; return -1; }
+    if (req->count == req->capacity) {
+        int cap = req->capacity ? req->capacity * 2 : 16;
+        struct mock_atomic_item *items = realloc(req->items, (size_t)cap * sizeof(*items));
+        if (!items) { errno = ENOMEM; return -1; }
+        req->items = items;
+        req->capacity = cap;
+    }
+    req->items[req->count].obj = obj;
+    req->items[req->count].prop = prop;
+    req->items[req->count].value = value;
+    return ++req->count;
+}
+
+int drmModeAtomicCommit(int fd, drmModeAtomicReq *req, uint32_t flags, void *data) {
+    (void)fd;
+    if (!g_mock.atomic_cap || !req) { errno = EINVAL; return -1; }
+
+    /* Validate before touching state, like the kernel's check phase. */
+    const uint32_t fb_prop = MOCK_PROP_BASE + 1;
+    for (int i = 0; i < req->count; i++) {
+        if (mock_plane_index(req->items[i].obj) < 0 ||
+            req->items[i].prop < MOCK_PROP_BASE + 1 ||
+            req->items[i].prop >= MOCK_PROP_BASE + MOCK_PROP_COUNT) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (req->items[i].prop == fb_prop && !mock_fb_exists((uint32_t)req->items[i].value)) {
+            errno = ENOENT;
+            return -1;
+        }
+    }
+    if (flags & DRM_MODE_ATOMIC_TEST_ONLY) return 0;
+
+    if (flags & DRM_MODE_ATOMIC_NONBLOCK) {
+        if ((flags & DRM_MODE_PAGE_FLIP_EVENT) ? mock_queue_flip(data) < 0
+                                                : (g_mock.flip_pending && mock_current_seq() < g_mock.flip_seq)) {
+            errno = EBUSY;
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < req->count; i++)
+        if (req->items[i].prop == fb_prop)
+            mock_set_plane_fb(mock_plane_index(req->items[i].obj), (uint32_t)req->items[i].value);
+
+    if (!(flags & DRM_MODE_ATOMIC_NONBLOCK))
+        mock_wait_next_vblank();
+    return 0;
+}
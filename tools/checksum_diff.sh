@@ -0,0 +1,77 @@
+#!/bin/bash
+# Compare per-frame scanout checksums ([checksum] lines, G64_FRAME_CHECKSUM)
+# from two runs of the same replay, e.g. before and after a performance
+# change. Frames are matched by frame index; frames present in only one
+# run (frame skip, different run length) are counted but not compared.
+# Prints the first mismatching frame and exits 1 if any frame differs.
+#
+# Usage: tools/checksum_diff.sh [--skip N] <baseline.txt> <candidate.txt>
+#   --skip N   ignore frames with index below N (boot, intro, default 0)
+set -euo pipefail
+
+SKIP=0
+if [ "${1:-}" = "--skip" ]; then
+	SKIP="$2"
+	shift 2
+fi
+
+if [ "$#" -ne 2 ]; then
+	echo "Usage: $0 [--skip N] <baseline.txt> <candidate.txt>" >&2
+	exit 1
+fi
+
+awk -v skip="$SKIP" '
+	function field(name,    i) {
+		for (i = 2; i <= NF; i++)
+			if (index($i, name "=") == 1)
+				return substr($i, length(name) + 2)
+		return ""
+	}
+	FNR == 1 { file++ }
+	!/^\[checksum\] frame=/ { next }
+	{
+		frame = field("frame") + 0
+		if (frame < skip)
+			next
+		value = field("size") " " field("fnv")
+		if (file == 1) {
+			base[frame] = value
+			base_path[frame] = field("path")
+			n_base++
+			next
+		}
+		n_cand++
+		if (!(frame in base)) {
+			only_cand++
+			next
+		}
+		seen[frame] = 1
+		compared++
+		if (base[frame] != value) {
+			mismatches++
+			if (first == "" || frame < first + 0) {
+				first = frame
+				first_base = base[frame] " (" base_path[frame] ")"
+				first_cand = value " (" field("path") ")"
+			}
+		}
+	}
+	END {
+		for (f in base)
+			if (!(f in seen))
+				only_base++
+		printf "frames: baseline=%d candidate=%d compared=%d only_baseline=%d only_candidate=%d\n",
+			n_base, n_cand, compared, only_base, only_cand
+		if (compared == 0) {
+			print "No common frames to compare" > "/dev/stderr"
+			exit 2
+		}
+		if (mismatches == 0) {
+			print "All compared frames match"
+			exit 0
+		}
+		printf "mismatches: %d (%.1f%%)\n", mismatches, 100.0 * mismatches / compared
+		printf "first mismatch: frame %d\n  baseline:  %s\n  candidate: %s\n", first, first_base, first_cand
+		exit 1
+	}
+' "$1" "$2"
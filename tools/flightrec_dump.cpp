@@ -0,0 +1,169 @@
+/*
+ * Decode a gopher64 flight recorder ring (G64_FLIGHT_RECORDER)
+ *
+ * Prints the header and the surviving records in write order. Frame rows
+ * are tab-separated so they can be pasted into a spreadsheet or piped
+ * through awk. Stack frames print as "module+0xoffset" (resolve with
+ * addr2line -f -C -e <unstripped module> 0xoffset) or "symbol+0xoffset".
+ *
+ * Usage: flightrec_dump [--last-seconds N] <file>
+ */
+
+#include "../patches/flight_recorder.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+static const char *state_name(uint32_t state)
+{
+	switch (state)
+	{
+	case FLIGHT_RECORDER_RUNNING:
+		return "running (no clean exit: hang, SIGKILL or power loss)";
+	case FLIGHT_RECORDER_CLEAN_EXIT:
+		return "clean exit";
+	case FLIGHT_RECORDER_SIGNALED:
+		return "signaled";
+	default:
+		return "unknown";
+	}
+}
+
+static const char *path_name(uint16_t path)
+{
+	const size_t count = sizeof(flight_recorder_path_names) / sizeof(flight_recorder_path_names[0]);
+	return path < count ? flight_recorder_path_names[path] : "unknown";
+}
+
+static const char *stage_name(uint16_t stage)
+{
+	return stage < FLIGHT_STAGES ? flight_recorder_stage_names[stage] : "unknown";
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [--last-seconds N] <flightrec.bin>\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+	double last_seconds = 0.0;
+	const char *file = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--last-seconds") == 0 && i + 1 < argc)
+			last_seconds = atof(argv[++i]);
+		else if (argv[i][0] != '-' && !file)
+			file = argv[i];
+		else
+		{
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (!file)
+	{
+		usage(argv[0]);
+		return 2;
+	}
+
+	FILE *f = fopen(file, "rb");
+	if (!f)
+	{
+		perror(file);
+		return 1;
+	}
+
+	FlightRecorderHeader header = {};
+	if (fread(&header, sizeof(header), 1, f) != 1 ||
+	    memcmp(header.magic, FLIGHT_RECORDER_MAGIC, sizeof(header.magic)) != 0)
+	{
+		fprintf(stderr, "%s: not a flight recorder file\n", file);
+		fclose(f);
+		return 1;
+	}
+	if (header.version != FLIGHT_RECORDER_VERSION || header.record_size != sizeof(FlightRecord))
+	{
+		fprintf(stderr, "%s: unsupported version %u (record size %u)\n",
+		        file, header.version, header.record_size);
+		fclose(f);
+		return 1;
+	}
+
+	std::vector<FlightRecord> records(header.capacity);
+	size_t n = fread(records.data(), sizeof(FlightRecord), records.size(), f);
+	fclose(f);
+	records.resize(n);
+
+	// Slots with seq == 0 were never written or were mid-write at the crash.
+	records.erase(std::remove_if(records.begin(), records.end(),
+	                             [](const FlightRecord &r) { return r.seq == 0; }),
+	              records.end());
+	std::sort(records.begin(), records.end(),
+	          [](const FlightRecord &a, const FlightRecord &b) { return a.seq < b.seq; });
+
+	printf("# pid=%d capacity=%u written=%llu state=%s\n",
+	       header.pid, header.capacity, (unsigned long long)header.write_index, state_name(header.state));
+	if (header.state == FLIGHT_RECORDER_SIGNALED)
+		printf("# last_signal=%d (%s) at t=%.3fs\n", header.last_signal, strsignal(header.last_signal),
+		       double(header.signal_time_us - header.start_monotonic_us) / 1e6);
+	if (records.empty())
+		return 0;
+
+	uint64_t cutoff_us = 0;
+	if (last_seconds > 0.0)
+	{
+		uint64_t window_us = uint64_t(last_seconds * 1e6);
+		uint64_t end_us = records.back().time_us;
+		cutoff_us = end_us > window_us ? end_us - window_us : 0;
+	}
+
+	printf("# t_s\tframe\ttype\tdetails\n");
+	for (const FlightRecord &r : records)
+	{
+		if (r.time_us < cutoff_us)
+			continue;
+
+		double t = double(r.time_us - header.start_monotonic_us) / 1e6;
+		switch (r.type)
+		{
+		case FLIGHT_RECORD_FRAME:
+			printf("%.6f\t%u\tframe\tpath=%s gap=%.2f scanout=%.2f render=%.2f flip=%.2f total=%.2f vblank_wait=%.2f flip_busy=%u\n",
+			       t, r.frame, path_name(r.path),
+			       r.timing.gap_us / 1000.0, r.timing.scanout_us / 1000.0, r.timing.render_us / 1000.0,
+			       r.timing.flip_us / 1000.0, r.timing.total_us / 1000.0, r.timing.vblank_wait_us / 1000.0,
+			       r.timing.flip_busy);
+			break;
+		case FLIGHT_RECORD_CLOCKS:
+			printf("%.6f\t%u\tclocks\tfps=%.2f cpu=%dMHz gpu=%dMHz gpu_util=%d%%\n",
+			       t, r.frame, r.clocks.fps_x100 / 100.0, r.clocks.cpu_mhz, r.clocks.gpu_mhz, r.clocks.gpu_util);
+			break;
+		case FLIGHT_RECORD_EVENT:
+			printf("%.6f\t%u\tevent\t%.*s\n", t, r.frame, int(sizeof(r.text)), r.text);
+			break;
+		case FLIGHT_RECORD_SIGNAL:
+			printf("%.6f\t%u\tsignal\t%d (%s) code=%d addr=0x%llx\n",
+			       t, r.frame, r.signal.signo, strsignal(r.signal.signo), r.signal.code,
+			       (unsigned long long)r.signal.addr);
+			break;
+		case FLIGHT_RECORD_STALL:
+			printf("%.6f\t%u\tstall\telapsed=%.2f threshold=%.2f stage=%s stage_elapsed=%.2f stacks=%u\n",
+			       t, r.frame, r.stall.elapsed_us / 1000.0, r.stall.threshold_us / 1000.0, stage_name(r.path),
+			       r.stall.stage_us / 1000.0, r.stall.threads);
+			break;
+		case FLIGHT_RECORD_STACK:
+			printf("%.6f\t%u\tstack\ttid=%d #%u/%u %.*s+0x%llx\n",
+			       t, r.frame, r.stack.tid, r.stack.depth, r.stack.frames,
+			       int(sizeof(r.stack.where)), r.stack.where, (unsigned long long)r.stack.offset);
+			break;
+		default:
+			printf("%.6f\t%u\ttype%u\n", t, r.frame, r.type);
+			break;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,272 @@
+/*
+ * Offline frame pacing simulator
+ *
+ * Replays the per-frame timings of a flight recorder ring (G64_FLIGHT_RECORDER)
+ * through every pacing policy of patches/frame_pacing.hpp, at 60 Hz and
+ * 50 Hz display refresh, and prints displayed FPS, emulation speed, judder,
+ * dropped/skipped frames and latency per policy.
+ *
+ * Each recorded frame is split into emulation time (the gap to the next
+ * frame minus the frame's own time) and render/present work (its total
+ * minus the vblank waits). Frames the recording skipped share the gap. The
+ * display model is the DRM path: one flip can be queued and latches at the
+ * next vblank; cadence waits and busy flips go through the same decision
+ * functions the runtime uses. Record with the speed limiter off for the
+ * most faithful input: limiter sleeps otherwise count as emulation time.
+ *
+ * Usage: pacing_sim [--vi-hz 60|50] [--cadence N] [--skip N]
+ *                   [--last-seconds N] <flightrec.bin>
+ */
+
+#include "../patches/flight_recorder.hpp"
+#include "../patches/frame_pacing.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+struct ViFrame
+{
+	double emu_us;  // core emulation before the frame is ready to render
+	double work_us; // scanout, render and present work
+};
+
+struct SimResult
+{
+	uint32_t displayed = 0;
+	uint32_t dropped = 0;
+	uint32_t skipped = 0;
+	double duration_us = 0.0;
+	std::vector<double> intervals_us; // between consecutive displayed frames
+	std::vector<double> latency_us;   // emulation start -> latch vblank
+};
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [--vi-hz 60|50] [--cadence N] [--skip N] [--last-seconds N] <flightrec.bin>\n",
+	        argv0);
+}
+
+static bool load_frames(const char *file, double last_seconds, std::vector<FlightRecord> &frames)
+{
+	FILE *f = fopen(file, "rb");
+	if (!f)
+	{
+		perror(file);
+		return false;
+	}
+
+	FlightRecorderHeader header = {};
+	if (fread(&header, sizeof(header), 1, f) != 1 ||
+	    memcmp(header.magic, FLIGHT_RECORDER_MAGIC, sizeof(header.magic)) != 0)
+	{
+		fprintf(stderr, "%s: not a flight recorder file\n", file);
+		fclose(f);
+		return false;
+	}
+	if (header.version != FLIGHT_RECORDER_VERSION || header.record_size != sizeof(FlightRecord))
+	{
+		fprintf(stderr, "%s: unsupported version %u (record size %u)\n",
+		        file, header.version, header.record_size);
+		fclose(f);
+		return false;
+	}
+
+	std::vector<FlightRecord> records(header.capacity);
+	size_t n = fread(records.data(), sizeof(FlightRecord), records.size(), f);
+	fclose(f);
+	records.resize(n);
+
+	for (const FlightRecord &r : records)
+		if (r.seq != 0 && r.type == FLIGHT_RECORD_FRAME)
+			frames.push_back(r);
+	std::sort(frames.begin(), frames.end(),
+	          [](const FlightRecord &a, const FlightRecord &b) { return a.seq < b.seq; });
+
+	if (last_seconds > 0.0 && !frames.empty())
+	{
+		const uint64_t window_us = uint64_t(last_seconds * 1e6);
+		const uint64_t end_us = frames.back().time_us;
+		const uint64_t cutoff_us = end_us > window_us ? end_us - window_us : 0;
+		frames.erase(frames.begin(),
+		             std::find_if(frames.begin(), frames.end(),
+		                          [cutoff_us](const FlightRecord &r) { return r.time_us >= cutoff_us; }));
+	}
+	return true;
+}
+
+// One entry per VI frame. The emulation time between two recorded frames
+// is spread over the VI frames between them.
+static std::vector<ViFrame> build_vi_frames(const std::vector<FlightRecord> &frames)
+{
+	std::vector<ViFrame> out;
+	for (size_t i = 0; i + 1 < frames.size(); i++)
+	{
+		const FlightRecord &r = frames[i];
+		const FlightRecord &next = frames[i + 1];
+		const double total = r.timing.total_us;
+		const double work = std::max(0.0, total - double(r.timing.vblank_wait_us));
+		const double emu = std::max(0.0, double(next.timing.gap_us) - total);
+		const uint32_t span = next.frame > r.frame ? next.frame - r.frame : 1;
+		for (uint32_t k = 0; k < span; k++)
+			out.push_back({ emu / span, work });
+	}
+	return out;
+}
+
+static double next_vblank(double t, double period)
+{
+	return (std::floor(t / period) + 1.0) * period;
+}
+
+static SimResult simulate(const std::vector<ViFrame> &frames, const FramePacingConfig &cfg,
+                          double refresh_hz, double vi_hz)
+{
+	SimResult res;
+	const double period = 1e6 / refresh_hz;
+	const double vi_period = 1e6 / vi_hz;
+	const bool limiter = frame_pacing_core_limiter(cfg);
+
+	double t = 0.0;
+	double pending_latch = -1.0; // latch time of the last queued flip
+	double last_display = -1.0;
+
+	for (size_t j = 0; j < frames.size(); j++)
+	{
+		const double begin = t;
+		t += frames[j].emu_us;
+		if (limiter)
+			t = std::max(t, double(j + 1) * vi_period);
+
+		if (!frame_pacing_render(cfg, uint32_t(j), 0))
+		{
+			res.skipped++;
+			continue;
+		}
+		t += frames[j].work_us;
+
+		if (pending_latch >= 0.0)
+		{
+			// Vblank sequence numbers are vblank indices here.
+			const int32_t since_latch = int32_t(std::floor(t / period) - std::floor(pending_latch / period + 0.5));
+			for (uint32_t n = frame_pacing_flip_waits(cfg, since_latch); n; n--)
+				t = next_vblank(t, period);
+		}
+		if (pending_latch > t)
+		{
+			if (frame_pacing_on_busy(cfg) == FRAME_PACING_DROP)
+			{
+				res.dropped++;
+				continue;
+			}
+			t = pending_latch;
+		}
+
+		const double latch = next_vblank(t, period);
+		pending_latch = latch;
+		res.displayed++;
+		res.latency_us.push_back(latch - begin);
+		if (last_display >= 0.0)
+			res.intervals_us.push_back(latch - last_display);
+		last_display = latch;
+	}
+	res.duration_us = t;
+	return res;
+}
+
+static double mean(const std::vector<double> &v)
+{
+	double sum = 0.0;
+	for (double x : v)
+		sum += x;
+	return v.empty() ? 0.0 : sum / double(v.size());
+}
+
+static double stddev(const std::vector<double> &v)
+{
+	const double m = mean(v);
+	double sum = 0.0;
+	for (double x : v)
+		sum += (x - m) * (x - m);
+	return v.empty() ? 0.0 : std::sqrt(sum / double(v.size()));
+}
+
+static double percentile(std::vector<double> v, double p)
+{
+	if (v.empty())
+		return 0.0;
+	std::sort(v.begin(), v.end());
+	const size_t i = std::min(v.size() - 1, size_t(p * double(v.size() - 1) + 0.5));
+	return v[i];
+}
+
+int main(int argc, char **argv)
+{
+	double last_seconds = 0.0;
+	double vi_hz = 60.0;
+	FramePacingConfig base;
+	const char *file = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--last-seconds") == 0 && i + 1 < argc)
+			last_seconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--vi-hz") == 0 && i + 1 < argc)
+			vi_hz = atof(argv[++i]);
+		else if (strcmp(argv[i], "--cadence") == 0 && i + 1 < argc)
+			base.cadence = uint32_t(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--skip") == 0 && i + 1 < argc)
+			base.skip = uint32_t(atoi(argv[++i]));
+		else if (argv[i][0] != '-' && !file)
+			file = argv[i];
+		else
+		{
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (!file || vi_hz <= 0.0)
+	{
+		usage(argv[0]);
+		return 2;
+	}
+
+	std::vector<FlightRecord> records;
+	if (!load_frames(file, last_seconds, records))
+		return 1;
+	const std::vector<ViFrame> frames = build_vi_frames(records);
+	if (frames.empty())
+	{
+		fprintf(stderr, "%s: fewer than two frame records\n", file);
+		return 1;
+	}
+
+	std::vector<double> work;
+	for (const ViFrame &f : frames)
+		work.push_back(f.work_us);
+	printf("# source=%s recorded_frames=%zu vi_frames=%zu vi=%.0fHz work_ms avg=%.2f p95=%.2f max=%.2f\n",
+	       file, records.size(), frames.size(), vi_hz, mean(work) / 1000.0, percentile(work, 0.95) / 1000.0,
+	       *std::max_element(work.begin(), work.end()) / 1000.0);
+	printf("# refresh\tpolicy\tfps\tspeed%%\tjudder_ms\tdropped\tskipped\tlatency_ms\tlatency_p95_ms\n");
+
+	const double refresh_rates[] = { 60.0, 50.0 };
+	for (double refresh : refresh_rates)
+	{
+		for (int p = 0; p < FRAME_PACING_POLICIES; p++)
+		{
+			FramePacingConfig cfg = base;
+			cfg.policy = FramePacingPolicy(p);
+			const SimResult r = simulate(frames, cfg, refresh, vi_hz);
+			const double seconds = r.duration_us / 1e6;
+			printf("%.0f\t%s\t%.2f\t%.1f\t%.2f\t%u\t%u\t%.2f\t%.2f\n",
+			       refresh, frame_pacing_names[p],
+			       seconds > 0.0 ? double(r.displayed) / seconds : 0.0,
+			       seconds > 0.0 ? 100.0 * double(frames.size()) * (1.0 / vi_hz) / seconds : 0.0,
+			       stddev(r.intervals_us) / 1000.0, r.dropped, r.skipped,
+			       mean(r.latency_us) / 1000.0, percentile(r.latency_us, 0.95) / 1000.0);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,87 @@
+#!/bin/bash
+# Compare [perf] window lines from two gopher64 logs (e.g. baseline vs PGO
+# build, same game and scene). Prints mean FPS and stage times per log and
+# the relative change, plus power and energy per frame when both logs have
+# battery telemetry (discharging windows only).
+#
+# Usage: tools/perf_compare.sh [--skip N] <baseline.txt> <candidate.txt>
+#   --skip N   ignore the first N perf windows of each log (warm-up, default 5)
+set -euo pipefail
+
+SKIP=5
+if [ "${1:-}" = "--skip" ]; then
+	SKIP="$2"
+	shift 2
+fi
+
+if [ "$#" -ne 2 ]; then
+	echo "Usage: $0 [--skip N] <baseline.txt> <candidate.txt>" >&2
+	exit 1
+fi
+
+summarize() {
+	awk -v skip="$SKIP" '
+		/^\[perf\] path=/ {
+			n_seen++
+			if (n_seen <= skip)
+				next
+			for (i = 2; i <= NF; i++) {
+				split($i, kv, "=")
+				key = kv[1]
+				sub(/^stage_ms\(avg /, "", key)
+				val = kv[2]
+				sub(/\)$/, "", val)
+				if (key == "fps" || key == "gap" || key == "total" || key == "max_gap" || key == "max_total")
+					sum[key] += val
+				if (key == "max_total" && val + 0 > worst)
+					worst = val + 0
+				if (key == "power" && val != "charging") {
+					power += val
+					n_power++
+				}
+				if (key == "mj_frame")
+					mj += val
+			}
+			n++
+		}
+		END {
+			if (n == 0) {
+				print "0 0 0 0 0 0 0 0"
+				exit
+			}
+			printf "%d %.3f %.3f %.3f %.3f %.3f %.3f %.3f\n", n, sum["fps"] / n, sum["gap"] / n, sum["total"] / n, sum["max_gap"] / n, worst,
+				n_power ? power / n_power : 0, n_power ? mj / n_power : 0
+		}
+	' "$1"
+}
+
+read -r base_n base_fps base_gap base_total base_max_gap base_worst base_watts base_mj < <(summarize "$1")
+read -r cand_n cand_fps cand_gap cand_total cand_max_gap cand_worst cand_watts cand_mj < <(summarize "$2")
+
+if [ "$base_n" -eq 0 ] || [ "$cand_n" -eq 0 ]; then
+	echo "No [perf] windows found after skipping $SKIP (baseline=$base_n candidate=$cand_n)" >&2
+	exit 1
+fi
+
+awk -v bn="$base_n" -v cn="$cand_n" \
+	-v bf="$base_fps" -v cf="$cand_fps" \
+	-v bg="$base_gap" -v cg="$cand_gap" \
+	-v bt="$base_total" -v ct="$cand_total" \
+	-v bm="$base_max_gap" -v cm="$cand_max_gap" \
+	-v bw="$base_worst" -v cw="$cand_worst" \
+	-v bp="$base_watts" -v cp="$cand_watts" \
+	-v be="$base_mj" -v ce="$cand_mj" '
+	function pct(a, b) { return a == 0 ? 0 : 100.0 * (b - a) / a }
+	BEGIN {
+		printf "%-22s %12s %12s %9s\n", "metric", "baseline", "candidate", "change"
+		printf "%-22s %12d %12d\n", "windows", bn, cn
+		printf "%-22s %12.2f %12.2f %+8.1f%%\n", "fps (mean)", bf, cf, pct(bf, cf)
+		printf "%-22s %12.2f %12.2f %+8.1f%%\n", "frame gap ms (mean)", bg, cg, pct(bg, cg)
+		printf "%-22s %12.2f %12.2f %+8.1f%%\n", "stage total ms (mean)", bt, ct, pct(bt, ct)
+		printf "%-22s %12.2f %12.2f %+8.1f%%\n", "max gap ms (mean)", bm, cm, pct(bm, cm)
+		printf "%-22s %12.2f %12.2f %+8.1f%%\n", "max total ms (worst)", bw, cw, pct(bw, cw)
+		if (bp > 0 && cp > 0) {
+			printf "%-22s %12.2f %12.2f %+8.1f%%\n", "power W (mean)", bp, cp, pct(bp, cp)
+			printf "%-22s %12.1f %12.1f %+8.1f%%\n", "energy mJ/frame (mean)", be, ce, pct(be, ce)
+		}
+	}'